@@ -0,0 +1,1042 @@
+//*****************************************
+// A* Search on Grid Maps
+//  Copyright (c) Rylogic Ltd 2026
+//*****************************************
+#pragma once
+#include <span>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <execution>
+#include <type_traits>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+#include <cassert>
+
+namespace pr::algorithm::astar::grid
+{
+	// Notes:
+	//  - A specialisation of A* for 2D occupancy grids. See 'astar_search.h' for the general graph version.
+	//  - Moves are 8-connected with costs 1 and sqrt(2). Diagonal moves are only allowed when both adjacent
+	//    orthogonal cells are passable (i.e. no corner cutting). The heuristic is the octile distance.
+	//  - Per-cell search data is stored in flat arrays. A generation counter marks which entries belong to the
+	//    current search so that the arrays don't need clearing between searches.
+	//  - 'Hierarchy' is an HPA* style abstraction. The grid is divided into square clusters with entrances on
+	//    the cluster borders. Paths are found on the abstract graph then refined within each cluster. The paths
+	//    are near-optimal rather than optimal.
+
+	using cost_t = float;
+	inline constexpr cost_t CostMax = std::numeric_limits<cost_t>::infinity();
+	inline constexpr cost_t DiagonalCost = 1.41421356237f;
+
+	// Concept for an execution policy (e.g. std::execution::par)
+	template <typename T> concept ExecutionPolicy = std::is_execution_policy_v<std::remove_cvref_t<T>>;
+
+	// Methods for grid searches
+	enum class EMethod
+	{
+		AStar,     // Plain A* over all neighbours
+		JumpPoint, // Jump Point Search. Optimal on uniform cost grids and expands far fewer nodes.
+	};
+
+	// A grid cell coordinate
+	struct Cell
+	{
+		int x, y;
+		friend bool operator == (Cell lhs, Cell rhs) = default;
+	};
+
+	// A rectangular region of cells: [x0,x1) x [y0,y1)
+	struct Region
+	{
+		int x0, y0, x1, y1;
+
+		int width() const
+		{
+			return x1 - x0;
+		}
+		int height() const
+		{
+			return y1 - y0;
+		}
+		bool contains(int x, int y) const
+		{
+			return x >= x0 && x < x1 && y >= y0 && y < y1;
+		}
+		bool contains(Cell c) const
+		{
+			return contains(c.x, c.y);
+		}
+	};
+
+	// Occupancy grid. Non-zero cells are blocked.
+	struct Grid
+	{
+		int m_width;
+		int m_height;
+		std::vector<uint8_t> m_cells;
+
+		Grid(int width, int height)
+			: m_width(width)
+			, m_height(height)
+			, m_cells(static_cast<size_t>(width) * height)
+		{}
+
+		// The full extent of the grid
+		Region Bounds() const
+		{
+			return Region{ 0, 0, m_width, m_height };
+		}
+
+		// True if the cell at (x,y) can be moved through
+		bool Passable(int x, int y) const
+		{
+			return x >= 0 && x < m_width && y >= 0 && y < m_height && m_cells[static_cast<size_t>(y) * m_width + x] == 0;
+		}
+		bool Passable(Cell c) const
+		{
+			return Passable(c.x, c.y);
+		}
+
+		// Set the blocked state of a cell. Call 'Hierarchy::Invalidate' after changing cells that are used by a hierarchy.
+		void Set(Cell c, bool blocked)
+		{
+			assert(Bounds().contains(c));
+			m_cells[static_cast<size_t>(c.y) * m_width + c.x] = blocked ? 1 : 0;
+		}
+	};
+
+	// The octile distance between two cells. Admissible and consistent for 8-connected grids.
+	inline cost_t Octile(Cell a, Cell b)
+	{
+		auto dx = std::abs(a.x - b.x);
+		auto dy = std::abs(a.y - b.y);
+		return static_cast<cost_t>(std::max(dx, dy)) + (DiagonalCost - 1) * static_cast<cost_t>(std::min(dx, dy));
+	}
+
+	// Append the cells from 'a' (exclusive) to 'b' (inclusive) to 'path'. 'a' and 'b' must be joined by an octile line.
+	inline void AppendLine(Cell a, Cell b, std::vector<Cell>& path)
+	{
+		for (; a != b;)
+		{
+			a.x += (b.x > a.x) - (b.x < a.x);
+			a.y += (b.y > a.y) - (b.y < a.y);
+			path.push_back(a);
+		}
+	}
+
+	// Working data for searches within a region of a grid. Reuse instances between searches to avoid allocations.
+	// Not thread safe, use one instance per thread.
+	class Search
+	{
+		// Used in the open heap
+		struct Open
+		{
+			cost_t total_cost;
+			int index;
+		};
+
+		Grid const* m_grid;
+		Region m_region;
+		Cell m_goal;
+		int m_goal_index;
+		std::vector<cost_t> m_cost;    // Cost to reach each cell
+		std::vector<int> m_parent;     // Index of the predecessor of each cell
+		std::vector<uint32_t> m_stamp; // == m_generation if the cell has been seen, == m_generation + 1 if closed
+		std::vector<Open> m_open;      // Min heap of cells to explore
+		uint32_t m_generation;
+		size_t m_expanded;
+
+	public:
+
+		Search()
+			: m_grid()
+			, m_region()
+			, m_goal()
+			, m_goal_index(-1)
+			, m_cost()
+			, m_parent()
+			, m_stamp()
+			, m_open()
+			, m_generation(0)
+			, m_expanded(0)
+		{}
+
+		// The number of cells expanded by the last search
+		size_t Expanded() const
+		{
+			return m_expanded;
+		}
+
+		// Find a path from 'start' to 'goal'. Returns the cost of the path, or 'CostMax' if there is no path.
+		// 'path' receives the cells from 'start' to 'goal' inclusive. The search is restricted to 'region' if given.
+		cost_t FindPath(Grid const& grid, Cell start, Cell goal, std::vector<Cell>& path, EMethod method = EMethod::JumpPoint, Region const* region = nullptr)
+		{
+			path.resize(0);
+			Begin(grid, region ? *region : grid.Bounds());
+			if (!Passable(start.x, start.y) || !Passable(goal.x, goal.y))
+				return CostMax;
+
+			m_goal = goal;
+			m_goal_index = Index(goal.x, goal.y);
+			auto cost = Run(start, method);
+			if (cost == CostMax)
+				return CostMax;
+
+			// Walk back from the goal to the start
+			std::vector<Cell> nodes;
+			for (auto i = m_goal_index; i != -1; i = m_parent[i])
+				nodes.push_back(CellAt(i));
+
+			path.push_back(nodes.back());
+			for (auto i = nodes.size() - 1; i-- != 0;)
+				AppendLine(nodes[i + 1], nodes[i], path);
+
+			return cost;
+		}
+
+		// Find the cost from 'source' to each of 'targets' within 'region'. Unreachable targets are set to 'CostMax'
+		void Flood(Grid const& grid, Cell source, Region const& region, std::span<Cell const> targets, std::span<cost_t> costs)
+		{
+			assert(costs.size() >= targets.size());
+			Begin(grid, region);
+			std::fill(std::begin(costs), std::end(costs), CostMax);
+			if (!Passable(source.x, source.y))
+				return;
+
+			m_goal = source;
+			m_goal_index = -1;
+			Run(source, EMethod::AStar);
+
+			for (size_t i = 0; i != targets.size(); ++i)
+			{
+				if (!m_region.contains(targets[i])) continue;
+				auto idx = Index(targets[i].x, targets[i].y);
+				if (m_stamp[idx] - m_generation > 1) continue;
+				costs[i] = m_cost[idx];
+			}
+		}
+
+	private:
+
+		// Prepare the working data for a search
+		void Begin(Grid const& grid, Region const& region)
+		{
+			m_grid = &grid;
+			m_region = region;
+			m_expanded = 0;
+			m_open.resize(0);
+
+			auto count = static_cast<size_t>(region.width()) * region.height();
+			if (m_stamp.size() < count)
+			{
+				m_cost.resize(count);
+				m_parent.resize(count);
+				m_stamp.resize(count, 0);
+			}
+
+			// Start a new generation, clearing the stamps when the counter wraps
+			m_generation += 2;
+			if (m_generation < 2)
+			{
+				std::fill(std::begin(m_stamp), std::end(m_stamp), 0);
+				m_generation = 2;
+			}
+		}
+
+		// Search from 'start' until the goal is closed or all reachable cells have been expanded.
+		cost_t Run(Cell start, EMethod method)
+		{
+			constexpr auto MinHeap = [](Open const& lhs, Open const& rhs) { return lhs.total_cost > rhs.total_cost; };
+			auto heuristic = m_goal_index != -1;
+
+			// Add 'idx' to the open heap if 'cost' is an improvement
+			auto Relax = [&](int idx, int parent, cost_t cost, Cell cell)
+			{
+				if (m_stamp[idx] == m_generation + 1) return;
+				if (m_stamp[idx] == m_generation && !(cost < m_cost[idx])) return;
+				m_stamp[idx] = m_generation;
+				m_cost[idx] = cost;
+				m_parent[idx] = parent;
+				m_open.push_back(Open{ cost + (heuristic ? Octile(cell, m_goal) : cost_t{}), idx });
+				std::push_heap(std::begin(m_open), std::end(m_open), MinHeap);
+			};
+
+			Relax(Index(start.x, start.y), -1, 0, start);
+			for (; !m_open.empty();)
+			{
+				std::pop_heap(std::begin(m_open), std::end(m_open), MinHeap);
+				auto idx = m_open.back().index;
+				m_open.pop_back();
+
+				// Stale heap entry
+				if (m_stamp[idx] != m_generation)
+					continue;
+
+				m_stamp[idx] = m_generation + 1;
+				++m_expanded;
+
+				if (idx == m_goal_index)
+					return m_cost[idx];
+
+				auto cell = CellAt(idx);
+				auto cost = m_cost[idx];
+				switch (method)
+				{
+					case EMethod::AStar:
+					{
+						for (int dy = -1; dy <= 1; ++dy)
+						{
+							for (int dx = -1; dx <= 1; ++dx)
+							{
+								if ((dx == 0 && dy == 0) || !CanStep(cell.x, cell.y, dx, dy))
+									continue;
+
+								Cell next = { cell.x + dx, cell.y + dy };
+								Relax(Index(next.x, next.y), idx, cost + (dx && dy ? DiagonalCost : 1), next);
+							}
+						}
+						break;
+					}
+					case EMethod::JumpPoint:
+					{
+						int dirs[8][2];
+						auto count = PrunedDirections(idx, cell, dirs);
+						for (int i = 0; i != count; ++i)
+						{
+							auto jp = Jump(cell.x + dirs[i][0], cell.y + dirs[i][1], dirs[i][0], dirs[i][1]);
+							if (jp == -1)
+								continue;
+
+							auto next = CellAt(jp);
+							Relax(jp, idx, cost + Octile(cell, next), next);
+						}
+						break;
+					}
+					default:
+					{
+						assert(false && "Unknown search method");
+						return CostMax;
+					}
+				}
+			}
+			return m_goal_index == -1 ? cost_t{} : CostMax;
+		}
+
+		// The directions to search from 'cell' given the direction it was reached from
+		int PrunedDirections(int idx, Cell cell, int (&dirs)[8][2]) const
+		{
+			int count = 0;
+			auto Add = [&](int dx, int dy) { dirs[count][0] = dx; dirs[count][1] = dy; ++count; };
+
+			// The start cell searches in all directions
+			auto parent = m_parent[idx];
+			if (parent == -1)
+			{
+				for (int dy = -1; dy <= 1; ++dy)
+					for (int dx = -1; dx <= 1; ++dx)
+						if ((dx || dy) && CanStep(cell.x, cell.y, dx, dy))
+							Add(dx, dy);
+
+				return count;
+			}
+
+			auto p = CellAt(parent);
+			auto dx = (cell.x > p.x) - (cell.x < p.x);
+			auto dy = (cell.y > p.y) - (cell.y < p.y);
+			if (dx && dy)
+			{
+				// Diagonal: natural neighbours only. Forced neighbours can't occur without corner cutting.
+				auto h = Passable(cell.x + dx, cell.y);
+				auto v = Passable(cell.x, cell.y + dy);
+				if (v) Add(0, dy);
+				if (h) Add(dx, 0);
+				if (h && v) Add(dx, dy);
+			}
+			else if (dx)
+			{
+				// Horizontal: straight on, plus the perpendiculars which may lead around obstacles behind us
+				auto next = Passable(cell.x + dx, cell.y);
+				auto up = Passable(cell.x, cell.y + 1);
+				auto dn = Passable(cell.x, cell.y - 1);
+				if (next)
+				{
+					Add(dx, 0);
+					if (up) Add(dx, +1);
+					if (dn) Add(dx, -1);
+				}
+				if (up) Add(0, +1);
+				if (dn) Add(0, -1);
+			}
+			else
+			{
+				// Vertical: as for horizontal
+				auto next = Passable(cell.x, cell.y + dy);
+				auto rt = Passable(cell.x + 1, cell.y);
+				auto lt = Passable(cell.x - 1, cell.y);
+				if (next)
+				{
+					Add(0, dy);
+					if (rt) Add(+1, dy);
+					if (lt) Add(-1, dy);
+				}
+				if (rt) Add(+1, 0);
+				if (lt) Add(-1, 0);
+			}
+			return count;
+		}
+
+		// Step from (x,y) in direction (dx,dy) until a jump point is found. Returns the cell index of the jump point or -1.
+		int Jump(int x, int y, int dx, int dy) const
+		{
+			for (;;)
+			{
+				if (!Passable(x, y))
+					return -1;
+
+				auto idx = Index(x, y);
+				if (idx == m_goal_index)
+					return idx;
+
+				if (dx && dy)
+				{
+					// A diagonal move is a jump point if either straight component leads to a jump point
+					if (Jump(x + dx, y, dx, 0) != -1 || Jump(x, y + dy, 0, dy) != -1)
+						return idx;
+
+					// Diagonal moves require both orthogonal neighbours to be passable
+					if (!Passable(x + dx, y) || !Passable(x, y + dy))
+						return -1;
+				}
+				else if (dx)
+				{
+					// Forced neighbour: a perpendicular cell that was blocked behind us has opened up
+					if ((Passable(x, y - 1) && !Passable(x - dx, y - 1)) || (Passable(x, y + 1) && !Passable(x - dx, y + 1)))
+						return idx;
+				}
+				else
+				{
+					if ((Passable(x - 1, y) && !Passable(x - 1, y - dy)) || (Passable(x + 1, y) && !Passable(x + 1, y - dy)))
+						return idx;
+				}
+
+				x += dx;
+				y += dy;
+			}
+		}
+
+		// True if a step from (x,y) in direction (dx,dy) is allowed
+		bool CanStep(int x, int y, int dx, int dy) const
+		{
+			if (!Passable(x + dx, y + dy))
+				return false;
+			if (dx && dy && (!Passable(x + dx, y) || !Passable(x, y + dy)))
+				return false;
+
+			return true;
+		}
+
+		// True if (x,y) is within the search region and not blocked
+		bool Passable(int x, int y) const
+		{
+			return m_region.contains(x, y) && m_grid->Passable(x, y);
+		}
+
+		// Convert between cells and indices into the working data
+		int Index(int x, int y) const
+		{
+			return (y - m_region.y0) * m_region.width() + (x - m_region.x0);
+		}
+		Cell CellAt(int idx) const
+		{
+			return Cell{ m_region.x0 + idx % m_region.width(), m_region.y0 + idx / m_region.width() };
+		}
+	};
+
+	// An HPA* style cluster abstraction of a grid
+	class Hierarchy
+	{
+	public:
+
+		// Working data for hierarchy searches. Not thread safe, use one instance per thread.
+		struct Workspace
+		{
+			struct Open
+			{
+				cost_t total_cost;
+				int node;
+			};
+
+			Search local;
+			std::vector<cost_t> cost;
+			std::vector<int> parent;
+			std::vector<uint32_t> stamp;
+			std::vector<Open> open;
+			std::vector<cost_t> start_costs;
+			std::vector<cost_t> goal_costs;
+			std::vector<Cell> segment;
+			std::vector<Cell> targets;
+			std::vector<int> nodes;
+			uint32_t generation = 0;
+		};
+
+	private:
+
+		// A link from a cluster entry to the adjacent entry in a neighbouring cluster
+		struct Link
+		{
+			int local; // The entry in this cluster
+			int cell;  // The cell index of the entry in the neighbouring cluster
+			int node;  // The abstract node of the neighbouring entry
+		};
+
+		// A square block of cells
+		struct Cluster
+		{
+			Region region;
+			std::vector<Cell> entries;  // Entrance cells on the borders of this cluster
+			std::vector<Link> links;    // Connections to entries in neighbouring clusters
+			std::vector<cost_t> dist;   // entries.size()^2 matrix of path costs between entries within the cluster
+			int node0 = 0;              // The abstract node index of 'entries[0]'
+			bool dirty = true;          // True if entries and distances need recalculating
+		};
+
+		Grid const* m_grid;
+		int m_cluster_size;
+		int m_cx, m_cy;
+		std::vector<Cluster> m_clusters;
+		std::vector<int> m_node_cluster; // The cluster that each abstract node belongs to
+
+	public:
+
+		Hierarchy(Grid const& grid, int cluster_size = 32)
+			: m_grid(&grid)
+			, m_cluster_size(cluster_size)
+			, m_cx((grid.m_width + cluster_size - 1) / cluster_size)
+			, m_cy((grid.m_height + cluster_size - 1) / cluster_size)
+			, m_clusters(static_cast<size_t>(m_cx) * m_cy)
+			, m_node_cluster()
+		{
+			assert(cluster_size > 1);
+			for (int j = 0; j != m_cy; ++j)
+			{
+				for (int i = 0; i != m_cx; ++i)
+				{
+					auto& cluster = m_clusters[static_cast<size_t>(j) * m_cx + i];
+					cluster.region = Region{
+						i * cluster_size,
+						j * cluster_size,
+						std::min((i + 1) * cluster_size, grid.m_width),
+						std::min((j + 1) * cluster_size, grid.m_height),
+					};
+				}
+			}
+			Update(std::execution::seq);
+		}
+
+		// The number of nodes in the abstract graph
+		size_t NodeCount() const
+		{
+			return m_node_cluster.size();
+		}
+
+		// Record that 'cell' has changed in the grid. Call 'Update' before the next search.
+		void Invalidate(Cell cell)
+		{
+			// Entries depend on the cells either side of a border, so neighbouring clusters are affected by border cells
+			auto i = cell.x / m_cluster_size;
+			auto j = cell.y / m_cluster_size;
+			auto x = cell.x % m_cluster_size;
+			auto y = cell.y % m_cluster_size;
+			MarkDirty(i, j);
+			if (x == 0) MarkDirty(i - 1, j);
+			if (y == 0) MarkDirty(i, j - 1);
+			if (x == m_cluster_size - 1) MarkDirty(i + 1, j);
+			if (y == m_cluster_size - 1) MarkDirty(i, j + 1);
+		}
+
+		// Recalculate the entries and distances of clusters that have changed
+		template <ExecutionPolicy Policy>
+		void Update(Policy&& policy)
+		{
+			std::vector<Cluster*> dirty;
+			for (auto& cluster : m_clusters)
+				if (cluster.dirty)
+					dirty.push_back(&cluster);
+
+			if (dirty.empty())
+				return;
+
+			// Rebuild the dirty clusters
+			std::for_each(std::forward<Policy>(policy), std::begin(dirty), std::end(dirty), [&](Cluster* cluster)
+			{
+				Search search;
+				BuildCluster(*cluster, search);
+			});
+
+			// Renumber the abstract nodes
+			m_node_cluster.resize(0);
+			for (auto& cluster : m_clusters)
+			{
+				cluster.node0 = static_cast<int>(m_node_cluster.size());
+				m_node_cluster.insert(m_node_cluster.end(), cluster.entries.size(), static_cast<int>(&cluster - m_clusters.data()));
+			}
+
+			// Resolve the links into abstract node indices
+			for (auto& cluster : m_clusters)
+			{
+				for (auto& link : cluster.links)
+				{
+					auto cell = Cell{ link.cell % m_grid->m_width, link.cell / m_grid->m_width };
+					auto const& nbr = m_clusters[ClusterIndex(cell)];
+					auto local = LocalIndex(nbr, cell);
+					assert(local != -1 && "Entries should be symmetric across cluster borders");
+					link.node = nbr.node0 + local;
+				}
+			}
+		}
+
+		// Find a near-optimal path from 'start' to 'goal'. Returns the cost of the path, or 'CostMax' if there is no path.
+		cost_t FindPath(Workspace& ws, Cell start, Cell goal, std::vector<Cell>& path) const
+		{
+			constexpr auto MinHeap = [](Workspace::Open const& lhs, Workspace::Open const& rhs) { return lhs.total_cost > rhs.total_cost; };
+			path.resize(0);
+
+			if (!m_grid->Passable(start) || !m_grid->Passable(goal))
+				return CostMax;
+			if (start == goal)
+			{
+				path.push_back(start);
+				return 0;
+			}
+
+			auto const& scluster = m_clusters[ClusterIndex(start)];
+			auto const& gcluster = m_clusters[ClusterIndex(goal)];
+
+			// Connect the start and goal to the entries of their clusters
+			ws.start_costs.resize(scluster.entries.size() + 1);
+			ws.goal_costs.resize(gcluster.entries.size());
+			ws.targets.assign(std::begin(scluster.entries), std::end(scluster.entries));
+			ws.targets.push_back(goal);
+			ws.local.Flood(*m_grid, start, scluster.region, ws.targets, ws.start_costs);
+			ws.local.Flood(*m_grid, goal, gcluster.region, gcluster.entries, ws.goal_costs);
+
+			// Abstract nodes are: [0, N) cluster entries, N = start, N+1 = goal
+			auto const N = static_cast<int>(m_node_cluster.size());
+			auto const snode = N + 0;
+			auto const gnode = N + 1;
+			auto NodeCell = [&](int node) -> Cell
+			{
+				if (node == snode) return start;
+				if (node == gnode) return goal;
+				auto const& cluster = m_clusters[m_node_cluster[node]];
+				return cluster.entries[node - cluster.node0];
+			};
+
+			// Prepare the working data
+			if (ws.stamp.size() < static_cast<size_t>(N + 2))
+			{
+				ws.cost.resize(N + 2);
+				ws.parent.resize(N + 2);
+				ws.stamp.resize(N + 2, 0);
+			}
+			ws.open.resize(0);
+			ws.generation += 2;
+			if (ws.generation < 2)
+			{
+				std::fill(std::begin(ws.stamp), std::end(ws.stamp), 0);
+				ws.generation = 2;
+			}
+
+			auto Relax = [&](int node, int parent, cost_t cost)
+			{
+				if (cost == CostMax) return;
+				if (ws.stamp[node] == ws.generation + 1) return;
+				if (ws.stamp[node] == ws.generation && !(cost < ws.cost[node])) return;
+				ws.stamp[node] = ws.generation;
+				ws.cost[node] = cost;
+				ws.parent[node] = parent;
+				ws.open.push_back({ cost + Octile(NodeCell(node), goal), node });
+				std::push_heap(std::begin(ws.open), std::end(ws.open), MinHeap);
+			};
+
+			// Search the abstract graph
+			Relax(snode, -1, 0);
+			for (; !ws.open.empty();)
+			{
+				std::pop_heap(std::begin(ws.open), std::end(ws.open), MinHeap);
+				auto node = ws.open.back().node;
+				ws.open.pop_back();
+				if (ws.stamp[node] != ws.generation)
+					continue;
+
+				ws.stamp[node] = ws.generation + 1;
+				if (node == gnode)
+					break;
+
+				auto cost = ws.cost[node];
+				if (node == snode)
+				{
+					for (int i = 0, iend = static_cast<int>(scluster.entries.size()); i != iend; ++i)
+						Relax(scluster.node0 + i, node, ws.start_costs[i]);
+					if (&scluster == &gcluster)
+						Relax(gnode, node, ws.start_costs.back());
+
+					continue;
+				}
+
+				auto const& cluster = m_clusters[m_node_cluster[node]];
+				auto const local = node - cluster.node0;
+				auto const count = static_cast<int>(cluster.entries.size());
+
+				// Paths within the cluster
+				for (int i = 0; i != count; ++i)
+				{
+					if (i == local) continue;
+					Relax(cluster.node0 + i, node, cost + cluster.dist[static_cast<size_t>(local) * count + i]);
+				}
+
+				// Paths to neighbouring clusters
+				for (auto const& link : cluster.links)
+				{
+					if (link.local != local) continue;
+					Relax(link.node, node, cost + 1);
+				}
+
+				// Path to the goal
+				if (&cluster == &gcluster)
+					Relax(gnode, node, cost + ws.goal_costs[local]);
+			}
+			if (ws.stamp[gnode] != ws.generation + 1)
+				return CostMax;
+
+			// Collect the abstract path
+			ws.nodes.resize(0);
+			for (auto node = gnode; node != -1; node = ws.parent[node])
+				ws.nodes.push_back(node);
+
+			// Refine each abstract edge into grid cells
+			path.push_back(start);
+			for (auto i = ws.nodes.size() - 1; i-- != 0;)
+			{
+				auto a = NodeCell(ws.nodes[i + 1]);
+				auto b = NodeCell(ws.nodes[i]);
+				auto const& ca = m_clusters[ClusterIndex(a)];
+				auto const& cb = m_clusters[ClusterIndex(b)];
+				if (&ca != &cb)
+				{
+					// Adjacent entries across a border
+					path.push_back(b);
+					continue;
+				}
+
+				ws.local.FindPath(*m_grid, a, b, ws.segment, EMethod::JumpPoint, &ca.region);
+				assert(!ws.segment.empty() && "Abstract edges should always be traversable");
+				path.insert(path.end(), std::begin(ws.segment) + 1, std::end(ws.segment));
+			}
+
+			return ws.cost[gnode];
+		}
+
+	private:
+
+		// Mark the cluster at (i,j) as needing an update
+		void MarkDirty(int i, int j)
+		{
+			if (i < 0 || i >= m_cx || j < 0 || j >= m_cy) return;
+			m_clusters[static_cast<size_t>(j) * m_cx + i].dirty = true;
+		}
+
+		// The index of the cluster containing 'cell'
+		size_t ClusterIndex(Cell cell) const
+		{
+			return static_cast<size_t>(cell.y / m_cluster_size) * m_cx + cell.x / m_cluster_size;
+		}
+
+		// The index of 'cell' in the entries of 'cluster', or -1
+		static int LocalIndex(Cluster const& cluster, Cell cell)
+		{
+			auto iter = std::lower_bound(std::begin(cluster.entries), std::end(cluster.entries), cell, EntryOrder);
+			return iter != std::end(cluster.entries) && *iter == cell ? static_cast<int>(iter - std::begin(cluster.entries)) : -1;
+		}
+
+		// Sort order for cluster entries
+		static bool EntryOrder(Cell lhs, Cell rhs)
+		{
+			return lhs.y != rhs.y ? lhs.y < rhs.y : lhs.x < rhs.x;
+		}
+
+		// Find the entries on the borders of 'cluster' and the costs between them
+		void BuildCluster(Cluster& cluster, Search& search) const
+		{
+			auto const& r = cluster.region;
+			cluster.entries.resize(0);
+			cluster.links.resize(0);
+
+			// Scan a border for runs of cells that are passable on both sides.
+			// One entry is placed in the middle of each run. The same rule applied from the other side gives the matching entry.
+			std::vector<std::pair<Cell, Cell>> pairs;
+			auto ScanBorder = [&](Cell inside, Cell outside, int dx, int dy, int length)
+			{
+				for (int i = 0; i != length;)
+				{
+					auto Open = [&](int k)
+					{
+						return
+							m_grid->Passable(inside.x + k * dx, inside.y + k * dy) &&
+							m_grid->Passable(outside.x + k * dx, outside.y + k * dy);
+					};
+
+					if (!Open(i)) { ++i; continue; }
+					auto beg = i;
+					for (; i != length && Open(i); ++i) {}
+					auto mid = (beg + i - 1) / 2;
+					pairs.push_back({
+						Cell{ inside.x + mid * dx, inside.y + mid * dy },
+						Cell{ outside.x + mid * dx, outside.y + mid * dy },
+					});
+				}
+			};
+			ScanBorder({ r.x0, r.y0 }, { r.x0 - 1, r.y0 }, 0, 1, r.height());         // Left
+			ScanBorder({ r.x1 - 1, r.y0 }, { r.x1, r.y0 }, 0, 1, r.height());         // Right
+			ScanBorder({ r.x0, r.y0 }, { r.x0, r.y0 - 1 }, 1, 0, r.width());          // Bottom
+			ScanBorder({ r.x0, r.y1 - 1 }, { r.x0, r.y1 }, 1, 0, r.width());          // Top
+
+			// Unique entries (corner cells can be entries on two borders)
+			for (auto const& p : pairs)
+				cluster.entries.push_back(p.first);
+
+			std::sort(std::begin(cluster.entries), std::end(cluster.entries), EntryOrder);
+			cluster.entries.erase(std::unique(std::begin(cluster.entries), std::end(cluster.entries)), std::end(cluster.entries));
+			for (auto const& p : pairs)
+				cluster.links.push_back(Link{ LocalIndex(cluster, p.first), p.second.y * m_grid->m_width + p.second.x, -1 });
+
+			// Path costs between entries within the cluster
+			auto count = cluster.entries.size();
+			cluster.dist.resize(count * count);
+			for (size_t i = 0; i != count; ++i)
+				search.Flood(*m_grid, cluster.entries[i], r, cluster.entries, std::span(cluster.dist).subspan(i * count, count));
+
+			cluster.dirty = false;
+		}
+	};
+
+	// A path finding request
+	struct Query
+	{
+		Cell start;
+		Cell goal;
+	};
+
+	// A path finding result
+	struct Result
+	{
+		cost_t cost = CostMax;
+		std::vector<Cell> path;
+	};
+
+	namespace impl
+	{
+		// Call 'func(workspace, i)' for each 'i' in [0, count) using 'policy'. Workspaces are pooled and reused between tasks.
+		template <typename Workspace, ExecutionPolicy Policy, typename Func>
+		void ForEachWithWorkspace(Policy&& policy, size_t count, Func func)
+		{
+			constexpr size_t QueriesPerTask = 16;
+
+			std::mutex mutex;
+			std::vector<std::unique_ptr<Workspace>> pool;
+			std::vector<size_t> blocks((count + QueriesPerTask - 1) / QueriesPerTask);
+			for (size_t i = 0; i != blocks.size(); ++i) blocks[i] = i * QueriesPerTask;
+
+			std::for_each(std::forward<Policy>(policy), std::begin(blocks), std::end(blocks), [&](size_t first)
+			{
+				std::unique_ptr<Workspace> ws;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!pool.empty()) { ws = std::move(pool.back()); pool.pop_back(); }
+				}
+				if (!ws)
+					ws = std::make_unique<Workspace>();
+
+				auto last = std::min(first + QueriesPerTask, count);
+				for (auto i = first; i != last; ++i)
+					func(*ws, i);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				pool.push_back(std::move(ws));
+			});
+		}
+	}
+
+	// Answer many path queries on 'grid' concurrently. 'results' must have the same length as 'queries'
+	template <ExecutionPolicy Policy>
+	void FindPaths(Policy&& policy, Grid const& grid, std::span<Query const> queries, std::span<Result> results, EMethod method = EMethod::JumpPoint)
+	{
+		assert(results.size() >= queries.size());
+		impl::ForEachWithWorkspace<Search>(std::forward<Policy>(policy), queries.size(), [&](Search& search, size_t i)
+		{
+			results[i].cost = search.FindPath(grid, queries[i].start, queries[i].goal, results[i].path, method);
+		});
+	}
+
+	// Answer many path queries using 'hierarchy' concurrently. 'results' must have the same length as 'queries'
+	template <ExecutionPolicy Policy>
+	void FindPaths(Policy&& policy, Hierarchy const& hierarchy, std::span<Query const> queries, std::span<Result> results)
+	{
+		assert(results.size() >= queries.size());
+		impl::ForEachWithWorkspace<Hierarchy::Workspace>(std::forward<Policy>(policy), queries.size(), [&](Hierarchy::Workspace& ws, size_t i)
+		{
+			results[i].cost = hierarchy.FindPath(ws, queries[i].start, queries[i].goal, results[i].path);
+		});
+	}
+}
+
+#if PR_UNITTESTS
+#include "pr/common/unittests.h"
+namespace pr::algorithm::astar::grid::unittests
+{
+	PRUnitTestClass(AStarGridTests)
+	{
+		std::default_random_engine m_rng;
+
+		TestClass_AStarGridTests()
+			: m_rng(1u)
+		{}
+
+		// Create a grid with randomly blocked cells
+		Grid RandomGrid(int width, int height, float density)
+		{
+			Grid grid(width, height);
+			std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+			for (auto& cell : grid.m_cells)
+				cell = dist(m_rng) < density ? 1 : 0;
+
+			return grid;
+		}
+
+		// Choose a random passable cell
+		Cell RandomCell(Grid const& grid)
+		{
+			std::uniform_int_distribution<int> dx(0, grid.m_width - 1), dy(0, grid.m_height - 1);
+			for (;;)
+			{
+				Cell c = { dx(m_rng), dy(m_rng) };
+				if (grid.Passable(c)) return c;
+			}
+		}
+
+		// Check that 'path' is a valid sequence of moves from 'start' to 'goal' with the given cost
+		static void CheckPath(Grid const& grid, Cell start, Cell goal, std::vector<Cell> const& path, cost_t cost)
+		{
+			PR_EXPECT(!path.empty());
+			PR_EXPECT(path.front() == start);
+			PR_EXPECT(path.back() == goal);
+
+			cost_t length = 0;
+			for (size_t i = 1; i < path.size(); ++i)
+			{
+				auto dx = path[i].x - path[i - 1].x;
+				auto dy = path[i].y - path[i - 1].y;
+				PR_EXPECT(std::abs(dx) <= 1 && std::abs(dy) <= 1 && (dx || dy));
+				PR_EXPECT(grid.Passable(path[i]));
+				PR_EXPECT(!(dx && dy) || (grid.Passable(path[i - 1].x + dx, path[i - 1].y) && grid.Passable(path[i - 1].x, path[i - 1].y + dy)));
+				length += dx && dy ? DiagonalCost : 1;
+			}
+			PR_EXPECT(std::abs(length - cost) < 0.01f);
+		}
+
+		PRUnitTestMethod(AStarVsJumpPoint)
+		{
+			auto grid = RandomGrid(64, 64, 0.3f);
+			Search search;
+			std::vector<Cell> path;
+			for (int i = 0; i != 100; ++i)
+			{
+				auto start = RandomCell(grid);
+				auto goal = RandomCell(grid);
+
+				auto cost0 = search.FindPath(grid, start, goal, path, EMethod::AStar);
+				if (cost0 != CostMax) CheckPath(grid, start, goal, path, cost0);
+
+				auto cost1 = search.FindPath(grid, start, goal, path, EMethod::JumpPoint);
+				if (cost1 != CostMax) CheckPath(grid, start, goal, path, cost1);
+
+				// Both methods are optimal
+				PR_EXPECT((cost0 == CostMax) == (cost1 == CostMax));
+				PR_EXPECT(cost0 == CostMax || std::abs(cost0 - cost1) < 0.01f);
+			}
+		}
+		PRUnitTestMethod(Hierarchical)
+		{
+			auto grid = RandomGrid(96, 80, 0.2f);
+			Hierarchy hpa(grid, 16);
+			Hierarchy::Workspace ws;
+			Search search;
+			std::vector<Cell> path;
+
+			auto Compare = [&](Hierarchy const& h)
+			{
+				for (int i = 0; i != 50; ++i)
+				{
+					auto start = RandomCell(grid);
+					auto goal = RandomCell(grid);
+
+					auto optimal = search.FindPath(grid, start, goal, path, EMethod::JumpPoint);
+					auto cost = h.FindPath(ws, start, goal, path);
+					if (cost != CostMax)
+						CheckPath(grid, start, goal, path, cost);
+
+					// HPA* paths are no better than optimal
+					PR_EXPECT(cost == CostMax || cost >= optimal - 0.01f);
+				}
+			};
+			Compare(hpa);
+
+			// Change some cells and update incrementally. Should match a hierarchy built from scratch.
+			for (int i = 0; i != 200; ++i)
+			{
+				auto c = Cell{ std::uniform_int_distribution<int>(0, grid.m_width - 1)(m_rng), std::uniform_int_distribution<int>(0, grid.m_height - 1)(m_rng) };
+				grid.Set(c, !grid.Passable(c));
+				hpa.Invalidate(c);
+			}
+			hpa.Update(std::execution::par);
+
+			Hierarchy fresh(grid, 16);
+			PR_EXPECT(fresh.NodeCount() == hpa.NodeCount());
+			Compare(hpa);
+		}
+		PRUnitTestMethod(Batch)
+		{
+			auto grid = RandomGrid(64, 64, 0.25f);
+			Hierarchy hpa(grid, 16);
+
+			std::vector<Query> queries(200);
+			for (auto& q : queries)
+				q = Query{ RandomCell(grid), RandomCell(grid) };
+
+			std::vector<Result> results(queries.size());
+			FindPaths(std::execution::par, grid, std::span<Query const>(queries), std::span(results));
+
+			Search search;
+			std::vector<Cell> path;
+			for (size_t i = 0; i != queries.size(); ++i)
+			{
+				auto cost = search.FindPath(grid, queries[i].start, queries[i].goal, path);
+				PR_EXPECT(cost == results[i].cost);
+				PR_EXPECT(path == results[i].path);
+			}
+
+			FindPaths(std::execution::par, hpa, std::span<Query const>(queries), std::span(results));
+
+			Hierarchy::Workspace ws;
+			for (size_t i = 0; i != queries.size(); ++i)
+			{
+				auto cost = hpa.FindPath(ws, queries[i].start, queries[i].goal, path);
+				PR_EXPECT(cost == results[i].cost);
+			}
+		}
+	};
+}
+#endif
@@ -9,6 +9,7 @@ namespace pr::algorithm::astar
 {
 	// Notes:
 	//  - A* is a graph search algorithm for finding the cheapest path from a node toward some goal.
+	//  - See 'astar_grid.h' for a specialisation for 2D occupancy grids (JPS and HPA*).
 
 	// Types to specialise the algorithm with
 	template <typename T>
@@ -5,15 +5,18 @@
 // Uses the same per-axis sorted array idea as sweep-and-prune, but for
 // point-in-region queries rather than pair-wise interval overlap detection.
 // Maintains N sorted index arrays (one per dimension) over a collection of items.
-// Queries perform parallel binary searches on each axis to narrow candidates,
-// then intersect the results. Supports axis-aligned bounding box and spherical
-// range queries.
+// Queries perform binary searches on each axis to narrow candidates, then test
+// the narrowest candidate set on the other axes. Supports axis-aligned bounding
+// box and spherical range queries.
 //
 // Complexity:
-//   Build/Update:  O(N log N) per dimension (parallel across dimensions)
+//   Build:         O(N log N) per dimension (parallel across dimensions)
+//   Update:        O(N + shifts) per dimension when few items have moved, like
+//                  sweep-and-prune. O(K * displacement) when the K moved items
+//                  are given. Falls back to O(N log N) for large changes.
 //   Query:         O(D * log N) for the binary search phase, then linear in
 //                  the narrowest candidate set for intersection.
-//   Storage:       sizeof(Index) * Dimensions * N
+//   Storage:       (sizeof(Index) * 2 + sizeof(S) * Dimensions) * Dimensions * N
 //
 // Intended for moderate-sized datasets where a full spatial tree (k-d, BVH)
 // is overkill and the data changes frequently enough to benefit from fast rebuilds.
@@ -64,13 +67,28 @@ namespace pr::algorithm
 		// Notes:
 		// - Stores a sorted list of object indices for each dimension.
 		//   Storage = sizeof(Index) * Dimensions * items.size()
-		// - Search is O(Dimensions * log(N)), however each dimension is searched in parallel.
+		// - Alongside each sorted list is a SoA copy of the item values on every dimension, in the same order.
+		//   Storage = sizeof(S) * Dimensions * Dimensions * items.size()
+		//   This means the candidates on one axis can be tested on the other axes with contiguous, vectorisable loops,
+		//   and binary searches don't need to call 'get_value'.
+		// - 'm_rank' is the position of each item in each sorted list, used to update moved items in place.
+		// - Search is O(Dimensions * log(N)), followed by a linear scan of the narrowest range.
 		using IndexContainer = std::vector<Index>;
 		using IndexRange = std::span<Index>;
+		using ValueContainer = std::vector<S>;
+
+		// The number of insertion sort shifts per item that 'Update' will do before switching to a full sort
+		static constexpr size_t MaxShiftsPerItem = 8;
 
 		// Indices sorted on each dimension.
 		IndexContainer m_space[Dimensions];
 
+		// The values of the items in 'm_space[axis]' order. i.e. 'm_value[axis][dim][k]' is the 'dim' value of item 'm_space[axis][k]'
+		ValueContainer m_value[Dimensions][Dimensions];
+
+		// The position of each item in 'm_space'. i.e. 'm_space[axis][m_rank[axis][i]] == i'
+		IndexContainer m_rank[Dimensions];
+
 		DimensionIndex() = default;
 
 		// Spatially partition 'items'
@@ -86,7 +104,11 @@ namespace pr::algorithm
 				m_space[i] = m_space[0]; // value copy
 
 			// Sort on each dimension
-			Update(items, get_value);
+			auto values = Values(items, get_value);
+			std::for_each(std::execution::par, std::begin(m_space), std::end(m_space), [&](auto& space)
+			{
+				Sort(static_cast<int>(&space - &m_space[0]), values);
+			});
 		}
 
 		// Re-sort the index for the same number of items
@@ -95,66 +117,51 @@ namespace pr::algorithm
 		{
 			assert(items.size() == m_space[0].size());
 
-			// For each dimension, sort on the item's position in that dimension
+			// Notes:
+			//  - The existing order is repaired using insertion sort, which is O(N) when few items have moved.
+			//    If an axis needs too many shifts, it is sorted from scratch instead.
+			auto values = Values(items, get_value);
 			std::for_each(std::execution::par, std::begin(m_space), std::end(m_space), [&](auto& space)
 			{
-				auto dim = s_cast<int>(&space - &m_space[0]);
-				std::sort(std::begin(space), std::end(space), [&](int a, int b)
-				{
-					return get_value(items[a], dim) < get_value(items[b], dim);
-				});
+				auto axis = static_cast<int>(&space - &m_space[0]);
+				if (!Repair(axis, values))
+					Sort(axis, values);
 			});
 		}
 
-		// Find items within 'bbox' of 'search'
-		template <typename Item, GetValueFunc<S, Item> GetValue, FoundFunc<S, Item> Found>
-		void Find(std::span<Item const> items, S const (&search)[Dimensions], S const (&bbox)[Dimensions], GetValue get_value, Found found)
+		// Update the index after the items in 'moved' have changed position. All other items must be unchanged.
+		// Each moved item is shifted to its new position on each dimension, so the cost depends on how far they moved.
+		template <typename Item, GetValueFunc<S, Item> GetValue>
+		void Update(std::span<Item const> items, std::span<Index const> moved, GetValue get_value)
 		{
-			// The range of items on each dimension that are within 'bbox' of 'search'
-			IndexRange ranges[Dimensions];
-
-			// On each dimension, find the range of indices that are within 'bbox' of 'search'
+			assert(items.size() == m_space[0].size());
 			std::for_each(std::execution::par, std::begin(m_space), std::end(m_space), [&](auto& space)
 			{
-				auto dim = s_cast<int>(&space - &m_space[0]);
-				auto lower = search[dim] - bbox[dim];
-				auto upper = search[dim] + bbox[dim];
-				auto lo = std::lower_bound(std::begin(space), std::end(space), lower, [&](int a, S b)
-				{
-					return get_value(items[a], dim) < b;
-				});
-				auto hi = std::upper_bound(lo, std::end(space), upper, [&](S a, int b)
+				auto axis = static_cast<int>(&space - &m_space[0]);
+				for (auto idx : moved)
 				{
-					return a < get_value(items[b], dim);
-				});
+					auto k = static_cast<size_t>(m_rank[axis][idx]);
+					for (int d = 0; d != Dimensions; ++d)
+						m_value[axis][d][k] = get_value(items[idx], d);
 
-				ranges[dim] = { lo, hi };
+					Sift(axis, k);
+				}
 			});
+		}
 
-			// Find the narrowest range
-			auto narrowest = std::min_element(std::begin(ranges), std::end(ranges), [](auto const& a, auto const& b)
+		// Find items within 'bbox' of 'search'
+		template <typename Item, GetValueFunc<S, Item> GetValue, FoundFunc<S, Item> Found>
+		void Find(std::span<Item const> items, S const (&search)[Dimensions], S const (&bbox)[Dimensions], GetValue, Found found) const
+		{
+			Scan(search, bbox, [&](int axis, size_t k)
 			{
-				return a.size() < b.size();
+				found(items[m_space[axis][k]]);
 			});
-
-			// Reduce the results to the intersection on all dimensions
-			for (auto& idx : *narrowest)
-			{
-				// Check if 'idx' is present in all the other dimensions
-				auto in_all = std::all_of(std::begin(ranges), std::end(ranges), [&](auto const& range)
-				{
-					return &range == &*narrowest || std::ranges::find(range, idx) != std::end(range);
-				});
-
-				// If not in all ranges, skip
-				if (in_all)
-					found(items[idx]);
-			}
 		}
 
 		// Find items within 'radius' of 'search'
 		template <typename Item, GetValueFunc<S, Item> GetValue, FoundInSphereFunc<S, Item> Found>
-		void Find(std::span<Item const> items, S const (&search)[Dimensions], S radius, GetValue get_value, Found found)
+		void Find(std::span<Item const> items, S const (&search)[Dimensions], S radius, GetValue, Found found) const
 		{
 			S r[Dimensions];
 			std::fill(std::begin(r), std::end(r), radius);
@@ -162,21 +169,175 @@ namespace pr::algorithm
 			auto radius_sq = radius * radius;
 
 			// Convert a box search to a sphere search
-			Find(items, search, r, get_value, [=](Item const& item)
+			Scan(search, r, [&](int axis, size_t k)
 			{
 				S dist_sq = {};
 				for (int i = 0; i != Dimensions; ++i)
 				{
-					auto diff = get_value(item, i) - search[i];
+					auto diff = m_value[axis][i][k] - search[i];
 					dist_sq += diff * diff;
 				}
 				if (dist_sq < radius_sq)
 				{
-					found(item, dist_sq);
+					found(items[m_space[axis][k]], dist_sq);
 				}
 			});
 		}
+
+	private:
+
+		// The number of candidates tested together in 'Scan'
+		static constexpr size_t BlockSize = 256;
+
+		// Read the values of all items into SoA arrays, indexed by item
+		template <typename Item, typename GetValue>
+		static std::vector<ValueContainer> Values(std::span<Item const> items, GetValue& get_value)
+		{
+			std::vector<ValueContainer> values(Dimensions);
+			for (int d = 0; d != Dimensions; ++d)
+			{
+				values[d].resize(items.size());
+				for (size_t i = 0, iend = items.size(); i != iend; ++i)
+					values[d][i] = get_value(items[i], d);
+			}
+			return values;
+		}
+
+		// Copy the item values into 'm_value[axis]' (in 'm_space[axis]' order) and set the ranks
+		void Gather(int axis, std::vector<ValueContainer> const& values)
+		{
+			auto const& space = m_space[axis];
+			auto count = space.size();
+			for (int d = 0; d != Dimensions; ++d)
+			{
+				auto& dst = m_value[axis][d];
+				dst.resize(count);
+				for (size_t k = 0; k != count; ++k)
+					dst[k] = values[d][space[k]];
+			}
+
+			m_rank[axis].resize(count);
+			for (size_t k = 0; k != count; ++k)
+				m_rank[axis][space[k]] = static_cast<Index>(k);
+		}
+
+		// Sort 'axis' from scratch
+		void Sort(int axis, std::vector<ValueContainer> const& values)
+		{
+			auto const& key = values[axis];
+			std::sort(std::begin(m_space[axis]), std::end(m_space[axis]), [&](Index a, Index b)
+			{
+				return key[a] < key[b];
+			});
+			Gather(axis, values);
+		}
+
+		// Restore the order of 'axis' using insertion sort. Returns false if the number of shifts exceeded the budget
+		bool Repair(int axis, std::vector<ValueContainer> const& values)
+		{
+			Gather(axis, values);
+
+			auto count = m_space[axis].size();
+			auto budget = count * MaxShiftsPerItem;
+			auto const& key = m_value[axis][axis];
+			for (size_t k = 1; k < count; ++k)
+			{
+				if (!(key[k] < key[k - 1]))
+					continue;
+
+				auto shifts = Sift(axis, k);
+				if (shifts > budget) return false;
+				budget -= shifts;
+			}
+			return true;
+		}
+
+		// Move the entry at 'k' in 'axis' to its sorted position, assuming all other entries are in order. Returns the number of shifts
+		size_t Sift(int axis, size_t k)
+		{
+			auto& space = m_space[axis];
+			auto& rank = m_rank[axis];
+			auto& value = m_value[axis];
+			auto const& key = value[axis];
+			auto count = space.size();
+
+			// Find the new position
+			auto k0 = k;
+			auto v = key[k];
+			for (; k0 != 0 && v < key[k0 - 1]; --k0) {}
+			if (k0 == k)
+			{
+				for (; k0 + 1 != count && key[k0 + 1] < v; ++k0) {}
+			}
+			if (k0 == k)
+				return 0;
+
+			// Rotate the entries in the range so that 'k' is at 'k0'
+			auto rotate = [=](auto& vec)
+			{
+				if (k0 < k) std::rotate(std::begin(vec) + k0, std::begin(vec) + k, std::begin(vec) + k + 1);
+				else std::rotate(std::begin(vec) + k, std::begin(vec) + k + 1, std::begin(vec) + k0 + 1);
+			};
+			rotate(space);
+			for (int d = 0; d != Dimensions; ++d)
+				rotate(value[d]);
+
+			auto lo = std::min(k, k0), hi = std::max(k, k0);
+			for (auto i = lo; i <= hi; ++i)
+				rank[space[i]] = static_cast<Index>(i);
+
+			return hi - lo;
+		}
+
+		// Call 'accept(axis, k)' for each entry within 'bbox' of 'search'. 'k' is the position in 'm_space[axis]'
+		template <typename Accept>
+		void Scan(S const (&search)[Dimensions], S const (&bbox)[Dimensions], Accept accept) const
+		{
+			S lower[Dimensions], upper[Dimensions];
+			for (int d = 0; d != Dimensions; ++d)
+			{
+				lower[d] = search[d] - bbox[d];
+				upper[d] = search[d] + bbox[d];
+			}
+
+			// On each dimension, find the range of entries that are within 'bbox' of 'search'
+			size_t lo[Dimensions], hi[Dimensions];
+			for (int d = 0; d != Dimensions; ++d)
+			{
+				auto const& key = m_value[d][d];
+				lo[d] = std::lower_bound(std::begin(key), std::end(key), lower[d]) - std::begin(key);
+				hi[d] = std::upper_bound(std::begin(key) + lo[d], std::end(key), upper[d]) - std::begin(key);
+			}
+
+			// Find the narrowest range
+			int axis = 0;
+			for (int d = 1; d != Dimensions; ++d)
+				if (hi[d] - lo[d] < hi[axis] - lo[axis])
+					axis = d;
+
+			// Test the candidates on the other dimensions, a block at a time
+			uint8_t inside[BlockSize];
+			for (auto k0 = lo[axis]; k0 < hi[axis]; k0 += BlockSize)
+			{
+				auto n = std::min(BlockSize, hi[axis] - k0);
+				std::fill(inside, inside + n, uint8_t(1));
+				for (int d = 0; d != Dimensions; ++d)
+				{
+					if (d == axis) continue;
+					auto v = m_value[axis][d].data() + k0;
+					auto l = lower[d], u = upper[d];
+					for (size_t i = 0; i != n; ++i)
+						inside[i] &= static_cast<uint8_t>(!(v[i] < l) & !(u < v[i]));
+				}
+				for (size_t i = 0; i != n; ++i)
+				{
+					if (inside[i])
+						accept(axis, k0 + i);
+				}
+			}
+		}
 	};
+
 }
 
 #if PR_UNITTESTS
@@ -227,6 +388,86 @@ namespace pr::algorithm::tests
 			PR_EXPECT(std::ranges::contains(results, points[5]));
 		}
 	}
+	PRUnitTest(DimensionIndexUpdateTests)
+	{
+		std::default_random_engine rng(1);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+		auto GetValue = [](v4 const& p, int i)
+		{
+			return p[i];
+		};
+
+		// Brute force search for comparison
+		auto BruteForce = [](std::span<v4 const> points, v4 const& search, float radius)
+		{
+			std::vector<int> result;
+			for (int i = 0; i != isize(points); ++i)
+				if (LengthSq(points[i].xyz - search.xyz) < radius * radius)
+					result.push_back(i);
+			return result;
+		};
+		auto Search = [&](DimensionIndex<3, float> const& index, std::span<v4 const> points, v4 const& search, float radius)
+		{
+			std::vector<int> result;
+			index.Find<v4>(points, search.xyz.arr, radius, GetValue, [&](v4 const& a, float)
+			{
+				result.push_back(s_cast<int>(&a - points.data()));
+			});
+			std::ranges::sort(result);
+			return result;
+		};
+		auto Check = [&](DimensionIndex<3, float> const& index, std::span<v4 const> points)
+		{
+			for (int i = 0; i != 3; ++i)
+			{
+				for (size_t k = 1; k < index.m_space[i].size(); ++k)
+					PR_EXPECT(!(index.m_value[i][i][k] < index.m_value[i][i][k - 1]));
+				for (size_t k = 0; k != index.m_space[i].size(); ++k)
+					PR_EXPECT(index.m_rank[i][index.m_space[i][k]] == s_cast<int>(k));
+			}
+			for (int q = 0; q != 20; ++q)
+			{
+				auto search = v4(dist(rng), dist(rng), dist(rng), 1);
+				auto radius = 0.3f * Abs(dist(rng));
+				PR_EXPECT(Search(index, points, search, radius) == BruteForce(points, search, radius));
+			}
+		};
+
+		const int N = 5000;
+		std::vector<v4> points;
+		for (int i = 0; i != N; ++i)
+			points.push_back(v4(dist(rng), dist(rng), dist(rng), 1));
+
+		DimensionIndex<3, float> index;
+		index.Build<v4>(points, GetValue);
+		Check(index, points);
+
+		// Move 1% of the points a little, and update with the moved list
+		for (int frame = 0; frame != 10; ++frame)
+		{
+			std::vector<int> moved;
+			for (int i = 0; i != N / 100; ++i)
+			{
+				auto idx = s_cast<int>(rng() % N);
+				points[idx] += 0.05f * v4(dist(rng), dist(rng), dist(rng), 0);
+				moved.push_back(idx);
+			}
+			index.Update<v4>(points, moved, GetValue);
+		}
+		Check(index, points);
+
+		// Move 10% of the points, and repair the whole index
+		for (int i = 0; i != N / 10; ++i)
+			points[rng() % N] += 0.05f * v4(dist(rng), dist(rng), dist(rng), 0);
+		index.Update<v4>(points, GetValue);
+		Check(index, points);
+
+		// Shuffle all the points, repair exceeds its budget and falls back to sorting
+		std::ranges::shuffle(points, rng);
+		index.Update<v4>(points, GetValue);
+		Check(index, points);
+	}
 	PRUnitTest(DimensionIndexLdrTests)
 	{
 		#if PR_UNITTESTS_VISUALISE
@@ -26,6 +26,8 @@
  */
 #pragma once
 #include <complex>
+#include <vector>
+#include <execution>
 #include "pr/common/cast.h"
 #include "pr/common/bit_fields.h"
 #include "pr/math/math.h"
@@ -291,6 +293,146 @@ namespace pr::algorithm::fft
 	{
 		return sampling_frequency * fidx / buffer_size;
 	}
+
+	// A 2D radix-2 FFT over a row-major grid of complex values.
+	// The twiddle factors and bit reversal permutation are computed once, so repeated transforms of the
+	// same size only cost the butterflies. Rows are transformed, then columns, each pass split across threads.
+	// Neither direction is scaled, i.e. Transform(inverse=true) computes 'Σ X(k)·e^(+iτkn/N)'.
+	template <typename Real>
+	struct FFT2D
+	{
+		// The transform along one axis
+		struct Axis
+		{
+			size_t m_length;
+			std::vector<size_t> m_rev;  // Bit reversed index
+			std::vector<Real> m_cos;    // cos(τk/N) for k in [0, N/2)
+			std::vector<Real> m_sin;    // sin(τk/N) for k in [0, N/2)
+
+			explicit Axis(size_t length)
+				:m_length(length)
+				,m_rev(length)
+				,m_cos(length / 2)
+				,m_sin(length / 2)
+			{
+				if (!IsPowerOfTwo(length))
+					throw std::runtime_error("FFT2D dimensions must be powers of 2");
+
+				int levels = 0;
+				for (auto i = length; i > 1; i >>= 1)
+					++levels;
+
+				for (size_t i = 0; i != length; ++i)
+					m_rev[i] = levels != 0 ? s_cast<size_t>(ReverseBits64(i, levels)) : 0;
+
+				for (size_t k = 0; k != length / 2; ++k)
+				{
+					m_cos[k] = s_cast<Real>(std::cos(constants<double>::tau * k / length));
+					m_sin[k] = s_cast<Real>(std::sin(constants<double>::tau * k / length));
+				}
+			}
+
+			// Transform a contiguous sequence of 'm_length' complex values in place
+			void Transform(Real* real, Real* imag, bool inverse) const
+			{
+				auto length = m_length;
+				for (size_t i = 0; i != length; ++i)
+				{
+					auto j = m_rev[i];
+					if (j <= i) continue;
+					std::swap(real[i], real[j]);
+					std::swap(imag[i], imag[j]);
+				}
+
+				// 'Cooley-Tukey' decimation-in-time radix-2 butterflies.
+				// Forward multiplies by e^(-iθ), inverse by e^(+iθ).
+				auto sgn = inverse ? Real(-1) : Real(+1);
+				for (size_t size = 2; size <= length; size *= 2)
+				{
+					auto halfsize = size / 2;
+					auto tablestep = length / size;
+					for (size_t i = 0; i < length; i += size)
+					{
+						for (size_t j = i, k = 0; j < i + halfsize; ++j, k += tablestep)
+						{
+							auto l = j + halfsize;
+							auto cos_k = m_cos[k];
+							auto sin_k = sgn * m_sin[k];
+							auto re =  real[l] * cos_k + imag[l] * sin_k;
+							auto im = -real[l] * sin_k + imag[l] * cos_k;
+
+							real[l] = real[j] - re;
+							imag[l] = imag[j] - im;
+							real[j] += re;
+							imag[j] += im;
+						}
+					}
+				}
+			}
+		};
+
+		Axis m_x; // Along rows (width)
+		Axis m_y; // Along columns (height)
+
+		FFT2D(size_t width, size_t height)
+			:m_x(width)
+			,m_y(height)
+		{}
+
+		// The grid dimensions
+		size_t width() const
+		{
+			return m_x.m_length;
+		}
+		size_t height() const
+		{
+			return m_y.m_length;
+		}
+
+		// Transform the 'width() x height()' grid (row-major) in place.
+		void Transform(Real* real, Real* imag, bool inverse) const
+		{
+			auto w = width();
+			auto h = height();
+
+			// Rows are contiguous
+			std::vector<size_t> rows(h);
+			for (size_t y = 0; y != h; ++y) rows[y] = y;
+			std::for_each(std::execution::par, std::begin(rows), std::end(rows), [&](size_t y)
+			{
+				m_x.Transform(real + y * w, imag + y * w, inverse);
+			});
+
+			// Columns are gathered into a contiguous buffer, a batch at a time
+			constexpr size_t Batch = 8;
+			std::vector<size_t> batches;
+			for (size_t x = 0; x < w; x += Batch) batches.push_back(x);
+			std::for_each(std::execution::par, std::begin(batches), std::end(batches), [&](size_t x0)
+			{
+				auto count = std::min(Batch, w - x0);
+				std::vector<Real> re(count * h), im(count * h);
+				for (size_t y = 0; y != h; ++y)
+				{
+					for (size_t c = 0; c != count; ++c)
+					{
+						re[c * h + y] = real[y * w + x0 + c];
+						im[c * h + y] = imag[y * w + x0 + c];
+					}
+				}
+				for (size_t c = 0; c != count; ++c)
+					m_y.Transform(re.data() + c * h, im.data() + c * h, inverse);
+
+				for (size_t y = 0; y != h; ++y)
+				{
+					for (size_t c = 0; c != count; ++c)
+					{
+						real[y * w + x0 + c] = re[c * h + y];
+						imag[y * w + x0 + c] = im[c * h + y];
+					}
+				}
+			});
+		}
+	};
 }
 
 namespace pr
@@ -570,6 +712,38 @@ namespace pr::algorithm::fft::tests
 			PR_EXPECT(max_err0 < -10);
 			PR_EXPECT(max_err1 < -10);
 		}
+		PRUnitTestMethod(DFT2DTests)
+		{
+			// Compare with separable naive DFTs
+			constexpr int W = 16, H = 8;
+			auto inputr = RandomReals(W * H);
+			auto inputi = RandomReals(W * H);
+
+			std::vector<double> expectr(W * H), expecti(W * H);
+			{
+				std::vector<double> tr(W * H), ti(W * H), cr(H), ci(H), outr(H), outi(H);
+				for (int y = 0; y != H; ++y)
+					impl::DFTNaive(&inputr[y * W], &inputi[y * W], &tr[y * W], &ti[y * W], W, false);
+				for (int x = 0; x != W; ++x)
+				{
+					for (int y = 0; y != H; ++y) { cr[y] = tr[y * W + x]; ci[y] = ti[y * W + x]; }
+					impl::DFTNaive(cr.data(), ci.data(), outr.data(), outi.data(), H, false);
+					for (int y = 0; y != H; ++y) { expectr[y * W + x] = outr[y]; expecti[y * W + x] = outi[y]; }
+				}
+			}
+
+			FFT2D<double> fft(W, H);
+			auto actualr = inputr;
+			auto actuali = inputi;
+			fft.Transform(actualr.data(), actuali.data(), false);
+			PR_EXPECT(Log10RMSError(expectr.data(), expecti.data(), actualr.data(), actuali.data(), W * H) < -10);
+
+			// The unscaled inverse returns the input multiplied by W*H
+			fft.Transform(actualr.data(), actuali.data(), true);
+			for (auto& v : actualr) v /= W * H;
+			for (auto& v : actuali) v /= W * H;
+			PR_EXPECT(Log10RMSError(inputr.data(), inputi.data(), actualr.data(), actuali.data(), W * H) < -10);
+		}
 		PRUnitTestMethod(ConvolutionTests)
 		{
 			double max_err = -99.0; // db
@@ -5,9 +5,14 @@
 // Updated 2023
 #pragma once
 #include <span>
+#include <vector>
 #include <concepts>
 #include <algorithm>
+#include <execution>
+#include <type_traits>
+#include <thread>
 #include <limits>
+#include <cstdint>
 #include <cmath>
 #include <cassert>
 
@@ -37,6 +42,9 @@ namespace pr::kdtree
 		{ t(std::declval<Item const&>(), std::declval<S>()) };
 	};
 
+	// Concept for an execution policy (e.g. std::execution::par)
+	template <typename T> concept ExecutionPolicy = std::is_execution_policy_v<std::remove_cvref_t<T>>;
+
 	// Strategies for selecting the axis to split on
 	enum class EStrategy
 	{
@@ -77,94 +85,188 @@ namespace pr::kdtree
 			}
 		};
 
-		// Build a KD tree from 'items'
+		// Sub-trees with this many items or less are scanned linearly during searches.
+		// This is valid for any sub-range of the tree because every item in the range is a candidate.
+		static constexpr size_t LeafSize = 16;
+
+		// Sub-trees smaller than this are not split further into separate build tasks
+		static constexpr size_t ParallelBuildThreshold = 4096;
+
+		// Partitions items into a KD tree
 		template <GetValueFunc<Item, S> GetValue, SetAxisFunc<Item> SetAxis>
-		static void Build(std::span<Item> items, GetValue get_value, SetAxis set_axis)
+		struct Builder
 		{
-			struct Builder
+			GetValue m_get_value;
+			SetAxis m_set_axis;
+			Builder(GetValue get_value, SetAxis set_axis)
+				: m_get_value(get_value)
+				, m_set_axis(set_axis)
 			{
-				GetValue m_get_value;
-				SetAxis m_set_axis;
-				Builder(GetValue get_value, SetAxis set_axis)
-					: m_get_value(get_value)
-					, m_set_axis(set_axis)
-				{
-				}
+			}
 
-				// Sort values based on the median value of the longest axis
-				void Run(std::span<Item> items, int level)
-				{
-					if (items.size() <= 1)
-						return;
+			// Sort values based on the median value of the longest axis
+			void Run(std::span<Item> items, int level)
+			{
+				if (items.size() <= 1)
+					return;
 
-					// Set the axis to split on.
-					int split_axis = 0;
-					if constexpr (SelectAxis == EStrategy::AxisByLevel)
-						split_axis = AxisByLevel(items, level);
-					if constexpr (SelectAxis == EStrategy::LongestAxis)
-						split_axis = LongestAxis(items, level);
+				auto mid = Split(items, level);
 
-					// Split the range. This ensures all values < mid have lesser value on 'split_axis' than all values > mid.
-					auto mid = items.size() / 2;
-					std::nth_element(items.data(), items.data() + mid, items.data() + items.size(), [&](auto const& lhs, auto const& rhs)
-					{
-						return m_get_value(lhs, split_axis) < m_get_value(rhs, split_axis);
-					});
+				// Construct recursively
+				Run(items.subspan(0, mid), level + 1);
+				Run(items.subspan(mid + 1), level + 1);
+			}
+
+			// Partition 'items' about the median on the split axis. Returns the index of the median item.
+			size_t Split(std::span<Item> items, int level)
+			{
+				// Set the axis to split on.
+				int split_axis = 0;
+				if constexpr (SelectAxis == EStrategy::AxisByLevel)
+					split_axis = AxisByLevel(items, level);
+				if constexpr (SelectAxis == EStrategy::LongestAxis)
+					split_axis = LongestAxis(items, level);
+
+				// Split the range. This ensures all values < mid have lesser value on 'split_axis' than all values > mid.
+				auto mid = items.size() / 2;
+				std::nth_element(items.data(), items.data() + mid, items.data() + items.size(), [&](auto const& lhs, auto const& rhs)
+				{
+					return m_get_value(lhs, split_axis) < m_get_value(rhs, split_axis);
+				});
 
-					// Record the split axis
-					m_set_axis(items[mid], split_axis);
+				// Record the split axis
+				m_set_axis(items[mid], split_axis);
+				return mid;
+			}
 
-					// Construct recursively
-					Run(items.subspan(0, mid), level + 1);
-					Run(items.subspan(mid + 1), level + 1);
-				};
+			// Select the axis simply based on level
+			int AxisByLevel(std::span<Item const>, int level)
+			{
+				return level % Dim;
+			}
+
+			// Find the axis with the greatest range
+			int LongestAxis(std::span<Item const> items, int)
+			{
+				auto ptr = items.data();
+				auto end = ptr + items.size();
 
-				// Select the axis simply based on level
-				int AxisByLevel(std::span<Item const>, int level)
+				// Find the bounds over all axes
+				S lower[Dim], upper[Dim];
+				for (int a = 0; a != Dim; ++a)
 				{
-					return level % Dim;
+					lower[a] = m_get_value(*ptr, a);
+					upper[a] = lower[a];
 				}
-
-				// Find the axis with the greatest range
-				int LongestAxis(std::span<Item const> items, int)
+				for (++ptr; ptr != end; ++ptr)
 				{
-					auto ptr = items.data();
-					auto end = ptr + items.size();
-
-					// Find the bounds over all axes
-					S lower[Dim], upper[Dim];
 					for (int a = 0; a != Dim; ++a)
 					{
-						lower[a] = m_get_value(*ptr, a);
-						upper[a] = lower[a];
-					}
-					for (++ptr; ptr != end; ++ptr)
-					{
-						for (int a = 0; a != Dim; ++a)
-						{
-							auto value = m_get_value(*ptr, a);
-							if (value < lower[a]) lower[a] = value;
-							if (value > upper[a]) upper[a] = value;
-						}
+						auto value = m_get_value(*ptr, a);
+						if (value < lower[a]) lower[a] = value;
+						if (value > upper[a]) upper[a] = value;
 					}
+				}
 
-					// Select the axis with the greatest range
-					for (int a = 0; a != Dim; ++a)
-						upper[a] -= lower[a];
+				// Select the axis with the greatest range
+				for (int a = 0; a != Dim; ++a)
+					upper[a] -= lower[a];
 
-					int largest = 0;
-					for (int a = 1; a != Dim; ++a)
-						largest = upper[a] > upper[largest] ? a : largest;
+				int largest = 0;
+				for (int a = 1; a != Dim; ++a)
+					largest = upper[a] > upper[largest] ? a : largest;
 
-					return largest;
-				}
-			};
+				return largest;
+			}
+		};
 
+		// Build a KD tree from 'items'
+		template <GetValueFunc<Item, S> GetValue, SetAxisFunc<Item> SetAxis>
+		static void Build(std::span<Item> items, GetValue get_value, SetAxis set_axis)
+		{
 			// Recursive build
-			Builder builder(get_value, set_axis);
+			Builder<GetValue, SetAxis> builder(get_value, set_axis);
 			builder.Run(items, 0);
 		}
 
+		// Build a KD tree from 'items' using 'policy' to build independent sub-trees concurrently.
+		// 'get_value' and 'set_axis' must be safe to call from multiple threads (on different items).
+		template <ExecutionPolicy Policy, GetValueFunc<Item, S> GetValue, SetAxisFunc<Item> SetAxis>
+		static void Build(Policy&& policy, std::span<Item> items, GetValue get_value, SetAxis set_axis)
+		{
+			// Notes:
+			//  - The top levels of the tree are split serially until there are enough independent
+			//    sub-trees to keep all threads busy. Each sub-tree is then built as a separate task.
+			//  - The resulting tree is identical to the one produced by the serial 'Build'.
+			struct Task { std::span<Item> items; int level; };
+
+			Builder<GetValue, SetAxis> builder(get_value, set_axis);
+			auto const min_tasks = std::max<size_t>(1, std::thread::hardware_concurrency()) * 4;
+
+			std::vector<Task> tasks = { {items, 0} }, next;
+			for (; tasks.size() < min_tasks;)
+			{
+				next.resize(0);
+				for (auto& task : tasks)
+				{
+					if (task.items.size() <= ParallelBuildThreshold)
+					{
+						next.push_back(task);
+						continue;
+					}
+
+					auto mid = builder.Split(task.items, task.level);
+					next.push_back({ task.items.subspan(0, mid), task.level + 1 });
+					next.push_back({ task.items.subspan(mid + 1), task.level + 1 });
+				}
+
+				// No more splitting possible
+				if (next.size() == tasks.size())
+					break;
+
+				std::swap(tasks, next);
+			}
+
+			// Build the sub-trees concurrently
+			std::for_each(std::forward<Policy>(policy), std::begin(tasks), std::end(tasks), [&](Task const& task)
+			{
+				builder.Run(task.items, task.level);
+			});
+		}
+
+		// Return the squared distance from 'centre' to 'item'
+		template <GetValueFunc<Item, S> GetValue>
+		static S MeasureDistanceSq(Item const& item, SearchCentre const& centre, GetValue const& get_value)
+		{
+			auto dist_sq = S{};
+			for (int a = 0; a != Dim; ++a)
+			{
+				auto dist = get_value(item, a) - centre[a];
+				dist_sq += dist * dist;
+			}
+			return dist_sq;
+		}
+
+		// Return the squared distances from 'centre' to each item in a leaf bucket.
+		// Loops are axis-major so that the compiler can vectorise across the items in the bucket.
+		template <GetValueFunc<Item, S> GetValue>
+		static void MeasureDistanceSq(std::span<Item const> items, SearchCentre const& centre, GetValue const& get_value, S (&dist_sq)[LeafSize])
+		{
+			assert(items.size() <= LeafSize);
+			auto count = items.size();
+			for (size_t i = 0; i != LeafSize; ++i)
+				dist_sq[i] = S{};
+			for (int a = 0; a != Dim; ++a)
+			{
+				auto c = centre[a];
+				for (size_t i = 0; i != count; ++i)
+				{
+					auto dist = get_value(items[i], a) - c;
+					dist_sq[i] += dist * dist;
+				}
+			}
+		}
+
 		// Search a KD tree for all items within 'radius' of 'centre'.
 		template <GetValueFunc<Item, S> GetValue, GetAxisFunc<Item> GetAxis, FoundFunc<Item, S> Found>
 		static void Find(std::span<Item const> kdtree, SearchCentre const& centre, S radius, GetValue get_value, GetAxis get_axis, Found found)
@@ -191,8 +293,21 @@ namespace pr::kdtree
 					if (items.empty())
 						return;
 
+					// Small sub-trees are cheaper to scan than to descend
+					if (items.size() <= LeafSize)
+					{
+						S dist_sq[LeafSize];
+						MeasureDistanceSq(items, m_centre, m_get_value, dist_sq);
+						for (size_t i = 0; i != items.size(); ++i)
+						{
+							if (dist_sq[i] > m_radius * m_radius) continue;
+							m_found(items[i], dist_sq[i]);
+						}
+						return;
+					}
+
 					auto mid = items.size() / 2;
-					if (auto dist_sq = MeasureDistanceSq(items[mid]); dist_sq <= m_radius * m_radius)
+					if (auto dist_sq = MeasureDistanceSq(items[mid], m_centre, m_get_value); dist_sq <= m_radius * m_radius)
 						m_found(items[mid], dist_sq);
 
 					// Bottom of the tree? Time to leave
@@ -211,18 +326,6 @@ namespace pr::kdtree
 					if (m_centre[split_axis] + m_radius >= split_value)
 						Run(items.subspan(mid + 1));
 				}
-
-				// Return the squared distance from the centre to 'item'
-				S MeasureDistanceSq(Item const& item) const
-				{
-					auto dist_sq = S{};
-					for (int a = 0; a != Dim; ++a)
-					{
-						auto dist = m_get_value(item, a) - m_centre[a];
-						dist_sq += dist * dist;
-					}
-					return dist_sq;
-				}
 			};
 
 			// Recursive search
@@ -264,8 +367,21 @@ namespace pr::kdtree
 					if (items.empty())
 						return;
 
+					// Small sub-trees are cheaper to scan than to descend
+					if (items.size() <= LeafSize)
+					{
+						S dist_sq[LeafSize];
+						MeasureDistanceSq(items, m_centre, m_get_value, dist_sq);
+						for (size_t i = 0; i != items.size(); ++i)
+						{
+							if (dist_sq[i] > m_radius * m_radius) continue;
+							TrackNearest(items[i], dist_sq[i]);
+						}
+						return;
+					}
+
 					auto mid = items.size() / 2;
-					if (auto dist_sq = MeasureDistanceSq(items[mid]); dist_sq <= m_radius * m_radius)
+					if (auto dist_sq = MeasureDistanceSq(items[mid], m_centre, m_get_value); dist_sq <= m_radius * m_radius)
 						TrackNearest(items[mid], dist_sq);
 
 					// Bottom of the tree? Time to leave
@@ -309,18 +425,6 @@ namespace pr::kdtree
 						m_radius = std::sqrt(m_nearest[0].squared_distance);
 					}
 				}
-
-				// Return the squared distance from the centre to 'item'
-				S MeasureDistanceSq(Item const& item) const
-				{
-					S dist_sq = {};
-					for (int a = 0; a != Dim; ++a)
-					{
-						auto dist = m_get_value(item, a) - m_centre[a];
-						dist_sq += dist * dist;
-					}
-					return dist_sq;
-				}
 			};
 
 			// Recursive search
@@ -335,6 +439,83 @@ namespace pr::kdtree
 			return finder.m_count;
 		}
 
+		// Search a KD tree for the 'K' nearest neighbours within 'radius' of each of 'centres'.
+		// 'nearest_out' is a flat array of 'centres.size() * K' neighbours. The neighbours of 'centres[i]' are
+		// returned in 'nearest_out[i*K, i*K + counts_out[i])' in order of increasing distance from the search point.
+		// 'get_value' and 'get_axis' must be safe to call from multiple threads.
+		template <ExecutionPolicy Policy, GetValueFunc<Item, S> GetValue, GetAxisFunc<Item> GetAxis>
+		static void FindNearestBatch(Policy&& policy, std::span<Item const> kdtree, std::span<SearchCentre const> centres, S radius, size_t K, std::span<Neighbour> nearest_out, std::span<size_t> counts_out, GetValue get_value, GetAxis get_axis)
+		{
+			// Notes:
+			//  - Queries are processed in Morton order so that consecutive queries on the same thread
+			//    touch the same parts of the tree. Results are written back in the caller's order.
+			assert(K != 0);
+			assert(nearest_out.size() >= centres.size() * K);
+			assert(counts_out.size() >= centres.size());
+			constexpr size_t QueriesPerTask = 64;
+			if (centres.empty())
+				return;
+
+			// Order the queries along a Z-order curve
+			auto order = MortonOrder(centres);
+
+			// Answer blocks of spatially coherent queries concurrently
+			std::vector<size_t> blocks((order.size() + QueriesPerTask - 1) / QueriesPerTask);
+			for (size_t i = 0; i != blocks.size(); ++i) blocks[i] = i * QueriesPerTask;
+			std::for_each(std::forward<Policy>(policy), std::begin(blocks), std::end(blocks), [&](size_t first)
+			{
+				auto last = std::min(first + QueriesPerTask, order.size());
+				for (auto q = first; q != last; ++q)
+				{
+					auto i = order[q];
+					counts_out[i] = FindNearest(kdtree, centres[i], radius, nearest_out.subspan(i * K, K), get_value, get_axis);
+				}
+			});
+		}
+
+		// Return the indices of 'points' sorted by Morton code (Z-order) within the bounds of 'points'
+		static std::vector<size_t> MortonOrder(std::span<SearchCentre const> points)
+		{
+			constexpr int Bits = std::min(21, 63 / Dim);
+			constexpr auto Cells = static_cast<S>((1ULL << Bits) - 1);
+
+			// Find the bounds of the points
+			S lower[Dim], scale[Dim];
+			for (int a = 0; a != Dim; ++a)
+			{
+				auto upper = points[0][a];
+				lower[a] = points[0][a];
+				for (auto const& pt : points)
+				{
+					lower[a] = std::min(lower[a], pt[a]);
+					upper = std::max(upper, pt[a]);
+				}
+				scale[a] = upper > lower[a] ? Cells / (upper - lower[a]) : S{};
+			}
+
+			// Quantise each point and interleave the bits of each axis
+			struct Key { uint64_t code; size_t index; };
+			std::vector<Key> keys(points.size());
+			for (size_t i = 0; i != points.size(); ++i)
+			{
+				uint64_t code = 0;
+				for (int a = 0; a != Dim; ++a)
+				{
+					auto q = static_cast<uint64_t>((points[i][a] - lower[a]) * scale[a]);
+					for (int b = 0; b != Bits; ++b)
+						code |= ((q >> b) & 1ULL) << (b * Dim + a);
+				}
+				keys[i] = { code, i };
+			}
+			std::sort(std::begin(keys), std::end(keys), [](Key const& lhs, Key const& rhs) { return lhs.code < rhs.code; });
+
+			std::vector<size_t> order(points.size());
+			for (size_t i = 0; i != keys.size(); ++i)
+				order[i] = keys[i].index;
+
+			return order;
+		}
+
 		// Find pairs of items that are the nearest to each other
 		// Pairs are returned in order of increasing separation.
 		// Return value is the number of pairs found (may be less than pairs_out.size()).
@@ -378,6 +559,18 @@ namespace pr::kdtree
 					if (items.empty() || &target >= &items.back())
 						return;
 
+					// Small sub-trees are cheaper to scan than to descend
+					if (items.size() <= LeafSize)
+					{
+						for (auto const& item : items)
+						{
+							if (&target >= &item) continue;
+							if (auto sep_sq = SeparationSq(target, item); sep_sq <= m_radius * m_radius)
+								TrackClosest(target, item, sep_sq);
+						}
+						return;
+					}
+
 					auto mid = items.size() / 2;
 					if (auto sep_sq = SeparationSq(target, items[mid]); sep_sq <= m_radius * m_radius && &target < &items[mid])
 						TrackClosest(target, items[mid], sep_sq);
@@ -925,6 +1118,45 @@ namespace pr::algorithm::tests
 				CheckPairs(points, search_radius, pairs);
 			}
 		}
+		PRUnitTestMethod(ParallelBuildAndBatch)
+		{
+			std::vector<Pt> points(10000);
+			GenerateRandomPoints(points);
+			auto serial = points;
+
+			auto get_value = [](Pt const& p, int a) { return p[a]; };
+			auto set_axis = [](Pt& p, int a) { p.z = static_cast<float>(a); };
+			auto get_axis = [](Pt const& p) { return static_cast<int>(p.z); };
+
+			// The parallel build should produce the same tree as the serial build
+			KDTree::Build(serial, get_value, set_axis);
+			KDTree::Build(std::execution::par, points, get_value, set_axis);
+			PR_EXPECT(points == serial);
+
+			// Batch queries should match individual queries
+			constexpr size_t K = 8;
+			constexpr float search_radius = 1.0f;
+			std::vector<KDTree::SearchCentre> centres(500);
+			for (auto& c : centres)
+			{
+				auto pt = Random<v2>(m_rng, v2::Zero(), 10.0f);
+				c[0] = pt.x;
+				c[1] = pt.y;
+			}
+
+			std::vector<KDTree::Neighbour> batch(centres.size() * K);
+			std::vector<size_t> counts(centres.size());
+			KDTree::FindNearestBatch(std::execution::par, std::span<Pt const>(points), std::span<KDTree::SearchCentre const>(centres), search_radius, K, std::span(batch), std::span(counts), get_value, get_axis);
+
+			std::vector<KDTree::Neighbour> nearest(K);
+			for (size_t i = 0; i != centres.size(); ++i)
+			{
+				auto count = KDTree::FindNearest(points, centres[i], search_radius, std::span(nearest), get_value, get_axis);
+				PR_EXPECT(count == counts[i]);
+				for (size_t j = 0; j != count; ++j)
+					PR_EXPECT(batch[i * K + j].squared_distance == nearest[j].squared_distance);
+			}
+		}
 		PRUnitTestMethod(Degenerates)
 		{
 			std::vector<Pt> points;
@@ -3,6 +3,8 @@
 //  Copyright (c) Rylogic Ltd 2025
 //*********************************************
 // Classical (Torgerson) MDS: embeds items into low-dimensional space preserving pairwise distances.
+// Landmark MDS (de Silva & Tenenbaum): classical MDS on a small set of landmarks, with the remaining
+// items triangulated from their distances to the landmarks. Scales to millions of items.
 #pragma once
 #include <concepts>
 #include <type_traits>
@@ -13,16 +15,53 @@
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <cstdint>
 #include <cassert>
+#include <random>
+#include <limits>
+#include <execution>
 #include "pr/math/math.h"
 
 namespace pr::algorithm::mds
 {
+	// The embedding method
+	enum class EMethod
+	{
+		// Classical MDS on the full N×N distance matrix. O(N²) time and memory. This is the reference method.
+		Full,
+
+		// Classical MDS on a k×k block of landmark distances, then every item is positioned from its distances to
+		// the landmarks. O(N·k) time and memory. Exact for Euclidean distances when the landmarks span the embedding.
+		Landmark,
+	};
+
+	// How landmarks are chosen
+	enum class ELandmarks
+	{
+		// Each landmark is the item furthest from the landmarks chosen so far. Spreads the landmarks over the data.
+		MaxMin,
+
+		// Uniformly random items
+		Random,
+	};
+
 	// Configuration for MDS embedding
 	struct Config
 	{
 		// Number of output dimensions (1, 2, or 3). Unused v4 components are zero-filled, w = 1.
 		int dimensions = 3;
+
+		// The embedding method. With 'Landmark', 'dist' is called from multiple threads.
+		EMethod method = EMethod::Full;
+
+		// The number of landmarks to use with 'EMethod::Landmark'. Clamped to [dimensions + 1, N].
+		int landmarks = 100;
+
+		// How landmarks are chosen
+		ELandmarks landmark_selection = ELandmarks::MaxMin;
+
+		// Seed for the random choices made when selecting landmarks
+		uint32_t seed = 1;
 	};
 
 	// Concept for a distance function between items
@@ -31,6 +70,144 @@ namespace pr::algorithm::mds
 		std::invocable<DistFunc, Item const&, Item const&> && 
 		std::convertible_to<std::invoke_result_t<DistFunc, Item const&, Item const&>, float>;
 
+	// Landmark MDS. See 'EMethod::Landmark'.
+	template <typename Range, typename DistFunc>
+	void EmbedLandmarks(Range&& items, std::span<v4> out, DistFunc dist, int dim, Config const& config)
+	{
+		auto const n = static_cast<int>(std::ranges::size(items));
+		auto const k_max = std::clamp(config.landmarks, dim + 1, n);
+		auto rng = std::default_random_engine(config.seed);
+
+		// Call 'func(beg, end)' for batches of items in parallel
+		auto ParallelBatches = [n](auto func)
+		{
+			constexpr int BatchSize = 4096;
+			auto batches = std::vector<int>{};
+			for (int i = 0; i < n; i += BatchSize)
+				batches.push_back(i);
+
+			std::for_each(std::execution::par, std::begin(batches), std::end(batches), [&](int beg)
+			{
+				func(beg, (std::min)(beg + BatchSize, n));
+			});
+		};
+
+		// Squared distances from each landmark to every item, one row of length N per landmark.
+		// These are all the distances that landmark MDS needs, so 'dist' is called k·N times.
+		auto landmarks = std::vector<int>{};
+		auto D2 = std::vector<float>{};
+		auto AddLandmark = [&](int idx)
+		{
+			landmarks.push_back(idx);
+			D2.resize(landmarks.size() * n);
+			auto row = D2.data() + (landmarks.size() - 1) * n;
+			ParallelBatches([&](int beg, int end)
+			{
+				for (int i = beg; i != end; ++i)
+				{
+					auto d = static_cast<float>(dist(items[idx], items[i]));
+					row[i] = d * d;
+				}
+			});
+		};
+
+		// Step 1: Choose the landmarks
+		if (config.landmark_selection == ELandmarks::MaxMin)
+		{
+			// Squared distance from each item to its nearest landmark
+			auto nearest = std::vector<float>(n, std::numeric_limits<float>::max());
+			AddLandmark(std::uniform_int_distribution<int>(0, n - 1)(rng));
+			for (;;)
+			{
+				auto row = D2.data() + (landmarks.size() - 1) * n;
+				for (int i = 0; i != n; ++i)
+					nearest[i] = (std::min)(nearest[i], row[i]);
+
+				if (static_cast<int>(landmarks.size()) == k_max)
+					break;
+
+				// If the furthest item is on a landmark, all items coincide with landmarks
+				auto next = static_cast<int>(std::max_element(nearest.begin(), nearest.end()) - nearest.begin());
+				if (nearest[next] == 0)
+					break;
+
+				AddLandmark(next);
+			}
+		}
+		else
+		{
+			// Partial Fisher-Yates shuffle
+			auto order = std::vector<int>(n);
+			std::iota(order.begin(), order.end(), 0);
+			for (int i = 0; i != k_max; ++i)
+			{
+				std::swap(order[i], order[std::uniform_int_distribution<int>(i, n - 1)(rng)]);
+				AddLandmark(order[i]);
+			}
+		}
+
+		auto const k = static_cast<int>(landmarks.size());
+		if (k < 2)
+		{
+			// All items are in the same place
+			std::fill(out.begin(), out.begin() + n, v4{ 0, 0, 0, 1 });
+			return;
+		}
+
+		// Step 2: Classical MDS on the landmarks. 'mean[j]' is the mean squared distance from landmark 'j' to the other landmarks.
+		auto mean = std::vector<float>(k, 0.0f);
+		auto grand_mean = 0.0f;
+		for (int j = 0; j != k; ++j)
+		{
+			for (int m = 0; m != k; ++m)
+				mean[j] += D2[j * n + landmarks[m]];
+
+			mean[j] /= static_cast<float>(k);
+			grand_mean += mean[j];
+		}
+		grand_mean /= static_cast<float>(k);
+
+		auto B = Matrix<float>(k, k);
+		for (int i = 0; i != k; ++i)
+			for (int j = 0; j != k; ++j)
+				B(i, j) = -0.5f * (D2[i * n + landmarks[j]] - mean[i] - mean[j] + grand_mean);
+
+		// 'k' is small, so use the full decomposition rather than the iterative one
+		auto const kdim = (std::min)(dim, k - 1);
+		auto eigen = EigenSymmetric(B);
+
+		// The pseudo-inverse transpose of the landmark coordinates: eigenvector 'i' scaled by 1/sqrt(eigenvalue 'i')
+		auto pinv = std::vector<float>(3 * k, 0.0f);
+		for (int i = 0; i != kdim; ++i)
+		{
+			auto lambda = eigen.values(i);
+			auto scale = lambda > 0 ? 1.0f / std::sqrt(lambda) : 0.0f;
+			for (int j = 0; j != k; ++j)
+				pinv[i * k + j] = eigen.vectors(j, i) * scale;
+		}
+
+		// Step 3: Triangulate every item (including the landmarks) from its squared distances to the landmarks.
+		//  x = -1/2 * pinv * (d2 - mean)
+		ParallelBatches([&](int beg, int end)
+		{
+			auto count = end - beg;
+			auto x = std::vector<float>(3 * count, 0.0f);
+			for (int j = 0; j != k; ++j)
+			{
+				auto row = D2.data() + j * n + beg;
+				for (int i = 0; i != kdim; ++i)
+				{
+					auto p = pinv[i * k + j];
+					auto xi = x.data() + i * count;
+					for (int a = 0; a != count; ++a)
+						xi[a] += p * (row[a] - mean[j]);
+				}
+			}
+			for (int a = 0; a != count; ++a)
+				out[beg + a] = v4{ -0.5f * x[0 * count + a], -0.5f * x[1 * count + a], -0.5f * x[2 * count + a], 1 };
+		});
+	}
+
 	// Embed N items into low-dimensional space preserving pairwise distances.
 	// 'dist(items[i], items[j])' must return a float dissimilarity >= 0.
 	// Returns a vector of v4 points with w=1. Unused dimensions are zero.
@@ -54,6 +231,13 @@ namespace pr::algorithm::mds
 		auto const n = static_cast<int>(std::ranges::size(items));
 		auto const dim = (std::min)(config.dimensions, n - 1);
 
+		// Landmark MDS, unless every item would be a landmark anyway
+		if (config.method == EMethod::Landmark && n > (std::max)(config.landmarks, dim + 1))
+		{
+			EmbedLandmarks(items, out, dist, dim, config);
+			return;
+		}
+
 		// Step 1: Build N×N squared distance matrix D²
 		auto D2 = std::vector<float>(n * n, 0.0f);
 		for (int i = 0; i != n; ++i)
@@ -169,6 +353,43 @@ namespace pr::algorithm
 				PR_EXPECT(std::abs(p.w - 1.0f) < 1e-5f);
 			}
 		}
+		PRUnitTestMethod(Landmarks)
+		{
+			// Points in a box. Euclidean distances in 3D are embedded exactly (up to rotation/reflection) by both methods.
+			struct Point { float x, y, z; };
+			auto euclidean = [](Point const& a, Point const& b)
+			{
+				auto dx = a.x - b.x;
+				auto dy = a.y - b.y;
+				auto dz = a.z - b.z;
+				return std::sqrt(dx * dx + dy * dy + dz * dz);
+			};
+
+			std::default_random_engine rng(1);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			auto pts = std::vector<Point>(5000);
+			for (auto& pt : pts)
+				pt = { 4.0f * dist(rng), 2.0f * dist(rng), 1.0f * dist(rng) };
+
+			for (auto selection : { mds::ELandmarks::MaxMin, mds::ELandmarks::Random })
+			{
+				auto result = mds::Embed(pts, euclidean, { .dimensions = 3, .method = mds::EMethod::Landmark, .landmarks = 20, .landmark_selection = selection });
+				PR_EXPECT(result.size() == pts.size());
+
+				for (int i = 0; i < 5000; i += 37)
+				{
+					for (int j = i + 1; j < 5000; j += 501)
+					{
+						auto embed_d = Length(result[i] - result[j]);
+						PR_EXPECT(std::abs(euclidean(pts[i], pts[j]) - embed_d) < 1e-3f);
+					}
+				}
+			}
+
+			// Identical items
+			auto same = mds::Embed(std::vector<Point>(200), euclidean, { .method = mds::EMethod::Landmark, .landmarks = 10 });
+			PR_EXPECT(std::ranges::all_of(same, [](v4 const& p) { return p == v4{ 0, 0, 0, 1 }; }));
+		}
 		PRUnitTestMethod(Visualise)
 		{
 			constexpr int N = 100;
@@ -15,6 +15,11 @@
 // Primary use: Polytope vs any shape (fills the tri-table Polytope entries).
 // Can also serve as a generic fallback for any convex pair.
 //
+// Queries of the same pair on consecutive frames can share a 'gjk::Cache'. The last separating
+// axis, the enclosing simplex, and the support hints are kept in shape space and re-transformed at
+// the start of the next query. A pair that is still separated by the same axis costs one support
+// call; a pair whose cached simplex still encloses the origin goes straight to EPA.
+//
 #pragma once
 #include "pr/collision/forward.h"
 #include "pr/collision/shape.h"
@@ -69,6 +74,24 @@ namespace pr::collision
 			}
 		};
 
+		// Per-pair state carried from one query of a shape pair to the next (e.g. across physics steps).
+		// Default construct one per pair and pass it to every query of that pair. 'Reset' if the shapes change.
+		struct Cache
+		{
+			v4 m_axis = {};     // The last separating axis in shape A space (zero if the last query wasn't separated)
+			v4 m_a[4] = {};     // The last enclosing simplex, support vertices in shape A space
+			v4 m_b[4] = {};     // The last enclosing simplex, support vertices in shape B space
+			bool m_enclosed = false; // True if 'm_a/m_b' hold an enclosing simplex
+			int m_ha = 0;       // Support vertex hints
+			int m_hb = 0;
+			int m_supports = 0; // The number of GJK support calls made by the last query, excluding EPA (diagnostic)
+
+			void Reset()
+			{
+				*this = Cache{};
+			}
+		};
+
 		// ---- Simplex cases ----
 		// Each function updates the simplex to the closest feature to the origin,
 		// sets the new search direction, and returns true if the origin is enclosed.
@@ -194,6 +217,26 @@ namespace pr::collision
 			return false;
 		}
 
+		// True if the tetrahedron 'sx' contains the origin. Unlike 'SimplexTetra', all four faces are
+		// tested, because a re-transformed simplex carries no information about where the origin was.
+		inline bool TetraContainsOrigin(Simplex const& sx)
+		{
+			if (sx.n != 4)
+				return false;
+
+			static constexpr int faces[4][4] = { {0,1,2,3}, {0,2,3,1}, {0,3,1,2}, {1,3,2,0} };
+			for (auto& f : faces)
+			{
+				auto p = sx.s[f[0]].w;
+				auto n = Cross(sx.s[f[1]].w - p, sx.s[f[2]].w - p);
+				auto side_opp = Dot3(n, sx.s[f[3]].w - p);
+				auto side_org = Dot3(n, -p);
+				if (side_opp * side_org < 0 || Abs(side_opp) < Eps)
+					return false;
+			}
+			return true;
+		}
+
 		// ---- EPA (Expanding Polytope Algorithm) ----
 
 		struct Face
@@ -354,51 +397,45 @@ namespace pr::collision
 		}
 	}
 
-	// GJK + EPA collision detection for two arbitrary convex shapes.
-	// Compatible with the tri-table function signature.
-	inline bool pr_vectorcall GjkCollide(Shape const& lhs, m4x4 const& l2w, Shape const& rhs, m4x4 const& r2w, Contact& contact)
+	namespace gjk
 	{
-		using namespace gjk;
-
-		// Compute shape-to-world and world-to-shape transforms
-		auto a2w = l2w * lhs.m_s2p;
-		auto b2w = r2w * rhs.m_s2p;
-		auto w2a = InvertOrthonormal(a2w);
-		auto w2b = InvertOrthonormal(b2w);
-
-		int ha = 0, hb = 0; // support vertex hints (warm-start for polytopes)
-
-		// Initial search direction: from B's centre toward A's centre
-		auto dir = (a2w.pos - b2w.pos).w0();
-		if (LengthSq(dir) < Eps)
-			dir = v4::XAxis();
-
-		// Seed the simplex with the first support point
-		Simplex sx;
-		auto sup = MkSupport(lhs, a2w, w2a, rhs, b2w, w2b, dir, ha, hb);
-		sx.Push(sup);
-		dir = -sup.w;
-
-		// GJK main loop: build a simplex that (hopefully) encloses the origin
-		for (int iter = 0; iter < MaxIter; ++iter)
+		// GJK + EPA, optionally warm-started from (and saving to) 'cache'
+		inline bool Collide(Shape const& lhs, m4x4 const& l2w, Shape const& rhs, m4x4 const& r2w, Contact& contact, Cache* cache)
 		{
-			if (LengthSq(dir) < Eps)
-				break;
-
-			sup = MkSupport(lhs, a2w, w2a, rhs, b2w, w2b, dir, ha, hb);
-
-			// If the new support point doesn't pass the origin, shapes are separated
-			if (Dot3(sup.w, dir) < 0)
-				return false;
-
-			sx.Push(sup);
+			// Compute shape-to-world and world-to-shape transforms
+			auto a2w = l2w * lhs.m_s2p;
+			auto b2w = r2w * rhs.m_s2p;
+			auto w2a = InvertOrthonormal(a2w);
+			auto w2b = InvertOrthonormal(b2w);
+
+			int ha = 0, hb = 0; // support vertex hints (warm-start for polytopes)
+			int supports = 0;
+			Simplex sx;
+
+			// Record the result for the next query of this pair
+			auto Save = [&](v4 const* sep_axis, bool enclosed)
+			{
+				if (cache == nullptr) return;
+				cache->m_axis = sep_axis ? w2a * *sep_axis : v4::Zero();
+				cache->m_enclosed = enclosed;
+				for (int i = 0; enclosed && i != 4; ++i)
+				{
+					cache->m_a[i] = w2a * sx.s[i].a;
+					cache->m_b[i] = w2b * sx.s[i].b;
+				}
+				cache->m_ha = ha;
+				cache->m_hb = hb;
+				cache->m_supports = supports;
+			};
 
-			if (DoSimplex(sx, dir))
+			// The simplex encloses the origin, run EPA for penetration info
+			auto Penetration = [&]
 			{
-				// Origin enclosed — shapes overlap. Run EPA for penetration info.
 				v4 normal, ptA, ptB;
 				float depth;
-				if (!Epa(lhs, a2w, w2a, rhs, b2w, w2b, sx, ha, hb, normal, depth, ptA, ptB))
+				auto ok = Epa(lhs, a2w, w2a, rhs, b2w, w2b, sx, ha, hb, normal, depth, ptA, ptB);
+				Save(nullptr, ok);
+				if (!ok)
 					return false;
 
 				// Orient axis from lhs toward rhs (convention: axis points A→B)
@@ -410,9 +447,91 @@ namespace pr::collision
 				contact.m_mat_idA = lhs.m_material_id;
 				contact.m_mat_idB = rhs.m_material_id;
 				return true;
+			};
+
+			// Initial search direction: from B's centre toward A's centre
+			auto dir = (a2w.pos - b2w.pos).w0();
+			if (cache != nullptr)
+			{
+				ha = cache->m_ha;
+				hb = cache->m_hb;
+
+				// If last query's enclosing simplex (at the current transforms) still contains the origin, skip GJK
+				if (cache->m_enclosed)
+				{
+					sx.n = 4;
+					for (int i = 0; i != 4; ++i)
+					{
+						auto a = (a2w * cache->m_a[i]).w1();
+						auto b = (b2w * cache->m_b[i]).w1();
+						sx.s[i] = { (a - b).w0(), a, b };
+					}
+					if (TetraContainsOrigin(sx))
+						return Penetration();
+
+					sx.n = 0;
+				}
+
+				// Otherwise, start with the last separating axis
+				if (LengthSq(cache->m_axis) > Eps)
+					dir = a2w * cache->m_axis;
+			}
+			if (LengthSq(dir) < Eps)
+				dir = v4::XAxis();
+
+			// Seed the simplex with the first support point
+			auto sup = MkSupport(lhs, a2w, w2a, rhs, b2w, w2b, dir, ha, hb);
+			++supports;
+
+			// If the first support point doesn't reach the origin, 'dir' is a separating axis
+			if (Dot3(sup.w, dir) < 0)
+			{
+				Save(&dir, false);
+				return false;
+			}
+
+			sx.Push(sup);
+			dir = -sup.w;
+
+			// GJK main loop: build a simplex that (hopefully) encloses the origin
+			for (int iter = 0; iter < MaxIter; ++iter)
+			{
+				if (LengthSq(dir) < Eps)
+					break;
+
+				sup = MkSupport(lhs, a2w, w2a, rhs, b2w, w2b, dir, ha, hb);
+				++supports;
+
+				// If the new support point doesn't pass the origin, shapes are separated
+				if (Dot3(sup.w, dir) < 0)
+				{
+					Save(&dir, false);
+					return false;
+				}
+
+				sx.Push(sup);
+
+				// Origin enclosed — shapes overlap
+				if (DoSimplex(sx, dir))
+					return Penetration();
 			}
+
+			Save(nullptr, false);
+			return false; // GJK did not converge
 		}
-		return false; // GJK did not converge
+	}
+
+	// GJK + EPA collision detection for two arbitrary convex shapes.
+	// Compatible with the tri-table function signature.
+	inline bool pr_vectorcall GjkCollide(Shape const& lhs, m4x4 const& l2w, Shape const& rhs, m4x4 const& r2w, Contact& contact)
+	{
+		return gjk::Collide(lhs, l2w, rhs, r2w, contact, nullptr);
+	}
+
+	// GJK + EPA collision detection, warm-started from the previous query of the same pair.
+	inline bool pr_vectorcall GjkCollide(Shape const& lhs, m4x4 const& l2w, Shape const& rhs, m4x4 const& r2w, Contact& contact, gjk::Cache& cache)
+	{
+		return gjk::Collide(lhs, l2w, rhs, r2w, contact, &cache);
 	}
 }
 
@@ -584,6 +703,43 @@ namespace pr::collision::tests
 			// Separated — should not collide
 			PR_EXPECT(!GjkCollide(pa, m4x4::Identity(), pb, m4x4::Translation(v4{10, 0, 0, 0}), c));
 		}
+
+		// Per-pair cache: repeated queries with small motions reuse the last axis/simplex
+		PRUnitTestMethod(CachedQueries)
+		{
+			auto ba = ShapeBox{v4{2, 2, 2, 0}};
+			auto bb = ShapeBox{v4{2, 2, 2, 0}};
+			gjk::Cache cache;
+			Contact c;
+
+			// Still separated by the cached axis: one support call
+			PR_EXPECT(!GjkCollide(ba, m4x4::Identity(), bb, m4x4::Translation(v4{5.0f, 0, 0, 0}), c, cache));
+			PR_EXPECT(!GjkCollide(ba, m4x4::Identity(), bb, m4x4::Translation(v4{4.9f, 0.1f, 0, 0}), c, cache));
+			PR_EXPECT(cache.m_supports == 1);
+
+			// Still enclosed by the cached simplex: straight to EPA
+			PR_EXPECT(GjkCollide(ba, m4x4::Identity(), bb, m4x4::Translation(v4{1.5f, 0, 0, 0}), c, cache));
+			PR_EXPECT(GjkCollide(ba, m4x4::Identity(), bb, m4x4::Translation(v4{1.51f, 0.01f, 0, 0}), c, cache));
+			PR_EXPECT(cache.m_supports == 0);
+			PR_EXPECT(FEqlRelative(c.m_depth, 0.49f, 0.01f));
+
+			// Cached and uncached queries agree as the pair moves in and out of contact
+			auto sph = ShapeSphere{0.7f};
+			cache.Reset();
+			for (int i = 0; i != 40; ++i)
+			{
+				auto t = i * 0.05f;
+				auto l2w = m4x4::Transform(RotationRad<m3x4>(0, 0, 0.3f * t), v4::Origin());
+				auto r2w = m4x4::Translation(v4{2.5f - t, 0.2f, 0.1f, 0});
+
+				Contact c0, c1;
+				auto r0 = GjkCollide(ba, l2w, sph, r2w, c0);
+				auto r1 = GjkCollide(ba, l2w, sph, r2w, c1, cache);
+				PR_EXPECT(r0 == r1);
+				if (r0 && r1)
+					PR_EXPECT(FEqlRelative(c0.m_depth, c1.m_depth, 0.01f));
+			}
+		}
 	};
 }
 #endif
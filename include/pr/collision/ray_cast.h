@@ -52,7 +52,7 @@ namespace pr::collision
 		
 		// Find the closest point to the line
 		auto closest_point   = ray.m_point - ray.m_direction * (Dot(ray.m_direction, ray.m_point) / direction_lenSq);
-		auto closest_distSq  = LengthSq(closest_point);
+		auto closest_distSq  = LengthSq(closest_point.w0());
 		auto radius          = shape.m_radius + ray.m_thickness;
 		auto radiusSq        = radius * radius;
 
@@ -83,13 +83,12 @@ namespace pr::collision
 		// For each side of the box
 		result.m_t0 = 0.0f;
 		result.m_t1 = 1.0f;
-		result.m_shape = &shape.m_base;
 		for (auto i = 0; i != 3; ++i)
 		{
 			if (Abs(ray.m_direction[i]) < math::tiny<float>)
 			{
-				if (Abs(ray.m_point[i]) > shape.m_radius[i])
-					return result;
+				if (Abs(ray.m_point[i]) > shape.m_radius[i] + ray.m_thickness)
+					return RayCastResult{};
 			}
 			else
 			{
@@ -119,10 +118,11 @@ namespace pr::collision
 				}
 				if (result.m_t0 > result.m_t1)
 				{
-					return result;
+					return RayCastResult{};
 				}
 			}
 		}
+		result.m_shape = &shape.m_base;
 		return result;
 	}
 
@@ -0,0 +1,727 @@
+//*********************************************
+// Collision
+//  Copyright (c) Rylogic Ltd 2026
+//*********************************************
+// Ray packets.
+// Casts four rays at a time against a shape using SSE. The rays are stored in SoA form, one ray
+// per lane, so a packet is transformed into shape space once and each primitive is tested against
+// all four rays without branching. Composite shapes are traversed using the bounding boxes of their
+// children, skipping any child that no ray in the packet can hit nearer than its current nearest hit.
+//
+// Unlike the single ray 'RayCast' functions, packet results are clipped to the ray segment. A ray hits
+// a shape if some part of it, t ∈ [0,1], is inside the shape, and [m_t0,m_t1] is that part. Casts only
+// replace a ray's result when they find a nearer hit, so one result can be passed to several casts.
+//
+// For batches of rays, use:
+//   RayCastWS(std::span<Ray const> rays, shape, s2w, std::span<RayCastResult> results);
+//
+#pragma once
+#include "pr/collision/forward.h"
+#include "pr/collision/shape.h"
+#include "pr/collision/ray.h"
+#include "pr/collision/ray_cast.h"
+#include "pr/collision/ray_cast_result.h"
+
+namespace pr::collision
+{
+	namespace impl::packet
+	{
+		// Three component vectors, one per lane
+		struct Vec3x4
+		{
+			__m128 x, y, z;
+		};
+
+		inline Vec3x4 Splat(v4 v)
+		{
+			return { _mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z) };
+		}
+		inline Vec3x4 Add(Vec3x4 const& a, Vec3x4 const& b)
+		{
+			return { _mm_add_ps(a.x, b.x), _mm_add_ps(a.y, b.y), _mm_add_ps(a.z, b.z) };
+		}
+		inline Vec3x4 Sub(Vec3x4 const& a, Vec3x4 const& b)
+		{
+			return { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+		}
+		inline Vec3x4 Mul(Vec3x4 const& a, __m128 s)
+		{
+			return { _mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s) };
+		}
+		inline __m128 Dot(Vec3x4 const& a, Vec3x4 const& b)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+		}
+		inline Vec3x4 Cross(Vec3x4 const& a, Vec3x4 const& b)
+		{
+			return {
+				_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+				_mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+				_mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x)),
+			};
+		}
+
+		// Per-lane 'mask ? a : b'
+		inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+		inline Vec3x4 Select(__m128 mask, Vec3x4 const& a, Vec3x4 const& b)
+		{
+			return { Select(mask, a.x, b.x), Select(mask, a.y, b.y), Select(mask, a.z, b.z) };
+		}
+
+		// Convert a bit mask of lanes (as returned by '_mm_movemask_ps') to a lane mask
+		inline __m128 LaneMask(int bits)
+		{
+			auto lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+			return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lane_bits), lane_bits));
+		}
+
+		// Transform 'v' by 'm'. Points include the translation of 'm', directions don't.
+		inline Vec3x4 Transform(m4x4 const& m, Vec3x4 const& v, bool point)
+		{
+			auto r = Add(Add(Mul(Splat(m.x), v.x), Mul(Splat(m.y), v.y)), Mul(Splat(m.z), v.z));
+			return point ? Add(r, Splat(m.w)) : r;
+		}
+	}
+
+	// Four rays in SoA form
+	struct alignas(16) RayPacket
+	{
+		static constexpr int Width = 4;
+
+		impl::packet::Vec3x4 m_point;     // The origins of the rays
+		impl::packet::Vec3x4 m_direction; // The directions of the rays. The end of each ray is at t = 1
+		__m128               m_thickness; // The thickness of each ray
+		int                  m_count;     // The number of rays in the packet. Unused lanes repeat the last ray
+
+		RayPacket() = default;
+		explicit RayPacket(std::span<Ray const> rays)
+			:m_count(static_cast<int>(std::min<size_t>(rays.size(), Width)))
+		{
+			assert("A packet needs at least one ray" && !rays.empty());
+
+			alignas(16) float f[7][Width];
+			for (int i = 0; i != Width; ++i)
+			{
+				auto const& ray = rays[std::min(i, m_count - 1)];
+				f[0][i] = ray.m_point.x;
+				f[1][i] = ray.m_point.y;
+				f[2][i] = ray.m_point.z;
+				f[3][i] = ray.m_direction.x;
+				f[4][i] = ray.m_direction.y;
+				f[5][i] = ray.m_direction.z;
+				f[6][i] = ray.m_thickness;
+			}
+			m_point = { _mm_load_ps(f[0]), _mm_load_ps(f[1]), _mm_load_ps(f[2]) };
+			m_direction = { _mm_load_ps(f[3]), _mm_load_ps(f[4]), _mm_load_ps(f[5]) };
+			m_thickness = _mm_load_ps(f[6]);
+		}
+
+		// Read a single ray from the packet
+		Ray Lane(int i) const
+		{
+			assert("Lane index out of range" && i >= 0 && i < Width);
+			alignas(16) float f[7][Width];
+			_mm_store_ps(f[0], m_point.x);
+			_mm_store_ps(f[1], m_point.y);
+			_mm_store_ps(f[2], m_point.z);
+			_mm_store_ps(f[3], m_direction.x);
+			_mm_store_ps(f[4], m_direction.y);
+			_mm_store_ps(f[5], m_direction.z);
+			_mm_store_ps(f[6], m_thickness);
+			return Ray(v4(f[0][i], f[1][i], f[2][i], 1.0f), v4(f[3][i], f[4][i], f[5][i], 0.0f), f[6][i]);
+		}
+
+		// Operators
+		friend RayPacket operator * (m4x4 const& lhs, RayPacket const& rhs)
+		{
+			auto packet = rhs;
+			packet.m_point = impl::packet::Transform(lhs, rhs.m_point, true);
+			packet.m_direction = impl::packet::Transform(lhs, rhs.m_direction, false);
+			return packet;
+		}
+	};
+
+	// The nearest hits for a packet of rays
+	struct alignas(16) RayPacketResult
+	{
+		impl::packet::Vec3x4 m_normal;                  // The normal of the incident face
+		__m128               m_t0, m_t1;                // The parametric range of the portion of each ray inside the shape
+		Shape const*         m_shape[RayPacket::Width]; // The primitive that each ray hit, or nullptr
+
+		RayPacketResult()
+			:m_normal({ _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() })
+			,m_t0(_mm_set1_ps(limits<float>::max()))
+			,m_t1(_mm_set1_ps(limits<float>::max()))
+			,m_shape()
+		{}
+
+		// Read/Write a single ray result
+		RayCastResult Lane(int i) const
+		{
+			assert("Lane index out of range" && i >= 0 && i < RayPacket::Width);
+			alignas(16) float f[5][RayPacket::Width];
+			_mm_store_ps(f[0], m_normal.x);
+			_mm_store_ps(f[1], m_normal.y);
+			_mm_store_ps(f[2], m_normal.z);
+			_mm_store_ps(f[3], m_t0);
+			_mm_store_ps(f[4], m_t1);
+
+			RayCastResult result;
+			if (m_shape[i] != nullptr)
+			{
+				result.m_normal = v4(f[0][i], f[1][i], f[2][i], 0.0f);
+				result.m_shape = m_shape[i];
+				result.m_t0 = f[3][i];
+				result.m_t1 = f[4][i];
+			}
+			return result;
+		}
+		void Lane(int i, RayCastResult const& result)
+		{
+			assert("Lane index out of range" && i >= 0 && i < RayPacket::Width);
+			alignas(16) float f[5][RayPacket::Width];
+			_mm_store_ps(f[0], m_normal.x);
+			_mm_store_ps(f[1], m_normal.y);
+			_mm_store_ps(f[2], m_normal.z);
+			_mm_store_ps(f[3], m_t0);
+			_mm_store_ps(f[4], m_t1);
+
+			auto miss = result.m_shape == nullptr;
+			f[0][i] = result.m_normal.x;
+			f[1][i] = result.m_normal.y;
+			f[2][i] = result.m_normal.z;
+			f[3][i] = miss ? limits<float>::max() : result.m_t0;
+			f[4][i] = miss ? limits<float>::max() : result.m_t1;
+			m_shape[i] = result.m_shape;
+
+			m_normal = { _mm_load_ps(f[0]), _mm_load_ps(f[1]), _mm_load_ps(f[2]) };
+			m_t0 = _mm_load_ps(f[3]);
+			m_t1 = _mm_load_ps(f[4]);
+		}
+	};
+
+	// Forward
+	int RayCast(RayPacket const& packet, Shape const& shape, RayPacketResult& result);
+
+	// Implementation details
+	namespace impl::packet
+	{
+		// Record the lanes of 'hit' that are nearer than the current nearest hits.
+		// Returns a bit mask of the lanes that were recorded.
+		inline int Record(RayPacketResult& result, __m128 hit, __m128 t0, __m128 t1, Vec3x4 const& normal, Shape const* shape)
+		{
+			hit = _mm_and_ps(hit, _mm_cmplt_ps(t0, result.m_t0));
+			auto bits = _mm_movemask_ps(hit);
+			if (bits == 0)
+				return 0;
+
+			result.m_normal = Select(hit, normal, result.m_normal);
+			result.m_t0 = Select(hit, t0, result.m_t0);
+			result.m_t1 = Select(hit, t1, result.m_t1);
+			for (int i = 0; i != RayPacket::Width; ++i)
+			{
+				if (bits & (1 << i))
+					result.m_shape[i] = shape;
+			}
+			return bits;
+		}
+
+		// Clip each ray against the slabs of an axis aligned box. Returns the lanes where the ray segment
+		// overlaps the box, with [t0,t1] the overlapping range. 'normal' is the face the ray enters through,
+		// or zero if the ray starts inside the box.
+		inline __m128 Slabs(RayPacket const& packet, v4 centre, v4 radius, __m128& t0, __m128& t1, Vec3x4& normal)
+		{
+			auto zero = _mm_setzero_ps();
+			auto abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+			auto tiny = _mm_set1_ps(math::tiny<float>);
+			auto huge = _mm_set1_ps(limits<float>::max());
+			auto p = Sub(packet.m_point, Splat(centre));
+			auto r = Add(Splat(radius), Vec3x4{ packet.m_thickness, packet.m_thickness, packet.m_thickness });
+
+			__m128 const* P[] = { &p.x, &p.y, &p.z };
+			__m128 const* D[] = { &packet.m_direction.x, &packet.m_direction.y, &packet.m_direction.z };
+			__m128 const* R[] = { &r.x, &r.y, &r.z };
+			__m128 near_t[3], sign[3];
+
+			t0 = zero;
+			t1 = _mm_set1_ps(1.0f);
+			for (int i = 0; i != 3; ++i)
+			{
+				// Rays parallel to the slab get a huge inverse so that they are either entirely inside or outside it
+				auto d = *D[i];
+				auto parallel = _mm_cmplt_ps(_mm_and_ps(d, abs_mask), tiny);
+				auto inv_d = Select(parallel, huge, _mm_div_ps(_mm_set1_ps(1.0f), d));
+
+				// Intersection 't' values with the -r and +r planes
+				auto ta = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(zero, *R[i]), *P[i]), inv_d);
+				auto tb = _mm_mul_ps(_mm_sub_ps(*R[i], *P[i]), inv_d);
+				near_t[i] = _mm_min_ps(ta, tb);
+				sign[i] = Select(_mm_cmpgt_ps(d, zero), _mm_set1_ps(-1.0f), _mm_set1_ps(+1.0f));
+
+				t0 = _mm_max_ps(t0, near_t[i]);
+				t1 = _mm_min_ps(t1, _mm_max_ps(ta, tb));
+			}
+
+			// The entry face is the first axis whose near plane gives 't0'
+			auto entered = _mm_cmpgt_ps(t0, zero);
+			auto on_x = _mm_and_ps(entered, _mm_cmpeq_ps(near_t[0], t0));
+			auto on_y = _mm_andnot_ps(on_x, _mm_and_ps(entered, _mm_cmpeq_ps(near_t[1], t0)));
+			auto on_z = _mm_andnot_ps(_mm_or_ps(on_x, on_y), _mm_and_ps(entered, _mm_cmpeq_ps(near_t[2], t0)));
+			normal = { _mm_and_ps(on_x, sign[0]), _mm_and_ps(on_y, sign[1]), _mm_and_ps(on_z, sign[2]) };
+
+			return _mm_cmple_ps(t0, t1);
+		}
+
+		// Clip each ray against a bounding box, for culling. Returns the lanes that could hit something within the box,
+		// with 't0' a lower bound on the parametric value of any such hit. Thick rays hit triangles using a ray that is
+		// shifted forward and sideways by up to 'thickness' (see 'impl::ShiftTowardOrigin'), so for those lanes the
+		// box is inflated by an extra 'thickness', the segment is extended by 'thickness/|d|', and 't0' is reduced by the
+		// same amount.
+		inline __m128 CullBounds(RayPacket const& packet, BBox const& bbox, __m128& t0, __m128& t1, Vec3x4& normal)
+		{
+			auto zero = _mm_setzero_ps();
+			auto thick = _mm_cmpgt_ps(packet.m_thickness, zero);
+			if (_mm_movemask_ps(thick) == 0)
+				return Slabs(packet, bbox.m_centre, bbox.m_radius, t0, t1, normal);
+
+			// The forward shift, as a fraction of each ray. Zero for thin rays and rays too short to be shifted.
+			auto one = _mm_set1_ps(1.0f);
+			auto direction_len = _mm_sqrt_ps(Dot(packet.m_direction, packet.m_direction));
+			auto shift = _mm_and_ps(_mm_and_ps(thick, _mm_cmpge_ps(direction_len, _mm_set1_ps(math::tiny<float>))), _mm_div_ps(packet.m_thickness, direction_len));
+			auto scale = _mm_add_ps(one, shift);
+
+			auto widened = packet;
+			widened.m_direction = Mul(packet.m_direction, scale);
+			widened.m_thickness = _mm_add_ps(packet.m_thickness, packet.m_thickness);
+			auto hit = Slabs(widened, bbox.m_centre, bbox.m_radius, t0, t1, normal);
+
+			// Convert back to parametric values on the original rays
+			t0 = _mm_sub_ps(_mm_mul_ps(t0, scale), shift);
+			t1 = _mm_mul_ps(t1, scale);
+			return hit;
+		}
+
+		// Cast each ray in the packet individually. For shapes without a packet implementation
+		template <typename Shp>
+		int RayCastPerLane(RayPacket const& packet, Shp const& shape, RayPacketResult& result)
+		{
+			RayPacketResult lanes;
+			for (int i = 0; i != packet.m_count; ++i)
+			{
+				// Clip to the ray segment
+				auto res = RayCast(packet.Lane(i), shape);
+				if (res.m_shape == nullptr)
+					continue;
+
+				res.m_t0 = std::max(res.m_t0, 0.0f);
+				res.m_t1 = std::min(res.m_t1, 1.0f);
+				if (res.m_t0 <= res.m_t1)
+					lanes.Lane(i, res);
+			}
+
+			auto hit = _mm_cmplt_ps(lanes.m_t0, _mm_set1_ps(limits<float>::max()));
+			return Record(result, hit, lanes.m_t0, lanes.m_t1, lanes.m_normal, &shape.m_base);
+		}
+	}
+
+	// Packet vs. Sphere
+	template <typename = void>
+	int RayCast(RayPacket const& packet, ShapeSphere const& shape, RayPacketResult& result)
+	{
+		using namespace impl::packet;
+		auto zero = _mm_setzero_ps();
+		auto one = _mm_set1_ps(1.0f);
+		auto const& p = packet.m_point;
+		auto const& d = packet.m_direction;
+
+		// Find the closest point on each line to the centre
+		auto direction_lenSq = Dot(d, d);
+		auto inv_lenSq = _mm_div_ps(one, direction_lenSq);
+		auto t_closest = _mm_sub_ps(zero, _mm_mul_ps(Dot(d, p), inv_lenSq));
+		auto closest_point = Add(p, Mul(d, t_closest));
+		auto closest_distSq = Dot(closest_point, closest_point);
+		auto radius = _mm_add_ps(_mm_set1_ps(shape.m_radius), packet.m_thickness);
+		auto radiusSq = _mm_mul_ps(radius, radius);
+
+		// Parametric distance from the closest point to the boundary of the sphere
+		auto x = _mm_sqrt_ps(_mm_mul_ps(_mm_max_ps(_mm_sub_ps(radiusSq, closest_distSq), zero), inv_lenSq));
+		auto t0 = _mm_sub_ps(t_closest, x);
+		auto t1 = _mm_add_ps(t_closest, x);
+		auto normal = Mul(Add(p, Mul(d, t0)), _mm_div_ps(one, radius));
+
+		// Clip to the ray segment
+		auto hit = _mm_and_ps(
+			_mm_cmpge_ps(direction_lenSq, _mm_set1_ps(Sqr(math::tiny<float>))),
+			_mm_cmpge_ps(radiusSq, closest_distSq));
+		t0 = _mm_max_ps(t0, zero);
+		t1 = _mm_min_ps(t1, one);
+		hit = _mm_and_ps(hit, _mm_cmple_ps(t0, t1));
+
+		return Record(result, hit, t0, t1, normal, &shape.m_base);
+	}
+
+	// Packet vs. Box
+	template <typename = void>
+	int RayCast(RayPacket const& packet, ShapeBox const& shape, RayPacketResult& result)
+	{
+		using namespace impl::packet;
+
+		__m128 t0, t1; Vec3x4 normal;
+		auto hit = Slabs(packet, v4::Origin(), shape.m_radius, t0, t1, normal);
+		return Record(result, hit, t0, t1, normal, &shape.m_base);
+	}
+
+	// Packet vs. Line
+	template <typename = void>
+	int RayCast(RayPacket const& packet, ShapeLine const& shape, RayPacketResult& result)
+	{
+		(void)packet;
+		(void)shape;
+		(void)result;
+		throw std::runtime_error("Not implemented");
+	}
+
+	// Packet vs. Triangle
+	template <typename = void>
+	int RayCast(RayPacket const& packet, ShapeTriangle const& shape, RayPacketResult& result)
+	{
+		using namespace impl::packet;
+		auto zero = _mm_setzero_ps();
+		auto one = _mm_set1_ps(1.0f);
+		auto tiny = _mm_set1_ps(math::tiny<float>);
+		auto p = packet.m_point;
+		auto const& d = packet.m_direction;
+
+		// Adjust the rays to account for their thickness (see 'impl::ShiftTowardOrigin')
+		auto thick = _mm_cmpgt_ps(packet.m_thickness, zero);
+		if (_mm_movemask_ps(thick) != 0)
+		{
+			auto direction_len = _mm_sqrt_ps(Dot(d, d));
+			auto forward = Mul(d, _mm_div_ps(one, direction_len));
+			auto sideways = Sub(Mul(forward, Dot(p, forward)), p);
+			auto sideways_len = _mm_sqrt_ps(Dot(sideways, sideways));
+			sideways = Mul(sideways, _mm_and_ps(_mm_cmpgt_ps(sideways_len, tiny), _mm_div_ps(one, sideways_len)));
+
+			auto shifted = Add(p, Add(
+				Mul(forward, _mm_min_ps(direction_len, packet.m_thickness)),
+				Mul(sideways, _mm_min_ps(sideways_len, packet.m_thickness))));
+			p = Select(_mm_and_ps(thick, _mm_cmpge_ps(direction_len, tiny)), shifted, p);
+		}
+
+		// Test that each line passes inside the edges of the triangle, using the
+		// signed tetrahedral volumes (see 'geometry::intersect::RayVsTriangle')
+		auto a = Splat(shape.m_v.x);
+		auto b = Splat(shape.m_v.y);
+		auto c = Splat(shape.m_v.z);
+		auto sa = Sub(a, p);
+		auto sb = Sub(b, p);
+		auto sc = Sub(c, p);
+		auto bx = Dot(d, Cross(sc, sb));
+		auto by = Dot(d, Cross(sa, sc));
+		auto bz = Dot(d, Cross(sb, sa));
+		auto sum = _mm_add_ps(_mm_add_ps(bx, by), bz);
+		auto denom = _mm_div_ps(one, sum);
+		bx = _mm_mul_ps(bx, denom);
+		by = _mm_mul_ps(by, denom);
+		bz = _mm_mul_ps(bz, denom);
+
+		auto neg_tiny = _mm_sub_ps(zero, tiny);
+		auto hit = _mm_cmpge_ps(_mm_and_ps(sum, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF))), tiny);
+		hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(bx, neg_tiny), _mm_and_ps(_mm_cmpgt_ps(by, neg_tiny), _mm_cmpgt_ps(bz, neg_tiny))));
+
+		// Parametric value of the intercept, which must be on the ray segment
+		auto intercept = Add(Add(Mul(a, bx), Mul(b, by)), Mul(c, bz));
+		auto t = _mm_div_ps(Dot(Sub(intercept, p), d), Dot(d, d));
+		hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmple_ps(t, one)));
+
+		// The normal faces the side the rays come from
+		auto f2b = Select(_mm_cmpgt_ps(denom, zero), one, _mm_set1_ps(-1.0f));
+		auto normal = Mul(Splat(shape.m_v.w), f2b);
+
+		return Record(result, hit, t, t, normal, &shape.m_base);
+	}
+
+	// Packet vs. Polytope
+	template <typename = void>
+	int RayCast(RayPacket const& packet, ShapePolytope const& shape, RayPacketResult& result)
+	{
+		return impl::packet::RayCastPerLane(packet, shape, result);
+	}
+
+	// Packet vs. Array
+	template <typename = void>
+	int RayCast(RayPacket const& packet, ShapeArray const& shape, RayPacketResult& result)
+	{
+		using namespace impl::packet;
+
+		auto bits = 0;
+		for (Shape const *s = shape.begin(), *s_end = shape.end(); s != s_end; s = next(s))
+		{
+			// Transform the packet into shape space
+			auto packet_ss = InvertOrthonormal(s->m_s2p) * packet;
+
+			// Skip shapes that no ray can hit nearer than its current nearest hit
+			__m128 t0, t1; Vec3x4 normal;
+			auto hit = CullBounds(packet_ss, s->m_bbox, t0, t1, normal);
+			if (_mm_movemask_ps(_mm_and_ps(hit, _mm_cmplt_ps(t0, result.m_t0))) == 0)
+				continue;
+
+			// Cast recursively, then transform the normals of any new nearest hits into this shape's space
+			auto hits = RayCast(packet_ss, *s, result);
+			if (hits == 0)
+				continue;
+
+			result.m_normal = Select(LaneMask(hits), Transform(s->m_s2p, result.m_normal, false), result.m_normal);
+			bits |= hits;
+		}
+		return bits;
+	}
+
+	// Cast a packet of rays at a shape. The rays must be in shape space.
+	// Returns a bit mask of the rays whose nearest hit is now on 'shape'.
+	inline int RayCast(RayPacket const& packet, Shape const& shape, RayPacketResult& result)
+	{
+		switch (shape.m_type)
+		{
+			#define PR_ENUM(name, comp) case EShape::name: return RayCast(packet, shape_cast<Shape##name>(shape), result);
+			PR_COLLISION_SHAPES(PR_ENUM)
+			#undef PR_ENUM
+			default: assert("Unknown primitive type" && false); return 0;
+		}
+	}
+
+	// Cast a world space packet of rays
+	template <ShapeType Shp>
+	inline int RayCastWS(RayPacket const& packet, Shp const& shape, m4x4 const& s2w, RayPacketResult& result)
+	{
+		using namespace impl::packet;
+
+		// Transform the packet into shape space
+		auto hits = RayCast(InvertOrthonormal(s2w) * packet, shape, result);
+
+		// Transform the new hits back to world space
+		if (hits != 0)
+			result.m_normal = Select(LaneMask(hits), Transform(s2w, result.m_normal, false), result.m_normal);
+
+		return hits;
+	}
+
+	namespace impl::packet
+	{
+		template <ShapeType Shp>
+		void RayCastBatch(std::span<Ray const> rays, Shp const& shape, m4x4 const& s2w, std::span<RayCastResult> results)
+		{
+			assert("There must be a result for each ray" && rays.size() == results.size());
+			auto w2s = InvertOrthonormal(s2w);
+
+			for (size_t i = 0, iend = rays.size(); i < iend; i += RayPacket::Width)
+			{
+				auto count = std::min<size_t>(iend - i, RayPacket::Width);
+				auto packet = w2s * RayPacket(rays.subspan(i, count));
+
+				// Start from the existing results so that only nearer hits replace them
+				RayPacketResult nearest;
+				for (size_t j = 0; j != count; ++j)
+				{
+					if (results[i + j].m_shape != nullptr)
+						nearest.Lane(static_cast<int>(j), results[i + j]);
+				}
+
+				auto hits = RayCast(packet, shape, nearest);
+				for (size_t j = 0; j != count; ++j)
+				{
+					if ((hits & (1 << j)) == 0)
+						continue;
+
+					auto& result = results[i + j] = nearest.Lane(static_cast<int>(j));
+					result.m_normal = s2w * result.m_normal;
+				}
+			}
+		}
+	}
+
+	// Cast a batch of world space rays, a packet at a time. 'results' must have one element per ray.
+	// 'results[i]' is only replaced where 'rays[i]' hits 'shape' nearer than the existing result, so
+	// casting one batch at several shapes leaves the nearest hit over all of them.
+	template <ShapeType Shp>
+	inline void RayCastWS(std::span<Ray const> rays, Shp const& shape, m4x4 const& s2w, std::span<RayCastResult> results)
+	{
+		impl::packet::RayCastBatch(rays, shape, s2w, results);
+	}
+	inline void RayCastWS(std::span<Ray const> rays, Shape const& shape, m4x4 const& s2w, std::span<RayCastResult> results)
+	{
+		// Dispatch on the shape type once for the whole batch
+		switch (shape.m_type)
+		{
+			#define PR_ENUM(name, comp) case EShape::name: return impl::packet::RayCastBatch(rays, shape_cast<Shape##name>(shape), s2w, results);
+			PR_COLLISION_SHAPES(PR_ENUM)
+			#undef PR_ENUM
+			default: assert("Unknown primitive type" && false); return;
+		}
+	}
+}
+
+#if PR_UNITTESTS
+#include "pr/common/unittests.h"
+#include <random>
+
+namespace pr::collision::tests
+{
+	PRUnitTestClass(RayPacketTests)
+	{
+		// Single ray cast results, clipped to the ray segment as packet results are
+		static RayCastResult Clip(RayCastResult result)
+		{
+			if (result.m_shape == nullptr)
+				return result;
+
+			result.m_t0 = std::max(result.m_t0, 0.0f);
+			result.m_t1 = std::min(result.m_t1, 1.0f);
+			return result.m_t0 <= result.m_t1 ? result : RayCastResult{};
+		}
+		static bool Equal(RayCastResult const& lhs, RayCastResult const& rhs)
+		{
+			if (lhs.m_shape != rhs.m_shape) return false;
+			if (lhs.m_shape == nullptr) return true;
+			return
+				FEqlAbsolute(lhs.m_t0, rhs.m_t0, 1e-4f) &&
+				FEqlAbsolute(lhs.m_t1, rhs.m_t1, 1e-4f) &&
+				FEqlAbsolute(lhs.m_normal, rhs.m_normal, 1e-3f);
+		}
+
+		// A random shape to world transform
+		static m4x4 RandomS2W(std::default_random_engine& rng)
+		{
+			std::uniform_real_distribution<float> pos(-1.0f, 1.0f);
+			return m4x4{math::Random<m3x4>(rng), v4{pos(rng), pos(rng), pos(rng), 1.0f}};
+		}
+
+		// Random rays from 'above' to 'below' the XY plane (in 's2w' space), so that triangle hits are in front of the ray
+		static std::vector<Ray> Rays(std::default_random_engine& rng, m4x4 const& s2w, int count, float thickness)
+		{
+			std::uniform_real_distribution<float> xy(-2.0f, 2.0f);
+			std::uniform_real_distribution<float> z(0.2f, 3.0f);
+
+			std::vector<Ray> rays;
+			for (int i = 0; i != count; ++i)
+			{
+				auto s = v4(xy(rng), xy(rng), +z(rng), 1.0f);
+				auto e = v4(xy(rng), xy(rng), -z(rng), 1.0f);
+				rays.push_back(s2w * Ray(s, (e - s).w0(), thickness));
+			}
+			return rays;
+		}
+
+		PRUnitTestMethod(Primitives)
+		{
+			std::default_random_engine rng(1);
+			auto sph = ShapeSphere{0.8f};
+			auto box = ShapeBox{v4{1.0f, 0.6f, 1.4f, 0.0f}};
+			auto tri = ShapeTriangle{v4{-1.0f, -1.0f, 0.0f, 1.0f}, v4{1.0f, -1.0f, 0.0f, 1.0f}, v4{0.0f, 1.0f, 0.0f, 1.0f}};
+			Shape const* shapes[] = { &sph.m_base, &box.m_base, &tri.m_base };
+
+			for (int i = 0; i != 10; ++i)
+			{
+				for (auto shape : shapes)
+				{
+					// An odd number of rays, so the last packet is partly filled
+					auto s2w = RandomS2W(rng);
+					auto rays = Rays(rng, s2w, 101, i < 5 ? 0.0f : 0.1f);
+
+					std::vector<RayCastResult> results(rays.size());
+					RayCastWS(rays, *shape, s2w, results);
+
+					for (size_t r = 0; r != rays.size(); ++r)
+						PR_EXPECT(Equal(results[r], Clip(RayCastWS(rays[r], *shape, s2w))));
+				}
+			}
+		}
+		PRUnitTestMethod(Composite)
+		{
+			struct Compound
+			{
+				ShapeArray    arr;
+				ShapeSphere   sph;
+				ShapeBox      box0;
+				ShapeBox      box1;
+				ShapeTriangle tri;
+			} compound = {
+				ShapeArray{},
+				ShapeSphere{0.5f, m4x4::Translation(v4{-1.0f, 0.0f, 0.0f, 0.0f})},
+				ShapeBox{v4{0.6f, 0.6f, 0.6f, 0.0f}, m4x4::TransformRad(0.3f, 0.5f, 0.7f, v4{1.0f, 0.2f, 0.0f, 1.0f})},
+				ShapeBox{v4{2.0f, 0.2f, 0.2f, 0.0f}, m4x4::Translation(v4{0.0f, -1.0f, 0.5f, 0.0f})},
+				ShapeTriangle{v4{-1.5f, -1.5f, 0.0f, 1.0f}, v4{1.5f, -1.5f, 0.0f, 1.0f}, v4{0.0f, 1.5f, 0.0f, 1.0f}, m4x4::Translation(v4{0.2f, 0.0f, -0.3f, 0.0f})},
+			};
+			compound.arr.Complete(4);
+
+			// Thin and thick rays. Thick rays hit the triangle child using a shifted ray (see 'impl::ShiftTowardOrigin')
+			std::default_random_engine rng(2);
+			for (int i = 0; i != 20; ++i)
+			{
+				auto s2w = RandomS2W(rng);
+				auto rays = Rays(rng, s2w, 100, i < 10 ? 0.0f : 0.1f);
+
+				std::vector<RayCastResult> results(rays.size());
+				RayCastWS(rays, compound.arr, s2w, results);
+
+				for (size_t r = 0; r != rays.size(); ++r)
+				{
+					// The nearest of the clipped hits on each child
+					RayCastResult expected;
+					for (Shape const *s = compound.arr.begin(), *s_end = compound.arr.end(); s != s_end; s = next(s))
+					{
+						auto res = Clip(RayCastWS(rays[r], *s, s2w * s->m_s2p));
+						if (res.m_shape != nullptr && (expected.m_shape == nullptr || res.m_t0 < expected.m_t0))
+							expected = res;
+					}
+					PR_EXPECT(Equal(results[r], expected));
+				}
+			}
+
+			// A thick ray that grazes a triangle child. The shifted ray hits the triangle at a 't' before the ray
+			// enters the triangle's bounding box, and the box child (tested first) is hit between the two.
+			{
+				struct Graze
+				{
+					ShapeArray    arr;
+					ShapeBox      box;
+					ShapeTriangle tri;
+				} graze = {
+					ShapeArray{},
+					ShapeBox{v4{0.24f, 0.3f, 0.3f, 0.0f}, m4x4::Translation(v4{0.18f, 0.0f, 0.1f, 0.0f})},
+					ShapeTriangle{v4{-1.5f, -1.5f, 0.0f, 1.0f}, v4{1.5f, -1.5f, 0.0f, 1.0f}, v4{0.0f, 1.5f, 0.0f, 1.0f}},
+				};
+				graze.arr.Complete(2);
+
+				auto s2w = RandomS2W(rng);
+				Ray rays[] = { s2w * Ray(v4{-2.0f, 0.0f, 0.3f, 1.0f}, v4{4.0f, 0.0f, -0.4f, 0.0f}, 0.1f) };
+
+				RayCastResult results[1];
+				RayCastWS(rays, graze.arr, s2w, results);
+
+				auto expected = Clip(RayCastWS(rays[0], graze.tri.m_base, s2w * graze.tri.m_base.m_s2p));
+				auto box = Clip(RayCastWS(rays[0], graze.box.m_base, s2w * graze.box.m_base.m_s2p));
+				PR_EXPECT(expected.m_shape != nullptr && box.m_shape != nullptr && expected.m_t0 < box.m_t0);
+				PR_EXPECT(Equal(results[0], expected));
+			}
+
+			// Casting at each child in turn gives the same nearest hits
+			{
+				auto s2w = RandomS2W(rng);
+				auto rays = Rays(rng, s2w, 100, 0.0f);
+
+				std::vector<RayCastResult> whole(rays.size()), parts(rays.size());
+				RayCastWS(rays, compound.arr, s2w, whole);
+				for (Shape const *s = compound.arr.begin(), *s_end = compound.arr.end(); s != s_end; s = next(s))
+					RayCastWS(rays, *s, s2w * s->m_s2p, parts);
+
+				for (size_t r = 0; r != rays.size(); ++r)
+					PR_EXPECT(Equal(whole[r], parts[r]));
+			}
+		}
+	};
+}
+#endif
@@ -13,3 +13,4 @@
 #include "pr/collision/shape_array.h"
 #include "pr/collision/ray.h"
 #include "pr/collision/ray_cast.h"
+#include "pr/collision/ray_packet.h"
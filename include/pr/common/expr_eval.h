@@ -10,6 +10,9 @@
 #include <type_traits>
 #include <initializer_list>
 #include <cassert>
+#include <cstring>
+#include <span>
+#include <vector>
 #include "pr/common/fmt.h"
 #include "pr/common/hash.h"
 #include "pr/math/math.h"
@@ -712,6 +715,677 @@ namespace pr::eval
 		}
 	};
 
+	// The number of operands consumed by an operator token. Zero for non-operator tokens
+	constexpr int Arity(ETok op)
+	{
+		switch (op)
+		{
+			case ETok::UnaryPlus:
+			case ETok::UnaryMinus:
+			case ETok::Comp:
+			case ETok::Not:
+			case ETok::Ceil:
+			case ETok::Floor:
+			case ETok::Round:
+			case ETok::Abs:
+			case ETok::Sin:
+			case ETok::Cos:
+			case ETok::Tan:
+			case ETok::ASin:
+			case ETok::ACos:
+			case ETok::ATan:
+			case ETok::SinH:
+			case ETok::CosH:
+			case ETok::TanH:
+			case ETok::Exp:
+			case ETok::Log:
+			case ETok::Log10:
+			case ETok::Sqr:
+			case ETok::Sqrt:
+			case ETok::Deg:
+			case ETok::Rad:
+				return 1;
+			case ETok::Add:
+			case ETok::Sub:
+			case ETok::Mul:
+			case ETok::Div:
+			case ETok::Mod:
+			case ETok::LogOR:
+			case ETok::LogAND:
+			case ETok::LogEql:
+			case ETok::LogNEql:
+			case ETok::LogLT:
+			case ETok::LogLTEql:
+			case ETok::LogGT:
+			case ETok::LogGTEql:
+			case ETok::BitOR:
+			case ETok::BitAND:
+			case ETok::BitXOR:
+			case ETok::LeftShift:
+			case ETok::RightShift:
+			case ETok::Min:
+			case ETok::Max:
+			case ETok::ATan2:
+			case ETok::Pow:
+			case ETok::Len2:
+				return 2;
+			case ETok::Clamp:
+			case ETok::Len3:
+				return 3;
+			case ETok::Len4:
+				return 4;
+			default:
+				return 0;
+		}
+	}
+
+	// A description of an operator token, used in error messages
+	constexpr char const* Describe(ETok op)
+	{
+		switch (op)
+		{
+			case ETok::Add: return "add";
+			case ETok::Sub: return "subtract";
+			case ETok::Mul: return "multiply";
+			case ETok::Div: return "divide";
+			case ETok::Mod: return "modulus";
+			case ETok::UnaryPlus: return "unary plus";
+			case ETok::UnaryMinus: return "unary minus";
+			case ETok::Comp: return "twos complement";
+			case ETok::Not: return "boolean NOT";
+			case ETok::LogOR: return "logical OR";
+			case ETok::LogAND: return "logical AND";
+			case ETok::LogEql: return "equals";
+			case ETok::LogNEql: return "not equal";
+			case ETok::LogLT: return "less than";
+			case ETok::LogLTEql: return "less than or equal";
+			case ETok::LogGT: return "greater than";
+			case ETok::LogGTEql: return "greater than or equal";
+			case ETok::BitOR: return "bitwise OR";
+			case ETok::BitAND: return "bitwise AND";
+			case ETok::BitXOR: return "bitwise XOR";
+			case ETok::LeftShift: return "bitwise left shift";
+			case ETok::RightShift: return "bitwise right shift";
+			case ETok::Ceil: return "ceil()";
+			case ETok::Floor: return "floor()";
+			case ETok::Round: return "round()";
+			case ETok::Min: return "min()";
+			case ETok::Max: return "max()";
+			case ETok::Clamp: return "clamp()";
+			case ETok::Abs: return "abs()";
+			case ETok::Sin: return "sin()";
+			case ETok::Cos: return "cos()";
+			case ETok::Tan: return "tan()";
+			case ETok::ASin: return "asin()";
+			case ETok::ACos: return "acos()";
+			case ETok::ATan: return "atan()";
+			case ETok::ATan2: return "atan2()";
+			case ETok::SinH: return "sinh()";
+			case ETok::CosH: return "cosh()";
+			case ETok::TanH: return "tanh()";
+			case ETok::Exp: return "exp()";
+			case ETok::Log: return "log()";
+			case ETok::Log10: return "log10()";
+			case ETok::Pow: return "pow()";
+			case ETok::Sqr: return "sqr()";
+			case ETok::Sqrt: return "sqrt()";
+			case ETok::Len2: return "len2()";
+			case ETok::Len3: return "len3()";
+			case ETok::Len4: return "len4()";
+			case ETok::Deg: return "deg()";
+			case ETok::Rad: return "rad()";
+			default: return "unknown";
+		}
+	}
+
+	// Apply an operator to its operands. 'args' contains 'Arity(op)' values in left to right order
+	inline Val Apply(ETok op, Val const* args)
+	{
+		switch (op)
+		{
+			case ETok::Add:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a + b;
+			}
+			case ETok::Sub:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a - b;
+			}
+			case ETok::Mul:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a * b;
+			}
+			case ETok::Div:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a / b;
+			}
+			case ETok::Mod:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a % b;
+			}
+			case ETok::UnaryPlus:
+			{
+				auto const& x = args[0];
+				return +x;
+			}
+			case ETok::UnaryMinus:
+			{
+				auto const& x = args[0];
+				return -x;
+			}
+			case ETok::Comp:
+			{
+				auto const& x = args[0];
+				return ~x;
+			}
+			case ETok::Not:
+			{
+				auto const& x = args[0];
+				return !x;
+			}
+			case ETok::LogOR:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a || b;
+			}
+			case ETok::LogAND:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a && b;
+			}
+			case ETok::LogEql:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return Val(a == b);
+			}
+			case ETok::LogNEql:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return Val(a != b);
+			}
+			case ETok::LogLT:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return Val(a < b);
+			}
+			case ETok::LogLTEql:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return Val(a <= b);
+			}
+			case ETok::LogGT:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return Val(a > b);
+			}
+			case ETok::LogGTEql:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return Val(a >= b);
+			}
+			case ETok::BitOR:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a | b;
+			}
+			case ETok::BitAND:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a & b;
+			}
+			case ETok::BitXOR:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a ^ b;
+			}
+			case ETok::LeftShift:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a << b;
+			}
+			case ETok::RightShift:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				return a >> b;
+			}
+			case ETok::Ceil:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Ceil(x.db()));
+					case Val::EType::Real: return Val(Ceil(x.db()));
+					case Val::EType::Intg4: return Val(Ceil(x.v4()));
+					case Val::EType::Real4: return Val(Ceil(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Floor:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Floor(x.db()));
+					case Val::EType::Real: return Val(Floor(x.db()));
+					case Val::EType::Intg4: return Val(Floor(x.v4()));
+					case Val::EType::Real4: return Val(Floor(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Round:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Round(x.db()));
+					case Val::EType::Real: return Val(Round(x.db()));
+					case Val::EType::Intg4: return Val(Round(x.v4()));
+					case Val::EType::Real4: return Val(Round(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Min:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				switch (Val::common_type(a.m_ty, b.m_ty))
+				{
+					case Val::EType::Intg: return Val(Min(a.ll(), b.ll()));
+					case Val::EType::Real: return Val(Min(a.db(), b.db()));
+					case Val::EType::Intg4: return Val(Min(a.i4(), b.i4()));
+					case Val::EType::Real4: return Val(Min(a.v4(), b.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Max:
+			{
+				auto const& a = args[0];
+				auto const& b = args[1];
+				switch (Val::common_type(a.m_ty, b.m_ty))
+				{
+					case Val::EType::Intg: return Val(Max(a.ll(), b.ll()));
+					case Val::EType::Real: return Val(Max(a.db(), b.db()));
+					case Val::EType::Intg4: return Val(Max(a.i4(), b.i4()));
+					case Val::EType::Real4: return Val(Max(a.v4(), b.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Clamp:
+			{
+				auto const& x = args[0];
+				auto const& mn = args[1];
+				auto const& mx = args[2];
+				switch (Val::common_type(x.m_ty, Val::common_type(mn.m_ty, mx.m_ty)))
+				{
+					case Val::EType::Intg: return Val(Clamp(x.ll(), mn.ll(), mx.ll()));
+					case Val::EType::Real: return Val(Clamp(x.db(), mn.db(), mx.db()));
+					case Val::EType::Intg4: return Val(Clamp(x.i4(), mn.i4(), mx.i4()));
+					case Val::EType::Real4: return Val(Clamp(x.v4(), mn.v4(), mx.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Abs:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Abs(x.ll()));
+					case Val::EType::Real: return Val(Abs(x.db()));
+					case Val::EType::Intg4: return Val(Abs(x.i4()));
+					case Val::EType::Real4: return Val(Abs(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Sin:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Sin(x.db()));
+					case Val::EType::Real: return Val(Sin(x.db()));
+					case Val::EType::Intg4: return Val(Sin(x.v4()));
+					case Val::EType::Real4: return Val(Sin(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Cos:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Cos(x.db()));
+					case Val::EType::Real: return Val(Cos(x.db()));
+					case Val::EType::Intg4: return Val(Cos(x.v4()));
+					case Val::EType::Real4: return Val(Cos(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Tan:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Tan(x.db()));
+					case Val::EType::Real: return Val(Tan(x.db()));
+					case Val::EType::Intg4: return Val(Tan(x.v4()));
+					case Val::EType::Real4: return Val(Tan(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::ASin:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Asin(x.db()));
+					case Val::EType::Real: return Val(Asin(x.db()));
+					case Val::EType::Intg4: return Val(Asin(x.v4()));
+					case Val::EType::Real4: return Val(Asin(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::ACos:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Acos(x.db()));
+					case Val::EType::Real: return Val(Acos(x.db()));
+					case Val::EType::Intg4: return Val(Acos(x.v4()));
+					case Val::EType::Real4: return Val(Acos(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::ATan:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Atan(x.db()));
+					case Val::EType::Real: return Val(Atan(x.db()));
+					case Val::EType::Intg4: return Val(Atan(x.v4()));
+					case Val::EType::Real4: return Val(Atan(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::ATan2:
+			{
+				auto const& y = args[0];
+				auto const& x = args[1];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Atan2(y.db(), x.db()));
+					case Val::EType::Real: return Val(Atan2(y.db(), x.db()));
+					case Val::EType::Intg4: return Val(Atan2(y.v4(), x.v4()));
+					case Val::EType::Real4: return Val(Atan2(y.v4(), x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::SinH:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Sinh(x.db()));
+					case Val::EType::Real: return Val(Sinh(x.db()));
+					case Val::EType::Intg4: return Val(Sinh(x.v4()));
+					case Val::EType::Real4: return Val(Sinh(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::CosH:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Cosh(x.db()));
+					case Val::EType::Real: return Val(Cosh(x.db()));
+					case Val::EType::Intg4: return Val(Cosh(x.v4()));
+					case Val::EType::Real4: return Val(Cosh(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::TanH:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Tanh(x.db()));
+					case Val::EType::Real: return Val(Tanh(x.db()));
+					case Val::EType::Intg4: return Val(Tanh(x.v4()));
+					case Val::EType::Real4: return Val(Tanh(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Exp:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Exp(x.db()));
+					case Val::EType::Real: return Val(Exp(x.db()));
+					case Val::EType::Intg4: return Val(Exp(x.v4()));
+					case Val::EType::Real4: return Val(Exp(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Log:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Log(x.db()));
+					case Val::EType::Real: return Val(Log(x.db()));
+					case Val::EType::Intg4: return Val(Log(x.v4()));
+					case Val::EType::Real4: return Val(Log(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Log10:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Log10(x.db()));
+					case Val::EType::Real: return Val(Log10(x.db()));
+					case Val::EType::Intg4: return Val(Log10(x.v4()));
+					case Val::EType::Real4: return Val(Log10(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Pow:
+			{
+				auto const& x = args[0];
+				auto const& y = args[1];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Pow(x.db(), y.db()));
+					case Val::EType::Real: return Val(Pow(x.db(), y.db()));
+					case Val::EType::Intg4: return Val(Pow(x.v4(), y.v4()));
+					case Val::EType::Real4: return Val(Pow(x.v4(), y.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Sqr:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Sqr(x.ll()));
+					case Val::EType::Real: return Val(Sqr(x.db()));
+					case Val::EType::Intg4: return Val(Sqr(x.i4()));
+					case Val::EType::Real4: return Val(Sqr(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Sqrt:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Sqrt(x.db()));
+					case Val::EType::Real: return Val(Sqrt(x.db()));
+					case Val::EType::Intg4: return Val(CompSqrt(x.v4()));
+					case Val::EType::Real4: return Val(CompSqrt(x.v4()));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Len2:
+			{
+				auto const& x = args[0];
+				auto const& y = args[1];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Len(x.db(), y.db()));
+					case Val::EType::Real: return Val(Len(x.db(), y.db()));
+					case Val::EType::Intg4: return Val(CompOp(x.v4(), y.v4(), [](auto x, auto y) { return Len(x, y); }));
+					case Val::EType::Real4: return Val(CompOp(x.v4(), y.v4(), [](auto x, auto y) { return Len(x, y); }));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Len3:
+			{
+				auto const& x = args[0];
+				auto const& y = args[1];
+				auto const& z = args[2];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Len(x.db(), y.db(), z.db()));
+					case Val::EType::Real: return Val(Len(x.db(), y.db(), z.db()));
+					case Val::EType::Intg4: return Val(CompOp(x.v4(), y.v4(), z.v4(), [](auto x, auto y, auto z) { return Len(x, y, z); }));
+					case Val::EType::Real4: return Val(CompOp(x.v4(), y.v4(), z.v4(), [](auto x, auto y, auto z) { return Len(x, y, z); }));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Len4:
+			{
+				auto const& x = args[0];
+				auto const& y = args[1];
+				auto const& z = args[2];
+				auto const& w = args[3];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(Len(x.db(), y.db(), z.db(), w.db()));
+					case Val::EType::Real: return Val(Len(x.db(), y.db(), z.db(), w.db()));
+					case Val::EType::Intg4: return Val(CompOp(x.v4(), y.v4(), z.v4(), w.v4(), [](auto x, auto y, auto z, auto w) { return Len(x, y, z, w); }));
+					case Val::EType::Real4: return Val(CompOp(x.v4(), y.v4(), z.v4(), w.v4(), [](auto x, auto y, auto z, auto w) { return Len(x, y, z, w); }));
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Deg:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(x.db() * constants<double>::E60_by_tau);
+					case Val::EType::Real: return Val(x.db() * constants<double>::E60_by_tau);
+					case Val::EType::Intg4: return Val(x.v4() * constants<float>::E60_by_tau);
+					case Val::EType::Real4: return Val(x.v4() * constants<float>::E60_by_tau);
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			case ETok::Rad:
+			{
+				auto const& x = args[0];
+				switch (x.m_ty)
+				{
+					case Val::EType::Intg: return Val(x.db() * constants<double>::tau_by_360);
+					case Val::EType::Real: return Val(x.db() * constants<double>::tau_by_360);
+					case Val::EType::Intg4: return Val(x.v4() * constants<float>::tau_by_360);
+					case Val::EType::Real4: return Val(x.v4() * constants<float>::tau_by_360);
+					default: throw std::runtime_error("Unknown value type");
+				}
+			}
+			default:
+			{
+				throw std::runtime_error("Unknown expression token");
+			}
+		}
+	}
+
+	// Apply an operator to blocks of 'double' operands. 'args' contains 'Arity(op)' pointers to 'n' values each
+	inline void Apply(ETok op, int n, double* out, double const* const* args)
+	{
+		// Notes:
+		//  - Equivalent to 'Apply(op, Val const*)' for 'Real' operands. Comparisons produce 0.0 or 1.0
+		//  - Written as simple loops over each operator so that the compiler can vectorise them
+		auto map1 = [=](auto fn) { auto a = args[0]; for (int i = 0; i != n; ++i) out[i] = static_cast<double>(fn(a[i])); };
+		auto map2 = [=](auto fn) { auto a = args[0], b = args[1]; for (int i = 0; i != n; ++i) out[i] = static_cast<double>(fn(a[i], b[i])); };
+		auto map3 = [=](auto fn) { auto a = args[0], b = args[1], c = args[2]; for (int i = 0; i != n; ++i) out[i] = static_cast<double>(fn(a[i], b[i], c[i])); };
+		auto map4 = [=](auto fn) { auto a = args[0], b = args[1], c = args[2], d = args[3]; for (int i = 0; i != n; ++i) out[i] = static_cast<double>(fn(a[i], b[i], c[i], d[i])); };
+		switch (op)
+		{
+			case ETok::Add:        map2([](double a, double b) { return a + b; }); break;
+			case ETok::Sub:        map2([](double a, double b) { return a - b; }); break;
+			case ETok::Mul:        map2([](double a, double b) { return a * b; }); break;
+			case ETok::Div:        map2([](double a, double b) { return a / b; }); break;
+			case ETok::Mod:        map2([](double a, double b) { return std::fmod(a, b); }); break;
+			case ETok::UnaryPlus:  map1([](double x) { return x; }); break;
+			case ETok::UnaryMinus: map1([](double x) { return -x; }); break;
+			case ETok::Not:        map1([](double x) { return x == 0; }); break;
+			case ETok::LogOR:      map2([](double a, double b) { return a != 0 || b != 0; }); break;
+			case ETok::LogAND:     map2([](double a, double b) { return a != 0 && b != 0; }); break;
+			case ETok::LogEql:     map2([](double a, double b) { return a == b; }); break;
+			case ETok::LogNEql:    map2([](double a, double b) { return !(a == b); }); break;
+			case ETok::LogLT:      map2([](double a, double b) { return a < b; }); break;
+			case ETok::LogLTEql:   map2([](double a, double b) { return a <= b; }); break;
+			case ETok::LogGT:      map2([](double a, double b) { return !(a <= b); }); break;
+			case ETok::LogGTEql:   map2([](double a, double b) { return !(a < b); }); break;
+			case ETok::Ceil:       map1([](double x) { return Ceil(x); }); break;
+			case ETok::Floor:      map1([](double x) { return Floor(x); }); break;
+			case ETok::Round:      map1([](double x) { return Round(x); }); break;
+			case ETok::Min:        map2([](double a, double b) { return Min(a, b); }); break;
+			case ETok::Max:        map2([](double a, double b) { return Max(a, b); }); break;
+			case ETok::Clamp:      map3([](double x, double mn, double mx) { return Clamp(x, mn, mx); }); break;
+			case ETok::Abs:        map1([](double x) { return Abs(x); }); break;
+			case ETok::Sin:        map1([](double x) { return Sin(x); }); break;
+			case ETok::Cos:        map1([](double x) { return Cos(x); }); break;
+			case ETok::Tan:        map1([](double x) { return Tan(x); }); break;
+			case ETok::ASin:       map1([](double x) { return Asin(x); }); break;
+			case ETok::ACos:       map1([](double x) { return Acos(x); }); break;
+			case ETok::ATan:       map1([](double x) { return Atan(x); }); break;
+			case ETok::ATan2:      map2([](double y, double x) { return Atan2(y, x); }); break;
+			case ETok::SinH:       map1([](double x) { return Sinh(x); }); break;
+			case ETok::CosH:       map1([](double x) { return Cosh(x); }); break;
+			case ETok::TanH:       map1([](double x) { return Tanh(x); }); break;
+			case ETok::Exp:        map1([](double x) { return Exp(x); }); break;
+			case ETok::Log:        map1([](double x) { return Log(x); }); break;
+			case ETok::Log10:      map1([](double x) { return Log10(x); }); break;
+			case ETok::Pow:        map2([](double x, double y) { return Pow(x, y); }); break;
+			case ETok::Sqr:        map1([](double x) { return Sqr(x); }); break;
+			case ETok::Sqrt:       map1([](double x) { return Sqrt(x); }); break;
+			case ETok::Len2:       map2([](double x, double y) { return Len(x, y); }); break;
+			case ETok::Len3:       map3([](double x, double y, double z) { return Len(x, y, z); }); break;
+			case ETok::Len4:       map4([](double x, double y, double z, double w) { return Len(x, y, z, w); }); break;
+			case ETok::Deg:        map1([](double x) { return x * constants<double>::E60_by_tau; }); break;
+			case ETok::Rad:        map1([](double x) { return x * constants<double>::tau_by_360; }); break;
+			default: throw std::runtime_error(Fmt("Operator '%s' is not supported for double", Describe(op)));
+		}
+	}
+
 	// A fixed size stack for expression evaluation
 	template <int S> struct Stack
 	{
@@ -744,720 +1418,734 @@ namespace pr::eval
 		}
 	};
 
-	// A compiled expression
-	struct Expression
+	// A register based form of an expression, used to evaluate over columns of arguments
+	struct Program
 	{
-		using ArgPair = struct { std::string_view name; Val val; };
-		using ArgNames = vector<Ident>;
+		// Notes:
+		//  - Built from the byte code of an 'Expression' by executing it symbolically, so that the stack is
+		//    resolved once rather than per evaluation. Each instruction writes to its own temporary.
+		//  - Operations on constants are folded, and repeated sub-expressions share one temporary.
+		//  - The '?:' branches are kept so that row-at-a-time evaluation only evaluates the taken side.
+		//    Block evaluation (the 'double' fast path) evaluates both sides and selects per element.
+		//  - 'm_valid' is false for byte code that doesn't have a supported form (e.g. '?' without ':').
+		//    Callers should fall back to 'Expression::call' in that case.
+		enum class ESrc :uint8_t { None, Arg, Const, Temp };
+		enum class EKind :uint8_t { Op, Select, BranchIfZero, Branch };
+
+		// An operand. 'm_idx' is the argument, constant, or temporary index
+		struct Reg
+		{
+			ESrc m_src;
+			int m_idx;
+
+			friend bool operator == (Reg lhs, Reg rhs)
+			{
+				return lhs.m_src == rhs.m_src && lhs.m_idx == rhs.m_idx;
+			}
+		};
 
-		// The compiled expression
-		byte_data<> m_op;
+		// An instruction.
+		//  Op: m_dst = Apply(m_op, m_arg[0..m_arity))
+		//  Select: m_dst = m_arg[0] != 0 ? m_arg[1] : m_arg[2]
+		//  BranchIfZero: if m_arg[0] == 0 goto m_jmp
+		//  Branch: goto m_jmp
+		struct Instr
+		{
+			EKind m_kind;
+			ETok m_op;
+			int m_arity;
+			int m_dst;
+			int m_jmp;
+			Reg m_arg[4];
+		};
+
+		vector<Instr, 16> m_code;  // The instructions
+		vector<Val, 8> m_consts;   // The constant table
+		Reg m_result;              // Where the result of the expression ends up
+		int m_temps;               // The number of temporaries needed
+		bool m_built;              // True once 'Build' has been called
+		bool m_valid;              // True if the byte code was converted successfully
+		bool m_real;               // True if evaluating in 'double' gives the same results as evaluating in 'Val' (given 'double' arguments)
+		bool m_branches;           // True if the code contains branches
+
+		Program()
+			:m_code()
+			,m_consts()
+			,m_result()
+			,m_temps()
+			,m_built()
+			,m_valid()
+			,m_real()
+			,m_branches()
+		{}
+
+		// Convert the byte code 'op' into register form. 'args' are the arguments in discovery order
+		static Program Build(byte_data<> const& op, ArgSet const& args)
+		{
+			Program prog;
+			Builder b(prog, op, args);
+			prog.m_built = true;
+			prog.m_valid = b.Run(0, op.size()) && b.m_stack.size() == 1;
+			if (prog.m_valid)
+			{
+				prog.m_result = b.m_stack.back();
+				prog.m_temps = static_cast<int>(b.m_temp_type.size());
+			}
+			else
+			{
+				prog.m_code.resize(0);
+				prog.m_real = false;
+			}
+			return prog;
+		}
+
+	private:
+
+		struct Builder
+		{
+			// Notes:
+			//  - 'm_temp_type' is the type of each temporary, assuming arguments are 'Real'. 'Unknown' means
+			//    the type depends on a branch taken at run time. This is used to decide whether 'm_real' holds.
+			//  - Instructions are only reused by common sub-expression elimination if they are in the current
+			//    branch or one of its parents, because the other branches are not evaluated for every row.
+			Program& m_prog;
+			byte_data<> const& m_op;
+			ArgSet const& m_args;
+			vector<Reg, 16> m_stack;
+			vector<Val::EType, 16> m_temp_type;
+			vector<int, 16> m_scope;  // The branch scope of each instruction
+			vector<int, 8> m_active;  // The branch scopes that enclose the current instruction
+			int m_scopes;
+
+			Builder(Program& prog, byte_data<> const& op, ArgSet const& args)
+				:m_prog(prog)
+				,m_op(op)
+				,m_args(args)
+				,m_stack()
+				,m_temp_type()
+				,m_scope()
+				,m_active()
+				,m_scopes(1)
+			{
+				m_prog.m_real = true;
+				m_active.push_back(0);
+			}
+
+			// Symbolically execute the byte code in [i, end)
+			bool Run(size_t i, size_t end)
+			{
+				for (; i < end;)
+				{
+					auto tok = m_op.read<ETok>(i);
+					switch (tok)
+					{
+						case ETok::None:
+						{
+							break;
+						}
+						case ETok::Identifier:
+						{
+							auto hash = m_op.read<IdentHash>(i);
+							auto idx = 0;
+							for (auto& arg : m_args)
+							{
+								if (arg.m_hash == hash) break;
+								++idx;
+							}
+							if (idx == static_cast<int>(m_args.size()))
+								return false;
+
+							m_stack.push_back(Reg{ ESrc::Arg, idx });
+							break;
+						}
+						case ETok::Value:
+						{
+							auto ty = m_op.read<Val::EType>(i);
+							switch (ty)
+							{
+								case Val::EType::Intg: m_stack.push_back(Const(m_op.read<long long>(i))); break;
+								case Val::EType::Real: m_stack.push_back(Const(m_op.read<double>(i))); break;
+								default: return false;
+							}
+							break;
+						}
+						case ETok::If:
+						{
+							// Layout: [cond][If jmp0][a][Else jmp1][b]. The jumps are relative to the end of the jump value.
+							if (m_stack.empty()) return false;
+							auto cond = m_stack.back(); m_stack.pop_back();
+							auto jmp0 = m_op.read<int>(i);
+							auto else_ofs = i + jmp0;
+							if (jmp0 < 0 || else_ofs + sizeof(ETok) + sizeof(int) > end || m_op.at_byte_ofs<ETok>(else_ofs) != ETok::Else)
+								return false;
+
+							auto b_ofs = else_ofs + sizeof(ETok);
+							auto jmp1 = m_op.read<int>(b_ofs);
+							auto b_end = b_ofs + jmp1;
+							if (jmp1 < 0 || b_end > end)
+								return false;
+
+							// Only the taken branch is needed if the condition is constant
+							if (cond.m_src == ESrc::Const)
+							{
+								auto depth = m_stack.size();
+								auto taken = !(m_prog.m_consts[cond.m_idx] == Val(0));
+								if (!(taken ? Run(i, else_ofs) : Run(b_ofs, b_end)) || m_stack.size() != depth + 1)
+									return false;
+
+								i = b_end;
+								break;
+							}
+
+							// [cond][BranchIfZero][a][Branch][b][Select]
+							m_prog.m_branches = true;
+							auto bz = Emit(Instr{ EKind::BranchIfZero, ETok::If, 1, -1, 0, {cond} });
+
+							auto depth = m_stack.size();
+							if (!Branch(i, else_ofs) || m_stack.size() != depth + 1) return false;
+							auto a = m_stack.back(); m_stack.pop_back();
+
+							auto br = Emit(Instr{ EKind::Branch, ETok::Else, 0, -1, 0, {} });
+							m_prog.m_code[bz].m_jmp = static_cast<int>(m_prog.m_code.size());
+
+							if (!Branch(b_ofs, b_end) || m_stack.size() != depth + 1) return false;
+							auto b = m_stack.back(); m_stack.pop_back();
+							m_prog.m_code[br].m_jmp = static_cast<int>(m_prog.m_code.size());
+
+							auto ty = Type(a) == Type(b) ? Type(a) : Val::EType::Unknown;
+							auto dst = Temp(ty);
+							Emit(Instr{ EKind::Select, ETok::If, 3, dst, 0, {cond, a, b} });
+							m_stack.push_back(Reg{ ESrc::Temp, dst });
+							i = b_end;
+							break;
+						}
+						default:
+						{
+							auto arity = Arity(tok);
+							if (arity == 0 || m_stack.size() < static_cast<size_t>(arity))
+								return false;
+
+							Instr ins = { EKind::Op, tok, arity, -1, 0, {} };
+							for (int k = arity; k-- != 0;)
+							{
+								ins.m_arg[k] = m_stack.back();
+								m_stack.pop_back();
+							}
+							m_stack.push_back(Op(ins));
+							break;
+						}
+					}
+				}
+				return true;
+			}
+
+			// Run a branch of a '?:' in a new scope
+			bool Branch(size_t i, size_t end)
+			{
+				m_active.push_back(m_scopes++);
+				auto ok = Run(i, end);
+				m_active.pop_back();
+				return ok;
+			}
 
-		// The arguments (and default values) of the unique identifiers in the expression (in order of discovery from left to right).
-		ArgSet m_args;
+			// Add an operation, folding constants and reusing existing results where possible
+			Reg Op(Instr const& ins)
+			{
+				// Constant folding. Anything that throws is left to throw at evaluation time
+				auto all_const = true;
+				for (int k = 0; k != ins.m_arity; ++k)
+					all_const &= ins.m_arg[k].m_src == ESrc::Const;
+				if (all_const && !DivideByZero(ins))
+				{
+					Val a[4];
+					for (int k = 0; k != ins.m_arity; ++k)
+						a[k] = m_prog.m_consts[ins.m_arg[k].m_idx];
 
-		// The unique argument names in the expression
-		ArgNames m_arg_names;
+					try { return Const(Apply(ins.m_op, &a[0])); }
+					catch (std::exception const&) {}
+				}
 
-		// Is callable/valid test
-		explicit operator bool() const
-		{
-			return !m_op.empty();
-		}
+				// Common sub-expression elimination
+				for (int j = 0, jend = static_cast<int>(m_prog.m_code.size()); j != jend; ++j)
+				{
+					auto& rhs = m_prog.m_code[j];
+					if (rhs.m_kind != EKind::Op || rhs.m_op != ins.m_op) continue;
+					if (!std::equal(&ins.m_arg[0], &ins.m_arg[0] + ins.m_arity, &rhs.m_arg[0])) continue;
+					if (std::find(m_active.begin(), m_active.end(), m_scope[j]) == m_active.end()) continue;
+					return Reg{ ESrc::Temp, rhs.m_dst };
+				}
 
-		// Evaluate using the given args
-		Val operator()(ArgSet const& args) const
-		{
-			return call(args);
-		}
+				// New instruction
+				auto out = ins;
+				out.m_dst = Temp(ResultType(ins));
+				Emit(out);
+				return Reg{ ESrc::Temp, out.m_dst };
+			}
 
-		// Evaluate the expression with the given named arguments. e.g. expr({"x", 1.2}, {"y", 3})
-		Val operator()(std::initializer_list<ArgPair> arg_pairs) const
-		{
-			ArgSet args;
-			for (auto& a : arg_pairs)
-				args.add(a.name, a.val);
-			return call(args);
-		}
+			// Add a constant
+			Reg Const(Val val)
+			{
+				auto& consts = m_prog.m_consts;
+				for (int j = 0, jend = static_cast<int>(consts.size()); j != jend; ++j)
+				{
+					// Compare bits so that 0.0 and -0.0 are distinct
+					if (consts[j].m_ty != val.m_ty || std::memcmp(&consts[j].m_ll, &val.m_ll, sizeof(val.m_ll)) != 0) continue;
+					return Reg{ ESrc::Const, j };
+				}
+				consts.push_back(val);
+				return Reg{ ESrc::Const, static_cast<int>(consts.size()) - 1 };
+			}
 
-		// Evaluate the expression using arguments given in order. e.g. expr(1.2, 3)
-		template <typename... A> Val operator()(A... a) const
-		{
-			if constexpr (sizeof...(A) == 0)
+			// Allocate a temporary
+			int Temp(Val::EType ty)
 			{
-				return call();
+				m_temp_type.push_back(ty);
+				return static_cast<int>(m_temp_type.size()) - 1;
 			}
-			else
+
+			// Append an instruction
+			int Emit(Instr const& ins)
 			{
-				// Unpack the arguments into an array
-				std::array<Val, sizeof...(A)> values = {a...};
-				if (values.size() > m_args.size())
-					throw std::runtime_error("Too many arguments given");
+				m_prog.m_code.push_back(ins);
+				m_scope.push_back(m_active.back());
+				return static_cast<int>(m_prog.m_code.size()) - 1;
+			}
 
-				// Update any unassigned arguments in order.
-				auto args = m_args;
-				for (int i = 0, j = 0; i != int(args.size()) && j != int(values.size()); ++i)
+			// The type of an operand, assuming 'Real' arguments
+			Val::EType Type(Reg r) const
+			{
+				switch (r.m_src)
 				{
-					if (args[i].has_value()) continue;
-					args[i] = values[j++];
+					case ESrc::Arg: return Val::EType::Real;
+					case ESrc::Const: return m_prog.m_consts[r.m_idx].m_ty;
+					case ESrc::Temp: return m_temp_type[r.m_idx];
+					default: return Val::EType::Unknown;
 				}
-
-				// Evaluate
-				return call(args);
 			}
-		}
 
-		// Execute the expression with the given arguments. You can pass 'm_args' to this if you don't care about default values and you've assign values to them all.
-		template <typename Stack = Stack<64>>
-		Val call(ArgSet const& args = {}) const
-		{
-			// Check all arguments have a value
-			if (!args.all_assigned())
-				throw std::runtime_error("Unassigned argument values");
+			// True if 'ins' is an integer divide by a constant zero
+			bool DivideByZero(Instr const& ins) const
+			{
+				if (ins.m_op != ETok::Div && ins.m_op != ETok::Mod)
+					return false;
 
-			// Note:
-			//  - Parameters are pushed onto the stack in left to right order,
-			//    so when popping them off, the first is the rightmost argument.
-			//  - Operators should be implemented in 'Val', not here. That way
-			//    Val can be extended more easily
-			Stack stack;
-			for (size_t i = 0, iend = m_op.size(); i != iend;)
+				auto& a = m_prog.m_consts[ins.m_arg[0].m_idx];
+				auto& b = m_prog.m_consts[ins.m_arg[1].m_idx];
+				return Val::common_type(a.m_ty, b.m_ty) == Val::EType::Intg && b.ll() == 0;
+			}
+
+			// Determine the result type of 'ins'. Clears 'm_real' if 'double' evaluation would differ from 'Val' evaluation
+			Val::EType ResultType(Instr const& ins)
 			{
-				auto tok = m_op.read<ETok>(i);
-				switch (tok)
+				using EType = Val::EType;
+				auto common = [&](int n)
 				{
-					case ETok::None:
-					{
-						break;
-					}
-					case ETok::Identifier:
+					auto ty = Type(ins.m_arg[0]);
+					for (int k = 1; k != n; ++k)
 					{
-						auto hash = m_op.read<IdentHash>(i);
-						stack.push_back(args(hash));
-						break;
-					}
-					case ETok::Value:
-					{
-						// Deserialise a 'Val' instance
-						auto ty = m_op.read<Val::EType>(i);
-						switch (ty)
-						{
-							case Val::EType::Intg: stack.push_back(m_op.read<long long>(i)); break;
-							case Val::EType::Real: stack.push_back(m_op.read<double>(i)); break;
-							case Val::EType::Intg4: stack.push_back(m_op.read<v4>(i)); break;
-							case Val::EType::Real4: stack.push_back(m_op.read<iv4>(i)); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
+						auto t = Type(ins.m_arg[k]);
+						ty =
+							(ty == EType::Real || t == EType::Real) ? EType::Real :
+							(ty == EType::Intg && t == EType::Intg) ? EType::Intg :
+							EType::Unknown;
 					}
+					return ty;
+				};
+				auto require = [&](EType actual, EType required, EType result)
+				{
+					m_prog.m_real &= actual == required;
+					return result;
+				};
+				switch (ins.m_op)
+				{
 					case ETok::Add:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for add expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a + b);
-						break;
-					}
 					case ETok::Sub:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for subtract expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a - b);
-						break;
-					}
 					case ETok::Mul:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for multiply expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a * b);
-						break;
-					}
-					case ETok::Div:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for divide expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a / b);
-						break;
-					}
-					case ETok::Mod:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for modulus expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a % b);
-						break;
-					}
+					case ETok::Min:
+					case ETok::Max:
+					case ETok::Clamp:
 					case ETok::UnaryPlus:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for unary plus expression");
-						auto x = stack.back(); stack.pop_back();
-						stack.push_back(+x);
-						break;
-					}
 					case ETok::UnaryMinus:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for unary minus expression");
-						auto x = stack.back(); stack.pop_back();
-						stack.push_back(-x);
-						break;
-					}
-					case ETok::Comp:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for twos complement expression");
-						auto x = stack.back(); stack.pop_back();
-						stack.push_back(~x);
-						break;
-					}
+					case ETok::Abs:
+					case ETok::Sqr:
+						return common(ins.m_arity);
+					case ETok::Div:
+					case ETok::Mod:
+						return require(common(2), EType::Real, EType::Real);
 					case ETok::Not:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for boolean NOT expression");
-						auto x = stack.back(); stack.pop_back();
-						stack.push_back(!x);
-						break;
-					}
 					case ETok::LogOR:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for logical OR expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a || b);
-						break;
-					}
 					case ETok::LogAND:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for logical AND expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a && b);
-						break;
-					}
+						return require(common(ins.m_arity), EType::Intg, EType::Intg);
 					case ETok::LogEql:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for equals expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a == b);
-						break;
-					}
 					case ETok::LogNEql:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for not equal expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a != b);
-						break;
-					}
 					case ETok::LogLT:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for less than expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a < b);
-						break;
-					}
 					case ETok::LogLTEql:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for less than or equal expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a <= b);
-						break;
-					}
 					case ETok::LogGT:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for greater than expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a > b);
-						break;
-					}
 					case ETok::LogGTEql:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for greater than or equal expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a >= b);
-						break;
-					}
+						return EType::Intg;
+					case ETok::Comp:
 					case ETok::BitOR:
+					case ETok::BitAND:
+					case ETok::BitXOR:
+					case ETok::LeftShift:
+					case ETok::RightShift:
+						m_prog.m_real = false;
+						return EType::Intg;
+					default:
+						return EType::Real;
+				}
+			}
+		};
+	};
+
+	// A compiled expression
+	struct Expression
+	{
+		using ArgPair = struct { std::string_view name; Val val; };
+		using ArgNames = vector<Ident>;
+
+		// The compiled expression
+		byte_data<> m_op;
+
+		// The arguments (and default values) of the unique identifiers in the expression (in order of discovery from left to right).
+		ArgSet m_args;
+
+		// The unique argument names in the expression
+		ArgNames m_arg_names;
+
+		// The register form of 'm_op', used for evaluating over columns of arguments
+		Program m_prog;
+
+		// Is callable/valid test
+		explicit operator bool() const
+		{
+			return !m_op.empty();
+		}
+
+		// Evaluate using the given args
+		Val operator()(ArgSet const& args) const
+		{
+			return call(args);
+		}
+
+		// Evaluate the expression with the given named arguments. e.g. expr({"x", 1.2}, {"y", 3})
+		Val operator()(std::initializer_list<ArgPair> arg_pairs) const
+		{
+			ArgSet args;
+			for (auto& a : arg_pairs)
+				args.add(a.name, a.val);
+			return call(args);
+		}
+
+		// Evaluate the expression using arguments given in order. e.g. expr(1.2, 3)
+		template <typename... A> Val operator()(A... a) const
+		{
+			if constexpr (sizeof...(A) == 0)
+			{
+				return call();
+			}
+			else
+			{
+				// Unpack the arguments into an array
+				std::array<Val, sizeof...(A)> values = {a...};
+				if (values.size() > m_args.size())
+					throw std::runtime_error("Too many arguments given");
+
+				// Update any unassigned arguments in order.
+				auto args = m_args;
+				for (int i = 0, j = 0; i != int(args.size()) && j != int(values.size()); ++i)
+				{
+					if (args[i].has_value()) continue;
+					args[i] = values[j++];
+				}
+
+				// Evaluate
+				return call(args);
+			}
+		}
+
+		// Execute the expression with the given arguments. You can pass 'm_args' to this if you don't care about default values and you've assign values to them all.
+		template <typename Stack = Stack<64>>
+		Val call(ArgSet const& args = {}) const
+		{
+			// Check all arguments have a value
+			if (!args.all_assigned())
+				throw std::runtime_error("Unassigned argument values");
+
+			// Note:
+			//  - Parameters are pushed onto the stack in left to right order,
+			//    so when popping them off, the first is the rightmost argument.
+			//  - Operators should be implemented in 'Val', not here. That way
+			//    Val can be extended more easily
+			Stack stack;
+			for (size_t i = 0, iend = m_op.size(); i != iend;)
+			{
+				auto tok = m_op.read<ETok>(i);
+				switch (tok)
+				{
+					case ETok::None:
 					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for bitwise OR expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a | b);
-						break;
-					}
-					case ETok::BitAND:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for bitwise AND expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a & b);
-						break;
-					}
-					case ETok::BitXOR:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for bitwise XOR expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a ^ b);
-						break;
-					}
-					case ETok::LeftShift:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for bitwise left shift expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a << b);
-						break;
-					}
-					case ETok::RightShift:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for bitwise left shift expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						stack.push_back(a >> b);
-						break;
-					}
-					case ETok::Ceil:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for ceil() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Ceil(x.db())); break;
-							case Val::EType::Real: stack.push_back(Ceil(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Ceil(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Ceil(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Floor:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for floor() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Floor(x.db())); break;
-							case Val::EType::Real: stack.push_back(Floor(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Floor(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Floor(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Round:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for round() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Round(x.db())); break;
-							case Val::EType::Real: stack.push_back(Round(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Round(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Round(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Min:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for min() expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						switch (Val::common_type(a.m_ty, b.m_ty))
-						{
-							case Val::EType::Intg: stack.push_back(Min(a.ll(), b.ll())); break;
-							case Val::EType::Real: stack.push_back(Min(a.db(), b.db())); break;
-							case Val::EType::Intg4: stack.push_back(Min(a.i4(), b.i4())); break;
-							case Val::EType::Real4: stack.push_back(Min(a.v4(), b.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Max:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for max() expression");
-						auto b = stack.back(); stack.pop_back();
-						auto a = stack.back(); stack.pop_back();
-						switch (Val::common_type(a.m_ty, b.m_ty))
-						{
-							case Val::EType::Intg: stack.push_back(Max(a.ll(), b.ll())); break;
-							case Val::EType::Real: stack.push_back(Max(a.db(), b.db())); break;
-							case Val::EType::Intg4: stack.push_back(Max(a.i4(), b.i4())); break;
-							case Val::EType::Real4: stack.push_back(Max(a.v4(), b.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Clamp:
-					{
-						if (stack.size() < 3) throw std::runtime_error("Insufficient arguments for clamp() expression");
-						auto mx = stack.back(); stack.pop_back();
-						auto mn = stack.back(); stack.pop_back();
-						auto x = stack.back(); stack.pop_back();
-						switch (Val::common_type(x.m_ty, Val::common_type(mn.m_ty, mx.m_ty)))
-						{
-							case Val::EType::Intg: stack.push_back(Clamp(x.ll(), mn.ll(), mx.ll())); break;
-							case Val::EType::Real: stack.push_back(Clamp(x.db(), mn.db(), mx.db())); break;
-							case Val::EType::Intg4: stack.push_back(Clamp(x.i4(), mn.i4(), mx.i4())); break;
-							case Val::EType::Real4: stack.push_back(Clamp(x.v4(), mn.v4(), mx.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Abs:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for abs() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Abs(x.ll())); break;
-							case Val::EType::Real: stack.push_back(Abs(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Abs(x.i4())); break;
-							case Val::EType::Real4: stack.push_back(Abs(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Sin:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for sin() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Sin(x.db())); break;
-							case Val::EType::Real: stack.push_back(Sin(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Sin(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Sin(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Cos:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for cos() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Cos(x.db())); break;
-							case Val::EType::Real: stack.push_back(Cos(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Cos(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Cos(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::Tan:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for tan() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Tan(x.db())); break;
-							case Val::EType::Real: stack.push_back(Tan(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Tan(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Tan(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::ASin:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for asin() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Asin(x.db())); break;
-							case Val::EType::Real: stack.push_back(Asin(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Asin(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Asin(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::ACos:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for acos() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Acos(x.db())); break;
-							case Val::EType::Real: stack.push_back(Acos(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Acos(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Acos(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
-					}
-					case ETok::ATan:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for atan() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Atan(x.db())); break;
-							case Val::EType::Real: stack.push_back(Atan(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Atan(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Atan(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
 						break;
 					}
-					case ETok::ATan2:
+					case ETok::Identifier:
 					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for atan2() expression");
-						auto x = stack.back(); stack.pop_back();
-						auto y = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Atan2(y.db(), x.db())); break;
-							case Val::EType::Real: stack.push_back(Atan2(y.db(), x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Atan2(y.v4(), x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Atan2(y.v4(), x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
+						auto hash = m_op.read<IdentHash>(i);
+						stack.push_back(args(hash));
 						break;
 					}
-					case ETok::SinH:
+					case ETok::Value:
 					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for sinh() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						// Deserialise a 'Val' instance
+						auto ty = m_op.read<Val::EType>(i);
+						switch (ty)
 						{
-							case Val::EType::Intg: stack.push_back(Sinh(x.db())); break;
-							case Val::EType::Real: stack.push_back(Sinh(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Sinh(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Sinh(x.v4())); break;
+							case Val::EType::Intg: stack.push_back(m_op.read<long long>(i)); break;
+							case Val::EType::Real: stack.push_back(m_op.read<double>(i)); break;
+							case Val::EType::Intg4: stack.push_back(m_op.read<v4>(i)); break;
+							case Val::EType::Real4: stack.push_back(m_op.read<iv4>(i)); break;
 							default: throw std::runtime_error("Unknown value type");
 						}
 						break;
 					}
-					case ETok::CosH:
+					case ETok::If:
 					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for cosh() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for if expression");
+						auto boolean = stack.back(); stack.pop_back();
+						auto jmp = m_op.read<int>(i);
+						if (boolean == Val(0))
 						{
-							case Val::EType::Intg: stack.push_back(Cosh(x.db())); break;
-							case Val::EType::Real: stack.push_back(Cosh(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Cosh(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Cosh(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
+							i += jmp;
+
+							// If the next instruction is an 'else' statement, skip over it so that the else body
+							// gets executed. Remember If == branch-if-zero, Else == branch-always
+							if (m_op.at_byte_ofs<ETok>(i) == ETok::Else)
+								i += sizeof(ETok) + sizeof(int);
 						}
 						break;
 					}
-					case ETok::TanH:
+					case ETok::Else:
 					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for tanh() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Tanh(x.db())); break;
-							case Val::EType::Real: stack.push_back(Tanh(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Tanh(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Tanh(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
+						auto jmp = m_op.read<int>(i);
+						i += jmp;
 						break;
 					}
-					case ETok::Exp:
+					default:
 					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for exp() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						auto arity = Arity(tok);
+						if (arity == 0) throw std::runtime_error("Unknown expression token");
+						if (stack.size() < static_cast<size_t>(arity)) throw std::runtime_error(Fmt("Insufficient arguments for %s expression", Describe(tok)));
+
+						// Operands in left to right order
+						Val a[4];
+						for (int k = arity; k-- != 0;)
 						{
-							case Val::EType::Intg: stack.push_back(Exp(x.db())); break;
-							case Val::EType::Real: stack.push_back(Exp(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Exp(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Exp(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
+							a[k] = stack.back();
+							stack.pop_back();
 						}
+						stack.push_back(Apply(tok, &a[0]));
 						break;
 					}
-					case ETok::Log:
+				}
+			}
+			if (stack.size() != 1)
+				throw std::runtime_error("Expression does not evaluate to a single result");
+
+			return stack.back();
+		}
+
+		// Evaluate the expression over columns of argument values.
+		// 'columns[i]' are the values for argument 'i' (in discovery order, see 'm_arg_names'). Default values in 'm_args' are not used.
+		// Each column must contain at least 'result.size()' values. Row 'r' of the result is the expression evaluated using row 'r' of each column.
+		void call(std::span<std::span<Val const> const> columns, std::span<Val> result) const
+		{
+			Program local;
+			auto const& prog = program(local);
+			check_columns(columns, result.size());
+			call_rows(prog, columns, result);
+		}
+		void call(std::span<std::span<double const> const> columns, std::span<double> result) const
+		{
+			Program local;
+			auto const& prog = program(local);
+			check_columns(columns, result.size());
+			if (prog.m_real)
+				call_blocks(prog, columns, result);
+			else
+				call_rows(prog, columns, result);
+		}
+
+	private:
+
+		// The number of rows evaluated together by 'call_blocks'
+		static constexpr int BlockSize = 256;
+
+		// The register form of 'm_op' (set by 'Compile'), or a local one built on demand
+		Program const& program(Program& local) const
+		{
+			if (m_prog.m_built) return m_prog;
+			local = Program::Build(m_op, m_args);
+			return local;
+		}
+
+		// Validate the argument columns for a batch evaluation
+		template <typename T> void check_columns(std::span<std::span<T const> const> columns, size_t rows) const
+		{
+			if (columns.size() != m_args.size())
+				throw std::runtime_error(Fmt("Expected %d argument columns, %d were given", int(m_args.size()), int(columns.size())));
+
+			for (auto& column : columns)
+			{
+				if (column.size() >= rows) continue;
+				throw std::runtime_error(Fmt("Argument column has %d values, %d are required", int(column.size()), int(rows)));
+			}
+		}
+
+		// Evaluate 'prog' one row at a time, using 'Val' arithmetic
+		template <typename T> void call_rows(Program const& prog, std::span<std::span<T const> const> columns, std::span<T> result) const
+		{
+			auto output = [&](size_t r, Val const& val)
+			{
+				if constexpr (std::is_same_v<T, double>)
+					result[r] = val.db();
+				else
+					result[r] = val;
+			};
+
+			// Unsupported byte code, use the interpreter
+			if (!prog.m_valid)
+			{
+				auto args = m_args;
+				for (size_t r = 0, rend = result.size(); r != rend; ++r)
+				{
+					for (int c = 0, cend = static_cast<int>(columns.size()); c != cend; ++c)
+						args[c] = Val(columns[c][r]);
+
+					output(r, call(args));
+				}
+				return;
+			}
+
+			std::vector<Val> temps(prog.m_temps);
+			for (size_t r = 0, rend = result.size(); r != rend; ++r)
+			{
+				auto fetch = [&](Program::Reg reg) -> Val
+				{
+					switch (reg.m_src)
 					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for log() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Log(x.db())); break;
-							case Val::EType::Real: stack.push_back(Log(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Log(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Log(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
+						case Program::ESrc::Arg: return Val(columns[reg.m_idx][r]);
+						case Program::ESrc::Const: return prog.m_consts[reg.m_idx];
+						case Program::ESrc::Temp: return temps[reg.m_idx];
+						default: throw std::runtime_error("Invalid operand");
 					}
-					case ETok::Log10:
+				};
+
+				for (int pc = 0, pcend = static_cast<int>(prog.m_code.size()); pc != pcend;)
+				{
+					auto& ins = prog.m_code[pc];
+					switch (ins.m_kind)
 					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for log10() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						case Program::EKind::Op:
 						{
-							case Val::EType::Intg: stack.push_back(Log10(x.db())); break;
-							case Val::EType::Real: stack.push_back(Log10(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Log10(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(Log10(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
+							Val a[4];
+							for (int k = 0; k != ins.m_arity; ++k)
+								a[k] = fetch(ins.m_arg[k]);
+
+							temps[ins.m_dst] = Apply(ins.m_op, &a[0]);
+							++pc;
+							break;
 						}
-						break;
-					}
-					case ETok::Pow:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for pow() expression");
-						auto y = stack.back(); stack.pop_back();
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						case Program::EKind::Select:
 						{
-							case Val::EType::Intg: stack.push_back(Pow(x.db(), y.db())); break;
-							case Val::EType::Real: stack.push_back(Pow(x.db(), y.db())); break;
-							case Val::EType::Intg4: stack.push_back(Pow(x.v4(), y.v4())); break;
-							case Val::EType::Real4: stack.push_back(Pow(x.v4(), y.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
+							temps[ins.m_dst] = fetch(ins.m_arg[0]) == Val(0) ? fetch(ins.m_arg[2]) : fetch(ins.m_arg[1]);
+							++pc;
+							break;
 						}
-						break;
-					}
-					case ETok::Sqr:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for sqr() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						case Program::EKind::BranchIfZero:
 						{
-							case Val::EType::Intg: stack.push_back(Sqr(x.ll())); break;
-							case Val::EType::Real: stack.push_back(Sqr(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(Sqr(x.i4())); break;
-							case Val::EType::Real4: stack.push_back(Sqr(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
+							pc = fetch(ins.m_arg[0]) == Val(0) ? ins.m_jmp : pc + 1;
+							break;
 						}
-						break;
-					}
-					case ETok::Sqrt:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for sqrt() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						case Program::EKind::Branch:
 						{
-							case Val::EType::Intg: stack.push_back(Sqrt(x.db())); break;
-							case Val::EType::Real: stack.push_back(Sqrt(x.db())); break;
-							case Val::EType::Intg4: stack.push_back(CompSqrt(x.v4())); break;
-							case Val::EType::Real4: stack.push_back(CompSqrt(x.v4())); break;
-							default: throw std::runtime_error("Unknown value type");
+							pc = ins.m_jmp;
+							break;
 						}
-						break;
-					}
-					case ETok::Len2:
-					{
-						if (stack.size() < 2) throw std::runtime_error("Insufficient arguments for len2() expression");
-						auto y = stack.back(); stack.pop_back();
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						default:
 						{
-							case Val::EType::Intg: stack.push_back(Len(x.db(), y.db())); break;
-							case Val::EType::Real: stack.push_back(Len(x.db(), y.db())); break;
-							case Val::EType::Intg4: stack.push_back(CompOp(x.v4(), y.v4(), [](auto x, auto y) { return Len(x, y); })); break;
-							case Val::EType::Real4: stack.push_back(CompOp(x.v4(), y.v4(), [](auto x, auto y) { return Len(x, y); })); break;
-							default: throw std::runtime_error("Unknown value type");
+							throw std::runtime_error("Unknown instruction");
 						}
-						break;
 					}
-					case ETok::Len3:
+				}
+
+				output(r, fetch(prog.m_result));
+			}
+		}
+
+		// Evaluate 'prog' over blocks of rows, using 'double' arithmetic. Only valid if 'prog.m_real' is true
+		void call_blocks(Program const& prog, std::span<std::span<double const> const> columns, std::span<double> result) const
+		{
+			// Notes:
+			//  - Each instruction is applied to 'BlockSize' rows at a time, with constants broadcast into blocks.
+			//  - Branches are ignored. Both sides of a '?:' are evaluated and 'Select' chooses per row.
+			assert(prog.m_valid && prog.m_real);
+
+			auto temps = static_cast<size_t>(prog.m_temps);
+			std::vector<double> buf((temps + prog.m_consts.size()) * BlockSize);
+			for (size_t c = 0, cend = prog.m_consts.size(); c != cend; ++c)
+			{
+				auto block = &buf[(temps + c) * BlockSize];
+				std::fill(block, block + BlockSize, prog.m_consts[c].db());
+			}
+
+			for (size_t r0 = 0, rend = result.size(); r0 < rend; r0 += BlockSize)
+			{
+				auto n = static_cast<int>(std::min<size_t>(BlockSize, rend - r0));
+				auto src = [&](Program::Reg reg) -> double const*
+				{
+					switch (reg.m_src)
 					{
-						if (stack.size() < 3) throw std::runtime_error("Insufficient arguments for len3() expression");
-						auto z = stack.back(); stack.pop_back();
-						auto y = stack.back(); stack.pop_back();
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
-						{
-							case Val::EType::Intg: stack.push_back(Len(x.db(), y.db(), z.db())); break;
-							case Val::EType::Real: stack.push_back(Len(x.db(), y.db(), z.db())); break;
-							case Val::EType::Intg4: stack.push_back(CompOp(x.v4(), y.v4(), z.v4(), [](auto x, auto y, auto z) { return Len(x, y, z); })); break;
-							case Val::EType::Real4: stack.push_back(CompOp(x.v4(), y.v4(), z.v4(), [](auto x, auto y, auto z) { return Len(x, y, z); })); break;
-							default: throw std::runtime_error("Unknown value type");
-						}
-						break;
+						case Program::ESrc::Arg: return columns[reg.m_idx].data() + r0;
+						case Program::ESrc::Const: return &buf[(temps + reg.m_idx) * BlockSize];
+						case Program::ESrc::Temp: return &buf[reg.m_idx * BlockSize];
+						default: throw std::runtime_error("Invalid operand");
 					}
-					case ETok::Len4:
+				};
+
+				for (auto& ins : prog.m_code)
+				{
+					double const* args[4] = {};
+					for (int k = 0; k != ins.m_arity; ++k)
+						args[k] = src(ins.m_arg[k]);
+
+					switch (ins.m_kind)
 					{
-						if (stack.size() < 4) throw std::runtime_error("Insufficient arguments for len4() expression");
-						auto w = stack.back(); stack.pop_back();
-						auto z = stack.back(); stack.pop_back();
-						auto y = stack.back(); stack.pop_back();
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						case Program::EKind::Op:
 						{
-							case Val::EType::Intg: stack.push_back(Len(x.db(), y.db(), z.db(), w.db())); break;
-							case Val::EType::Real: stack.push_back(Len(x.db(), y.db(), z.db(), w.db())); break;
-							case Val::EType::Intg4: stack.push_back(CompOp(x.v4(), y.v4(), z.v4(), w.v4(), [](auto x, auto y, auto z, auto w) { return Len(x, y, z, w); })); break;
-							case Val::EType::Real4: stack.push_back(CompOp(x.v4(), y.v4(), z.v4(), w.v4(), [](auto x, auto y, auto z, auto w) { return Len(x, y, z, w); })); break;
-							default: throw std::runtime_error("Unknown value type");
+							Apply(ins.m_op, n, &buf[ins.m_dst * BlockSize], &args[0]);
+							break;
 						}
-						break;
-					}
-					case ETok::Deg:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for deg() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						case Program::EKind::Select:
 						{
-							case Val::EType::Intg: stack.push_back(x.db() * constants<double>::E60_by_tau); break;
-							case Val::EType::Real: stack.push_back(x.db() * constants<double>::E60_by_tau); break;
-							case Val::EType::Intg4: stack.push_back(x.v4() * constants<float>::E60_by_tau); break;
-							case Val::EType::Real4: stack.push_back(x.v4() * constants<float>::E60_by_tau); break;
-							default: throw std::runtime_error("Unknown value type");
+							auto out = &buf[ins.m_dst * BlockSize];
+							for (int i = 0; i != n; ++i)
+								out[i] = args[0][i] == 0 ? args[2][i] : args[1][i];
+							break;
 						}
-						break;
-					}
-					case ETok::Rad:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for rad() expression");
-						auto x = stack.back(); stack.pop_back();
-						switch (x.m_ty)
+						case Program::EKind::BranchIfZero:
+						case Program::EKind::Branch:
 						{
-							case Val::EType::Intg: stack.push_back(x.db() * constants<double>::tau_by_360); break;
-							case Val::EType::Real: stack.push_back(x.db() * constants<double>::tau_by_360); break;
-							case Val::EType::Intg4: stack.push_back(x.v4() * constants<float>::tau_by_360); break;
-							case Val::EType::Real4: stack.push_back(x.v4() * constants<float>::tau_by_360); break;
-							default: throw std::runtime_error("Unknown value type");
+							break;
 						}
-						break;
-					}
-					case ETok::If:
-					{
-						if (stack.size() < 1) throw std::runtime_error("Insufficient arguments for if expression");
-						auto boolean = stack.back(); stack.pop_back();
-						auto jmp = m_op.read<int>(i);
-						if (boolean == Val(0))
+						default:
 						{
-							i += jmp;
-
-							// If the next instruction is an 'else' statement, skip over it so that the else body
-							// gets executed. Remember If == branch-if-zero, Else == branch-always
-							if (m_op.at_byte_ofs<ETok>(i) == ETok::Else)
-								i += sizeof(ETok) + sizeof(int);
+							throw std::runtime_error("Unknown instruction");
 						}
-						break;
-					}
-					case ETok::Else:
-					{
-						auto jmp = m_op.read<int>(i);
-						i += jmp;
-						break;
-					}
-					default:
-					{
-						throw std::runtime_error("Unknown expression token");
 					}
 				}
-			}
-			if (stack.size() != 1)
-				throw std::runtime_error("Expression does not evaluate to a single result");
 
-			return stack.back();
+				auto res = src(prog.m_result);
+				std::copy(res, res + n, result.data() + r0);
+			}
 		}
 	};
 
@@ -2112,9 +2800,11 @@ namespace pr::eval
 	inline Expression Compile(char_range<Char> expr)
 	{
 		Expression compiled;
-		return Compile(expr, compiled, ETok::None)
-			? std::move(compiled)
-			: throw std::runtime_error("Expression is incomplete");
+		if (!Compile(expr, compiled, ETok::None))
+			throw std::runtime_error("Expression is incomplete");
+
+		compiled.m_prog = Program::Build(compiled.m_op, compiled.m_args);
+		return compiled;
 	}
 
 	// Compile an expression. Throws on syntax error
@@ -2502,6 +3192,70 @@ namespace pr::common::tests
 				PR_EXPECT(expr() == Val('1' + '2'));
 			}
 		}
+		{// Batch evaluation
+			auto const N = 1000;
+			std::vector<double> xs(N), ys(N), out(N);
+			for (int i = 0; i != N; ++i)
+			{
+				xs[i] = -2.0 + 4.0 * i / N;
+				ys[i] = 0.5 + 0.25 * (i % 7);
+			}
+			std::span<double const> cols[] = { xs, ys };
+
+			{ // double fast path
+				auto expr = Compile("x > 0.5 ? sqrt(x) * y : sin(x) * sin(x) + y % 1.5 - deg(atan2(y, x))");
+				PR_EXPECT(expr.m_prog.m_valid && expr.m_prog.m_real);
+
+				expr.call(cols, out);
+				auto ok = true;
+				for (int i = 0; i != N; ++i)
+					ok &= FEql(out[i], expr(xs[i], ys[i]).db());
+				PR_EXPECT(ok);
+			}
+			{ // constant folding and common sub-expressions
+				auto expr = Compile("sin(x) * sin(x) + 2 * 3 - (true ? y : x)");
+				PR_EXPECT(expr.m_prog.m_code.size() == 4); // sin, mul, add, sub
+				PR_EXPECT(expr.m_prog.m_real);
+
+				expr.call(cols, out);
+				auto ok = true;
+				for (int i = 0; i != N; ++i)
+					ok &= FEql(out[i], Sqr(std::sin(xs[i])) + 6 - ys[i]);
+				PR_EXPECT(ok);
+			}
+			{ // comparisons with integer results
+				auto expr = Compile("(x < 0) + (x >= y) * 2 + !(x == y)");
+				PR_EXPECT(expr.m_prog.m_real);
+
+				expr.call(cols, out);
+				auto ok = true;
+				for (int i = 0; i != N; ++i)
+					ok &= out[i] == expr(xs[i], ys[i]).db();
+				PR_EXPECT(ok);
+			}
+			{ // integer arithmetic uses 'Val'
+				auto expr = Compile("y != 0 ? x / y + (x & 3) : -1");
+				PR_EXPECT(expr.m_prog.m_valid && !expr.m_prog.m_real);
+
+				std::vector<Val> xi(N), yi(N), res(N);
+				for (int i = 0; i != N; ++i)
+				{
+					xi[i] = Val(i * 37 - 500);
+					yi[i] = Val(i % 5 - 2); // includes zero, the branch must not be evaluated
+				}
+				std::span<Val const> icols[] = { xi, yi };
+				expr.call(icols, res);
+
+				auto ok = true;
+				for (int i = 0; i != N; ++i)
+					ok &= res[i] == expr(xi[i], yi[i]);
+				PR_EXPECT(ok);
+			}
+			{ // argument columns must match the arguments
+				auto expr = Compile("x + y + z");
+				PR_THROWS(expr.call(cols, out), std::runtime_error);
+			}
+		}
 	}
 }
 #endif
@@ -53,6 +53,7 @@ namespace pr
 	// name - The name (within that namespace).
 	// version - The version number of the UUID to create; this value must be either 3 (for MD5 hashing) or 5 (for SHA-1 hashing).
 	// Returns a UUID derived from the namespace and name.
+	// Note: version 5 GUIDs match RFC 4122. Those created before the SHA1 round fix (in 'sha1.h') differ.
 	// See <a href="http://code.logos.com/blog/2011/04/generating_a_deterministic_guid.html">Generating a deterministic GUID</a>
 	inline Guid GenerateGUID(Guid namespace_id, char const* name, EGuidVersion version = EGuidVersion::SHA1Hashing)
 	{
@@ -252,6 +253,10 @@ namespace pr::common
 		PR_EXPECT(To<std::wstring>(GuidInvalid) == L"00000000-0000-0000-0000-000000000000");
 		PR_EXPECT(To<Guid>("00000000-0000-0000-0000-000000000000") == GuidInvalid);
 		PR_EXPECT(To<Guid>(L"00000000-0000-0000-0000-000000000000") == GuidZero);
+
+		// Name based GUIDs (known values, same as Python's uuid.uuid3/uuid5)
+		PR_EXPECT(GenerateGUID(GuidDnsNamespace, "www.example.com", EGuidVersion::SHA1Hashing) == To<Guid>("2ed6657d-e927-568b-95e1-2665a8aea6a2"));
+		PR_EXPECT(GenerateGUID(GuidDnsNamespace, "www.example.com", EGuidVersion::MD5Hashing) == To<Guid>("5df41881-3aed-3515-88a7-2f4a814cf09e"));
 	}
 }
 #endif
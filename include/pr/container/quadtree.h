@@ -5,6 +5,8 @@
 // Sparce loose quad tree (actually N-Dimensional tree)
 // Items in the nodes of the tree can over hang up to half
 // the size of the smallest dimension of the node.
+// 'FlatQuadTree' is a variant with a flat node array, bulk
+// rebuild, O(1) item moves, and parallel queries.
 
 #pragma once
 
@@ -12,6 +14,15 @@
 #include <deque>
 #include <limits>
 #include <algorithm>
+#include <unordered_map>
+#include <execution>
+#include <type_traits>
+#include <stdexcept>
+#include <thread>
+#include <span>
+#include <ranges>
+#include <cstdint>
+#include <cstring>
 #include <cassert>
 
 namespace pr
@@ -49,6 +60,24 @@ namespace pr
 			node*    m_child[1 << N]; // Pointers to the child nodes
 			Node(Coord<N> coord, node* parent) :Coord<N>(coord) ,m_items() ,m_parent(parent) ,m_child() {}
 		};
+
+		// An axis aligned box query region
+		template <int N> struct Box
+		{
+			float m_min[N];
+			float m_max[N];
+		};
+
+		// A plane of a convex query region (e.g. a view frustum). Points with 'dot(m_normal, p) + m_dist >= 0' are inside.
+		// 'm_normal' should be unit length so that item radii can be compared with plane distances.
+		template <int N> struct Plane
+		{
+			float m_normal[N];
+			float m_dist;
+		};
+
+		// Concept for an execution policy (e.g. std::execution::par)
+		template <typename T> concept ExecutionPolicy = std::is_execution_policy_v<std::remove_cvref_t<T>>;
 	}
 
 	// Loose quad tree
@@ -443,6 +472,609 @@ namespace pr
 			return &m_nodes.back();
 		}
 	};
+
+	// Flat loose quad tree (N-Dimensional) for large numbers of moving items
+	template <int N = 2>
+	struct FlatQuadTree
+	{
+		// Notes:
+		//  - Items are identified by id. 'Rebuild' uses the index of each item in the given span as its id,
+		//    'Insert' returns the lowest unused id.
+		//  - Items are placed in the same cells as 'QuadTree' would place them. Items in a node can over hang
+		//    the node by up to half the size of the node. The root node can contain items of any size.
+		//  - Nodes are stored in one array, in depth first Morton order, and the ancestors of every node exist.
+		//    'm_skip[i]' is the index of the node after the sub-tree of node 'i', so a query is a linear scan
+		//    that jumps over the sub-trees that it doesn't overlap.
+		//  - Nodes created by 'Insert' or 'Move' are appended after the ordered nodes and are tested one at a time.
+		//    The nodes are re-ordered once the unordered nodes become a significant fraction of the total.
+		//  - Each item records the node and slot that contain it, so 'Move' and 'Remove' are O(1). Moving an item
+		//    to a different cell costs one hash lookup.
+		using ItemId = uint32_t;
+		using Key = uint64_t;
+		static constexpr uint32_t NoNode = ~uint32_t();
+		static constexpr int MaxLevels = 63 / N < 32 ? 63 / N : 32;
+
+		// The bounding sphere of an item
+		struct Bounds
+		{
+			float m_centre[N];
+			float m_radius;
+		};
+
+		// An item in a node
+		struct Entry
+		{
+			Bounds m_bounds;
+			ItemId m_id;
+		};
+
+		// A node of the tree
+		struct Node
+		{
+			Key m_key;                  // Locational code. A '1' bit followed by the interleaved coordinate bits of each level
+			int m_level;                // The level in the tree that this node is in
+			uint32_t m_coord[N];        // The coordinates of this node within the level
+			std::vector<Entry> m_items; // The items contained in this node
+		};
+
+		// The location of an item in the tree
+		struct Handle
+		{
+			uint32_t m_node; // Index of the node containing the item, or 'NoNode' if the id is unused
+			uint32_t m_slot; // Index of the item within the node
+		};
+
+		std::vector<Node>     m_nodes;   // The nodes of the tree. [0, m_ordered) are in depth first Morton order
+		std::vector<uint32_t> m_skip;    // The index of the node after the sub-tree of each ordered node
+		std::vector<Handle>   m_handles; // The location of each item, indexed by id
+		std::vector<ItemId>   m_free;    // Unused item ids
+		std::unordered_map<Key, uint32_t> m_lookup; // Node index by key
+		size_t m_ordered;                // The number of nodes in depth first order
+		size_t m_count;                  // The number of items in the tree
+		float  m_min[N];                 // The min x,y,z,.. corner of the region covered by the tree
+		float  m_size[N];                // The x,y,z,... size of the region covered by the tree
+		int    m_max_levels;             // The maximum depth the tree will grow to
+
+		FlatQuadTree(float const (&min)[N], float const (&size)[N], int max_levels = 8)
+			:m_nodes()
+			,m_skip()
+			,m_handles()
+			,m_free()
+			,m_lookup()
+			,m_ordered()
+			,m_count()
+			,m_min()
+			,m_size()
+			,m_max_levels(std::clamp(max_levels, 1, MaxLevels))
+		{
+			for (int d = 0; d != N; ++d)
+			{
+				m_min[d] = min[d];
+				m_size[d] = size[d];
+			}
+			Clear();
+		}
+
+		// Remove all items
+		void Clear()
+		{
+			Reset();
+			Reorder();
+		}
+
+		// Replace the contents of the tree with 'items'. The id of each item is its index in 'items'
+		void Rebuild(std::span<Bounds const> items)
+		{
+			Rebuild(std::execution::seq, items);
+		}
+		template <quad_tree::ExecutionPolicy Policy>
+		void Rebuild(Policy&& policy, std::span<Bounds const> items)
+		{
+			if (items.size() >= NoNode)
+				throw std::overflow_error("Too many items for FlatQuadTree");
+
+			// Discard the old nodes and items. The node array capacity is reused
+			Reset();
+
+			// Find the node key for each item, then sort the items into node order
+			struct Placed { Key m_order; int m_level; Key m_key; ItemId m_id; };
+			std::vector<Placed> placed(items.size());
+			auto ids = std::views::iota(ItemId(0), static_cast<ItemId>(items.size()));
+			std::transform(policy, ids.begin(), ids.end(), std::begin(placed), [&](ItemId id)
+			{
+				uint32_t coord[N];
+				auto level = Locate(items[id], coord);
+				auto key = MakeKey(level, coord);
+				return Placed{ OrderKey(key, level), level, key, id };
+			});
+			std::sort(policy, std::begin(placed), std::end(placed), [](Placed const& lhs, Placed const& rhs)
+			{
+				if (lhs.m_order != rhs.m_order) return lhs.m_order < rhs.m_order;
+				if (lhs.m_level != rhs.m_level) return lhs.m_level < rhs.m_level;
+				return lhs.m_id < rhs.m_id;
+			});
+
+			// Create the nodes (and their ancestors)
+			for (size_t i = 0, iend = placed.size(); i != iend;)
+			{
+				auto key = placed[i].m_key;
+				for (; i != iend && placed[i].m_key == key; ++i) {}
+				NodeAt(key, placed[i - 1].m_level, false);
+			}
+			Reorder();
+
+			// Add the items to the nodes
+			m_handles.resize(items.size());
+			for (size_t i = 0, iend = placed.size(); i != iend;)
+			{
+				auto key = placed[i].m_key;
+				auto idx = m_lookup.find(key)->second;
+				auto& node = m_nodes[idx];
+
+				auto end = i;
+				for (; end != iend && placed[end].m_key == key; ++end) {}
+				node.m_items.reserve(end - i);
+
+				for (; i != end; ++i)
+				{
+					auto id = placed[i].m_id;
+					m_handles[id] = Handle{ idx, static_cast<uint32_t>(node.m_items.size()) };
+					node.m_items.push_back(Entry{ items[id], id });
+				}
+			}
+			m_count = items.size();
+		}
+
+		// Add an item to the tree. Returns the id of the item
+		ItemId Insert(Bounds const& bounds)
+		{
+			ItemId id;
+			if (!m_free.empty())
+			{
+				id = m_free.back();
+				m_free.pop_back();
+			}
+			else
+			{
+				if (m_handles.size() >= NoNode) throw std::overflow_error("Too many items for FlatQuadTree");
+				id = static_cast<ItemId>(m_handles.size());
+				m_handles.push_back(Handle{ NoNode, 0 });
+			}
+
+			Link(id, bounds);
+			++m_count;
+			return id;
+		}
+
+		// Remove an item from the tree
+		void Remove(ItemId id)
+		{
+			assert(Contains(id) && "Item is not in the tree");
+			Unlink(id);
+			m_handles[id].m_node = NoNode;
+			m_free.push_back(id);
+			--m_count;
+		}
+
+		// Update the bounds of an item
+		void Move(ItemId id, Bounds const& bounds)
+		{
+			assert(Contains(id) && "Item is not in the tree");
+			auto& h = m_handles[id];
+
+			// Still in the same cell?
+			uint32_t coord[N];
+			auto level = Locate(bounds, coord);
+			if (m_nodes[h.m_node].m_key == MakeKey(level, coord))
+			{
+				m_nodes[h.m_node].m_items[h.m_slot].m_bounds = bounds;
+				return;
+			}
+
+			Unlink(id);
+			Link(id, bounds);
+		}
+
+		// True if 'id' is an item in the tree
+		bool Contains(ItemId id) const
+		{
+			return id < m_handles.size() && m_handles[id].m_node != NoNode;
+		}
+
+		// Return the bounds of an item
+		Bounds const& Get(ItemId id) const
+		{
+			assert(Contains(id) && "Item is not in the tree");
+			auto& h = m_handles[id];
+			return m_nodes[h.m_node].m_items[h.m_slot].m_bounds;
+		}
+
+		// Call 'found(ItemId, Bounds const&)' for each item that overlaps 'box'.
+		// 'found' should return false to end the search early. Returns false if the search ended early.
+		template <typename Found> bool Find(quad_tree::Box<N> const& box, Found found) const
+		{
+			return Scan(0, m_nodes.size(), BoxTest{ box }, found);
+		}
+
+		// Call 'found(ItemId, Bounds const&)' for each item that is not entirely outside one of 'planes'.
+		// 'found' should return false to end the search early. Returns false if the search ended early.
+		template <typename Found> bool Find(std::span<quad_tree::Plane<N> const> planes, Found found) const
+		{
+			return Scan(0, m_nodes.size(), PlaneTest{ planes }, found);
+		}
+
+		// Find the ids of the items that overlap 'box', searching parts of the tree concurrently.
+		// The ids are returned in the same order as the serial 'Find'.
+		template <quad_tree::ExecutionPolicy Policy>
+		void Find(Policy&& policy, quad_tree::Box<N> const& box, std::vector<ItemId>& out) const
+		{
+			FindParallel(std::forward<Policy>(policy), BoxTest{ box }, out);
+		}
+
+		// Find the ids of the items not entirely outside one of 'planes', searching parts of the tree concurrently.
+		// The ids are returned in the same order as the serial 'Find'.
+		template <quad_tree::ExecutionPolicy Policy>
+		void Find(Policy&& policy, std::span<quad_tree::Plane<N> const> planes, std::vector<ItemId>& out) const
+		{
+			FindParallel(std::forward<Policy>(policy), PlaneTest{ planes }, out);
+		}
+
+		// Returns the dimensions of a cell at the given level
+		float CellSize(int d, int level) const
+		{
+			return m_size[d] / static_cast<float>(uint64_t(1) << level);
+		}
+
+		// Returns the level in the tree for an item bounded by 'radius' (See 'QuadTree::GetLevel')
+		int GetLevel(float radius) const
+		{
+			auto twor = 2 * radius;
+			for (int i = 1; i != m_max_levels; ++i)
+			{
+				for (int d = 0; d != N; ++d)
+					if (twor > CellSize(d, i))
+						return i - 1;
+			}
+			return m_max_levels - 1;
+		}
+
+		// Find the cell for an item. Returns the level and the cell coordinates in 'coord' (See 'QuadTree::GetLevelAndIndices')
+		int Locate(Bounds const& bounds, uint32_t (&coord)[N]) const
+		{
+			assert(bounds.m_radius >= 0.0f && "negative radius");
+
+			float pt[N];
+			for (int d = 0; d != N; ++d)
+				pt[d] = bounds.m_centre[d] - m_min[d];
+
+			auto level = GetLevel(bounds.m_radius);
+			auto max_index = static_cast<int64_t>(uint64_t(1) << level);
+
+			int64_t loc[N];
+			for (int d = 0; d != N; ++d)
+				loc[d] = std::clamp<int64_t>(static_cast<int64_t>(pt[d] / CellSize(d, level)), 0, max_index - 1);
+
+			// If 'point' is outside of the region then keep going up levels until the
+			// over hang is within half the cell width of the closest cell.
+			bool outside = false;
+			for (int d = 0; d != N; ++d) outside |= pt[d] < 0.0f || pt[d] >= m_size[d];
+			if (outside)
+			{
+				float dist[N] = {};
+				for (int d = 0; d != N; ++d)
+				{
+					if (pt[d] < 0.0f)       { dist[d] = -pt[d] + bounds.m_radius; }
+					if (pt[d] >= m_size[d]) { dist[d] = pt[d] - m_size[d] + bounds.m_radius; }
+				}
+				for (int d = 0; d != N; ++d)
+				{
+					while (level > 0 && 2.0f * dist[d] > CellSize(d, level))
+					{
+						--level;
+						for (int dd = 0; dd != N; ++dd)
+							loc[dd] /= 2;
+					}
+				}
+			}
+
+			for (int d = 0; d != N; ++d)
+				coord[d] = static_cast<uint32_t>(loc[d]);
+
+			return level;
+		}
+
+		// Return the bounds of 'node', optionally including the region that items in the node might overlap
+		void NodeBounds(Node const& node, bool overlap_region, float (&min)[N], float (&max)[N]) const
+		{
+			float ovr = overlap_region ? 0.5f : 0.0f;
+			for (int d = 0; d != N; ++d)
+			{
+				float cell = CellSize(d, node.m_level);
+				min[d] = (node.m_coord[d] - (0.0f + ovr)) * cell + m_min[d];
+				max[d] = (node.m_coord[d] + (1.0f + ovr)) * cell + m_min[d];
+			}
+		}
+
+		// The locational code for a cell
+		static Key MakeKey(int level, uint32_t const (&coord)[N])
+		{
+			Key key = 1;
+			for (int b = level; b-- != 0;)
+			{
+				for (int d = N; d-- != 0;)
+					key = (key << 1) | ((coord[d] >> b) & 1);
+			}
+			return key;
+		}
+
+		// The key that sorts cells into depth first order (ties are broken by level)
+		static Key OrderKey(Key key, int level)
+		{
+			return key << (N * (MaxLevels - 1 - level));
+		}
+
+		// True if 'anc' is an ancestor of 'node'
+		static bool IsAncestor(Node const& anc, Node const& node)
+		{
+			return anc.m_level < node.m_level && (node.m_key >> (N * (node.m_level - anc.m_level))) == anc.m_key;
+		}
+
+		// Sanity check the tree
+		bool SanityCheck() const
+		{
+			if (m_ordered > m_nodes.size() || m_skip.size() != m_ordered || m_lookup.size() != m_nodes.size())
+				return false;
+
+			size_t count = 0;
+			for (uint32_t i = 0, iend = static_cast<uint32_t>(m_nodes.size()); i != iend; ++i)
+			{
+				auto& node = m_nodes[i];
+				auto iter = m_lookup.find(node.m_key);
+				if (iter == m_lookup.end() || iter->second != i)
+					return false;
+
+				// The parent node must exist
+				if (node.m_level != 0 && m_lookup.count(node.m_key >> N) == 0)
+					return false;
+
+				// Sub-trees of ordered nodes must be contiguous
+				if (i < m_ordered)
+				{
+					if (m_skip[i] <= i || m_skip[i] > m_ordered) return false;
+					for (auto j = i + 1; j != m_skip[i]; ++j)
+						if (!IsAncestor(node, m_nodes[j])) return false;
+				}
+
+				// Items must know where they are
+				for (uint32_t s = 0, send = static_cast<uint32_t>(node.m_items.size()); s != send; ++s)
+				{
+					auto& h = m_handles[node.m_items[s].m_id];
+					if (h.m_node != i || h.m_slot != s)
+						return false;
+				}
+				count += node.m_items.size();
+			}
+			return count == m_count;
+		}
+
+	private:
+
+		// Box overlap tests
+		struct BoxTest
+		{
+			quad_tree::Box<N> const& m_box;
+
+			bool Overlaps(float const (&min)[N], float const (&max)[N]) const
+			{
+				for (int d = 0; d != N; ++d)
+					if (max[d] < m_box.m_min[d] || min[d] > m_box.m_max[d])
+						return false;
+				return true;
+			}
+			bool Overlaps(Bounds const& b) const
+			{
+				float dist_sq = 0;
+				for (int d = 0; d != N; ++d)
+				{
+					auto c = b.m_centre[d];
+					auto e = c < m_box.m_min[d] ? m_box.m_min[d] - c : c > m_box.m_max[d] ? c - m_box.m_max[d] : 0.0f;
+					dist_sq += e * e;
+				}
+				return dist_sq <= b.m_radius * b.m_radius;
+			}
+		};
+
+		// Convex region overlap tests
+		struct PlaneTest
+		{
+			std::span<quad_tree::Plane<N> const> m_planes;
+
+			bool Overlaps(float const (&min)[N], float const (&max)[N]) const
+			{
+				for (auto& plane : m_planes)
+				{
+					// The corner of the box furthest along the plane normal
+					auto dist = plane.m_dist;
+					for (int d = 0; d != N; ++d)
+						dist += plane.m_normal[d] * (plane.m_normal[d] >= 0 ? max[d] : min[d]);
+					if (dist < 0)
+						return false;
+				}
+				return true;
+			}
+			bool Overlaps(Bounds const& b) const
+			{
+				for (auto& plane : m_planes)
+				{
+					auto dist = plane.m_dist;
+					for (int d = 0; d != N; ++d)
+						dist += plane.m_normal[d] * b.m_centre[d];
+					if (dist < -b.m_radius)
+						return false;
+				}
+				return true;
+			}
+		};
+
+		// Test the nodes in [beg, end), calling 'found' for each overlapping item
+		template <typename Test, typename Found> bool Scan(size_t beg, size_t end, Test const& test, Found&& found) const
+		{
+			for (auto i = beg; i < end;)
+			{
+				auto& node = m_nodes[i];
+
+				// The root node can contain items of any size
+				float min[N], max[N];
+				NodeBounds(node, true, min, max);
+				if (node.m_level != 0 && !test.Overlaps(min, max))
+				{
+					i = i < m_ordered ? std::min<size_t>(m_skip[i], end) : i + 1;
+					continue;
+				}
+
+				for (auto& entry : node.m_items)
+				{
+					if (!test.Overlaps(entry.m_bounds)) continue;
+					if (!found(entry.m_id, entry.m_bounds)) return false;
+				}
+				++i;
+			}
+			return true;
+		}
+
+		// Split the nodes into ranges and scan them concurrently
+		template <typename Policy, typename Test> void FindParallel(Policy&& policy, Test const& test, std::vector<ItemId>& out) const
+		{
+			// Notes:
+			//  - A range can start part way through a sub-tree. The nodes in it are then tested without the
+			//    benefit of their ancestors' tests, which is still correct because each node is tested.
+			struct Range { size_t m_beg, m_end; std::vector<ItemId> m_found; };
+
+			auto const count = std::max<size_t>(1, std::thread::hardware_concurrency()) * 4;
+			auto const step = (m_nodes.size() + count - 1) / count;
+
+			std::vector<Range> ranges;
+			for (size_t i = 0; i < m_nodes.size(); i += step)
+				ranges.push_back(Range{ i, std::min(i + step, m_nodes.size()), {} });
+
+			std::for_each(std::forward<Policy>(policy), std::begin(ranges), std::end(ranges), [&](Range& range)
+			{
+				Scan(range.m_beg, range.m_end, test, [&](ItemId id, Bounds const&) { range.m_found.push_back(id); return true; });
+			});
+
+			out.resize(0);
+			for (auto& range : ranges)
+				out.insert(std::end(out), std::begin(range.m_found), std::end(range.m_found));
+		}
+
+		// Remove all nodes and items, except the root node. Container capacity is kept.
+		// Note: the nodes are not in depth first order until 'Reorder' is called.
+		void Reset()
+		{
+			m_nodes.clear();
+			m_skip.clear();
+			m_handles.clear();
+			m_free.clear();
+			m_lookup.clear();
+			m_ordered = 0;
+			m_count = 0;
+
+			// The root node always exists
+			uint32_t coord[N] = {};
+			m_nodes.push_back(Node{ MakeKey(0, coord), 0, {}, {} });
+			m_lookup[m_nodes[0].m_key] = 0;
+		}
+
+		// Return the index of the node at 'key', creating it (and its ancestors) if necessary
+		uint32_t NodeAt(Key key, int level, bool allow_reorder = true)
+		{
+			auto iter = m_lookup.find(key);
+			if (iter != m_lookup.end())
+				return iter->second;
+
+			// Create the ancestors first
+			if (level != 0)
+				NodeAt(key >> N, level - 1, false);
+
+			Node node = { key, level, {}, {} };
+			for (int b = 0; b != level; ++b)
+			{
+				for (int d = 0; d != N; ++d)
+					node.m_coord[d] |= static_cast<uint32_t>((key >> (b * N + d)) & 1) << b;
+			}
+
+			auto idx = static_cast<uint32_t>(m_nodes.size());
+			m_nodes.push_back(std::move(node));
+			m_lookup[key] = idx;
+
+			// Restore the depth first order if too many nodes are unordered
+			if (allow_reorder && m_nodes.size() - m_ordered > std::max<size_t>(64, m_ordered / 4))
+			{
+				Reorder();
+				idx = m_lookup[key];
+			}
+			return idx;
+		}
+
+		// Add 'id' to the node for 'bounds'
+		void Link(ItemId id, Bounds const& bounds)
+		{
+			uint32_t coord[N];
+			auto level = Locate(bounds, coord);
+			auto idx = NodeAt(MakeKey(level, coord), level);
+
+			auto& node = m_nodes[idx];
+			m_handles[id] = Handle{ idx, static_cast<uint32_t>(node.m_items.size()) };
+			node.m_items.push_back(Entry{ bounds, id });
+		}
+
+		// Remove 'id' from its node
+		void Unlink(ItemId id)
+		{
+			auto h = m_handles[id];
+			auto& items = m_nodes[h.m_node].m_items;
+			if (h.m_slot != items.size() - 1)
+			{
+				items[h.m_slot] = items.back();
+				m_handles[items[h.m_slot].m_id].m_slot = h.m_slot;
+			}
+			items.pop_back();
+		}
+
+		// Sort the nodes into depth first order and update the skip indices
+		void Reorder()
+		{
+			std::sort(std::begin(m_nodes), std::end(m_nodes), [](Node const& lhs, Node const& rhs)
+			{
+				auto l = OrderKey(lhs.m_key, lhs.m_level);
+				auto r = OrderKey(rhs.m_key, rhs.m_level);
+				return l != r ? l < r : lhs.m_level < rhs.m_level;
+			});
+
+			// Update the lookup and item handles
+			for (uint32_t i = 0, iend = static_cast<uint32_t>(m_nodes.size()); i != iend; ++i)
+			{
+				m_lookup[m_nodes[i].m_key] = i;
+				for (auto& entry : m_nodes[i].m_items)
+					m_handles[entry.m_id].m_node = i;
+			}
+
+			// Find the end of each node's sub-tree
+			std::vector<uint32_t> stack;
+			m_skip.resize(m_nodes.size());
+			for (uint32_t i = 0, iend = static_cast<uint32_t>(m_nodes.size()); i != iend; ++i)
+			{
+				for (; !stack.empty() && !IsAncestor(m_nodes[stack.back()], m_nodes[i]); stack.pop_back())
+					m_skip[stack.back()] = i;
+
+				stack.push_back(i);
+			}
+			for (; !stack.empty(); stack.pop_back())
+				m_skip[stack.back()] = static_cast<uint32_t>(m_nodes.size());
+
+			m_ordered = m_nodes.size();
+		}
+	};
 }
 
 #if PR_UNITTESTS
@@ -587,5 +1219,140 @@ namespace pr::common
 			}
 		}//*/
 	}
+	PRUnitTest(FlatQuadTreeTests)
+	{
+		using Tree = pr::FlatQuadTree<2>;
+		using Bounds = Tree::Bounds;
+		using ItemId = Tree::ItemId;
+
+		std::default_random_engine rng;
+		std::uniform_real_distribution<float> dist_x(-12.0f, 12.0f);
+		std::uniform_real_distribution<float> dist_y(-7.0f, 7.0f);
+		std::uniform_real_distribution<float> dist_r(0.0f, 0.5f);
+		auto random_bounds = [&]
+		{
+			// Mostly small items, with the occasional large one
+			auto r = dist_r(rng);
+			return Bounds{ {dist_x(rng), dist_y(rng)}, r > 0.49f ? 20 * r : r * r };
+		};
+
+		Tree tree({-10, -5}, {20, 10});
+		pr::QuadTree<int, 2> qtree({-10, -5}, {20, 10});
+
+		std::vector<Bounds> items(5000);
+		for (auto& b : items)
+			b = random_bounds();
+
+		// Items are placed in the same cells as in 'QuadTree'
+		for (auto& b : items)
+		{
+			uint32_t coord[2];
+			auto level = tree.Locate(b, coord);
+			auto c = qtree.GetLevelAndIndices(b.m_centre, b.m_radius);
+			PR_EXPECT(c.m_level == static_cast<size_t>(level));
+			PR_EXPECT(c.m_coord[0] == coord[0] && c.m_coord[1] == coord[1]);
+		}
+
+		tree.Rebuild(std::execution::par, items);
+		PR_EXPECT(tree.SanityCheck());
+		PR_EXPECT(tree.m_count == items.size());
+		for (ItemId id = 0; id != items.size(); ++id)
+			PR_EXPECT(std::memcmp(&tree.Get(id), &items[id], sizeof(Bounds)) == 0);
+
+		// Rebuilding replaces the old nodes
+		{
+			auto node_count = tree.m_nodes.size();
+			tree.Rebuild(std::execution::seq, std::span<Bounds const>(items).subspan(0, 10));
+			PR_EXPECT(tree.SanityCheck());
+			PR_EXPECT(tree.m_count == 10U);
+			PR_EXPECT(tree.m_nodes.size() < node_count);
+
+			Tree fresh({-10, -5}, {20, 10});
+			fresh.Rebuild(std::span<Bounds const>(items).subspan(0, 10));
+			PR_EXPECT(tree.m_nodes.size() == fresh.m_nodes.size());
+
+			tree.Rebuild(std::execution::par, items);
+			PR_EXPECT(tree.SanityCheck());
+			PR_EXPECT(tree.m_nodes.size() == node_count);
+		}
+
+		// Compare queries with brute force
+		auto check = [&]
+		{
+			for (int q = 0; q != 50; ++q)
+			{
+				auto cx = dist_x(rng), cy = dist_y(rng), hx = 2 * dist_r(rng) + 0.1f, hy = 4 * dist_r(rng) + 0.1f;
+				quad_tree::Box<2> box = { {cx - hx, cy - hy}, {cx + hx, cy + hy} };
+
+				std::vector<ItemId> found, par, brute;
+				tree.Find(box, [&](ItemId id, Bounds const&) { found.push_back(id); return true; });
+				tree.Find(std::execution::par, box, par);
+				PR_EXPECT(found == par);
+
+				for (ItemId id = 0; id != tree.m_handles.size(); ++id)
+				{
+					if (!tree.Contains(id)) continue;
+					auto& b = tree.Get(id);
+					auto dx = std::max({box.m_min[0] - b.m_centre[0], 0.0f, b.m_centre[0] - box.m_max[0]});
+					auto dy = std::max({box.m_min[1] - b.m_centre[1], 0.0f, b.m_centre[1] - box.m_max[1]});
+					if (dx * dx + dy * dy <= b.m_radius * b.m_radius) brute.push_back(id);
+				}
+				std::sort(std::begin(found), std::end(found));
+				PR_EXPECT(found == brute);
+			}
+			{
+				// A triangular 'frustum'
+				quad_tree::Plane<2> planes[] =
+				{
+					{ {+1.0f, 0.0f}, 3.0f },
+					{ {0.0f, -1.0f}, 2.0f },
+					{ {-0.70710678f, 0.70710678f}, 1.0f },
+				};
+
+				std::vector<ItemId> found, par, brute;
+				tree.Find(planes, [&](ItemId id, Bounds const&) { found.push_back(id); return true; });
+				tree.Find(std::execution::par, planes, par);
+				PR_EXPECT(found == par);
+
+				for (ItemId id = 0; id != tree.m_handles.size(); ++id)
+				{
+					if (!tree.Contains(id)) continue;
+					auto& b = tree.Get(id);
+					auto inside = true;
+					for (auto& p : planes)
+						inside &= p.m_normal[0] * b.m_centre[0] + p.m_normal[1] * b.m_centre[1] + p.m_dist >= -b.m_radius;
+					if (inside) brute.push_back(id);
+				}
+				std::sort(std::begin(found), std::end(found));
+				PR_EXPECT(found == brute);
+			}
+		};
+		check();
+
+		// Move the items around. This creates new nodes, so the tree is reordered along the way
+		for (int i = 0; i != 20000; ++i)
+		{
+			auto id = static_cast<ItemId>(rng() % items.size());
+			auto b = tree.Get(id);
+			b.m_centre[0] += 0.2f * (dist_r(rng) - 0.25f);
+			b.m_centre[1] += 0.2f * (dist_r(rng) - 0.25f);
+			tree.Move(id, i % 10 == 0 ? random_bounds() : b);
+		}
+		PR_EXPECT(tree.SanityCheck());
+		check();
+
+		// Remove and insert items
+		for (ItemId id = 0; id < items.size(); id += 3)
+			tree.Remove(id);
+		PR_EXPECT(tree.SanityCheck());
+		PR_EXPECT(tree.m_count == items.size() - (items.size() + 2) / 3);
+		for (int i = 0; i != 1000; ++i)
+		{
+			auto id = tree.Insert(random_bounds());
+			PR_EXPECT(id % 3 == 0); // Unused ids are reused first
+		}
+		PR_EXPECT(tree.SanityCheck());
+		check();
+	}
 }
 #endif
\ No newline at end of file
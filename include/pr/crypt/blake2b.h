@@ -8,13 +8,51 @@
 #pragma once
 
 #include <array>
+#include <vector>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <execution>
+#include <thread>
 #include <cstdint>
+#include <cstring>
 #include <intrin.h>
+#include "pr/crypt/hash_many.h"
 
 namespace pr::hash
 {
+	// BLAKE2 parameter block fields used for tree hashing (see the BLAKE2 spec, section 2.10)
+	struct Blake2Params
+	{
+		uint8_t m_fanout = 1;       // Maximum number of children per node (0 = unlimited)
+		uint8_t m_depth = 1;        // Maximum depth of the tree (1 = sequential mode)
+		uint32_t m_leaf_length = 0; // Maximum number of bytes per leaf (0 = unlimited)
+		uint64_t m_node_offset = 0; // Index of the node within its level
+		uint8_t m_node_depth = 0;   // Level of the node (0 = leaves)
+		uint8_t m_inner_length = 0; // Digest length of the inner nodes
+		bool m_last_node = false;   // True for the last node in a level
+	};
+
+	// The initial chain value words for a BLAKE2 parameter block
+	template <typename Word>
+	void Blake2ParamWords(Blake2Params const& p, int digest_len, int key_len, Word (&words)[8])
+	{
+		memset(&words[0], 0, sizeof(words));
+		if constexpr (sizeof(Word) == 8)
+		{
+			words[0] = Word(digest_len) | Word(key_len) << 8 | Word(p.m_fanout) << 16 | Word(p.m_depth) << 24 | Word(p.m_leaf_length) << 32;
+			words[1] = Word(p.m_node_offset);
+			words[2] = Word(p.m_node_depth) | Word(p.m_inner_length) << 8;
+		}
+		else
+		{
+			words[0] = Word(digest_len) | Word(key_len) << 8 | Word(p.m_fanout) << 16 | Word(p.m_depth) << 24;
+			words[1] = Word(p.m_leaf_length);
+			words[2] = Word(p.m_node_offset);
+			words[3] = Word((p.m_node_offset >> 32) & 0xFFFF) | Word(p.m_node_depth) << 16 | Word(p.m_inner_length) << 24;
+		}
+	}
+
 	template <int HashSize = 64>
 	class Blake2b
 	{
@@ -22,6 +60,7 @@ namespace pr::hash
 		uint64_t m_input_offset[2];
 		uint64_t m_input[16];
 		size_t   m_input_idx;
+		uint64_t m_last_node;
 
 	public:
 
@@ -30,23 +69,24 @@ namespace pr::hash
 		Blake2b()
 			:Blake2b(nullptr, 0ULL)
 		{}
-		Blake2b(uint8_t const* key, size_t key_size)
+		Blake2b(uint8_t const* key, size_t key_size, Blake2Params const& params = {})
 			:m_hash()
 			,m_input_offset()
 			,m_input()
 			,m_input_idx()
+			,m_last_node(params.m_last_node ? ~0ULL : 0ULL)
 		{
 			// initial hash
+			uint64_t words[8];
+			Blake2ParamWords(params, HashSize, static_cast<int>(key_size), words);
 			for (size_t i = 0; i != 8; ++i)
-				m_hash[i] = iv[i];
-
-			m_hash[0] ^= 0x01010000 ^ (key_size << 8) ^ HashSize;
+				m_hash[i] = iv[i] ^ words[i];
 
 			// if there is a key, the first block is that key (padded with zeroes)
 			if (key_size > 0)
 			{
-				Update(key, key_size);
-				Update(zero, 128 - key_size);
+				AddBytes(key, key_size);
+				AddBytes(zero, 128 - key_size);
 			}
 		}
 		~Blake2b()
@@ -64,7 +104,7 @@ namespace pr::hash
 
 			// Align ourselves with block boundaries
 			size_t align = std::min(align_to(m_input_idx, 128), len);
-			Update(bytes, align);
+			AddBytes(bytes, align);
 			bytes += align;
 			len -= align;
 
@@ -82,7 +122,7 @@ namespace pr::hash
 			len &= 127;
 
 			// Remaining bytes
-			Update(bytes, len);
+			AddBytes(bytes, len);
 		}
 
 		// Finalise  hash; call this after all data is added
@@ -161,7 +201,7 @@ namespace pr::hash
 			return (x << n) ^ (x >> (32 - n));
 		}
 
-		void Update(uint8_t const* bytes, size_t len)
+		void AddBytes(uint8_t const* bytes, size_t len)
 		{
 			for (size_t i = 0; i != len; ++i)
 			{
@@ -204,7 +244,7 @@ namespace pr::hash
 			uint64_t v4 = m_hash[4];  uint64_t v12 = iv[4] ^ m_input_offset[0];
 			uint64_t v5 = m_hash[5];  uint64_t v13 = iv[5] ^ m_input_offset[1];
 			uint64_t v6 = m_hash[6];  uint64_t v14 = iv[6] ^ (is_last_block ? ~0ULL : 0ULL);
-			uint64_t v7 = m_hash[7];  uint64_t v15 = iv[7];
+			uint64_t v7 = m_hash[7];  uint64_t v15 = iv[7] ^ (is_last_block ? m_last_node : 0ULL);
 
 			// mangle work vector
 			uint64_t* input = m_input;
@@ -244,7 +284,7 @@ namespace pr::hash
 		void SetInput(uint8_t input, size_t index)
 		{
 			if (index == 0)
-				memset(&m_input[0], 0, 16);
+				memset(&m_input[0], 0, sizeof(m_input));
 
 			size_t word = index >> 3;
 			size_t byte = index & 7;
@@ -302,6 +342,376 @@ namespace pr::hash
 		}
 		return sha.Final();
 	}
+
+	// Constants for the 64-bit (BLAKE2b) and 32-bit (BLAKE2s) variants
+	template <typename Word> struct Blake2Traits;
+	template <> struct Blake2Traits<uint64_t>
+	{
+		static constexpr int BlockSize = 128;
+		static constexpr int OutBytes = 64;
+		static constexpr int Rounds = 12;
+		static constexpr int R0 = 32, R1 = 24, R2 = 16, R3 = 63;
+		static constexpr uint64_t IV[8] =
+		{
+			0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+			0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+		};
+	};
+	template <> struct Blake2Traits<uint32_t>
+	{
+		static constexpr int BlockSize = 64;
+		static constexpr int OutBytes = 32;
+		static constexpr int Rounds = 10;
+		static constexpr int R0 = 16, R1 = 12, R2 = 8, R3 = 7;
+		static constexpr uint32_t IV[8] =
+		{
+			0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+			0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+		};
+	};
+
+	// 'Lanes' independent BLAKE2 states compressed in lock-step.
+	// Each operation is a loop over the lanes, which compilers turn into SIMD instructions.
+	// Used for multi-buffer hashing and for the leaves of the BLAKE2bp/BLAKE2sp trees.
+	template <typename Word, int Lanes>
+	struct Blake2Lanes
+	{
+		using traits = Blake2Traits<Word>;
+		using hash_t = std::array<uint8_t, traits::OutBytes>;
+		static constexpr int Count = Lanes;
+		static constexpr int BlockSize = traits::BlockSize;
+
+		Word m_h[8][Lanes];  // Chain values
+		Word m_t[2][Lanes];  // Byte counters
+		Word m_f[2][Lanes];  // Final block/last node flags
+		Word m_m[16][Lanes]; // Message blocks
+
+		// Initialise 'lane' for a new hash
+		void Init(int lane, Blake2Params const& params = {}, int digest_len = traits::OutBytes, int key_len = 0)
+		{
+			Word words[8];
+			Blake2ParamWords(params, digest_len, key_len, words);
+			for (int i = 0; i != 8; ++i)
+				m_h[i][lane] = traits::IV[i] ^ words[i];
+
+			m_t[0][lane] = m_t[1][lane] = 0;
+			m_f[0][lane] = m_f[1][lane] = 0;
+		}
+		void Reset(int lane)
+		{
+			Init(lane);
+		}
+
+		// Set the message block for 'lane'. 'len' bytes of 'data' are counted, the rest of the block is zero.
+		// 'last' flags the final block, 'last_node' flags the final block of the last node in a tree level.
+		void SetBlock(int lane, uint8_t const* data, size_t len, bool last, bool last_node = false)
+		{
+			uint8_t buf[BlockSize] = {};
+			if (len != 0)
+				memcpy(&buf[0], data, len);
+
+			for (int i = 0; i != 16; ++i)
+			{
+				Word w = 0;
+				for (int j = sizeof(Word); j-- != 0;)
+					w = (w << 8) | buf[i * sizeof(Word) + j];
+
+				m_m[i][lane] = w;
+			}
+
+			m_t[0][lane] += static_cast<Word>(len);
+			if (m_t[0][lane] < static_cast<Word>(len))
+				m_t[1][lane]++;
+
+			m_f[0][lane] = last ? ~Word() : Word();
+			m_f[1][lane] = last && last_node ? ~Word() : Word();
+		}
+
+		// Load block 'block' of 'msg' into 'lane'. Returns true if this is the last block. (For 'HashMany')
+		bool Load(int lane, message_t msg, size_t block)
+		{
+			auto ofs = block * BlockSize;
+			auto len = ofs < msg.size() ? std::min<size_t>(BlockSize, msg.size() - ofs) : 0;
+			auto last = ofs + BlockSize >= msg.size();
+			SetBlock(lane, len != 0 ? msg.data() + ofs : nullptr, len, last);
+			return last;
+		}
+
+		// Compress the message blocks. Lanes not in 'active' are unchanged.
+		void Compress(uint32_t active = ~0U)
+		{
+			static uint8_t const sigma[10][16] =
+			{
+				{  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+				{ 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+				{ 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+				{  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+				{  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+				{  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+				{ 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+				{ 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+				{  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+				{ 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+			};
+			constexpr int Bits = 8 * sizeof(Word);
+			auto rotr = [](Word x, int n) { return static_cast<Word>((x >> n) | (x << (Bits - n))); };
+
+			Word v[16][Lanes];
+			for (int i = 0; i != 8; ++i)
+			{
+				for (int l = 0; l != Lanes; ++l)
+				{
+					v[i][l] = m_h[i][l];
+					v[i + 8][l] = traits::IV[i];
+				}
+			}
+			for (int l = 0; l != Lanes; ++l)
+			{
+				v[12][l] ^= m_t[0][l];
+				v[13][l] ^= m_t[1][l];
+				v[14][l] ^= m_f[0][l];
+				v[15][l] ^= m_f[1][l];
+			}
+
+			auto G = [&](int a, int b, int c, int d, Word const* x, Word const* y)
+			{
+				for (int l = 0; l != Lanes; ++l)
+				{
+					v[a][l] += v[b][l] + x[l]; v[d][l] = rotr(v[d][l] ^ v[a][l], traits::R0);
+					v[c][l] += v[d][l];        v[b][l] = rotr(v[b][l] ^ v[c][l], traits::R1);
+					v[a][l] += v[b][l] + y[l]; v[d][l] = rotr(v[d][l] ^ v[a][l], traits::R2);
+					v[c][l] += v[d][l];        v[b][l] = rotr(v[b][l] ^ v[c][l], traits::R3);
+				}
+			};
+			for (int r = 0; r != traits::Rounds; ++r)
+			{
+				auto s = &sigma[r % 10][0];
+				G(0, 4,  8, 12, m_m[s[ 0]], m_m[s[ 1]]);
+				G(1, 5,  9, 13, m_m[s[ 2]], m_m[s[ 3]]);
+				G(2, 6, 10, 14, m_m[s[ 4]], m_m[s[ 5]]);
+				G(3, 7, 11, 15, m_m[s[ 6]], m_m[s[ 7]]);
+				G(0, 5, 10, 15, m_m[s[ 8]], m_m[s[ 9]]);
+				G(1, 6, 11, 12, m_m[s[10]], m_m[s[11]]);
+				G(2, 7,  8, 13, m_m[s[12]], m_m[s[13]]);
+				G(3, 4,  9, 14, m_m[s[14]], m_m[s[15]]);
+			}
+
+			// Update the chain values of the active lanes
+			Word mask[Lanes];
+			for (int l = 0; l != Lanes; ++l)
+				mask[l] = (active >> l) & 1 ? ~Word() : Word();
+			for (int i = 0; i != 8; ++i)
+			{
+				for (int l = 0; l != Lanes; ++l)
+					m_h[i][l] ^= (v[i][l] ^ v[i + 8][l]) & mask[l];
+			}
+		}
+
+		// The hash value of 'lane'
+		hash_t Digest(int lane) const
+		{
+			hash_t hash;
+			for (int i = 0; i != traits::OutBytes; ++i)
+				hash[i] = static_cast<uint8_t>(m_h[i / sizeof(Word)][lane] >> (8 * (i % sizeof(Word))));
+
+			return hash;
+		}
+	};
+
+	// BLAKE2 tree hashing with 'Leaves' leaves and a root node (BLAKE2bp for 64-bit words, BLAKE2sp for 32-bit words).
+	// The input is striped across the leaves one block at a time. The leaves are compressed in SIMD lanes, or for
+	// large updates, on separate threads. Only unkeyed hashing with the full digest length is supported.
+	template <typename Word, int Leaves>
+	class Blake2Tree
+	{
+		using traits = Blake2Traits<Word>;
+		static constexpr size_t BlockSize = traits::BlockSize;
+		static constexpr size_t StripeSize = BlockSize * Leaves;
+
+		// A leaf block can only be compressed once it's known not to be the last block of that leaf,
+		// so a stripe is held until there is data for every leaf after it.
+		static constexpr size_t HoldBack = BlockSize * (Leaves - 1);
+
+		// Updates at least this big have their leaves hashed on separate threads
+		static constexpr size_t ParallelSize = 1 << 20;
+
+		Blake2Lanes<Word, Leaves> m_leaves;
+		uint8_t m_buf[2 * StripeSize];
+		size_t m_buf_len;
+
+	public:
+
+		using hash_t = std::array<uint8_t, traits::OutBytes>;
+
+		Blake2Tree()
+			:m_leaves()
+			,m_buf()
+			,m_buf_len()
+		{
+			for (int i = 0; i != Leaves; ++i)
+				m_leaves.Init(i, LeafParams(i));
+		}
+		~Blake2Tree()
+		{
+			// Reset memory for security reasons
+			auto me = reinterpret_cast<uint8_t volatile*>(this);
+			for (auto size = sizeof(*this); size-- != 0; ++me)
+				*me = 0;
+		}
+
+		// Add data to the hash
+		void Update(void const* data, size_t len)
+		{
+			auto bytes = static_cast<uint8_t const*>(data);
+			for (;;)
+			{
+				// Compress the buffered stripe once there's data for every leaf after it
+				if (m_buf_len >= StripeSize && m_buf_len - StripeSize + len > HoldBack)
+				{
+					Stripes(&m_buf[0], 1);
+					m_buf_len -= StripeSize;
+					memmove(&m_buf[0], &m_buf[StripeSize], m_buf_len);
+					continue;
+				}
+
+				// Compress whole stripes directly from the input
+				if (m_buf_len == 0 && len > StripeSize + HoldBack)
+				{
+					auto count = (len - HoldBack - 1) / StripeSize;
+					Stripes(bytes, count);
+					bytes += count * StripeSize;
+					len -= count * StripeSize;
+					continue;
+				}
+
+				if (len == 0)
+					break;
+
+				// Buffer the input. Only fill to one stripe, so that the next stripe can come directly from the input
+				auto n = std::min(len, (m_buf_len < StripeSize ? StripeSize : sizeof(m_buf)) - m_buf_len);
+				memcpy(&m_buf[m_buf_len], bytes, n);
+				m_buf_len += n;
+				bytes += n;
+				len -= n;
+			}
+		}
+
+		// Finalise hash; call this after all data is added
+		hash_t Final()
+		{
+			// Each leaf has one or two blocks left in the buffer (or an empty block if it never received data)
+			for (size_t s = 0; s != 2; ++s)
+			{
+				uint32_t active = 0;
+				for (int i = 0; i != Leaves; ++i)
+				{
+					auto ofs = s * StripeSize + i * BlockSize;
+					if (s != 0 && ofs >= m_buf_len)
+						continue;
+
+					auto len = ofs < m_buf_len ? std::min(BlockSize, m_buf_len - ofs) : 0;
+					auto last = ofs + StripeSize >= m_buf_len;
+					m_leaves.SetBlock(i, &m_buf[0] + ofs, len, last, i == Leaves - 1);
+					active |= 1U << i;
+				}
+				if (active != 0)
+					m_leaves.Compress(active);
+			}
+
+			// The root hashes the concatenated leaf hashes
+			uint8_t leaf_hashes[Leaves * traits::OutBytes];
+			for (int i = 0; i != Leaves; ++i)
+			{
+				auto hash = m_leaves.Digest(i);
+				memcpy(&leaf_hashes[i * traits::OutBytes], hash.data(), hash.size());
+			}
+
+			Blake2Lanes<Word, 1> root;
+			root.Init(0, RootParams());
+			for (size_t ofs = 0; ofs != sizeof(leaf_hashes); ofs += BlockSize)
+			{
+				auto last = ofs + BlockSize == sizeof(leaf_hashes);
+				root.SetBlock(0, &leaf_hashes[ofs], BlockSize, last, true);
+				root.Compress();
+			}
+			return root.Digest(0);
+		}
+
+	private:
+
+		static Blake2Params LeafParams(int i)
+		{
+			Blake2Params params;
+			params.m_fanout = Leaves;
+			params.m_depth = 2;
+			params.m_node_offset = static_cast<uint64_t>(i);
+			params.m_inner_length = traits::OutBytes;
+			return params;
+		}
+		static Blake2Params RootParams()
+		{
+			Blake2Params params;
+			params.m_fanout = Leaves;
+			params.m_depth = 2;
+			params.m_node_depth = 1;
+			params.m_inner_length = traits::OutBytes;
+			return params;
+		}
+
+		// Compress 'count' whole stripes, none of which are the last for any leaf
+		void Stripes(uint8_t const* data, size_t count)
+		{
+			if (count * StripeSize >= ParallelSize && std::thread::hardware_concurrency() > 1)
+			{
+				// Each leaf is an independent hash, so can be run on its own thread
+				int leaf[Leaves];
+				for (int i = 0; i != Leaves; ++i) leaf[i] = i;
+				std::for_each(std::execution::par, std::begin(leaf), std::end(leaf), [&](int i)
+				{
+					Blake2Lanes<Word, 1> lane;
+					for (int j = 0; j != 8; ++j) lane.m_h[j][0] = m_leaves.m_h[j][i];
+					for (int j = 0; j != 2; ++j) lane.m_t[j][0] = m_leaves.m_t[j][i];
+
+					for (size_t s = 0; s != count; ++s)
+					{
+						lane.SetBlock(0, data + s * StripeSize + i * BlockSize, BlockSize, false);
+						lane.Compress();
+					}
+
+					for (int j = 0; j != 8; ++j) m_leaves.m_h[j][i] = lane.m_h[j][0];
+					for (int j = 0; j != 2; ++j) m_leaves.m_t[j][i] = lane.m_t[j][0];
+				});
+			}
+			else
+			{
+				// Compress the leaves in SIMD lanes
+				for (size_t s = 0; s != count; ++s, data += StripeSize)
+				{
+					for (int i = 0; i != Leaves; ++i)
+						m_leaves.SetBlock(i, data + i * BlockSize, BlockSize, false);
+
+					m_leaves.Compress();
+				}
+			}
+		}
+	};
+
+	// BLAKE2bp: four BLAKE2b leaves
+	using Blake2bp = Blake2Tree<uint64_t, 4>;
+
+	// Return the Blake2bp hash of the given data
+	inline Blake2bp::hash_t Blake2bpHash(void const* data, size_t len)
+	{
+		Blake2bp blake;
+		blake.Update(data, len);
+		return blake.Final();
+	}
+
+	// Return the Blake2b hashes of many independent messages, hashed four at a time in SIMD lanes
+	inline void Blake2bHashMany(std::span<message_t const> messages, std::span<Blake2b<>::hash_t> hashes)
+	{
+		HashMany<Blake2Lanes<uint64_t, 4>>(messages, hashes);
+	}
 }
 
 #if PR_UNITTESTS
@@ -318,6 +728,46 @@ namespace pr::hash
 		auto hash2 = Blake2bHash(str1, sizeof(str1));
 		PR_EXPECT(hash1 != hash2);
 
+		std::vector<uint8_t> data(1500);
+		for (size_t i = 0; i != data.size(); ++i)
+			data[i] = static_cast<uint8_t>(i % 251);
+
+		{// Known answers
+			auto hash = Blake2bHash("abc", 3);
+			auto expected = Blake2b<>::hash_t{0xBA,0x80,0xA5,0x3F,0x98,0x1C,0x4D,0x0D,0x6A,0x27,0x97,0xB6,0x9F,0x12,0xF6,0xE9,0x4C,0x21,0x2F,0x14,0x68,0x5A,0xC4,0xB7,0x4B,0x12,0xBB,0x6F,0xDB,0xFF,0xA2,0xD1,0x7D,0x87,0xC5,0x39,0x2A,0xAB,0x79,0x2D,0xC2,0x52,0xD5,0xDE,0x45,0x33,0xCC,0x95,0x18,0xD3,0x8A,0xA8,0xDB,0xF1,0x92,0x5A,0xB9,0x23,0x86,0xED,0xD4,0x00,0x99,0x23};
+			PR_EXPECT(hash == expected);
+		}
+		{// Multiple blocks, with byte-wise updates
+			Blake2b<> blake;
+			for (size_t i = 0; i != 200; ++i)
+				blake.Update(&data[i], 1);
+
+			auto expected = Blake2b<>::hash_t{0xFB,0x3C,0x1F,0x0F,0x56,0xA5,0x6F,0x8E,0x31,0x6F,0xDF,0x5D,0x85,0x3C,0x8C,0x87,0x2C,0x39,0x63,0x5D,0x08,0x36,0x34,0xC3,0x90,0x4F,0xC3,0xAC,0x07,0xD1,0xB5,0x78,0xE8,0x5F,0xF0,0xE4,0x80,0xE9,0x2D,0x44,0xAD,0xE3,0x3B,0x62,0xE8,0x93,0xEE,0x32,0x34,0x3E,0x79,0xDD,0xF6,0xEF,0x29,0x2E,0x89,0xB5,0x82,0xD3,0x12,0x50,0x23,0x14};
+			PR_EXPECT(blake.Final() == expected);
+		}
+		{// Blake2bp
+			auto hash = Blake2bpHash(data.data(), data.size());
+			auto expected = Blake2bp::hash_t{0x02,0x02,0xBE,0x7A,0x6D,0x0C,0x21,0x30,0x0B,0x0E,0xA6,0xB8,0x88,0x68,0x71,0x79,0x12,0xBD,0x82,0xF3,0x3A,0x6F,0xF5,0xC2,0x23,0x63,0x28,0x53,0xA4,0xF0,0x8D,0x0A,0xED,0xE2,0x10,0x52,0x38,0x4B,0xEE,0x41,0x9C,0xCF,0xB4,0x0C,0x8D,0x63,0x26,0x1D,0x84,0x91,0x00,0xF3,0xBE,0x98,0x60,0x00,0xEB,0x29,0xCE,0xF4,0xD1,0x48,0x7B,0x98};
+			PR_EXPECT(hash == expected);
+
+			// Streaming in odd sized pieces gives the same result
+			Blake2bp blake;
+			for (size_t i = 0, n = 1; i < data.size(); i += n, n = n * 3 + 1)
+				blake.Update(data.data() + i, std::min(n, data.size() - i));
+
+			PR_EXPECT(blake.Final() == expected);
+		}
+		{// Multi-buffer hashing matches single message hashing
+			std::vector<message_t> messages;
+			for (size_t i = 0; i != 50; ++i)
+				messages.push_back(message_t(data.data(), (i * 37) % data.size()));
+
+			std::vector<Blake2b<>::hash_t> hashes(messages.size());
+			Blake2bHashMany(messages, hashes);
+			for (size_t i = 0; i != messages.size(); ++i)
+				PR_EXPECT(hashes[i] == Blake2bHash(messages[i].data(), messages[i].size()));
+		}
+
 		// This hash doesn't seem to produce the same result as the windows context menu one
 		//auto hash3 = Blake2bHashFile("P:\\pr\\include\\pr\\crypt\\rijndael.h");
 		//auto hash4 = Blake2b<>::hash_t{0xD4,0x90,0xE7,0x7B,0x83,0x9D,0x61,0x2B,0x72,0x93,0x76,0x6E,0xFC,0x01,0x4C,0x0B,0x45,0x51,0x63,0x29,0x21,0xBA,0x3F,0xB4,0xB6,0x2A,0x5C,0xA5,0x40,0x0D,0x7E,0x75};
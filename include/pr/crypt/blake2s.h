@@ -0,0 +1,200 @@
+﻿//*************************************************************************************************
+// Blake2s
+//*************************************************************************************************
+// The 32-bit variant of BLAKE2, optimised for 8 to 32-bit platforms. Also BLAKE2sp, the 8-way
+// parallel tree version. Built on the lane engine in "pr/crypt/blake2b.h".
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "pr/crypt/blake2b.h"
+
+namespace pr::hash
+{
+	template <int HashSize = 32>
+	class Blake2s
+	{
+		static_assert(HashSize >= 1 && HashSize <= 32, "Blake2s digests are 1 to 32 bytes");
+		static constexpr size_t BlockSize = 64;
+
+		Blake2Lanes<uint32_t, 1> m_state;
+		uint8_t m_buf[BlockSize];
+		size_t m_buf_len;
+		bool m_last_node;
+
+	public:
+
+		using hash_t = typename std::array<uint8_t, HashSize>;
+
+		Blake2s()
+			:Blake2s(nullptr, 0ULL)
+		{}
+		Blake2s(uint8_t const* key, size_t key_size, Blake2Params const& params = {})
+			:m_state()
+			,m_buf()
+			,m_buf_len()
+			,m_last_node(params.m_last_node)
+		{
+			if (key_size > 32)
+				throw std::runtime_error("Blake2s keys are at most 32 bytes");
+
+			m_state.Init(0, params, HashSize, static_cast<int>(key_size));
+
+			// if there is a key, the first block is that key (padded with zeroes)
+			if (key_size > 0)
+			{
+				memcpy(&m_buf[0], key, key_size);
+				m_buf_len = BlockSize;
+			}
+		}
+		~Blake2s()
+		{
+			// Reset memory for security reasons
+			auto me = reinterpret_cast<uint8_t volatile*>(this);
+			for (auto size = sizeof(*this); size-- != 0; ++me)
+				*me = 0;
+		}
+
+		// Add data to the hash
+		void Update(void const* data, size_t len)
+		{
+			// The last block is compressed differently, so a full block is held until more data arrives
+			auto bytes = static_cast<uint8_t const*>(data);
+			for (; len != 0;)
+			{
+				if (m_buf_len == BlockSize)
+				{
+					m_state.SetBlock(0, &m_buf[0], BlockSize, false);
+					m_state.Compress();
+					m_buf_len = 0;
+				}
+
+				// Compress whole blocks directly from the input
+				for (; m_buf_len == 0 && len > BlockSize; bytes += BlockSize, len -= BlockSize)
+				{
+					m_state.SetBlock(0, bytes, BlockSize, false);
+					m_state.Compress();
+				}
+
+				auto n = std::min(len, BlockSize - m_buf_len);
+				memcpy(&m_buf[m_buf_len], bytes, n);
+				m_buf_len += n;
+				bytes += n;
+				len -= n;
+			}
+		}
+
+		// Finalise hash; call this after all data is added
+		hash_t Final()
+		{
+			m_state.SetBlock(0, &m_buf[0], m_buf_len, true, m_last_node);
+			m_state.Compress();
+
+			auto digest = m_state.Digest(0);
+			hash_t hash;
+			memcpy(hash.data(), digest.data(), HashSize);
+			return hash;
+		}
+	};
+
+	// BLAKE2sp: eight BLAKE2s leaves
+	using Blake2sp = Blake2Tree<uint32_t, 8>;
+
+	// Return the Blake2s hash of the given data
+	template <int HashSize = 32>
+	inline typename Blake2s<HashSize>::hash_t Blake2sHash(uint8_t const* key, size_t key_size, void const* data, size_t len)
+	{
+		Blake2s<HashSize> blake(key, key_size);
+		blake.Update(data, len);
+		return blake.Final();
+	}
+
+	// Return the Blake2s hash of the given data
+	inline Blake2s<>::hash_t Blake2sHash(void const* data, size_t len)
+	{
+		return Blake2sHash<32>(nullptr, 0, data, len);
+	}
+
+	// Return the Blake2sp hash of the given data
+	inline Blake2sp::hash_t Blake2spHash(void const* data, size_t len)
+	{
+		Blake2sp blake;
+		blake.Update(data, len);
+		return blake.Final();
+	}
+
+	// Hash file contents
+	inline Blake2s<>::hash_t Blake2sHashFile(std::filesystem::path const& filepath)
+	{
+		Blake2s blake;
+		std::array<char, 4096> buf;
+		std::ifstream file(filepath, std::ios_base::binary);
+		for (;file.good();)
+		{
+			auto read = file.read(buf.data(), buf.size()).gcount();
+			blake.Update(buf.data(), static_cast<size_t>(read));
+		}
+		return blake.Final();
+	}
+
+	// Return the Blake2s hashes of many independent messages, hashed eight at a time in SIMD lanes
+	inline void Blake2sHashMany(std::span<message_t const> messages, std::span<Blake2s<>::hash_t> hashes)
+	{
+		HashMany<Blake2Lanes<uint32_t, 8>>(messages, hashes);
+	}
+}
+
+#if PR_UNITTESTS
+#include "pr/common/unittests.h"
+namespace pr::hash
+{
+	PRUnitTest(Blake2sTests)
+	{
+		using namespace pr::hash;
+
+		std::vector<uint8_t> data(1500);
+		for (size_t i = 0; i != data.size(); ++i)
+			data[i] = static_cast<uint8_t>(i % 251);
+
+		{// Known answers
+			auto hash = Blake2sHash("abc", 3);
+			auto expected = Blake2s<>::hash_t{0x50,0x8C,0x5E,0x8C,0x32,0x7C,0x14,0xE2,0xE1,0xA7,0x2B,0xA3,0x4E,0xEB,0x45,0x2F,0x37,0x45,0x8B,0x20,0x9E,0xD6,0x3A,0x29,0x4D,0x99,0x9B,0x4C,0x86,0x67,0x59,0x82};
+			PR_EXPECT(hash == expected);
+		}
+		{// Keyed
+			uint8_t key[32];
+			for (int i = 0; i != 32; ++i) key[i] = static_cast<uint8_t>(i);
+			auto hash = Blake2sHash<32>(&key[0], sizeof(key), data.data(), 255);
+			auto expected = Blake2s<>::hash_t{0x11,0x98,0xD1,0xDA,0x21,0xA1,0xEF,0x30,0x56,0x09,0x9E,0xF6,0x64,0xDD,0x9C,0x6B,0x06,0xC4,0x82,0x67,0x4D,0xC3,0x34,0xDB,0xAF,0xD1,0x62,0x7B,0xE3,0x58,0xBF,0xB5};
+			PR_EXPECT(hash == expected);
+		}
+		{// Blake2sp
+			auto hash = Blake2spHash(data.data(), data.size());
+			auto expected = Blake2sp::hash_t{0x29,0x06,0xEF,0x9A,0x17,0xA2,0x74,0xD0,0x00,0x8E,0xBE,0x82,0x81,0xD7,0x5D,0x60,0x10,0x5B,0x57,0x99,0x96,0xB0,0xFA,0x31,0xCC,0x72,0x51,0xC3,0xF5,0x4A,0xFE,0x32};
+			PR_EXPECT(hash == expected);
+
+			// Streaming in odd sized pieces gives the same result
+			Blake2sp blake;
+			for (size_t i = 0, n = 1; i < data.size(); i += n, n = n * 3 + 1)
+				blake.Update(data.data() + i, std::min(n, data.size() - i));
+
+			PR_EXPECT(blake.Final() == expected);
+		}
+		{// Multi-buffer hashing matches single message hashing
+			std::vector<message_t> messages;
+			for (size_t i = 0; i != 50; ++i)
+				messages.push_back(message_t(data.data(), (i * 37) % data.size()));
+
+			std::vector<Blake2s<>::hash_t> hashes(messages.size());
+			Blake2sHashMany(messages, hashes);
+			for (size_t i = 0; i != messages.size(); ++i)
+				PR_EXPECT(hashes[i] == Blake2sHash(messages[i].data(), messages[i].size()));
+		}
+	}
+}
+#endif
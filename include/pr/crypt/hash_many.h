@@ -0,0 +1,173 @@
+﻿//*************************************************************************************************
+// Multi-buffer hashing
+//*************************************************************************************************
+// Hashing a small message is dominated by the latency of the compression function, not by the
+// amount of data. Multi-buffer hashing interleaves independent messages in SIMD lanes so that
+// each compression call advances several messages at once.
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <execution>
+#include <utility>
+
+#ifndef PR_CRYPT_USE_SHANI
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PR_CRYPT_USE_SHANI 1
+#else
+#define PR_CRYPT_USE_SHANI 0
+#endif
+#endif
+#if PR_CRYPT_USE_SHANI
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace pr::hash
+{
+	// A message to be hashed by 'HashMany'
+	using message_t = std::span<uint8_t const>;
+
+	// Call 'func' with std::integral_constant<int, I> for I in [0,N), so that loop indices are compile time constants
+	template <int N, typename Func> inline void Unroll(Func func)
+	{
+		[&]<int... I>(std::integer_sequence<int, I...>) { (func(std::integral_constant<int, I>{}), ...); }(std::make_integer_sequence<int, N>{});
+	}
+
+	// Hash many independent messages, 'TLanes::Count' at a time.
+	//  'TLanes' is a lane engine for a hash algorithm with the interface:
+	//    static constexpr int Count;                 - The number of lanes
+	//    using hash_t;                               - The hash type
+	//    void Reset(int lane);                       - Set the lane to the initial hash state
+	//    bool Load(int lane, message_t msg, size_t block); - Load block 'block' of 'msg' (including padding). Returns true for the last block.
+	//    void Compress(uint32_t active);             - Compress the loaded blocks. Lanes not in 'active' must be left unchanged.
+	//    hash_t Digest(int lane) const;              - The hash of the lane
+	// Lanes are refilled as soon as their message is finished, so messages of different lengths keep all lanes busy.
+	// Batches of messages are hashed on separate threads.
+	template <typename TLanes>
+	void HashMany(std::span<message_t const> messages, std::span<typename TLanes::hash_t> hashes)
+	{
+		if (hashes.size() < messages.size())
+			throw std::runtime_error("Hash buffer is too small");
+
+		// Hash a contiguous range of messages
+		auto HashRange = [&](size_t beg, size_t end)
+		{
+			struct Job { size_t m_msg; size_t m_block; bool m_active; };
+			Job jobs[TLanes::Count] = {};
+			TLanes lanes;
+
+			for (auto next = beg;;)
+			{
+				uint32_t active = 0, last = 0;
+				for (int i = 0; i != TLanes::Count; ++i)
+				{
+					auto& job = jobs[i];
+					if (!job.m_active)
+					{
+						if (next == end) continue;
+						job = Job{ next++, 0, true };
+						lanes.Reset(i);
+					}
+					if (lanes.Load(i, messages[job.m_msg], job.m_block++))
+						last |= 1U << i;
+
+					active |= 1U << i;
+				}
+				if (active == 0)
+					break;
+
+				lanes.Compress(active);
+
+				for (int i = 0; i != TLanes::Count; ++i)
+				{
+					if ((last & (1U << i)) == 0) continue;
+					hashes[jobs[i].m_msg] = lanes.Digest(i);
+					jobs[i].m_active = false;
+				}
+			}
+		};
+
+		// Split into batches for multiple threads
+		constexpr size_t BatchSize = 1024;
+		std::vector<size_t> batches;
+		for (size_t i = 0; i < messages.size(); i += BatchSize)
+			batches.push_back(i);
+
+		std::for_each(std::execution::par, std::begin(batches), std::end(batches), [&](size_t const& beg)
+		{
+			HashRange(beg, std::min(beg + BatchSize, messages.size()));
+		});
+	}
+
+	// Hash many independent messages using a single message hasher with the Update/Final interface
+	template <typename THasher>
+	void HashManySerial(std::span<message_t const> messages, std::span<typename THasher::hash_t> hashes)
+	{
+		if (hashes.size() < messages.size())
+			throw std::runtime_error("Hash buffer is too small");
+
+		std::for_each(std::execution::par, std::begin(messages), std::end(messages), [&](message_t const& msg)
+		{
+			THasher hasher;
+			hasher.Update(msg.data(), msg.size());
+			hashes[&msg - messages.data()] = hasher.Final();
+		});
+	}
+
+	// Load block 'block' of 'msg' with MD-strengthening padding (SHA-1, SHA-256), as big-endian words.
+	// Returns true if this is the last block of the padded message.
+	inline bool LoadBlockMD(message_t msg, size_t block, uint32_t (&words)[16])
+	{
+		uint8_t buf[64] = {};
+		auto ofs = block * 64;
+		auto len = msg.size();
+		if (ofs < len)
+			memcpy(&buf[0], msg.data() + ofs, std::min<size_t>(64, len - ofs));
+		if (ofs <= len && len < ofs + 64)
+			buf[len - ofs] = 0x80;
+
+		// The length goes in the last 8 bytes of the final block
+		auto last = block == (len + 8) / 64;
+		if (last)
+		{
+			auto bits = static_cast<uint64_t>(len) * 8;
+			for (int i = 0; i != 8; ++i)
+				buf[63 - i] = static_cast<uint8_t>(bits >> (8 * i));
+		}
+
+		for (int i = 0; i != 16; ++i)
+			words[i] = (uint32_t(buf[4*i+0]) << 24) | (uint32_t(buf[4*i+1]) << 16) | (uint32_t(buf[4*i+2]) << 8) | uint32_t(buf[4*i+3]);
+
+		return last;
+	}
+
+	// True if the CPU supports the SHA extensions (SHA-1 and SHA-256 instructions)
+	inline bool CpuHasShaNi()
+	{
+		#if PR_CRYPT_USE_SHANI
+		static bool const has = []
+		{
+			int info[4] = {};
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			__cpuid(info, 1);
+			auto ssse3 = (info[2] & (1 << 9)) != 0;
+			auto sse41 = (info[2] & (1 << 19)) != 0;
+
+			__cpuidex(info, 7, 0);
+			auto sha = (info[1] & (1 << 29)) != 0;
+			return ssse3 && sse41 && sha;
+		}();
+		return has;
+		#else
+		return false;
+		#endif
+	}
+}
@@ -10,11 +10,30 @@
 // This Implementation was tested against KAT test published by the authors of the method and the
 // results were identical.
 //
-// Data to be encrypted must be sized in multiples of the block size
+// Data to be encrypted must be sized in multiples of the block size, except in CTR and GCM modes.
+// When the CPU supports them, the AES-NI instructions are used instead of the tables. The output is identical.
 //
 #pragma once
 #include <cstring>
 #include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <execution>
+#include <utility>
+
+#ifndef PR_CRYPT_USE_AESNI
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PR_CRYPT_USE_AESNI 1
+#else
+#define PR_CRYPT_USE_AESNI 0
+#endif
+#endif
+#if PR_CRYPT_USE_AESNI
+#include <intrin.h>
+#include <immintrin.h>
+#endif
 
 namespace pr::crypt
 {
@@ -1033,6 +1052,25 @@ namespace pr::crypt
 		int m_a[MAX_BC];
 		int m_t[MAX_BC];
 
+		#if PR_CRYPT_USE_AESNI
+		// AES-NI round keys. These are 'm_Ke' and 'm_Kd' in the byte order of the AES standard
+		__m128i m_ni_ke[MAX_ROUNDS+1];
+		__m128i m_ni_kd[MAX_ROUNDS+1];
+
+		// Powers of the GHASH key, H^1..H^4, byte reversed for use with PCLMULQDQ
+		__m128i m_ni_hp[4];
+		#endif
+
+		// The GHASH key, H = E(0^128)
+		byte m_gcm_h[BLOCK_SIZE];
+
+		// 4-bit multiplication tables for H (used when AES-NI is not available)
+		uint64_t m_gcm_hl[16];
+		uint64_t m_gcm_hh[16];
+
+		// True if the AES-NI instructions are used
+		bool m_aesni;
+
 		// Encrypt exactly one block of data.
 		//  in     - The data to be encrypted.
 		//  result - The returned encrypted data.
@@ -1305,6 +1343,586 @@ namespace pr::crypt
 				*result++ ^= *buf++;
 		}
 
+		// Big-endian 64-bit load/store
+		static uint64_t LoadBE64(byte const* p)
+		{
+			uint64_t v = 0;
+			for (int i = 0; i != 8; ++i)
+				v = (v << 8) | p[i];
+			return v;
+		}
+		static void StoreBE64(byte* p, uint64_t v)
+		{
+			for (int i = 8; i-- != 0; v >>= 8)
+				p[i] = static_cast<byte>(v);
+		}
+
+		// A 128-bit big-endian counter block for CTR and GCM modes
+		struct Counter
+		{
+			uint64_t m_hi;
+			uint64_t m_lo;
+			bool m_inc32; // GCM only increments the low 32 bits, CTR mode increments the whole block
+
+			Counter(byte const* block, bool inc32)
+				:m_hi(LoadBE64(block))
+				,m_lo(LoadBE64(block + 8))
+				,m_inc32(inc32)
+			{}
+			Counter operator + (uint64_t n) const
+			{
+				auto c = *this;
+				if (m_inc32)
+				{
+					c.m_lo = (m_lo & 0xFFFFFFFF00000000ULL) | ((m_lo + n) & 0xFFFFFFFFULL);
+				}
+				else
+				{
+					c.m_lo = m_lo + n;
+					c.m_hi = m_hi + (c.m_lo < m_lo ? 1 : 0);
+				}
+				return c;
+			}
+			void Write(byte* block) const
+			{
+				StoreBE64(block + 0, m_hi);
+				StoreBE64(block + 8, m_lo);
+			}
+		};
+
+		// Large CTR and GCM buffers are split into pieces of this size and processed on separate threads.
+		// Each piece is small enough to stay in the L2 cache between the cipher and GHASH passes.
+		static constexpr size_t ParallelPieceSize = 256 * 1024;
+
+		// A block aligned section of a buffer
+		struct Piece
+		{
+			size_t m_ofs;             // Byte offset of the piece
+			size_t m_len;             // Length in bytes of the piece
+			byte m_ghash[BLOCK_SIZE]; // GHASH of the piece, starting from zero (GCM only)
+		};
+
+		// Divide 'len' bytes into pieces
+		static std::vector<Piece> Pieces(size_t len)
+		{
+			std::vector<Piece> pieces;
+			for (size_t ofs = 0; ofs < len; ofs += ParallelPieceSize)
+				pieces.push_back(Piece{ ofs, std::min(ParallelPieceSize, len - ofs), {} });
+			return pieces;
+		}
+
+		// Process each piece, in parallel if there is more than one
+		template <typename Func> static void ForEachPiece(std::vector<Piece>& pieces, Func func)
+		{
+			if (pieces.size() > 1)
+				std::for_each(std::execution::par, std::begin(pieces), std::end(pieces), func);
+			else
+				std::for_each(std::begin(pieces), std::end(pieces), func);
+		}
+
+		// XOR 'len' bytes of key stream, generated from successive values of 'ctr', with 'in'.
+		// 'len' does not need to be a multiple of the block size. Only uses locals, so can be called concurrently.
+		void CtrXor(Counter ctr, byte const* in, byte* result, size_t len)
+		{
+			#if PR_CRYPT_USE_AESNI
+			if (m_aesni)
+				return CtrXorNI(ctr, in, result, len);
+			#endif
+
+			byte block[BLOCK_SIZE], ks[BLOCK_SIZE];
+			for (uint64_t i = 0; len != 0; ++i)
+			{
+				(ctr + i).Write(block);
+				EncryptBlock<BLOCK_SIZE>(block, ks);
+
+				auto n = std::min<size_t>(len, BLOCK_SIZE);
+				for (size_t j = 0; j != n; ++j)
+					result[j] = in[j] ^ ks[j];
+
+				in += n;
+				result += n;
+				len -= n;
+			}
+		}
+
+		// CTR mode. 'chain' is the initial counter block and is advanced past the blocks used
+		void Ctr(byte const* in, byte* result, size_t len, byte* chain)
+		{
+			Counter ctr(chain, false);
+
+			auto pieces = Pieces(len);
+			ForEachPiece(pieces, [&](Piece& p)
+			{
+				CtrXor(ctr + p.m_ofs / BLOCK_SIZE, in + p.m_ofs, result + p.m_ofs, p.m_len);
+			});
+
+			(ctr + (len + BLOCK_SIZE - 1) / BLOCK_SIZE).Write(chain);
+		}
+
+		// Multiply 'x' and 'y' in GF(2^128) using the GCM bit order. 'result' can alias 'x' or 'y'.
+		// This is the bit-at-a-time algorithm from NIST SP 800-38D, only used for the occasional odd product.
+		static void GfMul(byte const* x, byte const* y, byte* result)
+		{
+			uint64_t zh = 0, zl = 0;
+			uint64_t vh = LoadBE64(y), vl = LoadBE64(y + 8);
+			for (int i = 0; i != 128; ++i)
+			{
+				if ((x[i >> 3] >> (7 - (i & 7))) & 1)
+				{
+					zh ^= vh;
+					zl ^= vl;
+				}
+				auto lsb = vl & 1;
+				vl = (vl >> 1) | (vh << 63);
+				vh = (vh >> 1) ^ (lsb ? 0xE100000000000000ULL : 0);
+			}
+			StoreBE64(result + 0, zh);
+			StoreBE64(result + 8, zl);
+		}
+
+		// Raise 'x' to the power 'n' in GF(2^128)
+		static void GfPow(byte const* x, uint64_t n, byte* result)
+		{
+			byte r[BLOCK_SIZE] = {0x80}; // '1' in the GCM bit order
+			byte s[BLOCK_SIZE];
+			memcpy(s, x, BLOCK_SIZE);
+			for (; n != 0; n >>= 1)
+			{
+				if (n & 1) GfMul(r, s, r);
+				GfMul(s, s, s);
+			}
+			memcpy(result, r, BLOCK_SIZE);
+		}
+
+		// Generate the 4-bit multiplication tables for 'm_gcm_h' (Shoup's method)
+		void GhashTables()
+		{
+			auto vh = LoadBE64(&m_gcm_h[0]);
+			auto vl = LoadBE64(&m_gcm_h[8]);
+
+			// 0b1000 is '1' in the GCM bit order
+			m_gcm_hh[0] = 0;
+			m_gcm_hl[0] = 0;
+			m_gcm_hh[8] = vh;
+			m_gcm_hl[8] = vl;
+			for (int i = 4; i != 0; i >>= 1)
+			{
+				auto lsb = vl & 1;
+				vl = (vl >> 1) | (vh << 63);
+				vh = (vh >> 1) ^ (lsb ? 0xE100000000000000ULL : 0);
+				m_gcm_hh[i] = vh;
+				m_gcm_hl[i] = vl;
+			}
+			for (int i = 2; i <= 8; i *= 2)
+			{
+				for (int j = 1; j != i; ++j)
+				{
+					m_gcm_hh[i + j] = m_gcm_hh[i] ^ m_gcm_hh[j];
+					m_gcm_hl[i + j] = m_gcm_hl[i] ^ m_gcm_hl[j];
+				}
+			}
+		}
+
+		// x = x * H, using the 4-bit tables
+		void GhashMulH(byte* x) const
+		{
+			static uint64_t const last4[16] =
+			{
+				0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+				0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+			};
+
+			auto lo = x[15] & 0xF;
+			auto zh = m_gcm_hh[lo];
+			auto zl = m_gcm_hl[lo];
+			for (int i = 15; i >= 0; --i)
+			{
+				lo = x[i] & 0xF;
+				auto hi = (x[i] >> 4) & 0xF;
+				if (i != 15)
+				{
+					auto rem = zl & 0xF;
+					zl = (zh << 60) | (zl >> 4);
+					zh = (zh >> 4) ^ (last4[rem] << 48) ^ m_gcm_hh[lo];
+					zl ^= m_gcm_hl[lo];
+				}
+				auto rem = zl & 0xF;
+				zl = (zh << 60) | (zl >> 4);
+				zh = (zh >> 4) ^ (last4[rem] << 48) ^ m_gcm_hh[hi];
+				zl ^= m_gcm_hl[hi];
+			}
+			StoreBE64(x + 0, zh);
+			StoreBE64(x + 8, zl);
+		}
+
+		// Accumulate 'len' bytes of 'data' into the GHASH value 'y'. A partial last block is zero padded.
+		void Ghash(byte* y, byte const* data, size_t len) const
+		{
+			#if PR_CRYPT_USE_AESNI
+			if (m_aesni)
+				return GhashNI(y, data, len);
+			#endif
+
+			for (; len != 0;)
+			{
+				auto n = std::min<size_t>(len, BLOCK_SIZE);
+				for (size_t i = 0; i != n; ++i)
+					y[i] ^= data[i];
+
+				GhashMulH(y);
+				data += n;
+				len -= n;
+			}
+		}
+
+		// Create the pre-counter block J0 from the initialisation vector
+		void GcmJ0(byte const* iv, size_t iv_len, byte* j0) const
+		{
+			if (iv_len == 12)
+			{
+				memcpy(j0, iv, 12);
+				j0[12] = j0[13] = j0[14] = 0;
+				j0[15] = 1;
+			}
+			else
+			{
+				byte lens[BLOCK_SIZE] = {};
+				StoreBE64(&lens[8], iv_len * 8ULL);
+				memset(j0, 0, BLOCK_SIZE);
+				Ghash(j0, iv, iv_len);
+				Ghash(j0, lens, BLOCK_SIZE);
+			}
+		}
+
+		// Encrypt or decrypt 'in' using the GCM counter starting at 'ctr', accumulating the cipher text into the GHASH value 'y'
+		void GcmCrypt(Counter ctr, byte const* in, byte* result, size_t len, byte* y, bool encrypt)
+		{
+			// Each piece is hashed from zero, independently of the other pieces.
+			// The cipher text is hashed before decrypting, since 'result' can alias 'in'.
+			auto pieces = Pieces(len);
+			ForEachPiece(pieces, [&](Piece& p)
+			{
+				memset(p.m_ghash, 0, BLOCK_SIZE);
+				if (!encrypt) Ghash(p.m_ghash, in + p.m_ofs, p.m_len);
+				CtrXor(ctr + p.m_ofs / BLOCK_SIZE, in + p.m_ofs, result + p.m_ofs, p.m_len);
+				if (encrypt) Ghash(p.m_ghash, result + p.m_ofs, p.m_len);
+			});
+
+			// GHASH is linear, so GHASH(y, X1..Xn) = y*H^n + GHASH(0, X1..Xn)
+			byte hn[BLOCK_SIZE];
+			uint64_t hn_blocks = 0;
+			for (auto& p : pieces)
+			{
+				auto n = static_cast<uint64_t>((p.m_len + BLOCK_SIZE - 1) / BLOCK_SIZE);
+				if (n != hn_blocks)
+				{
+					GfPow(m_gcm_h, n, hn);
+					hn_blocks = n;
+				}
+				GfMul(y, hn, y);
+				Xor(y, p.m_ghash);
+			}
+		}
+
+		// Generate the authentication tag from the GHASH value 'y'
+		void GcmTag(byte const* j0, byte* y, size_t aad_len, size_t len, byte* tag)
+		{
+			byte lens[BLOCK_SIZE];
+			StoreBE64(&lens[0], aad_len * 8ULL);
+			StoreBE64(&lens[8], len * 8ULL);
+			Ghash(y, lens, BLOCK_SIZE);
+
+			// tag = E(J0) ^ y
+			CtrXor(Counter(j0, true), y, tag, BLOCK_SIZE);
+		}
+
+		// Validate GCM parameters
+		static void GcmCheck(byte const* iv, size_t iv_len, byte const* aad, size_t aad_len, byte const* in, byte* result, size_t len, byte const* tag)
+		{
+			if (iv == nullptr || iv_len == 0)
+				throw std::runtime_error("GCM mode requires an initialisation vector");
+			if (aad == nullptr && aad_len != 0)
+				throw std::runtime_error("Additional authenticated data is null");
+			if ((in == nullptr || result == nullptr) && len != 0)
+				throw std::runtime_error("Data buffer is null");
+			if (tag == nullptr)
+				throw std::runtime_error("GCM mode requires a tag buffer");
+			if (static_cast<uint64_t>(len) > (1ULL << 36) - 32)
+				throw std::runtime_error("Data length exceeds the GCM limit of 2^36 - 32 bytes");
+		}
+
+		// CPU support for the AES-NI, PCLMULQDQ, and SSSE3 instructions
+		static bool CpuHasAesNi()
+		{
+			#if PR_CRYPT_USE_AESNI
+			static bool const has = []
+			{
+				int info[4] = {};
+				__cpuid(info, 0);
+				if (info[0] < 1)
+					return false;
+
+				__cpuid(info, 1);
+				auto aes    = (info[2] & (1 << 25)) != 0;
+				auto pclmul = (info[2] & (1 <<  1)) != 0;
+				auto ssse3  = (info[2] & (1 <<  9)) != 0;
+				return aes && pclmul && ssse3;
+			}();
+			return has;
+			#else
+			return false;
+			#endif
+		}
+
+		#if PR_CRYPT_USE_AESNI
+		#pragma region AES-NI
+
+		// Byte reversal shuffle mask
+		static __m128i ByteSwapNI()
+		{
+			return _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		}
+		static __m128i LoadNI(byte const* p)
+		{
+			return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+		}
+		static void StoreNI(byte* p, __m128i x)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(p), x);
+		}
+
+		// Convert a round key from big-endian words to AES byte order
+		static __m128i RoundKeyNI(int const* w)
+		{
+			byte b[BLOCK_SIZE];
+			for (int j = 0; j != 4; ++j)
+			{
+				b[4*j + 0] = static_cast<byte>(w[j] >> 24);
+				b[4*j + 1] = static_cast<byte>(w[j] >> 16);
+				b[4*j + 2] = static_cast<byte>(w[j] >>  8);
+				b[4*j + 3] = static_cast<byte>(w[j]      );
+			}
+			return LoadNI(b);
+		}
+
+		// Call 'func(i)' for i in [0,N). The calls are unrolled so that arrays indexed by 'i' can be kept in registers
+		template <int N, typename Func> static void Unroll(Func func)
+		{
+			[&]<size_t... I>(std::index_sequence<I...>) { (func(I), ...); }(std::make_index_sequence<N>{});
+		}
+
+		// Encrypt/Decrypt 'N' blocks at once. Interleaving independent blocks hides the latency of AESENC/AESDEC
+		template <int N> void EncryptNI(__m128i (&x)[N]) const
+		{
+			// Work on a local copy, otherwise the compiler assumes 'x' can alias the round keys and stores it every round
+			__m128i b[N];
+			Unroll<N>([&](size_t i) { b[i] = _mm_xor_si128(x[i], m_ni_ke[0]); });
+			for (int r = 1; r != m_rounds; ++r)
+			{
+				auto k = m_ni_ke[r];
+				Unroll<N>([&](size_t i) { b[i] = _mm_aesenc_si128(b[i], k); });
+			}
+			Unroll<N>([&](size_t i) { x[i] = _mm_aesenclast_si128(b[i], m_ni_ke[m_rounds]); });
+		}
+		template <int N> void DecryptNI(__m128i (&x)[N]) const
+		{
+			// Work on a local copy, otherwise the compiler assumes 'x' can alias the round keys and stores it every round
+			__m128i b[N];
+			Unroll<N>([&](size_t i) { b[i] = _mm_xor_si128(x[i], m_ni_kd[0]); });
+			for (int r = 1; r != m_rounds; ++r)
+			{
+				auto k = m_ni_kd[r];
+				Unroll<N>([&](size_t i) { b[i] = _mm_aesdec_si128(b[i], k); });
+			}
+			Unroll<N>([&](size_t i) { x[i] = _mm_aesdeclast_si128(b[i], m_ni_kd[m_rounds]); });
+		}
+		__m128i EncryptNI(__m128i x) const
+		{
+			__m128i b[1] = {x};
+			EncryptNI(b);
+			return b[0];
+		}
+
+		// ECB mode for 'count' blocks
+		template <bool Encrypt> void EcbNI(byte const* in, byte* result, size_t count) const
+		{
+			for (; count >= 8; count -= 8, in += 8 * BLOCK_SIZE, result += 8 * BLOCK_SIZE)
+			{
+				__m128i x[8];
+				Unroll<8>([&](size_t i) { x[i] = LoadNI(in + i * BLOCK_SIZE); });
+				if constexpr (Encrypt) EncryptNI(x); else DecryptNI(x);
+				Unroll<8>([&](size_t i) { StoreNI(result + i * BLOCK_SIZE, x[i]); });
+			}
+			for (; count != 0; --count, in += BLOCK_SIZE, result += BLOCK_SIZE)
+			{
+				__m128i x[1] = {LoadNI(in)};
+				if constexpr (Encrypt) EncryptNI(x); else DecryptNI(x);
+				StoreNI(result, x[0]);
+			}
+		}
+
+		// CBC mode decryption for 'count' blocks. Unlike encryption, the blocks are independent
+		void DecryptCbcNI(byte const* in, byte* result, size_t count, byte* chain) const
+		{
+			auto prev = LoadNI(chain);
+			for (; count >= 8; count -= 8, in += 8 * BLOCK_SIZE, result += 8 * BLOCK_SIZE)
+			{
+				__m128i c[8], x[8];
+				Unroll<8>([&](size_t i) { x[i] = c[i] = LoadNI(in + i * BLOCK_SIZE); });
+				DecryptNI(x);
+				Unroll<8>([&](size_t i) { StoreNI(result + i * BLOCK_SIZE, _mm_xor_si128(x[i], i == 0 ? prev : c[i - 1])); });
+				prev = c[7];
+			}
+			for (; count != 0; --count, in += BLOCK_SIZE, result += BLOCK_SIZE)
+			{
+				__m128i x[1] = {LoadNI(in)};
+				auto c = x[0];
+				DecryptNI(x);
+				StoreNI(result, _mm_xor_si128(x[0], prev));
+				prev = c;
+			}
+			StoreNI(chain, prev);
+		}
+
+		// CFB mode decryption for 'count' blocks. Unlike encryption, the blocks are independent
+		void DecryptCfbNI(byte const* in, byte* result, size_t count, byte* chain) const
+		{
+			auto prev = LoadNI(chain);
+			for (; count >= 8; count -= 8, in += 8 * BLOCK_SIZE, result += 8 * BLOCK_SIZE)
+			{
+				__m128i c[8], x[8];
+				Unroll<8>([&](size_t i) { c[i] = LoadNI(in + i * BLOCK_SIZE); });
+				Unroll<8>([&](size_t i) { x[i] = i == 0 ? prev : c[i - 1]; });
+				EncryptNI(x);
+				Unroll<8>([&](size_t i) { StoreNI(result + i * BLOCK_SIZE, _mm_xor_si128(x[i], c[i])); });
+				prev = c[7];
+			}
+			for (; count != 0; --count, in += BLOCK_SIZE, result += BLOCK_SIZE)
+			{
+				auto c = LoadNI(in);
+				StoreNI(result, _mm_xor_si128(EncryptNI(prev), c));
+				prev = c;
+			}
+			StoreNI(chain, prev);
+		}
+
+		// CTR mode key stream, 8 blocks at a time
+		void CtrXorNI(Counter ctr, byte const* in, byte* result, size_t len) const
+		{
+			auto const bswap = ByteSwapNI();
+			auto Block = [&](Counter c) { return _mm_shuffle_epi8(_mm_set_epi64x(static_cast<long long>(c.m_hi), static_cast<long long>(c.m_lo)), bswap); };
+
+			uint64_t n = 0;
+			for (; len >= 8 * BLOCK_SIZE; len -= 8 * BLOCK_SIZE, in += 8 * BLOCK_SIZE, result += 8 * BLOCK_SIZE)
+			{
+				__m128i x[8];
+				Unroll<8>([&](size_t i) { x[i] = Block(ctr + (n + i)); });
+				EncryptNI(x);
+				Unroll<8>([&](size_t i) { StoreNI(result + i * BLOCK_SIZE, _mm_xor_si128(x[i], LoadNI(in + i * BLOCK_SIZE))); });
+				n += 8;
+			}
+			for (; len >= BLOCK_SIZE; len -= BLOCK_SIZE, in += BLOCK_SIZE, result += BLOCK_SIZE)
+			{
+				StoreNI(result, _mm_xor_si128(EncryptNI(Block(ctr + n++)), LoadNI(in)));
+			}
+			if (len != 0)
+			{
+				byte ks[BLOCK_SIZE];
+				StoreNI(ks, EncryptNI(Block(ctr + n)));
+				for (size_t i = 0; i != len; ++i)
+					result[i] = in[i] ^ ks[i];
+			}
+		}
+
+		// Carry-less multiply of byte reversed 'a' and 'b' giving the unreduced 256-bit product
+		static void ClMulNI(__m128i a, __m128i b, __m128i& lo, __m128i& hi)
+		{
+			auto t0 = _mm_clmulepi64_si128(a, b, 0x00);
+			auto t1 = _mm_clmulepi64_si128(a, b, 0x10);
+			auto t2 = _mm_clmulepi64_si128(a, b, 0x01);
+			auto t3 = _mm_clmulepi64_si128(a, b, 0x11);
+			t1 = _mm_xor_si128(t1, t2);
+			lo = _mm_xor_si128(t0, _mm_slli_si128(t1, 8));
+			hi = _mm_xor_si128(t3, _mm_srli_si128(t1, 8));
+		}
+
+		// Reduce a 256-bit product modulo the GCM polynomial (Gueron & Kounavis, Intel white paper 323640)
+		static __m128i GfReduceNI(__m128i lo, __m128i hi)
+		{
+			// Shift the product left by one bit to account for the reflected bit order
+			auto c0 = _mm_srli_epi32(lo, 31);
+			auto c1 = _mm_srli_epi32(hi, 31);
+			lo = _mm_slli_epi32(lo, 1);
+			hi = _mm_slli_epi32(hi, 1);
+			auto c2 = _mm_srli_si128(c0, 12);
+			c1 = _mm_slli_si128(c1, 4);
+			c0 = _mm_slli_si128(c0, 4);
+			lo = _mm_or_si128(lo, c0);
+			hi = _mm_or_si128(hi, c1);
+			hi = _mm_or_si128(hi, c2);
+
+			// First phase of the reduction
+			auto a = _mm_slli_epi32(lo, 31);
+			auto b = _mm_slli_epi32(lo, 30);
+			auto c = _mm_slli_epi32(lo, 25);
+			a = _mm_xor_si128(a, b);
+			a = _mm_xor_si128(a, c);
+			b = _mm_srli_si128(a, 4);
+			a = _mm_slli_si128(a, 12);
+			lo = _mm_xor_si128(lo, a);
+
+			// Second phase
+			auto d = _mm_srli_epi32(lo, 1);
+			auto e = _mm_srli_epi32(lo, 2);
+			auto f = _mm_srli_epi32(lo, 7);
+			d = _mm_xor_si128(d, e);
+			d = _mm_xor_si128(d, f);
+			d = _mm_xor_si128(d, b);
+			lo = _mm_xor_si128(lo, d);
+			return _mm_xor_si128(hi, lo);
+		}
+		static __m128i GfMulNI(__m128i a, __m128i b)
+		{
+			__m128i lo, hi;
+			ClMulNI(a, b, lo, hi);
+			return GfReduceNI(lo, hi);
+		}
+
+		// GHASH using PCLMULQDQ. Four blocks are multiplied by H^4..H^1 and share one reduction
+		void GhashNI(byte* y, byte const* data, size_t len) const
+		{
+			auto const bswap = ByteSwapNI();
+			auto Y = _mm_shuffle_epi8(LoadNI(y), bswap);
+			for (; len >= 4 * BLOCK_SIZE; len -= 4 * BLOCK_SIZE, data += 4 * BLOCK_SIZE)
+			{
+				auto x0 = _mm_xor_si128(Y, _mm_shuffle_epi8(LoadNI(data + 0 * BLOCK_SIZE), bswap));
+				auto x1 = _mm_shuffle_epi8(LoadNI(data + 1 * BLOCK_SIZE), bswap);
+				auto x2 = _mm_shuffle_epi8(LoadNI(data + 2 * BLOCK_SIZE), bswap);
+				auto x3 = _mm_shuffle_epi8(LoadNI(data + 3 * BLOCK_SIZE), bswap);
+
+				__m128i lo, hi, l, h;
+				ClMulNI(x0, m_ni_hp[3], lo, hi);
+				ClMulNI(x1, m_ni_hp[2], l, h); lo = _mm_xor_si128(lo, l); hi = _mm_xor_si128(hi, h);
+				ClMulNI(x2, m_ni_hp[1], l, h); lo = _mm_xor_si128(lo, l); hi = _mm_xor_si128(hi, h);
+				ClMulNI(x3, m_ni_hp[0], l, h); lo = _mm_xor_si128(lo, l); hi = _mm_xor_si128(hi, h);
+				Y = GfReduceNI(lo, hi);
+			}
+			for (; len != 0;)
+			{
+				auto n = std::min<size_t>(len, BLOCK_SIZE);
+				byte block[BLOCK_SIZE] = {};
+				memcpy(block, data, n);
+
+				Y = GfMulNI(_mm_xor_si128(Y, _mm_shuffle_epi8(LoadNI(block), bswap)), m_ni_hp[0]);
+				data += n;
+				len -= n;
+			}
+			StoreNI(y, _mm_shuffle_epi8(Y, bswap));
+		}
+
+		#pragma endregion
+		#endif
+
 	public:
 
 		enum class EMode
@@ -1323,9 +1941,15 @@ namespace pr::crypt
 			// In CFB mode a ciphertext block is obtained by encrypting the previous
 			// ciphertext block and xoring the resulting value with the plaintext.
 			CFB = 2,
+
+			// Counter (CTR)
+			// In CTR mode a key stream is generated by encrypting successive values of a counter
+			// block and xoring it with the plaintext. Blocks are independent, so they can be pipelined
+			// and split across threads. Encryption and decryption are the same operation.
+			CTR = 3,
 		};
 
-		// A chain block for use with CBC and CFB modes
+		// A chain block for use with CBC and CFB modes, or the counter block for CTR mode
 		struct Chain
 		{
 			byte m_buf[BLOCK_SIZE];
@@ -1340,9 +1964,11 @@ namespace pr::crypt
 		// Expand a user-supplied key into a session key.
 		//  key        - The 128/192/256-bit user-key to use.
 		//  key_length - 16, 24 or 32 bytes
-		Rijndael(byte const* key, int key_length = DEFAULT_KEY_LENGTH)
+		//  use_aesni  - Use the AES-NI instructions if the CPU supports them. The output is the same either way.
+		Rijndael(byte const* key, int key_length = DEFAULT_KEY_LENGTH, bool use_aesni = true)
 			:m_key_length(key_length)
 			,m_rounds()
+			,m_aesni(use_aesni && CpuHasAesNi())
 		{
 			assert(key != nullptr && "Empty key");
 			assert((key_length == 16 || key_length == 24 || key_length == 32) && "Unsupported key length");
@@ -1443,6 +2069,29 @@ namespace pr::crypt
 						sm_U4((tt      ) & 0xFF);
 				}
 			}
+
+			#if PR_CRYPT_USE_AESNI
+			// 'm_Kd' is already in the 'equivalent inverse cipher' form that AESDEC expects
+			for (auto r = 0; r <= m_rounds; ++r)
+			{
+				m_ni_ke[r] = RoundKeyNI(m_Ke[r]);
+				m_ni_kd[r] = RoundKeyNI(m_Kd[r]);
+			}
+			#endif
+
+			// The GHASH key for GCM mode
+			byte zero[BLOCK_SIZE] = {};
+			EncryptBlock<BLOCK_SIZE>(zero, m_gcm_h);
+			GhashTables();
+
+			#if PR_CRYPT_USE_AESNI
+			if (m_aesni)
+			{
+				m_ni_hp[0] = _mm_shuffle_epi8(LoadNI(m_gcm_h), ByteSwapNI());
+				for (int i = 1; i != 4; ++i)
+					m_ni_hp[i] = GfMulNI(m_ni_hp[i - 1], m_ni_hp[0]);
+			}
+			#endif
 		}
 
 		// Destructor - zero sensitive key material for security
@@ -1471,20 +2120,27 @@ namespace pr::crypt
 			return m_rounds;
 		}
 
+		// True if the AES-NI instructions are used
+		bool AesNi() const
+		{
+			return m_aesni;
+		}
+
 		// Encrypt data.
 		//  in     - The source data to be encrypted
-		//  result - The buffer that receives the encrypted data. In-place encryption is supported for ECB mode, 'result' can alias 'in'
-		//  len    - The size in bytes of 'in' and 'result'. Must be a multiple of the block size
+		//  result - The buffer that receives the encrypted data. In-place encryption is supported for ECB and CTR modes, 'result' can alias 'in'
+		//  len    - The size in bytes of 'in' and 'result'. Must be a multiple of the block size, except for CTR mode
 		//  mode   - The encryption mode to use
-		//  chain  - Required for CBC or CFB modes. A chain instance should be used to encrypt successive blocks of data.
+		//  chain  - Required for CBC, CFB, or CTR modes. A chain instance should be used to encrypt successive blocks of data.
+		//           In CTR mode, only the last of a sequence of calls can have a length that isn't a multiple of the block size.
 		void Encrypt(byte const* in, byte* result, size_t len, EMode mode = EMode::ECB, Chain* chain = nullptr)
 		{
-			if ((len % BLOCK_SIZE) != 0)
+			if (mode != EMode::CTR && (len % BLOCK_SIZE) != 0)
 				throw std::runtime_error("Data length is not a multiple of the block size");
 			if (mode != EMode::ECB && chain == nullptr)
 				throw std::runtime_error("A chain instance is required for this encryption mode");
-			if (mode != EMode::ECB && in == result)
-				throw std::runtime_error("Inplace encryption is only support for ECB mode");
+			if (mode != EMode::ECB && mode != EMode::CTR && in == result)
+				throw std::runtime_error("Inplace encryption is only support for ECB and CTR modes");
 
 			auto src = in;
 			auto dst = result;
@@ -1492,6 +2148,13 @@ namespace pr::crypt
 			{
 				case EMode::ECB: //ECB mode, not using the Chain
 				{
+					#if PR_CRYPT_USE_AESNI
+					if (m_aesni)
+					{
+						EcbNI<true>(src, dst, len / BLOCK_SIZE);
+						break;
+					}
+					#endif
 					for (int i = 0, iend = (int)len / BLOCK_SIZE; i != iend; ++i)
 					{
 						EncryptBlock<BLOCK_SIZE>(src, dst);
@@ -1502,6 +2165,20 @@ namespace pr::crypt
 				}
 				case EMode::CBC: //CBC mode, using the Chain
 				{
+					#if PR_CRYPT_USE_AESNI
+					if (m_aesni)
+					{
+						// Each block depends on the previous one, so can't be pipelined
+						auto c = LoadNI(chain->m_buf);
+						for (size_t i = 0, iend = len / BLOCK_SIZE; i != iend; ++i, src += BLOCK_SIZE, dst += BLOCK_SIZE)
+						{
+							c = EncryptNI(_mm_xor_si128(c, LoadNI(src)));
+							StoreNI(dst, c);
+						}
+						StoreNI(chain->m_buf, c);
+						break;
+					}
+					#endif
 					for (size_t i = 0, iend = (int)len / BLOCK_SIZE; i != iend; ++i)
 					{
 						Xor(chain->m_buf, src);
@@ -1514,6 +2191,20 @@ namespace pr::crypt
 				}
 				case EMode::CFB: //CFB mode, using the Chain
 				{
+					#if PR_CRYPT_USE_AESNI
+					if (m_aesni)
+					{
+						// Each block depends on the previous one, so can't be pipelined
+						auto c = LoadNI(chain->m_buf);
+						for (size_t i = 0, iend = len / BLOCK_SIZE; i != iend; ++i, src += BLOCK_SIZE, dst += BLOCK_SIZE)
+						{
+							c = _mm_xor_si128(EncryptNI(c), LoadNI(src));
+							StoreNI(dst, c);
+						}
+						StoreNI(chain->m_buf, c);
+						break;
+					}
+					#endif
 					for (size_t i = 0, iend = (int)len / BLOCK_SIZE; i != iend; ++i)
 					{
 						EncryptBlock<BLOCK_SIZE>(chain->m_buf, dst);
@@ -1524,6 +2215,11 @@ namespace pr::crypt
 					}
 					break;
 				}
+				case EMode::CTR: //CTR mode, using the Chain as the counter
+				{
+					Ctr(src, dst, len, chain->m_buf);
+					break;
+				}
 				default:
 				{
 					throw std::runtime_error("Unknown encryption mode");
@@ -1533,18 +2229,18 @@ namespace pr::crypt
 
 		// Decrypt data.
 		//  in      - The source data to be decrypted
-		//  result  - The buffer that receives the decrypted data. In-plane decryption is supported for ECB mode, 'result' can alias 'in'
-		//  len     - The size in bytes of 'in' and 'result'. Must be a multiple of the block size
+		//  result  - The buffer that receives the decrypted data. In-plane decryption is supported for ECB and CTR modes, 'result' can alias 'in'
+		//  len     - The size in bytes of 'in' and 'result'. Must be a multiple of the block size, except for CTR mode
 		//  mode    - The encryption mode to use
-		//  chain   - Required for CBC or CFB modes. A chain instance should be used to decrypt successive blocks of data.
+		//  chain   - Required for CBC, CFB, or CTR modes. A chain instance should be used to decrypt successive blocks of data.
 		void Decrypt(byte const* in, byte* result, size_t len, EMode mode = EMode::ECB, Chain* chain = nullptr)
 		{
-			if ((len % BLOCK_SIZE) != 0)
+			if (mode != EMode::CTR && (len % BLOCK_SIZE) != 0)
 				throw std::runtime_error("Data length is not multiple of the block size");
 			if (mode != EMode::ECB && chain == nullptr)
 				throw std::runtime_error("A chain instance is required for this decryption mode");
-			if (mode != EMode::ECB && in == result)
-				throw std::runtime_error("Inplace decryption is only support for ECB mode");
+			if (mode != EMode::ECB && mode != EMode::CTR && in == result)
+				throw std::runtime_error("Inplace decryption is only support for ECB and CTR modes");
 
 			auto src = in;
 			auto dst = result;
@@ -1552,6 +2248,13 @@ namespace pr::crypt
 			{
 				case EMode::ECB: //ECB mode, not using the Chain
 				{
+					#if PR_CRYPT_USE_AESNI
+					if (m_aesni)
+					{
+						EcbNI<false>(src, dst, len / BLOCK_SIZE);
+						break;
+					}
+					#endif
 					for (int i = 0, iend = (int)len / BLOCK_SIZE; i != iend; ++i)
 					{
 						DecryptBlock<BLOCK_SIZE>(src, dst);
@@ -1562,6 +2265,13 @@ namespace pr::crypt
 				}
 				case EMode::CBC: //CBC mode, using the Chain
 				{
+					#if PR_CRYPT_USE_AESNI
+					if (m_aesni)
+					{
+						DecryptCbcNI(src, dst, len / BLOCK_SIZE, chain->m_buf);
+						break;
+					}
+					#endif
 					for (size_t i = 0, iend = (int)len / BLOCK_SIZE; i != iend; ++i)
 					{
 						DecryptBlock<BLOCK_SIZE>(src, dst);
@@ -1574,6 +2284,13 @@ namespace pr::crypt
 				}
 				case EMode::CFB: //CFB mode, using the Chain
 				{
+					#if PR_CRYPT_USE_AESNI
+					if (m_aesni)
+					{
+						DecryptCfbNI(src, dst, len / BLOCK_SIZE, chain->m_buf);
+						break;
+					}
+					#endif
 					for (size_t i = 0, iend = (int)len / BLOCK_SIZE; i != iend; ++i)
 					{
 						// Note: not using Decrypt(), this is not a bug
@@ -1585,12 +2302,66 @@ namespace pr::crypt
 					}
 					break;
 				}
+				case EMode::CTR: //CTR mode, using the Chain as the counter
+				{
+					Ctr(src, dst, len, chain->m_buf);
+					break;
+				}
 				default:
 				{
 					throw std::runtime_error("Unknown encryption mode");
 				}
 			}
 		}
+
+		// Authenticated encryption using Galois/Counter Mode (GCM).
+		//  iv/iv_len   - The initialisation vector. 12 bytes is recommended. Never reuse an iv with the same key.
+		//  aad/aad_len - Additional data that is authenticated but not encrypted. Can be null if 'aad_len' is zero.
+		//  in          - The source data to be encrypted. Can be any length.
+		//  result      - The buffer that receives the encrypted data. In-place encryption is supported, 'result' can alias 'in'
+		//  len         - The size in bytes of 'in' and 'result'
+		//  tag         - Receives the 16 byte authentication tag
+		// Large buffers are split across threads.
+		void EncryptGcm(byte const* iv, size_t iv_len, byte const* aad, size_t aad_len, byte const* in, byte* result, size_t len, byte* tag)
+		{
+			GcmCheck(iv, iv_len, aad, aad_len, in, result, len, tag);
+
+			byte j0[BLOCK_SIZE];
+			GcmJ0(iv, iv_len, j0);
+
+			byte y[BLOCK_SIZE] = {};
+			Ghash(y, aad, aad_len);
+			GcmCrypt(Counter(j0, true) + 1, in, result, len, y, true);
+			GcmTag(j0, y, aad_len, len, tag);
+		}
+
+		// Authenticated decryption using Galois/Counter Mode (GCM).
+		// Parameters are the same as for 'EncryptGcm', with 'tag' being the expected authentication tag.
+		// Returns false, and zeros 'result', if the data fails authentication.
+		bool DecryptGcm(byte const* iv, size_t iv_len, byte const* aad, size_t aad_len, byte const* in, byte* result, size_t len, byte const* tag)
+		{
+			GcmCheck(iv, iv_len, aad, aad_len, in, result, len, tag);
+
+			byte j0[BLOCK_SIZE];
+			GcmJ0(iv, iv_len, j0);
+
+			byte y[BLOCK_SIZE] = {};
+			Ghash(y, aad, aad_len);
+			GcmCrypt(Counter(j0, true) + 1, in, result, len, y, false);
+
+			byte expected[BLOCK_SIZE];
+			GcmTag(j0, y, aad_len, len, expected);
+
+			// Constant time comparison
+			byte diff = 0;
+			for (int i = 0; i != BLOCK_SIZE; ++i)
+				diff |= expected[i] ^ tag[i];
+			if (diff == 0)
+				return true;
+
+			if (len != 0) memset(result, 0, len);
+			return false;
+		}
 	};
 }
 
@@ -1652,6 +2423,162 @@ namespace pr::crypt
 				PR_EXPECT(memcmp(data, dec, len) == 0);
 			}
 		}
+
+		auto Hex = [](char const* s)
+		{
+			auto nib = [](char c) { return static_cast<byte>(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10); };
+			std::vector<byte> out;
+			for (; s[0] && s[1]; s += 2)
+				out.push_back(static_cast<byte>(nib(s[0]) << 4 | nib(s[1])));
+			return out;
+		};
+		{// FIPS-197 Appendix C known answers, with and without AES-NI
+			auto pt = Hex("00112233445566778899aabbccddeeff");
+			auto k = Hex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+			char const* ct[] = {"69c4e0d86a7b0430d8cdb78070b4c55a", "dda97ca4864cdfe06eaf70a0ec0d7191", "8ea2b7ca516745bfeafc49904b496089"};
+			for (auto aesni : {false, true})
+			for (auto keysize : {16,24,32})
+			{
+				Rijndael rj(k.data(), keysize, aesni);
+				byte out[16];
+				rj.Encrypt(pt.data(), out, 16);
+				PR_EXPECT(memcmp(out, Hex(ct[(keysize - 16) / 8]).data(), 16) == 0);
+				rj.Decrypt(out, out, 16);
+				PR_EXPECT(memcmp(out, pt.data(), 16) == 0);
+			}
+		}
+		{// The table and AES-NI implementations produce the same output
+			// An odd number of blocks, so that the AES-NI pipeline has a tail
+			std::vector<byte> src((1 << 20) - 16), out0(src.size()), out1(src.size()), dec(src.size());
+			for (size_t i = 0; i != src.size(); ++i)
+				src[i] = static_cast<byte>(i * 31 + (i >> 8));
+
+			for (auto mode : {Rijndael::EMode::ECB, Rijndael::EMode::CBC, Rijndael::EMode::CFB, Rijndael::EMode::CTR})
+			for (auto keysize : {16,24,32})
+			{
+				Rijndael rj0(key, keysize, false);
+				Rijndael rj1(key, keysize, true);
+				{
+					Rijndael::Chain chain0(data), chain1(data);
+					rj0.Encrypt(src.data(), out0.data(), src.size(), mode, &chain0);
+					rj1.Encrypt(src.data(), out1.data(), src.size(), mode, &chain1);
+					PR_EXPECT(memcmp(out0.data(), out1.data(), src.size()) == 0);
+					PR_EXPECT(memcmp(chain0.m_buf, chain1.m_buf, 16) == 0);
+				}
+				{
+					Rijndael::Chain chain0(data), chain1(data);
+					rj0.Decrypt(out0.data(), dec.data(), src.size(), mode, &chain0);
+					PR_EXPECT(memcmp(dec.data(), src.data(), src.size()) == 0);
+					rj1.Decrypt(out1.data(), dec.data(), src.size(), mode, &chain1);
+					PR_EXPECT(memcmp(dec.data(), src.data(), src.size()) == 0);
+					PR_EXPECT(memcmp(chain0.m_buf, chain1.m_buf, 16) == 0);
+				}
+			}
+		}
+		{// CTR mode, NIST SP 800-38A F.5.1
+			auto k = Hex("2b7e151628aed2a6abf7158809cf4f3c");
+			auto ctr = Hex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+			auto pt = Hex(
+				"6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+				"30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710");
+			auto ct = Hex(
+				"874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+				"5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+			for (auto aesni : {false, true})
+			{
+				Rijndael rj(k.data(), 16, aesni);
+				std::vector<byte> out(pt.size());
+
+				// Arbitrary lengths, in-place, and successive calls
+				Rijndael::Chain chain(ctr.data());
+				rj.Encrypt(pt.data(), out.data(), 32, Rijndael::EMode::CTR, &chain);
+				rj.Encrypt(pt.data() + 32, out.data() + 32, 27, Rijndael::EMode::CTR, &chain);
+				PR_EXPECT(memcmp(out.data(), ct.data(), 59) == 0);
+
+				Rijndael::Chain chain2(ctr.data());
+				rj.Decrypt(out.data(), out.data(), 59, Rijndael::EMode::CTR, &chain2);
+				PR_EXPECT(memcmp(out.data(), pt.data(), 59) == 0);
+			}
+		}
+		{// CTR mode, large buffers are split across threads
+			std::vector<byte> src(3 << 20 | 37), out0(src.size()), out1(src.size());
+			for (size_t i = 0; i != src.size(); ++i)
+				src[i] = static_cast<byte>(i ^ (i >> 11));
+
+			Rijndael rj(key, 32);
+			Rijndael::Chain chain0, chain1;
+			rj.Encrypt(src.data(), out0.data(), src.size(), Rijndael::EMode::CTR, &chain0);
+			for (size_t ofs = 0; ofs != src.size();)
+			{
+				auto n = std::min<size_t>(4096, src.size() - ofs);
+				rj.Encrypt(src.data() + ofs, out1.data() + ofs, n, Rijndael::EMode::CTR, &chain1);
+				ofs += n;
+			}
+			PR_EXPECT(memcmp(out0.data(), out1.data(), src.size()) == 0);
+			PR_EXPECT(memcmp(chain0.m_buf, chain1.m_buf, 16) == 0);
+		}
+		{// GCM mode, test cases 4 and 6 from McGrew & Viega, "The Galois/Counter Mode of Operation"
+			auto k = Hex("feffe9928665731c6d6a8f9467308308");
+			auto aad = Hex("feedfacedeadbeeffeedfacedeadbeefabaddad2");
+			auto pt = Hex(
+				"d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+				"1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39");
+			struct { char const* iv; char const* ct; char const* tag; } tests[] =
+			{
+				{
+					"cafebabefacedbaddecaf888",
+					"42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+					"21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+					"5bc94fbc3221a5db94fae95ae7121a47",
+				},
+				{
+					"9313225df88406e555909c5aff5269aa6a7a9538534f7da1e4c303d2a318a728"
+					"c3c0c95156809539fcf0e2429a6b525416aedbf5a0de6a57a637b39b",
+					"8ce24998625615b603a033aca13fb894be9112a5c3a211a8ba262a3cca7e2ca7"
+					"01e4a9a4fba43c90ccdcb281d48c7c6fd62875d2aca417034c34aee5",
+					"619cc5aefffe0bfa462af43c1699d050",
+				},
+			};
+			for (auto aesni : {false, true})
+			for (auto& test : tests)
+			{
+				Rijndael rj(k.data(), 16, aesni);
+				auto iv = Hex(test.iv);
+				std::vector<byte> out(pt.size());
+				byte tag[16];
+
+				rj.EncryptGcm(iv.data(), iv.size(), aad.data(), aad.size(), pt.data(), out.data(), pt.size(), tag);
+				PR_EXPECT(memcmp(out.data(), Hex(test.ct).data(), pt.size()) == 0);
+				PR_EXPECT(memcmp(tag, Hex(test.tag).data(), 16) == 0);
+
+				PR_EXPECT(rj.DecryptGcm(iv.data(), iv.size(), aad.data(), aad.size(), out.data(), out.data(), out.size(), tag));
+				PR_EXPECT(memcmp(out.data(), pt.data(), pt.size()) == 0);
+
+				// Tampered data fails authentication
+				rj.EncryptGcm(iv.data(), iv.size(), aad.data(), aad.size(), pt.data(), out.data(), pt.size(), tag);
+				out[7] ^= 1;
+				PR_EXPECT(!rj.DecryptGcm(iv.data(), iv.size(), aad.data(), aad.size(), out.data(), out.data(), out.size(), tag));
+			}
+		}
+		{// GCM mode, large buffers are split across threads
+			std::vector<byte> src(3 << 20 | 37), out0(src.size()), out1(src.size());
+			for (size_t i = 0; i != src.size(); ++i)
+				src[i] = static_cast<byte>(i ^ (i >> 13));
+
+			for (auto keysize : {16,24,32})
+			{
+				Rijndael rj0(key, keysize, false);
+				Rijndael rj1(key, keysize, true);
+				byte tag0[16], tag1[16];
+				rj0.EncryptGcm(data, 12, data, 20, src.data(), out0.data(), src.size(), tag0);
+				rj1.EncryptGcm(data, 12, data, 20, src.data(), out1.data(), src.size(), tag1);
+				PR_EXPECT(memcmp(out0.data(), out1.data(), src.size()) == 0);
+				PR_EXPECT(memcmp(tag0, tag1, 16) == 0);
+
+				PR_EXPECT(rj1.DecryptGcm(data, 12, data, 20, out1.data(), out1.data(), out1.size(), tag1));
+				PR_EXPECT(memcmp(out1.data(), src.data(), src.size()) == 0);
+			}
+		}
 	}
 }
 #endif
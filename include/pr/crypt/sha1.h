@@ -12,7 +12,9 @@
 #include <fstream>
 #include <filesystem>
 #include <cstdint>
+#include <cstring>
 #include <intrin.h>
+#include "pr/crypt/hash_many.h"
 
 namespace pr::hash
 {
@@ -32,6 +34,7 @@ namespace pr::hash
 
 		uint8_t m_workspace[64];
 		Block* m_block; // SHA1 pointer to the byte array above
+		bool m_shani;   // Use the SHA extensions
 
 	public:
 
@@ -46,6 +49,7 @@ namespace pr::hash
 			,m_reserved1()
 			,m_workspace()
 			,m_block((Block*)&m_workspace[0])
+			,m_shani(CpuHasShaNi())
 		{
 			// SHA1 initialization constants
 			m_state[0] = 0x67452301;
@@ -63,26 +67,28 @@ namespace pr::hash
 		}
 
 		// Add data to the hash
-		void Update(void const* data, int len)
+		void Update(void const* data, size_t length)
 		{
 			auto bytes = static_cast<uint8_t const*>(data);
-			auto length = static_cast<uint32_t>(len);
 
 			auto j = (m_count[0] >> 3) & 0x3F;
-			if ((m_count[0] += (length << 3)) < (length << 3))
+			auto bits = static_cast<uint64_t>(length) << 3;
+			if ((m_count[0] += static_cast<uint32_t>(bits)) < static_cast<uint32_t>(bits))
 				++m_count[1]; // Overflow
 
-			m_count[1] += (length >> 29);
+			m_count[1] += static_cast<uint32_t>(bits >> 32);
 
-			uint32_t i = 0;
+			size_t i = 0;
 			if ((j + length) > 63)
 			{
 				i = 64 - j;
 				memcpy(&m_buffer[j], bytes, i);
-				Transform(m_state, m_buffer, m_block);
+				Transform(m_state, m_buffer, 1, m_block, m_shani);
 
-				for (; (i + 63) < length; i += 64)
-					Transform(m_state, &bytes[i], m_block);
+				// Whole blocks directly from the input
+				auto count = (length - i) / 64;
+				Transform(m_state, &bytes[i], count, m_block, m_shani);
+				i += count * 64;
 
 				j = 0;
 			}
@@ -113,7 +119,7 @@ namespace pr::hash
 			memset(m_state, 0, 20);
 			memset(m_count, 0, 8);
 			memset(final_count, 0, 8);
-			Transform(m_state, m_buffer, m_block);
+			Transform(m_state, m_buffer, 1, m_block, false);
 
 			return Hash();
 		}
@@ -128,6 +134,20 @@ namespace pr::hash
 
 	private:
 
+		// SHA-1 transformation of 'count' 64-byte blocks
+		static void Transform(uint32_t* pState, uint8_t const* pBuffer, size_t count, Block* block, bool shani)
+		{
+			#if PR_CRYPT_USE_SHANI
+			if (shani)
+				return TransformNI(pState, pBuffer, count);
+			#else
+			(void)shani;
+			#endif
+
+			for (; count-- != 0; pBuffer += 64)
+				Transform(pState, pBuffer, block);
+		}
+
 		// Private SHA-1 transformation
 		static void Transform(uint32_t* pState, uint8_t const* pBuffer, Block* block)
 		{
@@ -152,28 +172,29 @@ namespace pr::hash
 				return block->l[i & 15] = RotateLeft(block->l[(i + 13) & 15] ^ block->l[(i + 8) & 15] ^ block->l[(i + 2) & 15] ^ block->l[i & 15], 1);
 			};
 
-			// SHA-1 rounds
-			auto R0 = [=](uint32_t v, uint32_t w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
+			// SHA-1 rounds. Note: 'w' must be by reference, the rotate is part of the round.
+			// (This was by value in earlier versions, so hashes, and v5 GUIDs, from those versions differ)
+			auto R0 = [=](uint32_t v, uint32_t& w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
 			{
 				z += ((w&(x^y)) ^ y) + SHABLK0(i) + 0x5A827999 + RotateLeft(v, 5);
 				w = RotateLeft(w, 30);
 			};
-			auto R1 = [=](uint32_t v, uint32_t w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
+			auto R1 = [=](uint32_t v, uint32_t& w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
 			{
 				z += ((w&(x^y)) ^ y) + SHABLK(i) + 0x5A827999 + RotateLeft(v, 5);
 				w = RotateLeft(w, 30);
 			};
-			auto R2 = [=](uint32_t v, uint32_t w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
+			auto R2 = [=](uint32_t v, uint32_t& w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
 			{
 				z += (w^x^y) + SHABLK(i) + 0x6ED9EBA1 + RotateLeft(v, 5);
 				w = RotateLeft(w, 30);
 			};
-			auto R3 = [=](uint32_t v, uint32_t w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
+			auto R3 = [=](uint32_t v, uint32_t& w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
 			{
 				z += (((w | x)&y) | (w&x)) + SHABLK(i) + 0x8F1BBCDC + RotateLeft(v, 5);
 				w = RotateLeft(w, 30);
 			};
-			auto R4 = [=](uint32_t v, uint32_t w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
+			auto R4 = [=](uint32_t v, uint32_t& w, uint32_t x, uint32_t y, uint32_t& z, uint32_t i)
 			{
 				z += (w^x^y) + SHABLK(i) + 0xCA62C1D6 + RotateLeft(v, 5);
 				w = RotateLeft(w, 30);
@@ -216,10 +237,143 @@ namespace pr::hash
 			// Wipe variables
 			a = b = c = d = e = 0;
 		}
+
+		#if PR_CRYPT_USE_SHANI
+		// SHA-NI transformation. Each group of four rounds consumes one message vector and
+		// advances the message schedule of the groups that follow.
+		static void TransformNI(uint32_t* pState, uint8_t const* pBuffer, size_t count)
+		{
+			auto const mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+			auto abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(pState)), 0x1B);
+			auto e0 = _mm_set_epi32(static_cast<int>(pState[4]), 0, 0, 0);
+			auto e1 = _mm_setzero_si128();
+
+			for (; count-- != 0; pBuffer += 64)
+			{
+				auto abcd_save = abcd;
+				auto e0_save = e0;
+
+				__m128i m[4];
+				Unroll<20>([&](auto G)
+				{
+					constexpr int g = G;
+					if constexpr (g < 4)
+						m[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(pBuffer + 16 * g)), mask);
+
+					// 'e' alternates between 'e0' and 'e1'
+					auto& e = (g & 1) ? e1 : e0;
+					if constexpr (g == 0)
+						e = _mm_add_epi32(e, m[0]);
+					else
+						e = _mm_sha1nexte_epu32(e, m[g % 4]);
+					((g & 1) ? e0 : e1) = abcd;
+
+					if constexpr (g >= 3 && g <= 18)
+						m[(g + 1) % 4] = _mm_sha1msg2_epu32(m[(g + 1) % 4], m[g % 4]);
+
+					abcd = _mm_sha1rnds4_epu32(abcd, e, g / 5);
+
+					if constexpr (g >= 1 && g <= 16)
+						m[(g + 3) % 4] = _mm_sha1msg1_epu32(m[(g + 3) % 4], m[g % 4]);
+					if constexpr (g >= 2 && g <= 17)
+						m[(g + 2) % 4] = _mm_xor_si128(m[(g + 2) % 4], m[g % 4]);
+				});
+
+				e0 = _mm_sha1nexte_epu32(e0, e0_save);
+				abcd = _mm_add_epi32(abcd, abcd_save);
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pState), _mm_shuffle_epi32(abcd, 0x1B));
+			pState[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+		}
+		#endif
+	};
+
+	// 'Lanes' independent SHA-1 states compressed in lock-step (for 'HashMany').
+	// Each operation is a loop over the lanes, which compilers turn into SIMD instructions.
+	template <int Lanes>
+	struct SHA1Lanes
+	{
+		using hash_t = SHA1::hash_t;
+		static constexpr int Count = Lanes;
+
+		uint32_t m_h[5][Lanes];
+		uint32_t m_w[16][Lanes];
+
+		void Reset(int lane)
+		{
+			m_h[0][lane] = 0x67452301;
+			m_h[1][lane] = 0xEFCDAB89;
+			m_h[2][lane] = 0x98BADCFE;
+			m_h[3][lane] = 0x10325476;
+			m_h[4][lane] = 0xC3D2E1F0;
+		}
+		bool Load(int lane, message_t msg, size_t block)
+		{
+			uint32_t words[16];
+			auto last = LoadBlockMD(msg, block, words);
+			for (int i = 0; i != 16; ++i)
+				m_w[i][lane] = words[i];
+
+			return last;
+		}
+		void Compress(uint32_t active = ~0U)
+		{
+			auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+
+			uint32_t s[5][Lanes];
+			memcpy(&s[0][0], &m_h[0][0], sizeof(s));
+
+			// The message schedule is a rolling window of 16 words
+			uint32_t w[16][Lanes];
+			memcpy(&w[0][0], &m_w[0][0], sizeof(w));
+
+			// Unrolled so that the row indices are constants, which lets the lane loops vectorise
+			Unroll<80>([&](auto I)
+			{
+				constexpr int i = I;
+				auto& wi = w[i % 16];
+				if constexpr (i >= 16)
+				{
+					for (int l = 0; l != Lanes; ++l)
+						wi[l] = rotl(w[(i + 13) % 16][l] ^ w[(i + 8) % 16][l] ^ w[(i + 2) % 16][l] ^ wi[l], 1);
+				}
+
+				// Rotate the state names instead of moving the values
+				auto& a = s[(80 - i + 0) % 5]; auto& b = s[(80 - i + 1) % 5]; auto& c = s[(80 - i + 2) % 5];
+				auto& d = s[(80 - i + 3) % 5]; auto& e = s[(80 - i + 4) % 5];
+				for (int l = 0; l != Lanes; ++l)
+				{
+					uint32_t f;
+					if constexpr (i < 20) f = ((b[l] & (c[l] ^ d[l])) ^ d[l]) + 0x5A827999;
+					else if constexpr (i < 40) f = (b[l] ^ c[l] ^ d[l]) + 0x6ED9EBA1;
+					else if constexpr (i < 60) f = (((b[l] | c[l]) & d[l]) | (b[l] & c[l])) + 0x8F1BBCDC;
+					else f = (b[l] ^ c[l] ^ d[l]) + 0xCA62C1D6;
+
+					e[l] += rotl(a[l], 5) + f + wi[l];
+					b[l] = rotl(b[l], 30);
+				}
+			});
+
+			for (int i = 0; i != 5; ++i)
+			{
+				for (int l = 0; l != Lanes; ++l)
+					m_h[i][l] += (active >> l) & 1 ? s[i][l] : 0;
+			}
+		}
+		hash_t Digest(int lane) const
+		{
+			hash_t hash;
+			for (int i = 0; i != 20; ++i)
+				hash[i] = static_cast<uint8_t>(m_h[i / 4][lane] >> (24 - 8 * (i % 4)));
+
+			return hash;
+		}
 	};
 
 	// Return the SHA1 hash of the given data
-	inline SHA1::hash_t Sha1Hash(void const* data, int length)
+	inline SHA1::hash_t Sha1Hash(void const* data, size_t length)
 	{
 		SHA1 sha1;
 		sha1.Update(data, length);
@@ -235,10 +389,20 @@ namespace pr::hash
 		for (;file.good();)
 		{
 			auto read = file.read(buf.data(), buf.size()).gcount();
-			sha1.Update(buf.data(), int(read));
+			sha1.Update(buf.data(), static_cast<size_t>(read));
 		}
 		return sha1.Final();
 	}
+
+	// Return the SHA1 hashes of many independent messages.
+	// With SHA-NI, one message at a time per thread is fastest. Otherwise, messages are hashed eight at a time in SIMD lanes.
+	inline void Sha1HashMany(std::span<message_t const> messages, std::span<SHA1::hash_t> hashes)
+	{
+		if (CpuHasShaNi())
+			HashManySerial<SHA1>(messages, hashes);
+		else
+			HashMany<SHA1Lanes<8>>(messages, hashes);
+	}
 }
 
 #if PR_UNITTESTS
@@ -255,6 +419,51 @@ namespace pr::hash
 		auto hash2 = Sha1Hash(str1, sizeof(str1));
 		PR_EXPECT(hash1 != hash2);
 
+		{// Known answers
+			auto hash = Sha1Hash("abc", 3);
+			auto expected = SHA1::hash_t{0xA9,0x99,0x3E,0x36,0x47,0x06,0x81,0x6A,0xBA,0x3E,0x25,0x71,0x78,0x50,0xC2,0x6C,0x9C,0xD0,0xD8,0x9D};
+			PR_EXPECT(hash == expected);
+
+			char const msg[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+			hash = Sha1Hash(msg, sizeof(msg) - 1);
+			expected = SHA1::hash_t{0x84,0x98,0x3E,0x44,0x1C,0x3B,0xD2,0x6E,0xBA,0xAE,0x4A,0xA1,0xF9,0x51,0x29,0xE5,0xE5,0x46,0x70,0xF1};
+			PR_EXPECT(hash == expected);
+
+			std::string a(1000000, 'a');
+			hash = Sha1Hash(a.data(), a.size());
+			expected = SHA1::hash_t{0x34,0xAA,0x97,0x3C,0xD4,0xC4,0xDA,0xA4,0xF6,0x1E,0xEB,0x2B,0xDB,0xAD,0x27,0x31,0x65,0x34,0x01,0x6F};
+			PR_EXPECT(hash == expected);
+		}
+
+		std::vector<uint8_t> data(1500);
+		for (size_t i = 0; i != data.size(); ++i)
+			data[i] = static_cast<uint8_t>(i % 251);
+
+		{// Byte-wise updates
+			SHA1 sha;
+			for (auto b : data)
+				sha.Update(&b, 1);
+
+			auto expected = SHA1::hash_t{0x3A,0xBF,0x99,0xB1,0x30,0xFD,0xA3,0x83,0xC4,0x66,0xC4,0xB5,0x33,0x23,0xFC,0x46,0x58,0x49,0x1E,0xDF};
+			PR_EXPECT(sha.Final() == expected);
+		}
+		{// Multi-buffer hashing matches single message hashing
+			std::vector<message_t> messages;
+			for (size_t i = 0; i != 50; ++i)
+				messages.push_back(message_t(data.data(), (i * 37) % data.size()));
+
+			std::vector<SHA1::hash_t> hashes0(messages.size());
+			std::vector<SHA1::hash_t> hashes1(messages.size());
+			HashMany<SHA1Lanes<8>>(messages, hashes0);
+			Sha1HashMany(messages, hashes1);
+			for (size_t i = 0; i != messages.size(); ++i)
+			{
+				auto hash = Sha1Hash(messages[i].data(), messages[i].size());
+				PR_EXPECT(hashes0[i] == hash);
+				PR_EXPECT(hashes1[i] == hash);
+			}
+		}
+
 		// This hash doesn't seem to produce the same result as the windows context menu one
 		//auto hash3 = Sha1HashFile("P:\\pr\\include\\pr\\crypt\\rijndael.h");
 		//auto hash4 = SHA1::hash_t{0x49,0x74,0x3D,0x87,0xDF,0xC8,0x63,0x83,0x18,0xBE,0x23,0x42,0xB2,0x47,0x06,0xE9,0x16,0x09,0xE9,0x85};
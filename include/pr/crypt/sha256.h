@@ -0,0 +1,409 @@
+﻿//*************************************************************************************************
+// SHA256
+//*************************************************************************************************
+// FIPS 180-4 SHA-256. Uses the SHA extensions (SHA-NI) when the CPU supports them.
+// Also a multi-buffer lane engine for hashing many small messages at once.
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "pr/crypt/hash_many.h"
+
+namespace pr::hash
+{
+	namespace sha256
+	{
+		inline constexpr uint32_t IV[8] =
+		{
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+		};
+		alignas(16) inline constexpr uint32_t K[64] =
+		{
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+		};
+
+		constexpr uint32_t rot(uint32_t x, int c)
+		{
+			return (x >> c) | (x << (32 - c));
+		}
+		constexpr uint32_t ch(uint32_t x, uint32_t y, uint32_t z)
+		{
+			return (x & y) ^ (~x & z);
+		}
+		constexpr uint32_t maj(uint32_t x, uint32_t y, uint32_t z)
+		{
+			return (x & y) ^ (x & z) ^ (y & z);
+		}
+		constexpr uint32_t big_sigma0(uint32_t x)
+		{
+			return rot(x, 2) ^ rot(x, 13) ^ rot(x, 22);
+		}
+		constexpr uint32_t big_sigma1(uint32_t x)
+		{
+			return rot(x, 6) ^ rot(x, 11) ^ rot(x, 25);
+		}
+		constexpr uint32_t lit_sigma0(uint32_t x)
+		{
+			return rot(x, 7) ^ rot(x, 18) ^ (x >> 3);
+		}
+		constexpr uint32_t lit_sigma1(uint32_t x)
+		{
+			return rot(x, 17) ^ rot(x, 19) ^ (x >> 10);
+		}
+	}
+
+	class SHA256
+	{
+		uint32_t m_hash[8];
+		uint8_t  m_input[64];
+		size_t   m_input_idx;
+		uint64_t m_input_size;
+		bool     m_shani;
+
+	public:
+
+		using hash_t = std::array<uint8_t, 32>;
+
+		SHA256()
+			:m_hash()
+			,m_input()
+			,m_input_idx()
+			,m_input_size()
+			,m_shani(CpuHasShaNi())
+		{
+			memcpy(&m_hash[0], &sha256::IV[0], sizeof(m_hash));
+		}
+		~SHA256()
+		{
+			// Reset memory for security reasons
+			auto me = reinterpret_cast<uint8_t volatile*>(this);
+			for (auto size = sizeof(*this); size-- != 0; ++me)
+				*me = 0;
+		}
+
+		// Add data to the hash
+		void Update(void const* data, size_t len)
+		{
+			auto bytes = static_cast<uint8_t const*>(data);
+			m_input_size += len;
+
+			// Complete a partial block
+			if (m_input_idx != 0)
+			{
+				auto n = std::min(len, 64 - m_input_idx);
+				memcpy(&m_input[m_input_idx], bytes, n);
+				m_input_idx += n;
+				bytes += n;
+				len -= n;
+				if (m_input_idx != 64)
+					return;
+
+				Transform(m_hash, &m_input[0], 1, m_shani);
+				m_input_idx = 0;
+			}
+
+			// Whole blocks directly from the input
+			if (len >= 64)
+			{
+				Transform(m_hash, bytes, len / 64, m_shani);
+				bytes += len & ~size_t(63);
+				len &= 63;
+			}
+
+			// Remaining bytes
+			memcpy(&m_input[0], bytes, len);
+			m_input_idx = len;
+		}
+
+		// Finalise hash; call this after all data is added
+		hash_t Final()
+		{
+			auto bits = m_input_size * 8;
+
+			// Padding, plus an extra block if there's no room for the length
+			uint8_t pad[128] = { 0x80 };
+			auto pad_len = (m_input_idx < 56 ? 56 : 120) - m_input_idx;
+			for (int i = 0; i != 8; ++i)
+				pad[pad_len + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+
+			Update(&pad[0], pad_len + 8);
+			return Hash();
+		}
+
+		// Get the hash value
+		hash_t Hash() const
+		{
+			hash_t hash;
+			for (int i = 0; i != 32; ++i)
+				hash[i] = static_cast<uint8_t>(m_hash[i / 4] >> (24 - 8 * (i % 4)));
+
+			return hash;
+		}
+
+		// Compress 'count' 64-byte blocks into 'state'
+		static void Transform(uint32_t (&state)[8], uint8_t const* blocks, size_t count, bool shani)
+		{
+			#if PR_CRYPT_USE_SHANI
+			if (shani)
+				return TransformNI(state, blocks, count);
+			#else
+			(void)shani;
+			#endif
+
+			using namespace sha256;
+			for (; count-- != 0; blocks += 64)
+			{
+				uint32_t w[64];
+				for (int i = 0; i != 16; ++i)
+					w[i] = (uint32_t(blocks[4*i+0]) << 24) | (uint32_t(blocks[4*i+1]) << 16) | (uint32_t(blocks[4*i+2]) << 8) | uint32_t(blocks[4*i+3]);
+				for (int i = 16; i != 64; ++i)
+					w[i] = lit_sigma1(w[i-2]) + w[i-7] + lit_sigma0(w[i-15]) + w[i-16];
+
+				uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+				uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+				for (int i = 0; i != 64; ++i)
+				{
+					auto t1 = h + big_sigma1(e) + ch(e, f, g) + K[i] + w[i];
+					auto t2 = big_sigma0(a) + maj(a, b, c);
+					h = g; g = f; f = e; e = d + t1;
+					d = c; c = b; b = a; a = t1 + t2;
+				}
+				state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+				state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+			}
+		}
+
+	private:
+
+		#if PR_CRYPT_USE_SHANI
+		// SHA-NI compression. Each group of four rounds consumes one message vector and, from the
+		// fourth group on, completes the message schedule for a later group.
+		static void TransformNI(uint32_t (&state)[8], uint8_t const* blocks, size_t count)
+		{
+			auto const mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+			// The instructions use the state as ABEF/CDGH pairs
+			auto tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(&state[0])), 0xB1);
+			auto state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const*>(&state[4])), 0x1B);
+			auto state0 = _mm_alignr_epi8(tmp, state1, 8);
+			state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+			for (; count-- != 0; blocks += 64)
+			{
+				auto abef = state0;
+				auto cdgh = state1;
+
+				__m128i m[4];
+				Unroll<16>([&](auto G)
+				{
+					constexpr int g = G;
+					if constexpr (g < 4)
+						m[g] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(blocks + 16 * g)), mask);
+
+					auto msg = _mm_add_epi32(m[g % 4], _mm_load_si128(reinterpret_cast<__m128i const*>(&sha256::K[4 * g])));
+					state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+					if constexpr (g >= 3 && g <= 14)
+					{
+						auto& next = m[(g + 1) % 4];
+						next = _mm_add_epi32(next, _mm_alignr_epi8(m[g % 4], m[(g + 3) % 4], 4));
+						next = _mm_sha256msg2_epu32(next, m[g % 4]);
+					}
+					state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+					if constexpr (g >= 1 && g <= 12)
+						m[(g + 3) % 4] = _mm_sha256msg1_epu32(m[(g + 3) % 4], m[g % 4]);
+				});
+
+				state0 = _mm_add_epi32(state0, abef);
+				state1 = _mm_add_epi32(state1, cdgh);
+			}
+
+			tmp = _mm_shuffle_epi32(state0, 0x1B);
+			state1 = _mm_shuffle_epi32(state1, 0xB1);
+			state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+			state1 = _mm_alignr_epi8(state1, tmp, 8);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+		}
+		#endif
+	};
+
+	// 'Lanes' independent SHA-256 states compressed in lock-step (for 'HashMany').
+	// Each operation is a loop over the lanes, which compilers turn into SIMD instructions.
+	template <int Lanes>
+	struct SHA256Lanes
+	{
+		using hash_t = SHA256::hash_t;
+		static constexpr int Count = Lanes;
+
+		uint32_t m_h[8][Lanes];
+		uint32_t m_w[16][Lanes];
+
+		void Reset(int lane)
+		{
+			for (int i = 0; i != 8; ++i)
+				m_h[i][lane] = sha256::IV[i];
+		}
+		bool Load(int lane, message_t msg, size_t block)
+		{
+			uint32_t words[16];
+			auto last = LoadBlockMD(msg, block, words);
+			for (int i = 0; i != 16; ++i)
+				m_w[i][lane] = words[i];
+
+			return last;
+		}
+		void Compress(uint32_t active = ~0U)
+		{
+			using namespace sha256;
+
+			uint32_t s[8][Lanes];
+			memcpy(&s[0][0], &m_h[0][0], sizeof(s));
+
+			// The message schedule is a rolling window of 16 words
+			uint32_t w[16][Lanes];
+			memcpy(&w[0][0], &m_w[0][0], sizeof(w));
+
+			// Unrolled so that the row indices are constants, which lets the lane loops vectorise
+			Unroll<64>([&](auto I)
+			{
+				constexpr int i = I;
+				auto& wi = w[i % 16];
+				if constexpr (i >= 16)
+				{
+					for (int l = 0; l != Lanes; ++l)
+						wi[l] += lit_sigma1(w[(i - 2) % 16][l]) + w[(i - 7) % 16][l] + lit_sigma0(w[(i - 15) % 16][l]);
+				}
+
+				// Rotate the state names instead of moving the values
+				auto& a = s[(64 - i + 0) % 8]; auto& b = s[(64 - i + 1) % 8]; auto& c = s[(64 - i + 2) % 8]; auto& d = s[(64 - i + 3) % 8];
+				auto& e = s[(64 - i + 4) % 8]; auto& f = s[(64 - i + 5) % 8]; auto& g = s[(64 - i + 6) % 8]; auto& h = s[(64 - i + 7) % 8];
+				for (int l = 0; l != Lanes; ++l)
+				{
+					auto t1 = h[l] + big_sigma1(e[l]) + ch(e[l], f[l], g[l]) + K[i] + wi[l];
+					auto t2 = big_sigma0(a[l]) + maj(a[l], b[l], c[l]);
+					d[l] += t1;
+					h[l] = t1 + t2;
+				}
+			});
+
+			for (int i = 0; i != 8; ++i)
+			{
+				for (int l = 0; l != Lanes; ++l)
+					m_h[i][l] += (active >> l) & 1 ? s[i][l] : 0;
+			}
+		}
+		hash_t Digest(int lane) const
+		{
+			hash_t hash;
+			for (int i = 0; i != 32; ++i)
+				hash[i] = static_cast<uint8_t>(m_h[i / 4][lane] >> (24 - 8 * (i % 4)));
+
+			return hash;
+		}
+	};
+
+	// Return the SHA256 hash of the given data
+	inline SHA256::hash_t Sha256Hash(void const* data, size_t len)
+	{
+		SHA256 sha;
+		sha.Update(data, len);
+		return sha.Final();
+	}
+
+	// Hash file contents
+	inline SHA256::hash_t Sha256HashFile(std::filesystem::path const& filepath)
+	{
+		SHA256 sha;
+		std::array<char, 4096> buf;
+		std::ifstream file(filepath, std::ios_base::binary);
+		for (;file.good();)
+		{
+			auto read = file.read(buf.data(), buf.size()).gcount();
+			sha.Update(buf.data(), static_cast<size_t>(read));
+		}
+		return sha.Final();
+	}
+
+	// Return the SHA256 hashes of many independent messages.
+	// With SHA-NI, one message at a time per thread is fastest. Otherwise, messages are hashed eight at a time in SIMD lanes.
+	inline void Sha256HashMany(std::span<message_t const> messages, std::span<SHA256::hash_t> hashes)
+	{
+		if (CpuHasShaNi())
+			HashManySerial<SHA256>(messages, hashes);
+		else
+			HashMany<SHA256Lanes<8>>(messages, hashes);
+	}
+}
+
+#if PR_UNITTESTS
+#include "pr/common/unittests.h"
+namespace pr::hash
+{
+	PRUnitTest(Sha256Tests)
+	{
+		using namespace pr::hash;
+
+		{// Known answers
+			auto hash = Sha256Hash("abc", 3);
+			auto expected = SHA256::hash_t{0xBA,0x78,0x16,0xBF,0x8F,0x01,0xCF,0xEA,0x41,0x41,0x40,0xDE,0x5D,0xAE,0x22,0x23,0xB0,0x03,0x61,0xA3,0x96,0x17,0x7A,0x9C,0xB4,0x10,0xFF,0x61,0xF2,0x00,0x15,0xAD};
+			PR_EXPECT(hash == expected);
+
+			hash = Sha256Hash("", 0);
+			expected = SHA256::hash_t{0xE3,0xB0,0xC4,0x42,0x98,0xFC,0x1C,0x14,0x9A,0xFB,0xF4,0xC8,0x99,0x6F,0xB9,0x24,0x27,0xAE,0x41,0xE4,0x64,0x9B,0x93,0x4C,0xA4,0x95,0x99,0x1B,0x78,0x52,0xB8,0x55};
+			PR_EXPECT(hash == expected);
+
+			char const msg[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+			hash = Sha256Hash(msg, sizeof(msg) - 1);
+			expected = SHA256::hash_t{0x24,0x8D,0x6A,0x61,0xD2,0x06,0x38,0xB8,0xE5,0xC0,0x26,0x93,0x0C,0x3E,0x60,0x39,0xA3,0x3C,0xE4,0x59,0x64,0xFF,0x21,0x67,0xF6,0xEC,0xED,0xD4,0x19,0xDB,0x06,0xC1};
+			PR_EXPECT(hash == expected);
+		}
+
+		std::vector<uint8_t> data(1500);
+		for (size_t i = 0; i != data.size(); ++i)
+			data[i] = static_cast<uint8_t>(i % 251);
+
+		{// The scalar and SHA-NI transforms agree, with byte-wise updates
+			uint32_t state0[8], state1[8];
+			memcpy(&state0[0], &sha256::IV[0], sizeof(state0));
+			memcpy(&state1[0], &sha256::IV[0], sizeof(state1));
+			SHA256::Transform(state0, data.data(), data.size() / 64, false);
+			SHA256::Transform(state1, data.data(), data.size() / 64, CpuHasShaNi());
+			PR_EXPECT(memcmp(&state0[0], &state1[0], sizeof(state0)) == 0);
+
+			SHA256 sha;
+			for (auto b : data)
+				sha.Update(&b, 1);
+
+			auto expected = SHA256::hash_t{0x10,0xD0,0x9B,0x10,0x01,0x88,0x05,0xBF,0xA6,0x90,0xE6,0xF7,0x54,0x6F,0x48,0x58,0x25,0x40,0x5B,0xB1,0xAF,0x39,0xBA,0xB7,0x5D,0x2B,0x63,0x6B,0x6E,0xAC,0x58,0xDB};
+			PR_EXPECT(sha.Final() == expected);
+		}
+		{// Multi-buffer hashing matches single message hashing
+			std::vector<message_t> messages;
+			for (size_t i = 0; i != 50; ++i)
+				messages.push_back(message_t(data.data(), (i * 37) % data.size()));
+
+			std::vector<SHA256::hash_t> hashes0(messages.size());
+			std::vector<SHA256::hash_t> hashes1(messages.size());
+			HashMany<SHA256Lanes<8>>(messages, hashes0);
+			Sha256HashMany(messages, hashes1);
+			for (size_t i = 0; i != messages.size(); ++i)
+			{
+				auto hash = Sha256Hash(messages[i].data(), messages[i].size());
+				PR_EXPECT(hashes0[i] == hash);
+				PR_EXPECT(hashes1[i] == hash);
+			}
+		}
+	}
+}
+#endif
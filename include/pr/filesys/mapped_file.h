@@ -0,0 +1,75 @@
+//**********************************************
+// File path/File system operations
+//  Copyright (c) Rylogic Ltd 2025
+//**********************************************
+#pragma once
+#include <span>
+#include <memory>
+#include <cstddef>
+#include <format>
+#include <filesystem>
+#include "pr/win32/win32.h"
+
+namespace pr::filesys
+{
+	// A read-only memory mapped file.
+	// Pages are loaded on demand and are shared with the OS file cache, so mapping a large file
+	// costs no memory until the data is accessed, and untouched parts of the file are never read.
+	// Requires <windows.h> to be included
+	struct MappedFile
+	{
+		struct Unmapper
+		{
+			void operator()(void const* p)
+			{
+				if (p == nullptr) return;
+				::UnmapViewOfFile(p);
+			}
+		};
+
+		win32::Handle m_file;
+		win32::Handle m_map;
+		std::unique_ptr<void const, Unmapper> m_view;
+		size_t m_size;
+
+		explicit MappedFile(std::filesystem::path const& filepath)
+			:m_file()
+			,m_map()
+			,m_view()
+			,m_size()
+		{
+			m_file = win32::FileOpen(filepath, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, FILE_FLAG_RANDOM_ACCESS);
+			if (m_file == INVALID_HANDLE_VALUE)
+				throw std::runtime_error(std::format("Failed to open '{}': {}", filepath.string(), ::GetLastError()));
+
+			LARGE_INTEGER size;
+			if (!::GetFileSizeEx(m_file, &size))
+				throw std::runtime_error(std::format("Failed to read the size of '{}': {}", filepath.string(), ::GetLastError()));
+
+			// Empty files can't be mapped
+			m_size = static_cast<size_t>(size.QuadPart);
+			if (m_size == 0)
+				return;
+
+			m_map = ::CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_map == nullptr)
+				throw std::runtime_error(std::format("Failed to create a file mapping for '{}': {}", filepath.string(), ::GetLastError()));
+
+			m_view.reset(::MapViewOfFile(m_map, FILE_MAP_READ, 0, 0, 0));
+			if (m_view == nullptr)
+				throw std::runtime_error(std::format("Failed to map a view of '{}': {}", filepath.string(), ::GetLastError()));
+		}
+
+		// The size of the file in bytes
+		size_t size() const
+		{
+			return m_size;
+		}
+
+		// The file contents
+		std::span<std::byte const> data() const
+		{
+			return { static_cast<std::byte const*>(m_view.get()), m_view ? m_size : 0 };
+		}
+	};
+}
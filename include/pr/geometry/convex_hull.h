@@ -8,6 +8,7 @@
 #include <vector>
 #include <iterator>
 #include <algorithm>
+#include <execution>
 #include <ranges>
 #include <cassert>
 #include "pr/math/math.h"
@@ -48,339 +49,516 @@ namespace pr::hull
 		c = static_cast<VIndex>(face.vindex(2));
 	}
 
-	// A struct containing the parameters provided to ConvexHull()
-	// Prevents passing lots of variables around between functions
+	// Quickhull state for one call to ConvexHull().
+	// Each hull face owns a linked list of the unclassified verts that are in front of it (its conflict list).
+	// The furthest vert of a face is added to the hull by flood filling the faces that can see it,
+	// replacing them with a fan of faces around the horizon, and reassigning their conflict lists
+	// to the new faces. Neither the visible set nor the horizon has a size limit.
+	// Verts are identified by their position in the vert index container.
 	template <math::VectorTypeN<4> V, std::integral VIdx, typename FaceT>
 	struct HullGenerator
 	{
 		using Vec = V;
 		using VIndex = VIdx;
 		using FaceType = FaceT;
+		using S = typename math::vector_traits<V>::element_t;
 
-		static constexpr int MaxVisFaceCount = 64;
-
-		std::span<V const> m_verts;               // Vertex container
-		VIdx* m_vbeg;                              // Start of the vert index container
-		VIdx* m_vhull_last;                        // One past the last vert index that is on the convex hull
-		VIdx* m_vnon_hull;                         // First vert index that is definitely not on the convex hull
-		VIdx* m_vend;                              // End of the vert index container
-		FaceT* m_fbeg;                             // Start of the face container
-		FaceT* m_flast;                            // One past the last face added to the face container
-		FaceT* m_fend;                             // End of the face container
-		std::vector<V> m_half_spaces;              // Face normals buffer (owned)
-		V* m_hs_beg;                               // Start of the half space buffer
-		V* m_hs_last;                              // Pointer into the half space buffer, equivalent position to flast
-		V* m_hs_end;                               // End of the half space buffer
-		int m_vis_face_count;                      // The number of visible faces
-		int m_vis_face_buf1[MaxVisFaceCount];      // Double buffer for the
-		int m_vis_face_buf2[MaxVisFaceCount];      //  indices of visible faces
-		int* m_visible_face;                       // Pointer to one of the m_vis_face_buf's
+		// Conflict lists with at least this many verts are assigned to the new faces in parallel
+		static constexpr size_t ParallelAssignCount = 1 << 15;
+
+		// Verts are tested against the planes of the candidate faces in blocks of this size
+		static constexpr int AssignBlock = 16;
+
+		struct HFace
+		{
+			int m_v[3];                 // Vert positions, CCW when viewed from outside
+			int m_adj[3];               // Neighbouring face across edge (m_v[i], m_v[(i+1)%3])
+			V m_plane;                  // Outward facing plane of the face
+			int m_outside;              // First vert of the conflict list (linked through 'm_next'), or -1
+			int m_eye;                  // The conflict list vert furthest from the face (or -1)
+			S m_eye_dist;               // The distance of 'm_eye' from the face
+			int m_visit;                // Flood fill stamp
+			bool m_alive;               // False once the face has been removed from the hull
+		};
+		struct HorizonEdge
+		{
+			int m_a, m_b; // The edge, in the winding order of the visible face
+			int m_nbr;    // The face on the far side of the edge that can't see the eye vert
+		};
+
+		std::span<V const> m_verts;        // Vertex container
+		VIdx* m_vbeg;                      // Start of the vert index container
+		VIdx* m_vend;                      // End of the vert index container
+		FaceT* m_fbeg;                     // Start of the face container
+		FaceT* m_fend;                     // End of the face container
+		std::vector<S> m_x, m_y, m_z;      // Vert positions as structure-of-arrays (indexed by vert position)
+		std::vector<int> m_next;           // Conflict list links (indexed by vert position)
+		std::vector<HFace> m_faces;        // Hull faces, including removed ones waiting to be reused
+		std::vector<int> m_free;           // Removed faces
+		std::vector<int> m_pending;        // Faces that may have non-empty conflict lists
+		std::vector<int> m_visible;        // Scratch: faces that can see the eye vert
+		std::vector<int> m_stack;          // Scratch: flood fill stack
+		std::vector<HorizonEdge> m_horizon;// Scratch: edges between visible and non-visible faces
+		std::vector<int> m_new_faces;      // Scratch: faces created around the horizon
+		std::vector<int> m_orphans;        // Scratch: verts from the conflict lists of removed faces
+		std::vector<int> m_owner;          // Scratch: face assigned to each orphan
+		std::vector<S> m_owner_dist;       // Scratch: distance of each orphan from its face
+		std::vector<S> m_planes;           // Scratch: candidate face planes as structure-of-arrays
+		std::vector<int> m_fan;            // Scratch: new face index keyed by the first vert of its horizon edge
+		int m_alive_count;                 // The number of faces currently on the hull
+		int m_visit;                       // Flood fill stamp counter
+		S m_eps;                           // Distance tolerance, scaled to the size of the point cloud
 
 		HullGenerator(std::span<V const> verts, VIdx* vbeg, VIdx* vend, FaceT* fbeg, FaceT* fend)
 			: m_verts(verts)
 			, m_vbeg(vbeg)
-			, m_vhull_last(vbeg)
-			, m_vnon_hull(vend)
 			, m_vend(vend)
 			, m_fbeg(fbeg)
-			, m_flast(fbeg)
 			, m_fend(fend)
-			, m_half_spaces(static_cast<size_t>(fend - fbeg))
-			, m_hs_beg(m_half_spaces.data())
-			, m_hs_last(m_half_spaces.data())
-			, m_hs_end(m_half_spaces.data() + m_half_spaces.size())
-			, m_vis_face_count(0)
-			, m_vis_face_buf1()
-			, m_vis_face_buf2()
-			, m_visible_face(m_vis_face_buf1)
+			, m_x()
+			, m_y()
+			, m_z()
+			, m_next()
+			, m_faces()
+			, m_free()
+			, m_pending()
+			, m_visible()
+			, m_stack()
+			, m_horizon()
+			, m_new_faces()
+			, m_orphans()
+			, m_owner()
+			, m_owner_dist()
+			, m_planes()
+			, m_fan()
+			, m_alive_count()
+			, m_visit()
+			, m_eps()
 		{}
 		HullGenerator(HullGenerator&&) = delete;
 		HullGenerator(HullGenerator const&) = delete;
 		HullGenerator& operator=(HullGenerator&&) = delete;
 		HullGenerator& operator=(HullGenerator const&) = delete;
 
+		// The number of verts in the point cloud
+		int vcount() const
+		{
+			return static_cast<int>(m_vend - m_vbeg);
+		}
+
+		// The maximum number of faces that can be output
+		int fcapacity() const
+		{
+			return static_cast<int>(m_fend - m_fbeg);
+		}
+
 		// Initialise the convex hull by finding a shape with volume from the bounding verts.
 		// This function is set up to return false if any degenerate cases are detected.
 		bool InitHull()
 		{
-			using std::swap;
-
 			// A minimum of 4 verts are needed for a hull with volume
-			if (m_vend - m_vbeg < 4)
+			auto n = vcount();
+			if (n < 4)
 				return false;
 
 			// Check that there is room for the initial 4 faces
-			if (m_fend - m_flast < 4)
+			if (fcapacity() < 4)
 				return false;
 
+			// Copy the verts into structure-of-arrays form for the plane tests
+			m_x.resize(n);
+			m_y.resize(n);
+			m_z.resize(n);
+			m_next.resize(n);
+			S ext[3] = {};
+			for (int i = 0; i != n; ++i)
+			{
+				auto const& vert = m_verts[m_vbeg[i]];
+				m_x[i] = vert.x;
+				m_y[i] = vert.y;
+				m_z[i] = vert.z;
+				ext[0] = Max(ext[0], Abs(m_x[i]));
+				ext[1] = Max(ext[1], Abs(m_y[i]));
+				ext[2] = Max(ext[2], Abs(m_z[i]));
+			}
+
+			// Tolerance for deciding a vert is in front of a face
+			m_eps = 3 * limits<S>::epsilon() * (ext[0] + ext[1] + ext[2]);
+
 			// Scan through and find the min/max verts on the Z axis
-			auto vmin = m_vbeg;
-			auto vmax = m_vbeg;
+			int vmin = 0, vmax = 0;
 			{
-				auto dmin = +limits<float>::max();
-				auto dmax = -limits<float>::max();
-				for (auto i = m_vbeg; i != m_vend; ++i)
+				auto dmin = +limits<S>::max();
+				auto dmax = -limits<S>::max();
+				for (int i = 0; i != n; ++i)
 				{
-					auto d = Dot3(v4::ZAxis(), m_verts[*i]);
+					auto d = m_z[i];
 					if (d < dmin) { dmin = d; vmin = i; }
 					if (d > dmax) { dmax = d; vmax = i; }
 				}
 
 				// If the span is zero then all verts must lie
 				// in a plane parallel to the XY plane.
-				if (dmax - dmin < math::tiny<float>)
+				if (dmax - dmin < math::tiny<S>)
 					return false;
 			}
 
 			// Use these extreme verts as the Z axis
-			auto zaxis = m_verts[*vmax] - m_verts[*vmin];
-
-			// Move these vert indices to the convex hull end of the range.
-			// Ensure vmin is less than vmax, this prevents problems with swapping.
-			if (vmax < vmin) { swap(*vmin, *vmax); swap(vmin, vmax); }
-			swap(*vmin, *m_vhull_last++);
-			swap(*vmax, *m_vhull_last++);
-
-			auto const& zmin = m_verts[*m_vbeg];
+			auto zmin = Pos(vmin);
+			auto zaxis = Pos(vmax) - zmin;
 			auto zaxis_lensq = LengthSq(zaxis);
+			int v0 = vmin, v1 = vmax;
 
 			// Find the most radially distant vertex from the zaxis
+			int v2 = -1;
 			{
-				float dmax = 0.0f;
-				for (auto i = m_vhull_last; i != m_vend; ++i)
+				S dmax = 0;
+				for (int i = 0; i != n; ++i)
 				{
-					auto vert = m_verts[*i] - zmin;
+					auto vert = Pos(i) - zmin;
 					auto d = LengthSq(vert) - Sqr(Dot3(vert, zaxis)) / zaxis_lensq;
-					if (d > dmax) { dmax = d; vmax = i; }
+					if (d > dmax) { dmax = d; v2 = i; }
 				}
 
 				// If all verts lie on the zaxis...
-				if (dmax < math::tiny<float>)
+				if (dmax < math::tiny<S>)
 					return false;
 			}
 
-			// Choose a perpendicular axis
-			auto axis = Cross(zaxis, m_verts[*vmax] - zmin);
-
-			// Move 'vmax' to the convex hull end of the range.
-			swap(*vmax, *m_vhull_last++);
-
+			// Find the vert with the greatest distance from the plane of the first three
+			auto axis = Cross(zaxis, Pos(v2) - zmin);
+			int v3 = -1;
 			bool flip = false;
-
-			// Find the vert with the greatest distance along 'axis'
 			{
-				float dmax = 0.0f;
-				for (auto i = m_vhull_last; i != m_vend; ++i)
+				S dmax = 0;
+				for (int i = 0; i != n; ++i)
 				{
-					auto d = Dot3(axis, m_verts[*i] - zmin);
-					if (Abs(d) > dmax) { dmax = Abs(d); vmax = i; flip = d < 0.0f; }
+					auto d = Dot3(axis, Pos(i) - zmin);
+					if (Abs(d) > dmax) { dmax = Abs(d); v3 = i; flip = d > 0; }
 				}
 
 				// If all verts lie on in the plane...
-				if (dmax < math::tiny<float>)
+				if (dmax < math::tiny<S>)
 					return false;
 			}
 
-			// Move 'vmax' to the convex hull end of the range.
-			swap(*vmax, *m_vhull_last++);
-
 			// Generate the starting shape from the four hull verts we've found.
+			// 'v3' must be behind the face (v0,v1,v2) for the windings below to face outward.
 			if (flip)
+				std::swap(v1, v2);
+
+			AddFace(v0, v1, v2);
+			AddFace(v0, v3, v1);
+			AddFace(v1, v3, v2);
+			AddFace(v2, v3, v0);
+			for (int f = 0; f != 4; ++f)
 			{
-				AddFace(0, 1, 2);
-				AddFace(0, 2, 3);
-				AddFace(0, 3, 1);
-				AddFace(3, 2, 1);
+				for (int e = 0; e != 3; ++e)
+				{
+					auto& face = m_faces[f];
+					for (int g = 0; g != 4; ++g)
+					{
+						auto j = EdgeIndex(m_faces[g], face.m_v[(e + 1) % 3], face.m_v[e]);
+						if (g != f && j != -1) { face.m_adj[e] = g; break; }
+					}
+				}
 			}
-			else
+
+			// Assign all other verts to the initial faces
+			m_orphans.clear();
+			for (int i = 0; i != n; ++i)
 			{
-				AddFace(0, 2, 1);
-				AddFace(0, 3, 2);
-				AddFace(0, 1, 3);
-				AddFace(1, 2, 3);
+				if (i == v0 || i == v1 || i == v2 || i == v3) continue;
+				m_orphans.push_back(i);
 			}
+			int const initial[] = { 0, 1, 2, 3 };
+			AssignOrphans(initial);
 			return true;
 		}
 
-		// Move vert indices that are inside the current hull to the 'non-hull' end of the range.
-		// Records the vertex with the greatest distance from any face in the hull, this must be
-		// a vertex on the convex hull because it is the extreme vertex in the direction of the
-		// face normal. Returns this extreme vert, also caches the indices of the faces that can
-		// see this max vert.
-		VIdx* PartitionVerts()
+		// Add verts to the hull until there are none outside of it.
+		// Returns false if the face container runs out of space first.
+		bool BuildHull()
 		{
-			using std::swap;
-
-			m_vis_face_count = 0;
-			auto max_dist = 0.0f;
-			auto max_vert = m_vnon_hull;
-			for (auto v = m_vhull_last; v != m_vnon_hull;)
+			m_fan.assign(static_cast<size_t>(vcount()), -1);
+			for (; !m_pending.empty();)
 			{
-				// Find the maximum distance of 'v' from the faces of the hull
-				auto dist = 0.0f;
-				int vis_count = 0, face_index = 0;
-				for (auto plane = m_hs_beg; plane != m_hs_last; ++plane, ++face_index)
-				{
-					auto d = Dot(*plane, m_verts[*v]);
-					if (d <= 0.0f)
-						continue; // behind 'plane'
-
-					dist = Max(dist, d);
-					if (vis_count < MaxVisFaceCount)
-						m_visible_face[vis_count] = face_index;
-
-					++vis_count;
-				}
-
-				// If this vert is within all half spaces then it's not a hull vert
-				if (dist == 0.0f)
+				auto f = m_pending.back();
+				auto& face = m_faces[f];
+				if (!face.m_alive || face.m_eye == -1)
 				{
-					swap(*v, *(--m_vnon_hull));
+					m_pending.pop_back();
 					continue;
 				}
-
-				// If this vert has the greatest distance from a face, record it.
-				if (dist > max_dist)
-				{
-					max_dist = dist;
-					max_vert = v;
-					m_vis_face_count = vis_count;
-					SwapVisFaceDblBuffer();
-				}
-				++v;
+				if (!GrowHull(f))
+					return false;
 			}
-			SwapVisFaceDblBuffer();
-			return max_vert;
+			return true;
 		}
 
-		// Expand the convex hull to include 'v'.
-		void GrowHull(VIdx* v)
+		// Expand the convex hull to include the furthest vert in front of face 'f'.
+		// Returns false if there isn't room in the face container for the expanded hull.
+		bool GrowHull(int f)
 		{
-			using std::swap;
-
-			// Move 'v' into the convex hull
-			swap(*v, *m_vhull_last);
-			auto v_idx = static_cast<VIndex>(m_vhull_last - m_vbeg);
-			auto const& vert = m_verts[*m_vhull_last];
-			++m_vhull_last;
-
-			// Allocate memory for the edges remaining when the faces that can
-			// see 'v' are removed. The number of perimeter edges will ultimately be
-			// 2 * vis_face_count, however in the worst case we can receive the faces
-			// in an order that doesn't sharing any edges so allow for 3 edges for each face.
-			int max_edge_count = 3 * m_vis_face_count;
-			std::vector<typename Perimeter::Edge> edge_buf(max_edge_count);
-			Perimeter perimeter(edge_buf.data(), max_edge_count);
-
-			// If the number of visible faces is less than the size of
-			// the visible face cache then we don't need to retest the faces.
-			if (m_vis_face_count <= MaxVisFaceCount)
+			auto eye = m_faces[f].m_eye;
+
+			// Flood fill the faces that can see 'eye', recording the horizon edges
+			++m_visit;
+			m_visible.assign(1, f);
+			m_stack.assign(1, f);
+			m_horizon.clear();
+			m_faces[f].m_visit = m_visit;
+			for (; !m_stack.empty();)
 			{
-				for (auto i = m_visible_face + m_vis_face_count; i-- != m_visible_face; )
+				auto& face = m_faces[m_stack.back()];
+				m_stack.pop_back();
+				for (int e = 0; e != 3; ++e)
 				{
-					auto face = m_fbeg + *i;
-					auto plane = m_hs_beg + *i;
+					auto nbr = face.m_adj[e];
+					auto& nface = m_faces[nbr];
+					if (nface.m_visit == m_visit)
+						continue;
 
-					VIndex a, b, c;
-					GetFace(*face, a, b, c);
+					if (Distance(nface.m_plane, eye) > m_eps)
+					{
+						nface.m_visit = m_visit;
+						m_visible.push_back(nbr);
+						m_stack.push_back(nbr);
+					}
+					else
+					{
+						m_horizon.push_back({ face.m_v[e], face.m_v[(e + 1) % 3], nbr });
+					}
+				}
+			}
 
-					// Add the edges of 'face' to the edge stack
-					perimeter.AddEdge(a, b);
-					perimeter.AddEdge(b, c);
-					perimeter.AddEdge(c, a);
+			// Check there is enough space in the face range to expand the convex hull.
+			auto new_count = m_alive_count - static_cast<int>(m_visible.size()) + static_cast<int>(m_horizon.size());
+			if (new_count > fcapacity())
+				return false;
 
-					// Erase 'face'
-					swap(*face, *(--m_flast));
-					swap(*plane, *(--m_hs_last));
-				}
+			// Remove the visible faces, collecting their conflict lists
+			m_orphans.clear();
+			for (auto v : m_visible)
+			{
+				auto& face = m_faces[v];
+				for (auto i = face.m_outside; i != -1; i = m_next[i])
+					if (i != eye) m_orphans.push_back(i);
+
+				face.m_outside = -1;
+				face.m_eye = -1;
+				face.m_alive = false;
+				m_free.push_back(v);
+				--m_alive_count;
 			}
-			// Otherwise we need to test all faces again for being able to see 'v'
-			else
+
+			// Add a fan of faces from 'eye' to each horizon edge
+			m_new_faces.clear();
+			for (auto const& edge : m_horizon)
+			{
+				auto nf = AddFace(edge.m_a, edge.m_b, eye);
+				m_new_faces.push_back(nf);
+				m_fan[edge.m_a] = nf;
+
+				// Link with the face beyond the horizon
+				auto& nbr = m_faces[edge.m_nbr];
+				nbr.m_adj[EdgeIndex(nbr, edge.m_b, edge.m_a)] = nf;
+				m_faces[nf].m_adj[0] = edge.m_nbr;
+			}
+
+			// Link the fan faces to each other. The edge (b, eye) of one is the edge (eye, b) of the face whose horizon edge starts at 'b'
+			for (auto nf : m_new_faces)
+			{
+				auto& face = m_faces[nf];
+				auto next = m_fan[face.m_v[1]];
+				face.m_adj[1] = next;
+				m_faces[next].m_adj[2] = nf;
+			}
+			for (auto const& edge : m_horizon)
+				m_fan[edge.m_a] = -1;
+
+			// Give the orphaned verts to the new faces
+			AssignOrphans(m_new_faces);
+			return true;
+		}
+
+		// Assign each vert in 'm_orphans' to the face in 'faces' that it is furthest in front of.
+		// Verts that are not in front of any of the faces are inside the hull and are dropped.
+		void AssignOrphans(std::span<int const> faces)
+		{
+			auto count = m_orphans.size();
+			if (count == 0)
+				return;
+
+			// The face planes as structure-of-arrays
+			auto fcount = faces.size();
+			m_planes.resize(4 * fcount);
+			auto px = m_planes.data(), py = px + fcount, pz = py + fcount, pw = pz + fcount;
+			for (size_t j = 0; j != fcount; ++j)
+			{
+				auto const& p = m_faces[faces[j]].m_plane;
+				px[j] = p.x;
+				py[j] = p.y;
+				pz[j] = p.z;
+				pw[j] = p.w;
+			}
+
+			// Find the furthest face for a block of verts. The inner loop is over the verts in the block so that it vectorises.
+			m_owner.resize(count);
+			m_owner_dist.resize(count);
+			auto Classify = [&](size_t beg)
 			{
-				auto plane = m_hs_beg;
-				for (auto face = m_fbeg; !(face == m_flast); )
+				auto n = std::min<size_t>(AssignBlock, count - beg);
+				S x[AssignBlock] = {}, y[AssignBlock] = {}, z[AssignBlock] = {}, best[AssignBlock];
+				int owner[AssignBlock];
+				for (size_t k = 0; k != n; ++k)
 				{
-					// Ignore faces that face away or are edge on to 'v'
-					if (Dot(*plane, vert) <= 0.0f)
+					auto i = m_orphans[beg + k];
+					x[k] = m_x[i];
+					y[k] = m_y[i];
+					z[k] = m_z[i];
+				}
+				for (int k = 0; k != AssignBlock; ++k)
+				{
+					best[k] = m_eps;
+					owner[k] = -1;
+				}
+				for (size_t j = 0; j != fcount; ++j)
+				{
+					for (int k = 0; k != AssignBlock; ++k)
 					{
-						++face;
-						++plane;
-						continue;
+						auto d = px[j] * x[k] + py[j] * y[k] + pz[j] * z[k] + pw[j];
+						owner[k] = d > best[k] ? static_cast<int>(j) : owner[k];
+						best[k] = d > best[k] ? d : best[k];
 					}
+				}
+				for (size_t k = 0; k != n; ++k)
+				{
+					m_owner[beg + k] = owner[k];
+					m_owner_dist[beg + k] = best[k];
+				}
+			};
+
+			if (count >= ParallelAssignCount)
+			{
+				std::vector<size_t> blocks;
+				for (size_t i = 0; i < count; i += AssignBlock)
+					blocks.push_back(i);
+
+				std::for_each(std::execution::par, std::begin(blocks), std::end(blocks), Classify);
+			}
+			else
+			{
+				for (size_t i = 0; i < count; i += AssignBlock)
+					Classify(i);
+			}
 
-					VIndex a, b, c;
-					GetFace(*face, a, b, c);
+			// Add the verts to the conflict lists of their faces
+			for (size_t i = 0; i != count; ++i)
+			{
+				if (m_owner[i] == -1)
+					continue;
 
-					// Add the edges of 'face' to the edge stack
-					perimeter.AddEdge(a, b);
-					perimeter.AddEdge(b, c);
-					perimeter.AddEdge(c, a);
+				auto f = faces[m_owner[i]];
+				auto& face = m_faces[f];
+				if (face.m_outside == -1)
+					m_pending.push_back(f);
+				if (m_owner_dist[i] > face.m_eye_dist)
+				{
+					face.m_eye = m_orphans[i];
+					face.m_eye_dist = m_owner_dist[i];
+				}
+				m_next[m_orphans[i]] = face.m_outside;
+				face.m_outside = m_orphans[i];
+			}
+		}
 
-					// Erase 'face'
-					swap(*face, *(--m_flast));
-					swap(*plane, *(--m_hs_last));
+		// Partition the vert index container with the hull verts first and write the hull faces to the face container
+		void Output(size_t& vert_count, size_t& face_count)
+		{
+			// Map each vert position to its position after partitioning
+			auto n = vcount();
+			std::vector<int> remap(n, -1);
+			std::vector<VIdx> order;
+			order.reserve(n);
+			for (auto const& face : m_faces)
+			{
+				if (!face.m_alive) continue;
+				for (auto v : face.m_v)
+				{
+					if (remap[v] != -1) continue;
+					remap[v] = static_cast<int>(order.size());
+					order.push_back(m_vbeg[v]);
 				}
 			}
+			vert_count = order.size();
+			for (int i = 0; i != n; ++i)
+			{
+				if (remap[i] != -1) continue;
+				order.push_back(m_vbeg[i]);
+			}
+			std::copy(order.begin(), order.end(), m_vbeg);
 
-			// Add faces for each remaining edge
-			for (auto edge = perimeter.m_beg; edge != perimeter.m_last; ++edge)
+			// Faces index the partitioned positions
+			auto out = m_fbeg;
+			for (auto const& face : m_faces)
 			{
-				AddFace(v_idx, edge->m_i0, edge->m_i1);
+				if (!face.m_alive) continue;
+				SetFace(*out++, static_cast<VIndex>(remap[face.m_v[0]]), static_cast<VIndex>(remap[face.m_v[1]]), static_cast<VIndex>(remap[face.m_v[2]]));
 			}
+			face_count = static_cast<size_t>(out - m_fbeg);
 		}
 
-		// Add a face to the face container
-		void AddFace(VIndex a, VIndex b, VIndex c)
+		// The position of vert 'i' (w = 0)
+		V Pos(int i) const
 		{
-			// Set the face in the face container
-			SetFace(*m_flast, a, b, c);
-			++m_flast;
-
-			// Record the half space that this face represents
-			auto& A = m_verts[*(m_vbeg + a)];
-			auto e0 = m_verts[*(m_vbeg + b)] - A;
-			auto e1 = m_verts[*(m_vbeg + c)] - A;
-			auto& plane = *m_hs_last;
-			plane = Normalise(Cross(e0, e1));
-			plane.w = -Dot3(plane, A);
-			++m_hs_last;
+			V pos = {};
+			pos.x = m_x[i];
+			pos.y = m_y[i];
+			pos.z = m_z[i];
+			return pos;
 		}
 
-		// Swap the visible face double buffer
-		void SwapVisFaceDblBuffer()
+		// The signed distance of vert 'i' from 'plane'
+		S Distance(V const& plane, int i) const
 		{
-			m_visible_face = m_visible_face == m_vis_face_buf1 ? m_vis_face_buf2 : m_vis_face_buf1;
+			return plane.x * m_x[i] + plane.y * m_y[i] + plane.z * m_z[i] + plane.w;
 		}
 
-		// A structure used to keep track of the perimeter edges as faces are removed from the hull.
-		struct Perimeter
+		// Add a face to the hull, reusing a removed face if possible. Adjacency is set by the caller.
+		int AddFace(int a, int b, int c)
 		{
-			struct Edge { VIndex m_i0, m_i1; };
-			Edge* m_beg;
-			Edge* m_last;
-			Edge* m_end;
-
-			Perimeter(Edge* buf, int count)
-				: m_beg(buf)
-				, m_last(m_beg)
-				, m_end(m_beg + count)
-			{}
-			void AddEdge(VIndex i0, VIndex i1)
+			// Record the half space that this face represents
+			auto A = Pos(a);
+			auto plane = Normalise(Cross(Pos(b) - A, Pos(c) - A), V{});
+			plane.w = -Dot3(plane, A);
+
+			auto f = static_cast<int>(m_faces.size());
+			if (!m_free.empty())
 			{
-				for (auto e = m_beg; e != m_last; ++e)
-				{
-					if (!(e->m_i0 == i1 && e->m_i1 == i0))
-						continue;
+				f = m_free.back();
+				m_free.pop_back();
+			}
+			else
+			{
+				m_faces.push_back({});
+			}
 
-					// erase 'e'
-					*e = *(--m_last);
-					return;
-				}
-				m_last->m_i0 = i0;
-				m_last->m_i1 = i1;
-				++m_last;
+			m_faces[f] = HFace{ { a, b, c }, { -1, -1, -1 }, plane, -1, -1, S(0), 0, true };
+			++m_alive_count;
+			return f;
+		}
+
+		// Return the index of the edge (a,b) in 'face', or -1
+		static int EdgeIndex(HFace const& face, int a, int b)
+		{
+			for (int e = 0; e != 3; ++e)
+			{
+				if (face.m_v[e] == a && face.m_v[(e + 1) % 3] == b)
+					return e;
 			}
-		};
+			return -1;
+		}
 	};
 
 	// Generate the convex hull of a point cloud.
@@ -418,33 +596,12 @@ namespace pr::hull
 		if (!data.InitHull())
 			return false;
 
-		// Test the unclassified verts and move any that are within the convex hull to
-		// the 'non-hull' end of the range. 'v' is the vert most not in the convex hull.
-		// 'vis_count' is the number of faces of the current hull that can "see" 'v'
-		auto v = data.PartitionVerts();
+		// Add the furthest outside vert of each face until all verts are inside the hull
+		auto complete = data.BuildHull();
 
-		// While there are unclassified verts remaining
-		while (data.m_vhull_last != data.m_vnon_hull)
-		{
-			// Check there is enough space in the face range to expand the convex hull.
-			// Since the hull is convex, the faces that can see 'v' will form one connected
-			// polygon. This means the number of perimeter edges will be 2 + vis_face_count.
-			// Since we're also removing vis_face_count faces, the number of new faces added
-			// will be 2.
-			if (data.m_fend - data.m_flast < 2)
-				break;
-
-			// Expand the convex hull to include 'v'
-			data.GrowHull(v);
-
-			// Test the unclassified verts and move any that are within the convex hull to
-			// the 'non-hull' end of the range. Find a new most not in the convex hull vertex.
-			v = data.PartitionVerts();
-		}
-
-		vert_count = static_cast<size_t>(data.m_vhull_last - data.m_vbeg);
-		face_count = static_cast<size_t>(data.m_flast - data.m_fbeg);
-		return data.m_vhull_last == data.m_vnon_hull;
+		// Partition the vert indices and output the faces
+		data.Output(vert_count, face_count);
+		return complete;
 	}
 	
 	// Overload that reorders the verts in the vertex container.
@@ -505,6 +662,28 @@ namespace pr::hull
 		auto face_end = reinterpret_cast<FaceType*>(face_indices.data() + face_indices.size());
 		return ConvexHull(verts, std::span<FaceType>{face_beg, face_end}, vert_count, face_count);
 	}
+
+	// A point cloud for 'ConvexHulls'
+	template <math::VectorTypeN<4> V, std::integral VIdx>
+	struct HullJob
+	{
+		std::span<V const> m_verts; // Vertex container
+		std::span<VIdx> m_vidx;     // Indices of the point cloud verts. Partitioned with the hull verts first
+		std::span<VIdx> m_faces;    // Output face index triples. Room for 2*(N-2) faces guarantees a complete hull
+		size_t m_vert_count;        // Output: the number of hull verts
+		size_t m_face_count;        // Output: the number of hull faces
+		bool m_result;              // Output: the result of 'ConvexHull'
+	};
+
+	// Generate the convex hulls of many independent point clouds concurrently
+	template <math::VectorTypeN<4> V, std::integral VIdx>
+	void ConvexHulls(std::span<HullJob<V, VIdx>> jobs)
+	{
+		std::for_each(std::execution::par, std::begin(jobs), std::end(jobs), [](HullJob<V, VIdx>& job)
+		{
+			job.m_result = ConvexHull(job.m_verts, job.m_vidx, job.m_faces, job.m_vert_count, job.m_face_count);
+		});
+	}
 }
 
 #if PR_UNITTESTS
@@ -530,6 +709,43 @@ namespace pr::geometry::tests
 				vert_count, face_count);
 		}
 
+		// Check that 'faces' is a closed, outward facing hull containing all of 'pts'
+		static bool IsHull(std::span<v4 const> pts, std::span<int const> indices, std::span<int const> faces, size_t vert_count, size_t face_count)
+		{
+			// Every directed edge has a matching opposite edge
+			std::vector<std::pair<int, int>> edges;
+			for (size_t f = 0; f != face_count; ++f)
+			{
+				for (int e = 0; e != 3; ++e)
+					edges.push_back({ faces[f * 3 + e], faces[f * 3 + (e + 1) % 3] });
+			}
+			std::sort(edges.begin(), edges.end());
+			for (auto [a, b] : edges)
+			{
+				if (!std::binary_search(edges.begin(), edges.end(), std::pair<int, int>{ b, a }))
+					return false;
+			}
+
+			// Euler characteristic of a closed convex polytope
+			if (static_cast<int>(vert_count) - static_cast<int>(edges.size() / 2) + static_cast<int>(face_count) != 2)
+				return false;
+
+			// No point is in front of any face
+			for (size_t f = 0; f != face_count; ++f)
+			{
+				auto a = pts[indices[faces[f * 3 + 0]]];
+				auto b = pts[indices[faces[f * 3 + 1]]];
+				auto c = pts[indices[faces[f * 3 + 2]]];
+				auto n = Normalise(Cross(b - a, c - a));
+				for (auto const& p : pts)
+				{
+					if (Dot3(n, p - a) > 1e-4f)
+						return false;
+				}
+			}
+			return true;
+		}
+
 		// Four points forming a tetrahedron — simplest valid hull
 		PRUnitTestMethod(Tetrahedron)
 		{
@@ -621,6 +837,82 @@ namespace pr::geometry::tests
 			PR_EXPECT(vc == 6);
 			PR_EXPECT(fc == 8); // Octahedron has 8 triangular faces
 		}
+
+		// Random points in a ball, plus a point that can see most of the hull
+		PRUnitTestMethod(RandomBall)
+		{
+			std::default_random_engine rng(1);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			std::vector<v4> pts;
+			for (; pts.size() != 5000;)
+			{
+				auto p = v4{ dist(rng), dist(rng), dist(rng), 1 };
+				if (LengthSq(p.w0()) <= 1.0f) pts.push_back(p);
+			}
+			pts.push_back(v4{ 0, 0, 10, 1 });
+
+			auto count = static_cast<int>(pts.size());
+			std::vector<int> indices(count);
+			for (int i = 0; i != count; ++i) indices[i] = i;
+			std::vector<int> faces(2 * (count - 2) * 3);
+
+			size_t vc = 0, fc = 0;
+			PR_EXPECT(hull::ConvexHull(std::span<v4 const>{pts}, std::span<int>{indices}, std::span<int>{faces}, vc, fc));
+			PR_EXPECT(IsHull(pts, indices, faces, vc, fc));
+		}
+
+		// Many small hulls at once
+		PRUnitTestMethod(Batch)
+		{
+			std::default_random_engine rng(2);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+			constexpr int JobCount = 100, PointCount = 32;
+			std::vector<v4> pts(JobCount * PointCount);
+			for (auto& p : pts) p = v4{ dist(rng), dist(rng), dist(rng), 1 };
+
+			std::vector<int> indices(pts.size());
+			std::vector<int> faces(JobCount * 2 * (PointCount - 2) * 3);
+			std::vector<hull::HullJob<v4, int>> jobs(JobCount);
+			for (int j = 0; j != JobCount; ++j)
+			{
+				for (int i = 0; i != PointCount; ++i) indices[j * PointCount + i] = i;
+				jobs[j].m_verts = std::span<v4 const>{ &pts[j * PointCount], PointCount };
+				jobs[j].m_vidx = std::span<int>{ &indices[j * PointCount], PointCount };
+				jobs[j].m_faces = std::span<int>{ &faces[j * 2 * (PointCount - 2) * 3], 2 * (PointCount - 2) * 3 };
+			}
+
+			hull::ConvexHulls<v4, int>(jobs);
+			for (auto const& job : jobs)
+			{
+				PR_EXPECT(job.m_result);
+				PR_EXPECT(IsHull(job.m_verts, job.m_vidx, job.m_faces, job.m_vert_count, job.m_face_count));
+			}
+		}
+
+		// A face buffer that is too small gives a closed polytope containing some of the points
+		PRUnitTestMethod(FaceBufferTooSmall)
+		{
+			std::default_random_engine rng(3);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			std::vector<v4> pts(1000);
+			for (auto& p : pts) p = Normalise(v4{ dist(rng), dist(rng), dist(rng), 0 }).w1();
+
+			std::vector<int> indices(pts.size());
+			for (int i = 0; i != static_cast<int>(pts.size()); ++i) indices[i] = i;
+			std::vector<int> faces(50 * 3);
+
+			size_t vc = 0, fc = 0;
+			PR_EXPECT(!hull::ConvexHull(std::span<v4 const>{pts}, std::span<int>{indices}, std::span<int>{faces}, vc, fc));
+			PR_EXPECT(vc >= 4 && fc >= 4 && fc <= 50);
+
+			// Closed, with an Euler characteristic of 2
+			std::vector<v4> hull_pts;
+			for (size_t i = 0; i != vc; ++i) hull_pts.push_back(pts[indices[i]]);
+			std::vector<int> hull_idx(vc);
+			for (int i = 0; i != static_cast<int>(vc); ++i) hull_idx[i] = i;
+			PR_EXPECT(IsHull(hull_pts, hull_idx, faces, vc, fc));
+		}
 	};
 }
 #endif
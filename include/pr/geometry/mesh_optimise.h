@@ -0,0 +1,625 @@
+﻿//********************************
+// Mesh Optimisation
+//  Copyright (c) Rylogic Ltd 2025
+//********************************
+#pragma once
+#include <span>
+#include <vector>
+#include <concepts>
+#include <algorithm>
+#include <limits>
+#include <cassert>
+#include "pr/common/cast.h"
+#include "pr/math/math.h"
+#include "pr/geometry/common.h"
+
+namespace pr::geometry
+{
+	// Notes:
+	//  - These functions work on triangle lists. Indices are reordered in place.
+	//  - 'OptimiseVertexCache' reorders faces for post-transform vertex cache locality using 'Tipsify'
+	//    (Sander, Nehab, Barczak 2007). It runs in linear time, which matters for multi-million face meshes.
+	//  - 'OptimiseOverdraw' reorders whole clusters of faces from 'OptimiseVertexCache' so that outward facing
+	//    clusters are drawn first, without much change to the vertex cache efficiency.
+	//  - 'OptimiseVertexFetch' renumbers verts in the order they are first used, so vertex fetches
+	//    walk forward through memory. Use the returned remap to reorder the vertex streams.
+	//  - 'BuildMeshlets' splits a face list into small clusters with bounds and normal cones for cluster culling.
+	//    It should be called after 'OptimiseVertexCache' since it collects faces greedily in index order.
+
+	// Post-transform vertex cache efficiency
+	struct VertexCacheStats
+	{
+		// Average cache miss ratio. Vertex shader invocations per face (0.5 is ideal, 3.0 is worst)
+		double m_acmr;
+
+		// Average transform to vertex ratio. Vertex shader invocations per used vertex (1.0 is ideal)
+		double m_atvr;
+	};
+
+	// A cluster of faces from a triangle list
+	struct Meshlet
+	{
+		// Offset/Count into 'Meshlets::m_verts'
+		int m_vert_offset;
+		int m_vert_count;
+
+		// Offset/Count of faces in 'Meshlets::m_faces' (in units of faces, i.e. 3 local indices per face)
+		int m_face_offset;
+		int m_face_count;
+
+		// Bounding sphere of the meshlet verts
+		BSphere m_bounds;
+
+		// Normal cone. The meshlet is entirely back-facing if: Dot(Normalise(m_cone_apex - eye), m_cone_axis) >= m_cone_cutoff.
+		// 'm_cone_cutoff' is 1 when the face normals are too spread out for the cone to be useful.
+		v4 m_cone_apex;
+		v4 m_cone_axis;
+		float m_cone_cutoff;
+	};
+	struct Meshlets
+	{
+		// The meshlet descriptions
+		std::vector<Meshlet> m_meshlets;
+
+		// Vertex indices (into the source vertex buffer) for each meshlet
+		std::vector<int> m_verts;
+
+		// Faces as meshlet-local vertex indices (3 per face)
+		std::vector<uint8_t> m_faces;
+	};
+
+	// Measure the post-transform vertex cache efficiency of a triangle list using a FIFO cache of 'cache_size' entries
+	template <std::integral VIdx>
+	VertexCacheStats MeasureVertexCache(std::span<VIdx const> indices, int vcount, int cache_size = 16)
+	{
+		assert(indices.size() % 3 == 0 && "Expected a triangle list");
+		if (indices.empty())
+			return VertexCacheStats{ 0, 0 };
+
+		// 'stamp[v]' is the value of 'misses' when 'v' was last added to the cache
+		std::vector<int64_t> stamp(vcount, std::numeric_limits<int64_t>::min() / 2);
+		std::vector<uint8_t> used(vcount, 0);
+		int64_t misses = 0;
+		int unique = 0;
+		for (auto i : indices)
+		{
+			auto v = static_cast<int>(i);
+			unique += used[v] == 0;
+			used[v] = 1;
+
+			// In a FIFO cache, 'v' is present if fewer than 'cache_size' misses have happened since it was added
+			if (misses - stamp[v] < cache_size)
+				continue;
+
+			stamp[v] = misses++;
+		}
+
+		return VertexCacheStats
+		{
+			.m_acmr = double(misses) / double(indices.size() / 3),
+			.m_atvr = double(misses) / double(unique),
+		};
+	}
+
+	// Reorder faces in a triangle list for post-transform vertex cache locality.
+	// 'cache_size' is the target cache size, which is deliberately a bit smaller than typical hardware.
+	template <std::integral VIdx>
+	void OptimiseVertexCache(std::span<VIdx> indices, int vcount, int cache_size = 16)
+	{
+		assert(indices.size() % 3 == 0 && "Expected a triangle list");
+		auto fcount = static_cast<int>(indices.size() / 3);
+		if (fcount == 0)
+			return;
+
+		// Vertex to face adjacency (CSR)
+		std::vector<int> live(vcount, 0);
+		for (auto i : indices)
+			++live[static_cast<int>(i)];
+
+		std::vector<int> adj_ofs(vcount + 1, 0);
+		for (int v = 0; v != vcount; ++v)
+			adj_ofs[v + 1] = adj_ofs[v] + live[v];
+
+		std::vector<int> adj(indices.size());
+		{
+			std::vector<int> fill(adj_ofs.begin(), adj_ofs.end() - 1);
+			for (int f = 0; f != fcount; ++f)
+			{
+				adj[fill[static_cast<int>(indices[3 * f + 0])]++] = f;
+				adj[fill[static_cast<int>(indices[3 * f + 1])]++] = f;
+				adj[fill[static_cast<int>(indices[3 * f + 2])]++] = f;
+			}
+		}
+
+		// Tipsify state
+		std::vector<int> cache_time(vcount, 0);
+		std::vector<uint8_t> emitted(fcount, 0);
+		std::vector<int> dead_end;
+		std::vector<int> candidates;
+		std::vector<VIdx> result;
+		result.reserve(indices.size());
+		dead_end.reserve(indices.size());
+		candidates.reserve(64);
+		auto time = cache_size + 1;
+		auto cursor = 0;
+
+		// Find the next vertex to fan around when the candidates are exhausted
+		auto SkipDeadEnd = [&]
+		{
+			// Recently used verts that still have faces
+			for (; !dead_end.empty();)
+			{
+				auto v = dead_end.back();
+				dead_end.pop_back();
+				if (live[v] > 0)
+					return v;
+			}
+
+			// Otherwise the next vert in input order with faces remaining
+			for (; cursor != vcount; ++cursor)
+			{
+				if (live[cursor] > 0)
+					return cursor;
+			}
+			return -1;
+		};
+
+		// Start with the first used vertex
+		for (auto fan = SkipDeadEnd(); fan != -1;)
+		{
+			candidates.resize(0);
+
+			// Emit all remaining faces around 'fan'
+			for (int a = adj_ofs[fan], aend = adj_ofs[fan + 1]; a != aend; ++a)
+			{
+				auto f = adj[a];
+				if (emitted[f]) continue;
+				emitted[f] = 1;
+
+				for (int k = 0; k != 3; ++k)
+				{
+					auto idx = indices[3 * f + k];
+					auto v = static_cast<int>(idx);
+					result.push_back(idx);
+					dead_end.push_back(v);
+					candidates.push_back(v);
+					--live[v];
+
+					// Cache miss, 'v' gets a new time stamp
+					if (time - cache_time[v] > cache_size)
+						cache_time[v] = time++;
+				}
+			}
+
+			// Choose the candidate that will still be in the cache after its remaining faces are emitted,
+			// preferring the oldest so its faces are emitted before it drops out of the cache.
+			auto best = -1;
+			auto best_priority = -1;
+			for (auto v : candidates)
+			{
+				if (live[v] == 0)
+					continue;
+
+				auto priority = 0;
+				if (time - cache_time[v] + 2 * live[v] <= cache_size)
+					priority = time - cache_time[v];
+				if (priority > best_priority)
+				{
+					best_priority = priority;
+					best = v;
+				}
+			}
+
+			fan = best != -1 ? best : SkipDeadEnd();
+		}
+
+		assert(result.size() == indices.size());
+		std::copy(result.begin(), result.end(), indices.begin());
+	}
+
+	// Reorder clusters of faces to reduce overdraw, without undoing the work of 'OptimiseVertexCache'.
+	// Clusters start wherever a face misses the vertex cache for all three verts (i.e. where the cache order restarts).
+	// Clusters are sorted so that those facing out from the mesh centre are drawn first since they tend to occlude the rest.
+	template <std::integral VIdx, GetVertFn TGetV>
+	void OptimiseOverdraw(std::span<VIdx> indices, int vcount, TGetV getv, int cache_size = 16)
+	{
+		assert(indices.size() % 3 == 0 && "Expected a triangle list");
+		auto fcount = static_cast<int>(indices.size() / 3);
+		if (fcount == 0)
+			return;
+
+		// Find the cluster boundaries by simulating a FIFO cache
+		std::vector<int> cluster_start;
+		std::vector<int64_t> stamp(vcount, std::numeric_limits<int64_t>::min() / 2);
+		int64_t misses = 0;
+		for (int f = 0; f != fcount; ++f)
+		{
+			auto face_misses = 0;
+			for (int k = 0; k != 3; ++k)
+			{
+				auto v = static_cast<int>(indices[3 * f + k]);
+				if (misses - stamp[v] < cache_size) continue;
+				stamp[v] = misses++;
+				++face_misses;
+			}
+			if (face_misses == 3 || f == 0)
+				cluster_start.push_back(f);
+		}
+		cluster_start.push_back(fcount);
+		auto ccount = static_cast<int>(cluster_start.size()) - 1;
+		if (ccount == 1)
+			return;
+
+		// Area weighted centroid and normal for each cluster, and the mesh centroid
+		struct Cluster { v4 m_centroid; v4 m_normal; float m_area; float m_sort; int m_index; };
+		std::vector<Cluster> clusters(ccount);
+		auto mesh_centroid = v4::Zero();
+		auto mesh_area = 0.0f;
+		for (int c = 0; c != ccount; ++c)
+		{
+			auto& cluster = clusters[c];
+			cluster = Cluster{ v4::Zero(), v4::Zero(), 0.0f, 0.0f, c };
+			for (int f = cluster_start[c]; f != cluster_start[c + 1]; ++f)
+			{
+				auto p0 = getv(static_cast<int>(indices[3 * f + 0]));
+				auto p1 = getv(static_cast<int>(indices[3 * f + 1]));
+				auto p2 = getv(static_cast<int>(indices[3 * f + 2]));
+				auto n = Cross(p1 - p0, p2 - p0);
+				auto area = Length(n);
+				cluster.m_centroid += (p0 + p1 + p2).w0() * area;
+				cluster.m_normal += n;
+				cluster.m_area += area;
+			}
+			mesh_centroid += cluster.m_centroid;
+			mesh_area += cluster.m_area;
+			if (cluster.m_area > 0)
+				cluster.m_centroid /= 3.0f * cluster.m_area;
+		}
+		if (mesh_area > 0)
+			mesh_centroid /= 3.0f * mesh_area;
+
+		// Sort the clusters by how much they face outward from the mesh centre
+		for (auto& cluster : clusters)
+		{
+			auto len = Length(cluster.m_normal);
+			cluster.m_sort = len > math::tiny<float> ? Dot(cluster.m_centroid - mesh_centroid, cluster.m_normal / len) : 0.0f;
+		}
+		std::stable_sort(clusters.begin(), clusters.end(), [](Cluster const& lhs, Cluster const& rhs) { return lhs.m_sort > rhs.m_sort; });
+
+		// Write the faces in cluster order
+		std::vector<VIdx> result;
+		result.reserve(indices.size());
+		for (auto& cluster : clusters)
+		{
+			auto b = indices.begin() + 3 * cluster_start[cluster.m_index + 0];
+			auto e = indices.begin() + 3 * cluster_start[cluster.m_index + 1];
+			result.insert(result.end(), b, e);
+		}
+		std::copy(result.begin(), result.end(), indices.begin());
+	}
+
+	// Renumber verts in the order that they are first referenced by 'indices'.
+	// 'remap[old] = new' on return, or -1 for verts that are not referenced. Returns the number of referenced verts.
+	// For verts shared by several index buffers, pass the same 'remap' and the previously returned count to each call.
+	template <std::integral VIdx>
+	int OptimiseVertexFetch(std::span<VIdx> indices, int vcount, std::vector<int>& remap, int next = 0)
+	{
+		if (next == 0)
+			remap.assign(vcount, -1);
+
+		assert(isize(remap) == vcount && "'remap' should be from a previous call");
+		for (auto& i : indices)
+		{
+			auto& r = remap[static_cast<int>(i)];
+			if (r == -1) r = next++;
+			i = static_cast<VIdx>(r);
+		}
+		return next;
+	}
+
+	// Reorder a vertex stream using a remap from 'OptimiseVertexFetch'. Unreferenced elements are dropped.
+	template <typename T>
+	std::vector<T> RemapVertexStream(std::span<T const> stream, std::span<int const> remap, int new_vcount)
+	{
+		assert(stream.size() == remap.size());
+
+		std::vector<T> result(new_vcount);
+		for (int i = 0, iend = static_cast<int>(remap.size()); i != iend; ++i)
+		{
+			if (remap[i] == -1) continue;
+			result[remap[i]] = stream[i];
+		}
+		return result;
+	}
+
+	// Split a triangle list into meshlets of at most 'max_verts' unique verts and 'max_faces' faces.
+	// 'getv(i)' returns the position of vertex 'i'.
+	template <std::integral VIdx, GetVertFn TGetV>
+	Meshlets BuildMeshlets(std::span<VIdx const> indices, int vcount, TGetV getv, int max_verts = 64, int max_faces = 124)
+	{
+		assert(indices.size() % 3 == 0 && "Expected a triangle list");
+		if (max_verts < 3 || max_verts > 256 || max_faces < 1)
+			throw std::runtime_error("Meshlet limits must allow at least one face and local indices must fit in a byte");
+
+		Meshlets out;
+		out.m_meshlets.reserve(indices.size() / 3 / max_faces + 1);
+		out.m_verts.reserve(indices.size() / 3);
+		out.m_faces.reserve(indices.size());
+
+		// Meshlet local index for each vertex in the current meshlet (0xFF = not in the meshlet)
+		std::vector<uint8_t> local(vcount, 0xFF);
+
+		// Add the bounds and normal cone to the last meshlet, and reset 'local'
+		auto Finish = [&](Meshlet& m)
+		{
+			auto verts = std::span<int const>{ out.m_verts }.subspan(m.m_vert_offset, m.m_vert_count);
+			auto faces = std::span<uint8_t const>{ out.m_faces }.subspan(3 * m.m_face_offset, 3 * m.m_face_count);
+			for (auto v : verts)
+				local[v] = 0xFF;
+
+			// Bounds
+			auto bbox = BBox::Reset();
+			for (auto v : verts)
+				Grow(bbox, getv(v));
+
+			auto centre = bbox.Centre();
+			auto radius_sq = 0.0f;
+			for (auto v : verts)
+				radius_sq = std::max(radius_sq, LengthSq(getv(v) - centre));
+			m.m_bounds = BSphere(centre, Sqrt(radius_sq));
+
+			// Normal cone axis from the average face normal
+			std::vector<v4> norms; norms.reserve(m.m_face_count);
+			auto axis = v4::Zero();
+			for (int f = 0; f != m.m_face_count; ++f)
+			{
+				auto p0 = getv(verts[faces[3 * f + 0]]);
+				auto p1 = getv(verts[faces[3 * f + 1]]);
+				auto p2 = getv(verts[faces[3 * f + 2]]);
+				auto n = Cross(p1 - p0, p2 - p0);
+				auto len = Length(n);
+				if (len < math::tiny<float>) continue; // degenerate
+				n /= len;
+				norms.push_back(n);
+				axis += n;
+			}
+
+			// Default to a cone that never culls
+			m.m_cone_apex = centre;
+			m.m_cone_axis = v4::ZAxis();
+			m.m_cone_cutoff = 1.0f;
+			if (norms.empty() || Length(axis) < math::tiny<float>)
+				return;
+
+			axis = Normalise(axis);
+			auto min_dp = 1.0f;
+			for (auto& n : norms)
+				min_dp = std::min(min_dp, Dot(n, axis));
+
+			// Normals spread over more than ~85 degrees give a cone too wide to be useful
+			if (min_dp <= 0.1f)
+				return;
+
+			// Move the apex back along the axis so that the cone contains all face planes.
+			// 'maxt' is the distance along -axis to the furthest face plane intersection.
+			auto maxt = 0.0f;
+			for (int f = 0, n = 0; f != m.m_face_count; ++f)
+			{
+				auto p0 = getv(verts[faces[3 * f + 0]]);
+				auto p1 = getv(verts[faces[3 * f + 1]]);
+				auto p2 = getv(verts[faces[3 * f + 2]]);
+				if (Length(Cross(p1 - p0, p2 - p0)) < math::tiny<float>) continue;
+				auto& norm = norms[n++];
+				auto t = Dot(centre - p0, norm) / Dot(axis, norm);
+				maxt = std::max(maxt, t);
+			}
+
+			m.m_cone_apex = (centre - axis * maxt).w1();
+			m.m_cone_axis = axis;
+			m.m_cone_cutoff = Sqrt(1.0f - min_dp * min_dp);
+		};
+
+		Meshlet current = {};
+		for (size_t i = 0, iend = indices.size(); i != iend; i += 3)
+		{
+			int vidx[3] = {
+				static_cast<int>(indices[i + 0]),
+				static_cast<int>(indices[i + 1]),
+				static_cast<int>(indices[i + 2]),
+			};
+
+			// The number of verts this face would add
+			auto new_verts =
+				(local[vidx[0]] == 0xFF) +
+				(local[vidx[1]] == 0xFF && vidx[1] != vidx[0]) +
+				(local[vidx[2]] == 0xFF && vidx[2] != vidx[0] && vidx[2] != vidx[1]);
+
+			// Start a new meshlet if this face doesn't fit
+			if (current.m_vert_count + new_verts > max_verts || current.m_face_count == max_faces)
+			{
+				Finish(current);
+				out.m_meshlets.push_back(current);
+				current = Meshlet{ .m_vert_offset = isize(out.m_verts), .m_face_offset = isize(out.m_faces) / 3 };
+			}
+
+			// Add the face
+			for (auto v : vidx)
+			{
+				if (local[v] == 0xFF)
+				{
+					local[v] = static_cast<uint8_t>(current.m_vert_count++);
+					out.m_verts.push_back(v);
+				}
+				out.m_faces.push_back(local[v]);
+			}
+			++current.m_face_count;
+		}
+		if (current.m_face_count != 0)
+		{
+			Finish(current);
+			out.m_meshlets.push_back(current);
+		}
+		return out;
+	}
+}
+
+#if PR_UNITTESTS
+#include <array>
+#include <random>
+#include "pr/common/unittests.h"
+namespace pr::geometry::tests
+{
+	PRUnitTestClass(MeshOptimiseTests)
+	{
+		// A grid of 'n x n' quads with the faces in a shuffled order
+		static std::vector<int> ShuffledGrid(int n, std::vector<v4>& verts)
+		{
+			verts.resize(0);
+			for (int y = 0; y <= n; ++y)
+				for (int x = 0; x <= n; ++x)
+					verts.push_back(v4(float(x), float(y), 0, 1));
+
+			std::vector<std::array<int, 3>> faces;
+			for (int y = 0; y != n; ++y)
+			{
+				for (int x = 0; x != n; ++x)
+				{
+					auto i = y * (n + 1) + x;
+					faces.push_back({ i, i + 1, i + n + 2 });
+					faces.push_back({ i, i + n + 2, i + n + 1 });
+				}
+			}
+			std::default_random_engine rng(1);
+			std::shuffle(faces.begin(), faces.end(), rng);
+
+			std::vector<int> indices;
+			for (auto& f : faces)
+				indices.insert(indices.end(), f.begin(), f.end());
+			return indices;
+		}
+
+		// Sorted faces, with each face rotated so its smallest index is first
+		static std::vector<std::array<int, 3>> Canonical(std::span<int const> indices)
+		{
+			std::vector<std::array<int, 3>> faces;
+			for (size_t i = 0; i != indices.size(); i += 3)
+			{
+				std::array<int, 3> f = { indices[i], indices[i + 1], indices[i + 2] };
+				std::rotate(f.begin(), std::min_element(f.begin(), f.end()), f.end());
+				faces.push_back(f);
+			}
+			std::sort(faces.begin(), faces.end());
+			return faces;
+		}
+
+		PRUnitTestMethod(VertexCache)
+		{
+			std::vector<v4> verts;
+			auto indices = ShuffledGrid(50, verts);
+			auto vcount = isize(verts);
+
+			auto before = MeasureVertexCache<int>(indices, vcount);
+			auto faces = Canonical(indices);
+
+			OptimiseVertexCache<int>(indices, vcount);
+			auto after = MeasureVertexCache<int>(indices, vcount);
+
+			// Same faces (with the same winding), better cache use
+			PR_EXPECT(Canonical(indices) == faces);
+			PR_EXPECT(after.m_acmr < before.m_acmr);
+			PR_EXPECT(after.m_acmr < 0.8);
+			PR_EXPECT(after.m_atvr < 1.6);
+		}
+		PRUnitTestMethod(Overdraw)
+		{
+			// A cube of grids so that clusters face in different directions
+			std::vector<v4> verts;
+			auto grid = ShuffledGrid(20, verts);
+			auto vcount = isize(verts);
+			std::vector<v4> cube;
+			std::vector<int> indices;
+			for (int side = 0; side != 3; ++side)
+			{
+				auto base = isize(cube);
+				for (auto& v : verts)
+				{
+					// Grid points are in [0,20]. Map them to three faces of a cube centred on the origin
+					auto x = v.x - 10.0f, y = v.y - 10.0f;
+					cube.push_back(
+						side == 0 ? v4(x, y, 10.0f, 1.0f) :
+						side == 1 ? v4(10.0f, x, y, 1.0f) :
+						            v4(y, 10.0f, x, 1.0f));
+				}
+				for (auto i : grid)
+					indices.push_back(base + i);
+			}
+			vcount = isize(cube);
+
+			OptimiseVertexCache<int>(indices, vcount);
+			auto before = MeasureVertexCache<int>(indices, vcount);
+			auto faces = Canonical(indices);
+
+			OptimiseOverdraw<int>(indices, vcount, [&](int i) { return cube[i]; });
+			auto after = MeasureVertexCache<int>(indices, vcount);
+
+			// Same faces, with little change in the cache efficiency
+			PR_EXPECT(Canonical(indices) == faces);
+			PR_EXPECT(after.m_acmr < before.m_acmr * 1.05);
+		}
+		PRUnitTestMethod(VertexFetch)
+		{
+			std::vector<v4> verts;
+			auto indices = ShuffledGrid(20, verts);
+			auto orig = indices;
+
+			std::vector<int> remap;
+			auto vcount = OptimiseVertexFetch<int>(indices, isize(verts), remap);
+			auto new_verts = RemapVertexStream<v4>(verts, remap, vcount);
+			PR_EXPECT(vcount == isize(verts));
+
+			// Verts are first used in increasing order and the faces reference the same positions
+			auto next = 0;
+			for (size_t i = 0; i != indices.size(); ++i)
+			{
+				PR_EXPECT(indices[i] <= next);
+				if (indices[i] == next) ++next;
+				PR_EXPECT(new_verts[indices[i]] == verts[orig[i]]);
+			}
+		}
+		PRUnitTestMethod(MeshletLimits)
+		{
+			std::vector<v4> verts;
+			auto indices = ShuffledGrid(40, verts);
+			OptimiseVertexCache<int>(indices, isize(verts));
+
+			auto ml = BuildMeshlets<int>(indices, isize(verts), [&](int i) { return verts[i]; });
+
+			auto face_count = 0;
+			for (auto& m : ml.m_meshlets)
+			{
+				PR_EXPECT(m.m_vert_count <= 64);
+				PR_EXPECT(m.m_face_count <= 124);
+				face_count += m.m_face_count;
+
+				// Faces map back to the original indices, and verts are within the bounds
+				for (int f = 0; f != m.m_face_count; ++f)
+				{
+					for (int k = 0; k != 3; ++k)
+					{
+						auto local = ml.m_faces[3 * (m.m_face_offset + f) + k];
+						PR_EXPECT(local < m.m_vert_count);
+						auto v = ml.m_verts[m.m_vert_offset + local];
+						PR_EXPECT(v == indices[3 * (m.m_face_offset + f) + k]);
+						PR_EXPECT(Length(verts[v] - m.m_bounds.Centre()) <= m.m_bounds.Radius() + 0.001f);
+					}
+				}
+
+				// The grid is flat, facing +Z, so the cone is tight
+				PR_EXPECT(FEql(m.m_cone_axis, v4::ZAxis()));
+				PR_EXPECT(m.m_cone_cutoff < 0.01f);
+			}
+			PR_EXPECT(face_count == isize(indices) / 3);
+		}
+	};
+}
+#endif
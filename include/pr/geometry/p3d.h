@@ -75,6 +75,8 @@ namespace pr::geometry::p3d
 		x(MeshName              ,= 0x00003101)/*       │  ├─ Name (cstr)                                                                         */\
 		x(MeshBBox              ,= 0x00003102)/*       │  ├─ Bounding box (BBox)                                                                 */\
 		x(MeshTransform         ,= 0x00003103)/*       │  ├─ Mesh to Parent Transform (m4x4)                                                     */\
+		x(MeshLodError          ,= 0x00003104)/*       │  ├─ LOD error (f32, object space distance from the full detail surface)                 */\
+		x(MeshLod               ,= 0x00003200)/*       │  ├─ Reduced detail version of the mesh (same layout as Mesh, finest first)              */\
 		x(MeshVerts             ,= 0x00003300)/*       │  ├─ Vertex positions (u32 count, u16 format, u16 stride, count * [stride])              */\
 		x(MeshNorms             ,= 0x00003310)/*       │  ├─ Vertex normals   (u32 count, u16 format, u16 stride, count * [stride])              */\
 		x(MeshColours           ,= 0x00003320)/*       │  ├─ Vertex colours   (u32 count, u16 format, u16 stride, count * [stride])              */\
@@ -590,6 +592,13 @@ namespace pr::geometry::p3d
 		// Child meshes
 		MeshCont m_children;
 
+		// Reduced detail versions of this mesh, in order of increasing 'm_lod_error'.
+		MeshCont m_lods;
+
+		// The object space error of this mesh compared to the full detail mesh (0 for the full detail mesh).
+		// Use 'ScreenSpaceError' to choose a LOD for a given view.
+		float m_lod_error;
+
 		// Construct
 		explicit Mesh(std::string_view name = {})
 			:m_name(name)
@@ -600,6 +609,9 @@ namespace pr::geometry::p3d
 			,m_nugget()
 			,m_bbox(BBox::Reset())
 			,m_o2p(m4x4::Identity())
+			,m_children()
+			,m_lods()
+			,m_lod_error()
 		{}
 
 		// The length of the vertex buffer
@@ -712,6 +724,12 @@ namespace pr::geometry::p3d
 			,m_scene()
 		{}
 	};
+
+	// The size in pixels of the object space error 'lod_error' viewed at 'distance' with a vertical field of view of 'fovY'
+	inline float ScreenSpaceError(float lod_error, float distance, float fovY, float screen_height)
+	{
+		return lod_error * screen_height / (2.0f * std::max(distance, math::tiny<float>) * std::tan(0.5f * fovY));
+	}
 	#pragma endregion
 
 	#pragma region Stream traits
@@ -1176,6 +1194,18 @@ namespace pr::geometry::p3d
 		return hdr.m_length;
 	}
 
+	// Write the LOD error of a mesh to 'out'
+	template <typename TOut> uint32_t WriteMeshLodError(TOut& out, float lod_error)
+	{
+		if (lod_error == 0)
+			return 0;
+
+		ChunkHeader hdr(EChunkId::MeshLodError, sizeof(float));
+		Write<ChunkHeader>(out, hdr);
+		Write<float>(out, lod_error);
+		return hdr.m_length;
+	}
+
 	// Write a mesh to parent transform to 'out'
 	template <typename TOut> uint32_t WriteMeshTransform(TOut& out, m4x4 const& o2p)
 	{
@@ -1599,13 +1629,13 @@ namespace pr::geometry::p3d
 		return hdr.m_length;
 	}
 
-	// Write a mesh to 'out'
-	template <typename TOut> uint32_t WriteMesh(TOut& out, Mesh const& mesh, EFlags flags)
+	// Write a mesh to 'out'. LODs are written as meshes with the 'MeshLod' chunk id
+	template <typename TOut> uint32_t WriteMesh(TOut& out, Mesh const& mesh, EFlags flags, EChunkId chunk_id = EChunkId::Mesh)
 	{
 		auto offset = traits<TOut>::tellp(out);
 
 		// Mesh chunk header
-		ChunkHeader hdr(EChunkId::Mesh, 0U);
+		ChunkHeader hdr(chunk_id, 0U);
 		Write<ChunkHeader>(out, hdr);
 
 		// Mesh name
@@ -1633,6 +1663,13 @@ namespace pr::geometry::p3d
 		for (auto const& nugget : mesh.m_nugget)
 			hdr.m_length += WriteNugget(out, nugget, flags);
 
+		// LOD error
+		hdr.m_length += WriteMeshLodError(out, mesh.m_lod_error);
+
+		// Reduced detail versions
+		for (auto const& lod : mesh.m_lods)
+			hdr.m_length += WriteMesh(out, lod, flags, EChunkId::MeshLod);
+
 		UpdateHeader(out, offset, hdr);
 		return hdr.m_length;
 	}
@@ -2015,6 +2052,32 @@ namespace pr::geometry::p3d
 		return cont;
 	}
 
+	// Decode ZigZag delta encoded variable length indices in the range ['p', 'pend').
+	// Note, the data can contain padding, so decoding stops once 'count' indices are read.
+	// 'out' is called with each index value. Returns the number of indices decoded.
+	template <typename TOut> size_t DecodeIdxNBit(uint8_t const* p, uint8_t const* pend, size_t count, TOut out)
+	{
+		size_t i = 0;
+		int64_t prev = 0;
+		for (; i != count && p != pend; ++i, ++p)
+		{
+			int s = 0;
+			uint64_t zz = 0;
+			for (; p != pend && (*p & 0x80); ++p, s += 7)
+				zz |= static_cast<uint64_t>(*p & 0x7F) << s;
+			if (p != pend)
+				zz |= static_cast<uint64_t>(*p & 0x7F) << s;
+
+			// ZigZag decode
+			auto delta = static_cast<int64_t>((zz & 1) ? (zz >> 1) ^ -1 : (zz >> 1));
+
+			// Get the index value from the delta (only works for little endian!)
+			prev += delta;
+			out(prev);
+		}
+		return i;
+	}
+
 	// Fill a container of indices. 'src' is assumed to point to the start of EChunkId::Mesh?Idx chunk data
 	template <typename TSrc> IdxBuf ReadIndices(TSrc& src, uint32_t len)
 	{
@@ -2069,28 +2132,8 @@ namespace pr::geometry::p3d
 				Read(src, buf.data(), buf.size());
 
 				// Decompress from 'buf' into 'cont'
-				// Note, that 'buf' contains padding, so the loop needs to stop when 'count' indices are read.
-				int64_t prev = 0;
 				auto const* p = buf.data<uint8_t>();
-				auto const* pend = p + buf.size<uint8_t>();
-				for (int i = 0; i != s_cast<int>(count) && p != pend; ++i, ++p)
-				{
-					int s = 0;
-					uint64_t zz = 0;
-					for (; p != pend && (*p & 0x80); ++p, s += 7)
-						zz |= static_cast<uint64_t>(*p & 0x7F) << s;
-					if (p != pend)
-						zz |= static_cast<uint64_t>(*p & 0x7F) << s;
-
-					// ZigZag decode
-					auto delta = static_cast<int64_t>((zz & 1) ? (zz >> 1) ^ -1 : (zz >> 1));
-
-					// Get the index value from the delta (only works for little endian!)
-					auto idx = prev + delta;
-					cont.push_back(idx);
-
-					prev += delta;
-				}
+				DecodeIdxNBit(p, p + buf.size<uint8_t>(), count, [&](int64_t idx) { cont.push_back(idx); });
 
 				// Integrity check
 				if (cont.size() != count)
@@ -2198,6 +2241,17 @@ namespace pr::geometry::p3d
 					mesh.m_children.emplace_back(std::move(child));
 					break;
 				}
+				case EChunkId::MeshLodError:
+				{
+					mesh.m_lod_error = Read<float>(src);
+					break;
+				}
+				case EChunkId::MeshLod:
+				{
+					auto lod = ReadMesh(src, hdr.payload());
+					mesh.m_lods.emplace_back(std::move(lod));
+					break;
+				}
 			}
 			return false;
 		});
@@ -2601,6 +2655,11 @@ namespace pr::geometry
 			nug.m_vidx.append<uint16_t>({ 0, 1, 2 });
 			mesh.m_nugget.emplace_back(std::move(nug));
 
+			p3d::Mesh lod = mesh;
+			lod.m_name = "tri_lod1";
+			lod.m_lod_error = 0.25f;
+			mesh.m_lods.push_back(lod);
+
 			file.m_version = Version;
 			file.m_scene.m_materials.push_back(mat);
 			file.m_scene.m_meshes.push_back(mesh);
@@ -2660,6 +2719,17 @@ namespace pr::geometry
 				PR_EXPECT(m0.m_norm.size() == m1.m_norm.size());
 				PR_EXPECT(m0.m_tex0.size() == m1.m_tex0.size());
 				PR_EXPECT(m0.m_nugget.size() == m1.m_nugget.size());
+				PR_EXPECT(m0.m_lod_error == m1.m_lod_error);
+				PR_EXPECT(m0.m_lods.size() == m1.m_lods.size());
+				for (int j = 0; j != (int)m1.m_lods.size(); ++j)
+				{
+					auto& l0 = m0.m_lods[j];
+					auto& l1 = m1.m_lods[j];
+					PR_EXPECT(l0.m_name == l1.m_name);
+					PR_EXPECT(l0.m_lod_error == l1.m_lod_error);
+					PR_EXPECT(l0.m_vert.size() == l1.m_vert.size());
+					PR_EXPECT(l0.icount() == l1.icount());
+				}
 				for (int j = 0; j != (int)m1.m_vert.size(); ++j)
 				{
 					auto& v0 = m0.m_vert[j];
@@ -0,0 +1,726 @@
+﻿//********************************
+// PR3D Model file format
+//  Copyright (c) Rylogic Ltd 2025
+//********************************
+// Read-only views of p3d data in memory
+#pragma once
+#include <span>
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <execution>
+#include <string_view>
+#include "pr/geometry/p3d.h"
+
+namespace pr::geometry::p3d
+{
+	// Notes:
+	//  - 'FileView' interprets p3d data that is already in memory, typically a memory mapped file (see 'pr/filesys/mapped_file.h').
+	//    Construction only walks the chunk headers down to the meshes. Everything else is resolved when asked for, so getting
+	//    the bounding box or one LOD of one mesh only touches the pages containing that data.
+	//  - Streams stored in their in-memory format (32-bit positions/normals/UVs, colours, 8/16/32-bit indices) can be accessed
+	//    directly as spans over the file data. Compressed streams (16-bit, packed normals, variable length indices) are decoded
+	//    into caller provided buffers, optionally a sub-range at a time.
+	//  - Views don't own the data, it must outlive the views. Views are immutable so independent meshes can be decoded in parallel.
+
+	using bytes_t = std::span<std::byte const>;
+
+	// A stream-like source over a span of bytes, so that the stream based 'Read' functions can be used on views
+	struct SpanSrc
+	{
+		std::byte const* m_beg;
+		std::byte const* m_ptr;
+		std::byte const* m_end;
+
+		explicit SpanSrc(bytes_t data)
+			:m_beg(data.data())
+			,m_ptr(data.data())
+			,m_end(data.data() + data.size())
+		{}
+		int64_t tellg() const
+		{
+			return m_ptr - m_beg;
+		}
+		bool seekg(int64_t pos)
+		{
+			if (pos < 0 || pos > m_end - m_beg) return false;
+			m_ptr = m_beg + pos;
+			return true;
+		}
+		int peek() const
+		{
+			return m_ptr != m_end ? static_cast<int>(*m_ptr) : -1;
+		}
+		bool good() const
+		{
+			return m_ptr != m_end;
+		}
+		bool read(char* out, size_t count)
+		{
+			if (count > static_cast<size_t>(m_end - m_ptr)) return false;
+			std::memcpy(out, m_ptr, count);
+			m_ptr += count;
+			return true;
+		}
+	};
+
+	// A chunk within p3d data
+	struct ChunkView
+	{
+		EChunkId m_id;
+		bytes_t m_data; // The chunk payload (excludes the header, includes padding)
+
+		ChunkView()
+			:m_id(EChunkId::Null)
+			,m_data()
+		{}
+		ChunkView(EChunkId id, bytes_t data)
+			:m_id(id)
+			,m_data(data)
+		{}
+
+		// True if this is not the null chunk
+		explicit operator bool() const
+		{
+			return m_id != EChunkId::Null;
+		}
+
+		// The size of the chunk payload in bytes
+		uint32_t payload() const
+		{
+			return s_cast<uint32_t>(m_data.size());
+		}
+
+		// Read a value from 'ofs' bytes into the payload
+		template <typename T> T read(size_t ofs) const
+		{
+			if (ofs + sizeof(T) > m_data.size())
+				throw std::runtime_error(Fmt("Read past the end of chunk '%s'", EChunkId_::ToStringA(m_id)));
+
+			T out;
+			std::memcpy(&out, m_data.data() + ofs, sizeof(T));
+			return out;
+		}
+
+		// Read a string chunk (u32 length, length * [u8])
+		std::string_view str() const
+		{
+			if (!*this) return {};
+			auto len = read<uint32_t>(0);
+			if (sizeof(uint32_t) + len > m_data.size())
+				throw std::runtime_error("String length is invalid");
+
+			return { reinterpret_cast<char const*>(m_data.data() + sizeof(uint32_t)), len };
+		}
+
+		// Enumerate the child chunks that start 'ofs' bytes into the payload.
+		// 'func' signature is: bool Func(ChunkView chunk). Return true to stop. Returns the chunk that stopped the search.
+		template <typename Func> ChunkView enumerate(Func func, size_t ofs = 0) const
+		{
+			for (; ofs + sizeof(ChunkHeader) <= m_data.size();)
+			{
+				auto hdr = read<ChunkHeader>(ofs);
+				if (hdr.m_length < sizeof(ChunkHeader) || ofs + hdr.m_length > m_data.size())
+					throw std::runtime_error(Fmt("invalid chunk found at offset 0x%llx in chunk '%s'", static_cast<unsigned long long>(ofs), EChunkId_::ToStringA(m_id)));
+
+				auto chunk = ChunkView(hdr.m_id, m_data.subspan(ofs + sizeof(ChunkHeader), hdr.payload()));
+				if (func(chunk))
+					return chunk;
+
+				ofs += hdr.m_length;
+			}
+			return ChunkView{};
+		}
+
+		// Find the first child chunk with id 'id'
+		ChunkView find(EChunkId id, size_t ofs = 0) const
+		{
+			return enumerate([=](ChunkView c) { return c.m_id == id; }, ofs);
+		}
+
+		// Find the nested chunk described by 'chunk_id'. Finds the first matching chunk Id at each level.
+		ChunkView find(std::initializer_list<EChunkId> chunk_id) const
+		{
+			auto chunk = *this;
+			for (auto id : chunk_id)
+			{
+				chunk = chunk.find(id);
+				if (!chunk) break;
+			}
+			return chunk;
+		}
+	};
+
+	// A vertex or index stream chunk (u32 count, u16 format, u16 stride, data)
+	struct StreamView
+	{
+		int m_count;
+		int m_format;
+		int m_stride;
+		bytes_t m_data;
+
+		StreamView()
+			:m_count()
+			,m_format()
+			,m_stride()
+			,m_data()
+		{}
+		explicit StreamView(ChunkView chunk)
+			:StreamView()
+		{
+			if (!chunk)
+				return;
+
+			m_count = s_cast<int>(chunk.read<uint32_t>(0));
+			m_format = chunk.read<uint16_t>(4);
+			m_stride = chunk.read<uint16_t>(6);
+			m_data = chunk.m_data.subspan(8);
+
+			// Integrity check - remember data may be padded. The stride of variable length indices is the decompressed size.
+			auto nbit = chunk.m_id == EChunkId::MeshVIdx && s_cast<EIndexFormat>(m_format) == EIndexFormat::IdxNBit;
+			if (!nbit && s_cast<size_t>(m_count) * m_stride > m_data.size())
+				throw std::runtime_error(Fmt("Stream count is invalid. Count is %d, data available for %d.", m_count, s_cast<int>(m_data.size() / std::max(m_stride, 1))));
+		}
+
+		// The number of elements in the stream
+		int size() const
+		{
+			return m_count;
+		}
+		bool empty() const
+		{
+			return m_count == 0;
+		}
+
+		// Direct access to the stream data as an array of 'T'. e.g. 'span<float>()' on 32-bit positions gives x,y,z,x,y,z,...
+		// Only valid for formats that don't need decoding, and where the stride is a multiple of 'T'.
+		template <typename T> std::span<T const> span() const
+		{
+			if (m_stride % sizeof(T) != 0)
+				throw std::runtime_error("Stream stride is not a multiple of the requested element size");
+			if (reinterpret_cast<uintptr_t>(m_data.data()) % alignof(T) != 0)
+				throw std::runtime_error("Stream data is not aligned for the requested element type");
+
+			return { reinterpret_cast<T const*>(m_data.data()), s_cast<size_t>(m_count) * m_stride / sizeof(T) };
+		}
+
+		// Decode elements ['first', 'first' + out.size()) of the stream using 'func(byte const* elem)'
+		template <typename TOut, typename Func> void decode(std::span<TOut> out, int first, Func func) const
+		{
+			if (first < 0 || first + out.size() > s_cast<size_t>(m_count))
+				throw std::runtime_error("Stream range is out of bounds");
+
+			auto ptr = m_data.data() + s_cast<size_t>(first) * m_stride;
+			for (auto& o : out)
+			{
+				o = func(ptr);
+				ptr += m_stride;
+			}
+		}
+	};
+
+	// Decode a range of a MeshVerts stream into 'out'
+	inline void DecodeVerts(StreamView const& stream, std::span<v4> out, int first = 0)
+	{
+		switch (s_cast<EVertFormat>(stream.m_format))
+		{
+			case EVertFormat::Verts32Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { float v[3]; std::memcpy(v, p, sizeof(v)); return v4{ v[0], v[1], v[2], 1.0f }; });
+				break;
+			}
+			case EVertFormat::Verts16Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { half_t v[3]; std::memcpy(v, p, sizeof(v)); return F16toF32<v4>(Half4{ v[0], v[1], v[2], 1.0_hf }); });
+				break;
+			}
+			default:
+			{
+				throw std::runtime_error("Unsupported mesh vertex format");
+			}
+		}
+	}
+
+	// Decode a range of a MeshColours stream into 'out'
+	inline void DecodeColours(StreamView const& stream, std::span<Colour32> out, int first = 0)
+	{
+		switch (s_cast<EColourFormat>(stream.m_format))
+		{
+			case EColourFormat::Colours32Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { uint32_t c; std::memcpy(&c, p, sizeof(c)); return Colour32{ c }; });
+				break;
+			}
+			default:
+			{
+				throw std::runtime_error("Unsupported mesh vertex colour format");
+			}
+		}
+	}
+
+	// Decode a range of a MeshNorms stream into 'out'
+	inline void DecodeNorms(StreamView const& stream, std::span<v4> out, int first = 0)
+	{
+		switch (s_cast<ENormFormat>(stream.m_format))
+		{
+			case ENormFormat::Norms32Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { float n[3]; std::memcpy(n, p, sizeof(n)); return v4{ n[0], n[1], n[2], 0.0f }; });
+				break;
+			}
+			case ENormFormat::Norms16Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { half_t n[3]; std::memcpy(n, p, sizeof(n)); return F16toF32<v4>(Half4{ n[0], n[1], n[2], 0.0_hf }); });
+				break;
+			}
+			case ENormFormat::NormsPack32:
+			{
+				stream.decode(out, first, [](std::byte const* p) { uint32_t n; std::memcpy(&n, p, sizeof(n)); return Norm32bit::Decompress(n); });
+				break;
+			}
+			default:
+			{
+				throw std::runtime_error("Unsupported mesh normals format");
+			}
+		}
+	}
+
+	// Decode a range of a MeshUVs stream into 'out'
+	inline void DecodeUVs(StreamView const& stream, std::span<v2> out, int first = 0)
+	{
+		switch (s_cast<EUVFormat>(stream.m_format))
+		{
+			case EUVFormat::UVs32Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { float t[2]; std::memcpy(t, p, sizeof(t)); return v2{ t[0], t[1] }; });
+				break;
+			}
+			case EUVFormat::UVs16Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { half_t t[2]; std::memcpy(t, p, sizeof(t)); return F16toF32<v4>(Half4{ t[0], t[1], 0.0_hf, 0.0_hf }).xy; });
+				break;
+			}
+			default:
+			{
+				throw std::runtime_error("Unsupported mesh UV format");
+			}
+		}
+	}
+
+	// Decode a range of a MeshVIdx stream into 'out'
+	template <std::integral Idx> void DecodeIndices(StreamView const& stream, std::span<Idx> out, int first = 0)
+	{
+		switch (s_cast<EIndexFormat>(stream.m_format))
+		{
+			case EIndexFormat::Idx32Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { uint32_t i; std::memcpy(&i, p, sizeof(i)); return s_cast<Idx>(i); });
+				break;
+			}
+			case EIndexFormat::Idx16Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { uint16_t i; std::memcpy(&i, p, sizeof(i)); return s_cast<Idx>(i); });
+				break;
+			}
+			case EIndexFormat::Idx8Bit:
+			{
+				stream.decode(out, first, [](std::byte const* p) { return s_cast<Idx>(std::to_integer<uint8_t>(*p)); });
+				break;
+			}
+			case EIndexFormat::IdxNBit:
+			{
+				// Variable length indices are delta encoded, so have to be decoded from the start
+				if (first < 0 || first + out.size() > s_cast<size_t>(stream.m_count))
+					throw std::runtime_error("Stream range is out of bounds");
+
+				auto i = 0;
+				auto end = first + isize(out);
+				auto const* p = reinterpret_cast<uint8_t const*>(stream.m_data.data());
+				auto n = DecodeIdxNBit(p, p + stream.m_data.size(), s_cast<size_t>(end), [&](int64_t idx)
+				{
+					if (i >= first) out[i - first] = s_cast<Idx>(idx);
+					++i;
+				});
+				if (n != s_cast<size_t>(end))
+					throw std::runtime_error(Fmt("Index buffer count is invalid. Count is %d, %d indices provided.", stream.m_count, s_cast<int>(n)));
+
+				break;
+			}
+			default:
+			{
+				throw std::runtime_error("Unsupported index buffer format");
+			}
+		}
+	}
+
+	// A view of a MeshNugget chunk
+	struct NuggetView
+	{
+		ChunkView m_chunk;
+
+		NuggetView()
+			:m_chunk()
+		{}
+		explicit NuggetView(ChunkView chunk)
+			:m_chunk(chunk)
+		{}
+
+		// Geometry topology
+		ETopo topo() const
+		{
+			return s_cast<ETopo>(m_chunk.read<uint16_t>(0));
+		}
+
+		// Geometry valid data
+		EGeom geom() const
+		{
+			return s_cast<EGeom>(m_chunk.read<uint16_t>(2));
+		}
+
+		// Material id
+		std::string_view mat() const
+		{
+			return m_chunk.find(EChunkId::MeshMatId, 4).str();
+		}
+
+		// The index stream
+		StreamView indices() const
+		{
+			return StreamView(m_chunk.find(EChunkId::MeshVIdx, 4));
+		}
+
+		// The number of indices in the nugget
+		int icount() const
+		{
+			return indices().size();
+		}
+
+		// Decode indices ['first', 'first' + out.size()) into 'out'
+		template <std::integral Idx> void ReadIndices(std::span<Idx> out, int first = 0) const
+		{
+			DecodeIndices(indices(), out, first);
+		}
+
+		// Load the nugget into memory
+		Nugget Load() const
+		{
+			SpanSrc src(m_chunk.m_data);
+			return ReadMeshNugget(src, m_chunk.payload());
+		}
+	};
+
+	// A view of a Mesh or MeshLod chunk
+	struct MeshView
+	{
+		ChunkView m_chunk;
+
+		MeshView()
+			:m_chunk()
+		{}
+		explicit MeshView(ChunkView chunk)
+			:m_chunk(chunk)
+		{}
+
+		// True if this view refers to a mesh
+		explicit operator bool() const
+		{
+			return static_cast<bool>(m_chunk);
+		}
+
+		// The mesh name
+		std::string_view name() const
+		{
+			return m_chunk.find(EChunkId::MeshName).str();
+		}
+
+		// Mesh bounding box
+		BBox bbox() const
+		{
+			auto chunk = m_chunk.find(EChunkId::MeshBBox);
+			return chunk ? chunk.read<BBox>(0) : BBox::Reset();
+		}
+
+		// Mesh to parent transform
+		m4x4 o2p() const
+		{
+			auto chunk = m_chunk.find(EChunkId::MeshTransform);
+			return chunk ? chunk.read<m4x4>(0) : m4x4::Identity();
+		}
+
+		// The object space error of this mesh compared to the full detail mesh
+		float lod_error() const
+		{
+			auto chunk = m_chunk.find(EChunkId::MeshLodError);
+			return chunk ? chunk.read<float>(0) : 0.0f;
+		}
+
+		// Vertex streams
+		StreamView verts() const
+		{
+			return StreamView(m_chunk.find(EChunkId::MeshVerts));
+		}
+		StreamView colours() const
+		{
+			return StreamView(m_chunk.find(EChunkId::MeshColours));
+		}
+		StreamView norms() const
+		{
+			return StreamView(m_chunk.find(EChunkId::MeshNorms));
+		}
+		StreamView uvs() const
+		{
+			return StreamView(m_chunk.find(EChunkId::MeshUVs));
+		}
+
+		// The length of the vertex buffer
+		int vcount() const
+		{
+			return verts().size();
+		}
+
+		// Decode vertex data ['first', 'first' + out.size()) into 'out'
+		void ReadVerts(std::span<v4> out, int first = 0) const
+		{
+			DecodeVerts(verts(), out, first);
+		}
+		void ReadColours(std::span<Colour32> out, int first = 0) const
+		{
+			DecodeColours(colours(), out, first);
+		}
+		void ReadNorms(std::span<v4> out, int first = 0) const
+		{
+			DecodeNorms(norms(), out, first);
+		}
+		void ReadUVs(std::span<v2> out, int first = 0) const
+		{
+			DecodeUVs(uvs(), out, first);
+		}
+
+		// The nuggets of this mesh
+		std::vector<NuggetView> nuggets() const
+		{
+			return children<NuggetView>(EChunkId::MeshNugget);
+		}
+
+		// Reduced detail versions of this mesh
+		std::vector<MeshView> lods() const
+		{
+			return children<MeshView>(EChunkId::MeshLod);
+		}
+
+		// Child meshes
+		std::vector<MeshView> meshes() const
+		{
+			return children<MeshView>(EChunkId::Mesh);
+		}
+
+		// Load the mesh (including children and LODs) into memory
+		Mesh Load() const
+		{
+			SpanSrc src(m_chunk.m_data);
+			return ReadMesh(src, m_chunk.payload());
+		}
+
+	private:
+
+		template <typename TView> std::vector<TView> children(EChunkId id) const
+		{
+			std::vector<TView> views;
+			m_chunk.enumerate([&](ChunkView c)
+			{
+				if (c.m_id == id) views.emplace_back(c);
+				return false;
+			});
+			return views;
+		}
+	};
+
+	// A view of a p3d file in memory
+	struct FileView
+	{
+		uint32_t m_version;
+		ChunkView m_main;
+		ChunkView m_materials;
+		std::vector<MeshView> m_meshes;
+
+		explicit FileView(bytes_t data)
+			:m_version()
+			,m_main()
+			,m_materials()
+			,m_meshes()
+		{
+			// Check that this is actually p3d data
+			auto root = ChunkView(EChunkId::Null, data);
+			if (data.size() < sizeof(ChunkHeader) || root.read<ChunkHeader>(0).m_id != EChunkId::Main)
+				throw std::runtime_error("Source is not a p3d stream");
+
+			m_main = root.enumerate([](ChunkView) { return true; });
+
+			// Index the top level meshes
+			auto version = m_main.find(EChunkId::FileVersion);
+			auto scene = m_main.find(EChunkId::Scene);
+			m_version = version ? version.read<uint32_t>(0) : 0U;
+			m_materials = scene.find(EChunkId::Materials);
+			scene.find(EChunkId::Meshes).enumerate([&](ChunkView c)
+			{
+				if (c.m_id == EChunkId::Mesh) m_meshes.emplace_back(c);
+				return false;
+			});
+		}
+
+		// The top level meshes
+		std::span<MeshView const> meshes() const
+		{
+			return m_meshes;
+		}
+
+		// Find a top level mesh by name. Returns a null view if not found
+		MeshView mesh(std::string_view name) const
+		{
+			for (auto& mesh : m_meshes)
+				if (mesh.name() == name)
+					return mesh;
+
+			return MeshView{};
+		}
+
+		// Load the materials into memory
+		MatCont materials() const
+		{
+			if (!m_materials) return {};
+			SpanSrc src(m_materials.m_data);
+			return ReadSceneMaterials(src, m_materials.payload());
+		}
+
+		// Load the top level meshes into memory. Meshes are decoded in parallel.
+		MeshCont LoadMeshes() const
+		{
+			MeshCont meshes(m_meshes.size());
+			std::for_each(std::execution::par, meshes.begin(), meshes.end(), [&](Mesh& mesh)
+			{
+				auto i = &mesh - meshes.data();
+				mesh = m_meshes[i].Load();
+			});
+			return meshes;
+		}
+
+		// Load the whole file into memory
+		File Load() const
+		{
+			File file;
+			file.m_version = m_version;
+			file.m_scene.m_materials = materials();
+			file.m_scene.m_meshes = LoadMeshes();
+			return file;
+		}
+	};
+}
+
+#if PR_UNITTESTS
+#include "pr/common/unittests.h"
+namespace pr::geometry
+{
+	PRUnitTest(P3dViewTests)
+	{
+		using namespace pr::geometry::p3d;
+
+		// A mesh with a LOD, using both uncompressed and compressed formats
+		File file;
+		{
+			Mesh mesh{ "quad" };
+			mesh.m_vert.assign({ v4{0, 0, 0, 1}, v4{1, 0, 0, 1}, v4{1, 1, 0, 1}, v4{0, 1, 0, 1} });
+			mesh.m_norm.assign({ v4{0, 0, 1, 0}, v4{0, 0, 1, 0}, v4{0, 0, 1, 0}, v4{0, 0, 1, 0} });
+			mesh.m_tex0.assign({ v2{0, 0}, v2{1, 0}, v2{1, 1}, v2{0, 1} });
+			mesh.m_bbox = BBox{ v4{0.5f, 0.5f, 0, 1}, v4{0.5f, 0.5f, 0, 0} };
+
+			Nugget nug{ ETopo::TriList, EGeom::Vert | EGeom::Norm | EGeom::Tex0, "mat0", sizeof(uint16_t) };
+			nug.m_vidx.append<uint16_t>({ 0, 1, 2, 0, 2, 3 });
+			mesh.m_nugget.push_back(nug);
+
+			Mesh lod{ "quad_lod1" };
+			lod.m_vert.assign({ v4{0, 0, 0, 1}, v4{1, 0, 0, 1}, v4{1, 1, 0, 1} });
+			lod.m_nugget.push_back(Nugget{ ETopo::TriList, EGeom::Vert, "mat0", sizeof(uint16_t) });
+			lod.m_nugget.back().m_vidx.append<uint16_t>({ 0, 1, 2 });
+			lod.m_lod_error = 0.5f;
+			mesh.m_lods.push_back(lod);
+
+			file.m_version = Version;
+			file.m_scene.m_materials.push_back(Material{ "mat0", ColourWhite });
+			file.m_scene.m_meshes.push_back(mesh);
+		}
+
+		// Uncompressed streams are accessible directly
+		{
+			std::stringstream buf(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+			Write(buf, file, EFlags::Default);
+			auto data = buf.str();
+
+			FileView view({ reinterpret_cast<std::byte const*>(data.data()), data.size() });
+			PR_EXPECT(view.m_version == Version);
+			PR_EXPECT(view.meshes().size() == 1);
+			PR_EXPECT(view.materials().size() == 1);
+
+			auto mesh = view.mesh("quad");
+			PR_EXPECT((bool)mesh);
+			PR_EXPECT(!view.mesh("missing"));
+			PR_EXPECT(mesh.vcount() == 4);
+			PR_EXPECT(FEql(mesh.bbox().Centre(), v4(0.5f, 0.5f, 0, 1)));
+			PR_EXPECT(mesh.lod_error() == 0.0f);
+
+			auto pos = mesh.verts().span<float>();
+			PR_EXPECT(pos.size() == 12);
+			PR_EXPECT(pos[3] == 1.0f && pos[7] == 1.0f && pos[10] == 1.0f);
+
+			auto nuggets = mesh.nuggets();
+			PR_EXPECT(nuggets.size() == 1);
+			PR_EXPECT(nuggets[0].topo() == ETopo::TriList);
+			PR_EXPECT(nuggets[0].mat() == "mat0");
+			auto idx = nuggets[0].indices().span<uint16_t>();
+			PR_EXPECT(idx.size() == 6 && idx[5] == 3);
+
+			auto lods = mesh.lods();
+			PR_EXPECT(lods.size() == 1);
+			PR_EXPECT(lods[0].name() == "quad_lod1");
+			PR_EXPECT(lods[0].lod_error() == 0.5f);
+			PR_EXPECT(lods[0].vcount() == 3);
+
+			// Loading from the view matches the stream loader
+			auto loaded = view.Load();
+			PR_EXPECT(loaded.m_scene.m_meshes.size() == 1);
+			PR_EXPECT(loaded.m_scene.m_meshes[0].m_name == "quad");
+			PR_EXPECT(loaded.m_scene.m_meshes[0].icount() == 6);
+			PR_EXPECT(loaded.m_scene.m_meshes[0].m_lods.size() == 1);
+		}
+
+		// Compressed streams are decoded into caller buffers
+		{
+			std::stringstream buf(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+			Write(buf, file, EFlags::CompressedMax);
+			auto data = buf.str();
+
+			FileView view({ reinterpret_cast<std::byte const*>(data.data()), data.size() });
+			auto mesh = view.meshes()[0];
+
+			v4 verts[2];
+			mesh.ReadVerts(verts, 2);
+			PR_EXPECT(FEql(verts[0], v4(1, 1, 0, 1)));
+			PR_EXPECT(FEql(verts[1], v4(0, 1, 0, 1)));
+
+			v4 norms[4];
+			mesh.ReadNorms(norms);
+			PR_EXPECT(FEqlRelative(norms[3], v4(0, 0, 1, 0), 0.001f));
+
+			v2 uvs[1];
+			mesh.ReadUVs(uvs, 2);
+			PR_EXPECT(FEql(uvs[0], v2(1, 1)));
+
+			uint32_t idx[3];
+			mesh.nuggets()[0].ReadIndices<uint32_t>(idx, 3);
+			PR_EXPECT(idx[0] == 0 && idx[1] == 2 && idx[2] == 3);
+
+			PR_EXPECT(mesh.colours().empty());
+		}
+	}
+}
+#endif
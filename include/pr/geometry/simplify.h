@@ -0,0 +1,671 @@
+﻿//********************************
+// Mesh Simplification
+//  Copyright (c) Rylogic Ltd 2025
+//********************************
+#pragma once
+#include <span>
+#include <vector>
+#include <numeric>
+#include <concepts>
+#include <algorithm>
+#include <execution>
+#include <limits>
+#include <cassert>
+#include "pr/common/cast.h"
+#include "pr/math/math.h"
+#include "pr/geometry/common.h"
+
+namespace pr::geometry
+{
+	// Notes:
+	//  - Edge collapse simplification using quadric error metrics (Garland & Heckbert 1997).
+	//  - Verts are collapsed onto one of their neighbours (no new positions) so vertex attributes are never interpolated.
+	//  - Verts with the same position but different indices are treated as attribute seams (UV/normal/colour splits).
+	//    Seam verts, verts shared by faces of different groups (materials), and verts on non-manifold edges don't move.
+	//    Verts on open borders only move along the border.
+	//  - Collapses are done in passes. Each pass measures the cost of every edge in parallel, sorts them, then
+	//    greedily collapses the cheapest edges whose neighbourhoods haven't been touched earlier in the pass.
+	//  - Errors are RMS distances from the original faces, in the units of the vertex positions.
+	//  - Working memory is roughly 200 bytes per input face (position ids, quadrics, adjacency, edges, and collapses).
+
+	struct SimplifyParams
+	{
+		// Stop when the face count reaches this
+		int m_target_faces = 0;
+
+		// Don't perform collapses with an error greater than this (object space distance)
+		float m_max_error = std::numeric_limits<float>::max();
+
+		// Don't move verts on open borders
+		bool m_lock_border = false;
+	};
+	struct SimplifyResult
+	{
+		// The number of faces remaining
+		int m_face_count;
+
+		// The largest error of the collapses performed (object space distance)
+		float m_error;
+	};
+
+	namespace simplify
+	{
+		// Symmetric 4x4 error quadric, with the total weight of the planes that contributed.
+		// Doubles are needed because errors on dense meshes are tiny compared to the squared plane distances.
+		struct Quadric
+		{
+			double a00, a01, a02, a03;
+			double      a11, a12, a13;
+			double           a22, a23;
+			double                a33;
+			double w;
+
+			static Quadric Plane(v4 n_, float d_, float weight_)
+			{
+				auto nx = double(n_.x), ny = double(n_.y), nz = double(n_.z), d = double(d_), w = double(weight_);
+				return Quadric{
+					w * nx * nx, w * nx * ny, w * nx * nz, w * nx * d,
+					             w * ny * ny, w * ny * nz, w * ny * d,
+					                          w * nz * nz, w * nz * d,
+					                                       w * d * d,
+					w,
+				};
+			}
+			Quadric& operator += (Quadric const& rhs)
+			{
+				a00 += rhs.a00; a01 += rhs.a01; a02 += rhs.a02; a03 += rhs.a03;
+				a11 += rhs.a11; a12 += rhs.a12; a13 += rhs.a13;
+				a22 += rhs.a22; a23 += rhs.a23;
+				a33 += rhs.a33;
+				w += rhs.w;
+				return *this;
+			}
+			friend Quadric operator + (Quadric lhs, Quadric const& rhs)
+			{
+				return lhs += rhs;
+			}
+
+			// The weighted mean squared distance of 'p' from the planes
+			float Error(v4 p_) const
+			{
+				auto x = double(p_.x), y = double(p_.y), z = double(p_.z);
+				auto rx = a00 * x + a01 * y + a02 * z + a03;
+				auto ry = a01 * x + a11 * y + a12 * z + a13;
+				auto rz = a02 * x + a12 * y + a22 * z + a23;
+				auto e = rx * x + ry * y + rz * z + a03 * x + a13 * y + a23 * z + a33;
+				return w > 0 ? static_cast<float>(std::max(e, 0.0) / w) : 0.0f;
+			}
+		};
+
+		// How a (position) vertex is allowed to move
+		enum class EKind : uint8_t
+		{
+			Manifold, // Can collapse onto any neighbour
+			Border,   // Can only collapse along an open border edge
+			Seam,     // Attribute seam, doesn't move
+			Locked,   // Material boundary or non-manifold, doesn't move
+		};
+
+		// An edge collapse 'm_src' -> 'm_dst' (position ids)
+		struct Collapse
+		{
+			float m_cost;
+			int m_src;
+			int m_dst;
+		};
+
+		// Key for an undirected edge
+		inline uint64_t EdgeKey(int a, int b)
+		{
+			if (a > b) std::swap(a, b);
+			return (uint64_t(uint32_t(a)) << 32) | uint32_t(b);
+		}
+	}
+
+	// Simplify a triangle list by collapsing edges until 'params.m_target_faces' is reached, or no more collapses are possible within 'params.m_max_error'.
+	// 'face_group' is empty or contains a group id (e.g. material) per face, and is compacted along with 'indices'. Face order is preserved.
+	// 'getv(i)' returns the position of vertex 'i'. Unreferenced verts are left in the vertex buffer.
+	template <std::integral VIdx, GetVertFn TGetV>
+	SimplifyResult Simplify(std::vector<VIdx>& indices, std::vector<int>& face_group, int vcount, TGetV getv, SimplifyParams const& params = {})
+	{
+		using namespace simplify;
+		assert(indices.size() % 3 == 0 && "Expected a triangle list");
+		assert(face_group.empty() || face_group.size() == indices.size() / 3);
+
+		auto fcount = isize(indices) / 3;
+		if (fcount <= params.m_target_faces)
+			return SimplifyResult{ fcount, 0.0f };
+
+		// Referenced verts
+		std::vector<uint8_t> used(vcount, 0);
+		for (auto i : indices)
+			used[static_cast<int>(i)] = 1;
+
+		// Copy the positions into a unit cube to keep the quadrics well conditioned
+		auto bbox = BBox::Reset();
+		for (int v = 0; v != vcount; ++v)
+			if (used[v]) Grow(bbox, getv(v));
+
+		auto radius = bbox.Radius();
+		auto scale = 1.0f / std::max(2.0f * std::max({ radius.x, radius.y, radius.z }), math::tiny<float>);
+		auto origin = bbox.Centre();
+		std::vector<v4> pos(vcount);
+		std::for_each(std::execution::par, pos.begin(), pos.end(), [&](v4& p)
+		{
+			auto v = s_cast<int>(&p - pos.data());
+			p = ((getv(v) - origin) * scale).w1();
+		});
+
+		// Position ids. Verts with identical positions share the lowest referenced vertex index as their id.
+		// The id must be a referenced vertex, because collapses are applied to the face indices through it.
+		// 'wedges[p]' is the number of referenced verts with position id 'p' (> 1 for attribute seams).
+		std::vector<int> pid(vcount);
+		std::vector<int> wedges(vcount, 0);
+		{
+			std::vector<int> order(vcount);
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(std::execution::par, order.begin(), order.end(), [&](int l, int r)
+			{
+				auto& a = pos[l];
+				auto& b = pos[r];
+				if (a.x != b.x) return a.x < b.x;
+				if (a.y != b.y) return a.y < b.y;
+				if (a.z != b.z) return a.z < b.z;
+				return l < r;
+			});
+			for (int i = 0, j; i != vcount; i = j)
+			{
+				auto& p = pos[order[i]];
+				for (j = i + 1; j != vcount && pos[order[j]].x == p.x && pos[order[j]].y == p.y && pos[order[j]].z == p.z; ++j) {}
+
+				auto first = order[i];
+				for (int k = i; k != j; ++k)
+				{
+					if (!used[order[k]]) continue;
+					first = order[k];
+					break;
+				}
+				for (int k = i; k != j; ++k)
+				{
+					pid[order[k]] = first;
+					wedges[first] += used[order[k]];
+				}
+			}
+		}
+
+		// The position id of a face corner
+		auto P = [&](int f, int k) { return pid[static_cast<int>(indices[3 * f + k])]; };
+
+		std::vector<Quadric> quadric(vcount, Quadric{});
+		std::vector<EKind> kind(vcount);
+		std::vector<int> vgroup(vcount);
+		std::vector<int> adj_ofs(vcount + 1);
+		std::vector<int> adj;
+		std::vector<uint64_t> edges;
+		std::vector<Collapse> collapses;
+		std::vector<int> collapse_to(vcount, -1);
+		std::vector<uint8_t> touched(vcount);
+		std::vector<int> ring_u, ring_v;
+
+		auto error_limit = Sqr(params.m_max_error * scale);
+		auto max_error = 0.0f;
+		for (int pass = 0; fcount > params.m_target_faces; ++pass)
+		{
+			// Position vertex to face adjacency (CSR)
+			std::fill(adj_ofs.begin(), adj_ofs.end(), 0);
+			for (int f = 0; f != fcount; ++f)
+				for (int k = 0; k != 3; ++k)
+					++adj_ofs[P(f, k) + 1];
+			std::inclusive_scan(adj_ofs.begin(), adj_ofs.end(), adj_ofs.begin());
+			adj.resize(3 * fcount);
+			{
+				std::vector<int> fill(adj_ofs.begin(), adj_ofs.end() - 1);
+				for (int f = 0; f != fcount; ++f)
+					for (int k = 0; k != 3; ++k)
+						adj[fill[P(f, k)]++] = f;
+			}
+
+			// Undirected edges, sorted so that duplicates are adjacent
+			edges.resize(3 * fcount);
+			std::for_each(std::execution::par, edges.begin(), edges.end(), [&](uint64_t& edge)
+			{
+				auto e = s_cast<int>(&edge - edges.data());
+				auto f = e / 3, k = e % 3;
+				edge = EdgeKey(P(f, k), P(f, (k + 1) % 3));
+			});
+			std::sort(std::execution::par, edges.begin(), edges.end());
+
+			// Classify the verts
+			std::fill(kind.begin(), kind.end(), EKind::Manifold);
+			std::fill(vgroup.begin(), vgroup.end(), -1);
+			for (int v = 0; v != vcount; ++v)
+				if (wedges[v] > 1) kind[v] = EKind::Seam;
+			for (int f = 0; f != fcount; ++f)
+			{
+				auto grp = face_group.empty() ? 0 : face_group[f];
+				for (int k = 0; k != 3; ++k)
+				{
+					auto p = P(f, k);
+					if (vgroup[p] == -1) vgroup[p] = grp;
+					else if (vgroup[p] != grp) kind[p] = EKind::Locked;
+				}
+			}
+			auto Demote = [&](int p, EKind k) { kind[p] = std::max(kind[p], k); };
+			for (size_t i = 0, iend = edges.size(); i != iend;)
+			{
+				auto j = i + 1;
+				for (; j != iend && edges[j] == edges[i]; ++j) {}
+				auto a = s_cast<int>(edges[i] >> 32);
+				auto b = s_cast<int>(edges[i] & 0xFFFFFFFF);
+				auto n = j - i;
+				if (n == 1)
+				{
+					Demote(a, params.m_lock_border ? EKind::Locked : EKind::Border);
+					Demote(b, params.m_lock_border ? EKind::Locked : EKind::Border);
+				}
+				else if (n > 2)
+				{
+					Demote(a, EKind::Locked);
+					Demote(b, EKind::Locked);
+				}
+				i = j;
+			}
+
+			// Initial quadrics from the original faces
+			if (pass == 0)
+			{
+				std::for_each(std::execution::par, quadric.begin(), quadric.end(), [&](Quadric& q)
+				{
+					auto p = s_cast<int>(&q - quadric.data());
+					for (int a = adj_ofs[p], aend = adj_ofs[p + 1]; a != aend; ++a)
+					{
+						auto f = adj[a];
+						auto p0 = pos[P(f, 0)];
+						auto n = Cross(pos[P(f, 1)] - p0, pos[P(f, 2)] - p0);
+						auto area = Length(n);
+						if (area < math::tiny<float> * math::tiny<float>) continue;
+						n /= area;
+						q += Quadric::Plane(n, -Dot(n, p0), area);
+					}
+				});
+
+				// Border edges get a constraint plane perpendicular to the face so borders keep their shape
+				for (size_t i = 0, iend = edges.size(); i != iend; ++i)
+				{
+					if ((i != 0 && edges[i - 1] == edges[i]) || (i + 1 != iend && edges[i + 1] == edges[i]))
+						continue;
+
+					auto a = s_cast<int>(edges[i] >> 32);
+					auto b = s_cast<int>(edges[i] & 0xFFFFFFFF);
+					for (int x = adj_ofs[a], xend = adj_ofs[a + 1]; x != xend; ++x)
+					{
+						auto f = adj[x];
+						if (P(f, 0) != b && P(f, 1) != b && P(f, 2) != b) continue;
+						auto p0 = pos[P(f, 0)];
+						auto fn = Cross(pos[P(f, 1)] - p0, pos[P(f, 2)] - p0);
+						auto e = pos[b] - pos[a];
+						auto n = Cross(e, fn);
+						auto len = Length(n);
+						if (len < math::tiny<float> * math::tiny<float>) break;
+						n /= len;
+						auto q = Quadric::Plane(n, -Dot(n, pos[a]), LengthSq(e));
+						quadric[a] += q;
+						quadric[b] += q;
+						break;
+					}
+				}
+			}
+
+			// Candidate collapses for each unique edge, in the cheaper direction
+			collapses.resize(0);
+			for (size_t i = 0, iend = edges.size(); i != iend;)
+			{
+				auto j = i + 1;
+				for (; j != iend && edges[j] == edges[i]; ++j) {}
+				auto a = s_cast<int>(edges[i] >> 32);
+				auto b = s_cast<int>(edges[i] & 0xFFFFFFFF);
+				auto border = j - i == 1;
+				auto can_a = kind[a] == EKind::Manifold || (kind[a] == EKind::Border && border);
+				auto can_b = kind[b] == EKind::Manifold || (kind[b] == EKind::Border && border);
+				if (j - i <= 2 && (can_a || can_b))
+					collapses.push_back(Collapse{ can_a && can_b ? -1.0f : 0.0f, can_a ? a : b, can_a ? b : a });
+				i = j;
+			}
+			std::for_each(std::execution::par, collapses.begin(), collapses.end(), [&](Collapse& c)
+			{
+				auto both = c.m_cost < 0;
+				auto q = quadric[c.m_src] + quadric[c.m_dst];
+				c.m_cost = q.Error(pos[c.m_dst]);
+				if (both)
+				{
+					auto cost = q.Error(pos[c.m_src]);
+					if (cost < c.m_cost)
+					{
+						std::swap(c.m_src, c.m_dst);
+						c.m_cost = cost;
+					}
+				}
+			});
+			std::sort(std::execution::par, collapses.begin(), collapses.end(), [](Collapse const& l, Collapse const& r)
+			{
+				return l.m_cost < r.m_cost;
+			});
+
+			// Only consider collapses up to the cost where the target would be reached if about half of them succeeded
+			// (each collapse removes ~2 faces, and neighbouring collapses block each other). More expensive collapses
+			// wait for the next pass, when cheaper options may have appeared, unless none of the cheaper ones are possible.
+			auto needed = fcount - params.m_target_faces;
+			auto pass_limit = collapses.empty() ? 0.0f : collapses[std::min<size_t>(collapses.size(), s_cast<size_t>(needed + 1)) - 1].m_cost;
+
+			// Greedily collapse edges
+			std::fill(touched.begin(), touched.end(), uint8_t(0));
+			auto removed = 0;
+			for (auto& c : collapses)
+			{
+				if (removed >= needed || c.m_cost > error_limit || (c.m_cost > pass_limit && removed != 0))
+					break;
+
+				auto u = c.m_src;
+				auto v = c.m_dst;
+				if (touched[u] || touched[v])
+					continue;
+
+				// Find the vertex (wedge) of 'v' used by the faces on edge 'u-v'.
+				// Faces around 'u' must not flip when 'u' moves to 'v'.
+				auto wedge = -1;
+				auto shared = 0;
+				auto ok = true;
+				for (int a = adj_ofs[u], aend = adj_ofs[u + 1]; a != aend && ok; ++a)
+				{
+					auto f = adj[a];
+					int k = 0;
+					for (; k != 3 && P(f, k) != v; ++k) {}
+					if (k != 3)
+					{
+						auto w = static_cast<int>(indices[3 * f + k]);
+						ok = wedge == -1 || wedge == w;
+						wedge = w;
+						++shared;
+						continue;
+					}
+
+					v4 p[3] = { pos[P(f, 0)], pos[P(f, 1)], pos[P(f, 2)] };
+					auto n0 = Cross(p[1] - p[0], p[2] - p[0]);
+					for (k = 0; k != 3; ++k) if (P(f, k) == u) p[k] = pos[v];
+					auto n1 = Cross(p[1] - p[0], p[2] - p[0]);
+					ok = Dot(n0, n1) > 0.25f * Length(n0) * Length(n1);
+				}
+				if (!ok || wedge == -1)
+					continue;
+
+				// Link condition: the only verts adjacent to both 'u' and 'v' can be those opposite edge 'u-v'.
+				// Otherwise the collapse pinches the surface into a non-manifold shape.
+				auto Ring = [&](int p, std::vector<int>& ring)
+				{
+					ring.resize(0);
+					for (int a = adj_ofs[p], aend = adj_ofs[p + 1]; a != aend; ++a)
+					{
+						for (int k = 0; k != 3; ++k)
+						{
+							auto q = P(adj[a], k);
+							if (q != u && q != v) ring.push_back(q);
+						}
+					}
+					std::sort(ring.begin(), ring.end());
+					ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+				};
+				Ring(u, ring_u);
+				Ring(v, ring_v);
+				auto common = 0;
+				for (auto iu = ring_u.begin(), iv = ring_v.begin(); iu != ring_u.end() && iv != ring_v.end();)
+				{
+					if (*iu < *iv) ++iu;
+					else if (*iv < *iu) ++iv;
+					else { ++common; ++iu; ++iv; }
+				}
+				if (common > shared)
+					continue;
+
+				// Faces around 'u' must not become copies of faces around 'v' (e.g. collapsing an edge of a tetrahedron)
+				for (int a = adj_ofs[u], aend = adj_ofs[u + 1]; a != aend && ok; ++a)
+				{
+					auto f = adj[a];
+					int o[2], n = 0;
+					for (int k = 0; k != 3 && n != -1; ++k)
+					{
+						auto q = P(f, k);
+						if (q == v) n = -1;
+						else if (q != u) o[n++] = q;
+					}
+					if (n != 2)
+						continue;
+
+					for (int b = adj_ofs[v], bend = adj_ofs[v + 1]; b != bend && ok; ++b)
+					{
+						auto g = adj[b];
+						auto has0 = P(g, 0) == o[0] || P(g, 1) == o[0] || P(g, 2) == o[0];
+						auto has1 = P(g, 0) == o[1] || P(g, 1) == o[1] || P(g, 2) == o[1];
+						ok = !(has0 && has1);
+					}
+				}
+				if (!ok)
+					continue;
+
+				// Collapse 'u' onto 'v'
+				collapse_to[u] = wedge;
+				quadric[v] += quadric[u];
+				touched[u] = touched[v] = 1;
+				for (int a = adj_ofs[u], aend = adj_ofs[u + 1]; a != aend; ++a)
+				{
+					auto f = adj[a];
+					touched[P(f, 0)] = touched[P(f, 1)] = touched[P(f, 2)] = 1;
+				}
+				max_error = std::max(max_error, c.m_cost);
+				removed += shared;
+			}
+			if (removed == 0)
+				break;
+
+			// Apply the collapses (recorded by position id) and remove degenerate faces
+			std::for_each(std::execution::par, indices.begin(), indices.end(), [&](VIdx& i)
+			{
+				auto to = collapse_to[pid[static_cast<int>(i)]];
+				if (to != -1) i = static_cast<VIdx>(to);
+			});
+			auto out = 0;
+			for (int f = 0; f != fcount; ++f)
+			{
+				auto p0 = P(f, 0), p1 = P(f, 1), p2 = P(f, 2);
+				if (p0 == p1 || p1 == p2 || p2 == p0)
+					continue;
+
+				for (int k = 0; k != 3; ++k)
+					indices[3 * out + k] = indices[3 * f + k];
+				if (!face_group.empty())
+					face_group[out] = face_group[f];
+				++out;
+			}
+			for (int v = 0; v != vcount; ++v)
+			{
+				if (collapse_to[v] == -1) continue;
+				wedges[pid[v]] -= 1;
+				collapse_to[v] = -1;
+			}
+			if (out == fcount)
+				break;
+
+			fcount = out;
+			indices.resize(3 * fcount);
+			if (!face_group.empty())
+				face_group.resize(fcount);
+		}
+
+		return SimplifyResult{ fcount, Sqrt(max_error) / scale };
+	}
+}
+
+#if PR_UNITTESTS
+#include "pr/common/unittests.h"
+#include <map>
+#include <set>
+namespace pr::geometry::tests
+{
+	PRUnitTestClass(SimplifyTests)
+	{
+		// A 'n x n' grid of quads on the surface z = height(x,y) with UVs split along x == n/2 (an attribute seam)
+		template <typename Height>
+		static std::vector<int> Grid(int n, std::vector<v4>& verts, Height height)
+		{
+			auto Add = [&](int x, int y) { verts.push_back(v4(float(x), float(y), height(float(x), float(y)), 1)); return isize(verts) - 1; };
+
+			verts.resize(0);
+			std::vector<int> index((n + 1) * (n + 1));
+			std::vector<int> seam(n + 1);
+			for (int y = 0; y <= n; ++y)
+				for (int x = 0; x <= n; ++x)
+					index[y * (n + 1) + x] = Add(x, y);
+			for (int y = 0; y <= n; ++y)
+				seam[y] = Add(n / 2, y);
+
+			std::vector<int> indices;
+			for (int y = 0; y != n; ++y)
+			{
+				for (int x = 0; x != n; ++x)
+				{
+					auto I = [&](int xx, int yy) { return xx == n / 2 && x >= n / 2 ? seam[yy] : index[yy * (n + 1) + xx]; };
+					indices.insert(indices.end(), { I(x, y), I(x + 1, y), I(x + 1, y + 1) });
+					indices.insert(indices.end(), { I(x, y), I(x + 1, y + 1), I(x, y + 1) });
+				}
+			}
+			return indices;
+		}
+
+		PRUnitTestMethod(FlatGrid)
+		{
+			// A flat grid should simplify to very few faces with no error. The seam column can't be
+			// simplified so each half is a fan of faces to the 32 seam edges.
+			std::vector<v4> verts;
+			auto indices = Grid(32, verts, [](float, float) { return 0.0f; });
+			auto orig = indices;
+			std::vector<int> groups;
+
+			auto r = Simplify<int>(indices, groups, isize(verts), [&](int i) { return verts[i]; }, { .m_max_error = 0.001f });
+			PR_EXPECT(r.m_face_count == isize(indices) / 3);
+			PR_EXPECT(r.m_face_count <= 2 * 32 + 2);
+			PR_EXPECT(r.m_error < 0.001f);
+
+			// Seam verts and the boundary corners don't move, and the seam remains a seam
+			std::vector<int> count(verts.size());
+			for (auto i : indices) ++count[i];
+			for (int y = 0; y <= 32; ++y)
+			{
+				auto a = y * 33 + 16;
+				auto b = 33 * 33 + y;
+				PR_EXPECT((count[a] != 0) == (count[b] != 0));
+			}
+			PR_EXPECT(count[0] != 0 && count[32] != 0 && count[32 * 33] != 0 && count[32 * 33 + 32] != 0);
+		}
+		PRUnitTestMethod(CurvedSurface)
+		{
+			// A curved surface keeps its shape within the reported error
+			std::vector<v4> verts;
+			auto height = [](float x, float y) { return 4.0f * std::sin(x * 0.2f) * std::cos(y * 0.15f); };
+			auto indices = Grid(40, verts, height);
+			auto orig_faces = isize(indices) / 3;
+			std::vector<int> groups(orig_faces);
+			for (int f = 0; f != orig_faces; ++f)
+				groups[f] = verts[indices[3 * f]].y < 20.0f ? 0 : 1;
+
+			auto r = Simplify<int>(indices, groups, isize(verts), [&](int i) { return verts[i]; }, { .m_target_faces = orig_faces / 4 });
+			PR_EXPECT(r.m_face_count <= orig_faces / 4);
+			PR_EXPECT(r.m_error > 0 && r.m_error < 0.5f);
+			PR_EXPECT(isize(groups) == r.m_face_count);
+
+			// Verts haven't moved off the surface, and faces stay within their group's half
+			for (auto i : indices)
+				PR_EXPECT(FEqlAbsolute(verts[i].z, height(verts[i].x, verts[i].y), 0.0001f));
+			for (int f = 0; f != r.m_face_count; ++f)
+			{
+				for (int k = 0; k != 3; ++k)
+				{
+					auto y = verts[indices[3 * f + k]].y;
+					PR_EXPECT(groups[f] == 0 ? y <= 20.0f : y >= 20.0f);
+				}
+			}
+
+			// A tight error limit stops early
+			indices = Grid(40, verts, height);
+			groups.resize(0);
+			auto r2 = Simplify<int>(indices, groups, isize(verts), [&](int i) { return verts[i]; }, { .m_max_error = 0.01f });
+			PR_EXPECT(r2.m_error <= 0.01f);
+			PR_EXPECT(r2.m_face_count > r.m_face_count);
+		}
+		PRUnitTestMethod(UnusedDuplicates)
+		{
+			// Unreferenced copies of every vertex, at lower indices than the referenced ones. Collapses
+			// must still reach the face indices, and an unreachable target must not loop forever.
+			std::vector<v4> verts;
+			auto indices = Grid(16, verts, [](float x, float y) { return 0.1f * x * y; });
+			auto orig_faces = isize(indices) / 3;
+			auto n = isize(verts);
+			verts.insert(verts.begin(), verts.begin(), verts.end());
+			for (auto& i : indices) i += n;
+			std::vector<int> groups;
+
+			auto r = Simplify<int>(indices, groups, isize(verts), [&](int i) { return verts[i]; }, { .m_target_faces = 1 });
+			PR_EXPECT(r.m_face_count == isize(indices) / 3);
+			PR_EXPECT(r.m_face_count < orig_faces / 4);
+			for (auto i : indices)
+				PR_EXPECT(i >= n);
+		}
+		PRUnitTestMethod(ClosedMesh)
+		{
+			// A closed mesh stays closed and manifold: every edge has two faces and no face is repeated
+			std::vector<v4> verts;
+			std::vector<int> indices;
+			int const stacks = 12, slices = 16;
+			verts.push_back(v4(0, 0, +1, 1));
+			verts.push_back(v4(0, 0, -1, 1));
+			for (int j = 1; j != stacks; ++j)
+			{
+				for (int i = 0; i != slices; ++i)
+				{
+					auto theta = constants<float>::tau_by_2 * j / stacks;
+					auto phi = constants<float>::tau * i / slices;
+					verts.push_back(v4(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta), 1));
+				}
+			}
+			auto V = [&](int j, int i) { return j == 0 ? 0 : j == stacks ? 1 : 2 + (j - 1) * slices + (i % slices); };
+			for (int j = 0; j != stacks; ++j)
+			{
+				for (int i = 0; i != slices; ++i)
+				{
+					if (j != 0) indices.insert(indices.end(), { V(j, i), V(j + 1, i), V(j, i + 1) });
+					if (j != stacks - 1) indices.insert(indices.end(), { V(j, i + 1), V(j + 1, i), V(j + 1, i + 1) });
+				}
+			}
+			auto orig_faces = isize(indices) / 3;
+			std::vector<int> groups;
+
+			auto r = Simplify<int>(indices, groups, isize(verts), [&](int i) { return verts[i]; }, { .m_target_faces = 4 });
+			PR_EXPECT(r.m_face_count == isize(indices) / 3);
+			PR_EXPECT(r.m_face_count < orig_faces / 4);
+
+			std::map<std::pair<int, int>, int> edges;
+			std::set<std::array<int, 3>> faces;
+			for (int f = 0; f != r.m_face_count; ++f)
+			{
+				std::array<int, 3> face = { indices[3 * f + 0], indices[3 * f + 1], indices[3 * f + 2] };
+				for (int k = 0; k != 3; ++k)
+					++edges[std::minmax(face[k], face[(k + 1) % 3])];
+
+				std::sort(face.begin(), face.end());
+				PR_EXPECT(face[0] != face[1] && face[1] != face[2]);
+				PR_EXPECT(faces.insert(face).second);
+			}
+			for (auto& [edge, count] : edges)
+				PR_EXPECT(count == 2);
+		}
+	};
+}
+#endif
@@ -6,6 +6,15 @@
 #include <type_traits>
 #include <concepts>
 #include <cassert>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <atomic>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <execution>
+#include <utility>
 #include "pr/geometry/common.h"
 #include "pr/geometry/triangle.h"
 
@@ -27,262 +36,451 @@ namespace pr::geometry
 		template <typename T> concept VertOutFn = std::invocable<T, int, int, v4>;
 		template <typename T> concept IdxOutFn = std::invocable<T, int, int, int>;
 
-		template <typename TIdxCIter, GetVertFn TGetV>
-		struct Impl
+		// Call 'func(beg, end)' for blocks of the range [0, count) in parallel
+		template <typename Func> void ParallelBlocks(size_t count, size_t block_size, Func func)
+		{
+			std::vector<size_t> blocks;
+			for (size_t i = 0; i < count; i += block_size)
+				blocks.push_back(i);
+
+			std::for_each(std::execution::par, std::begin(blocks), std::end(blocks), [&](size_t beg)
+			{
+				func(beg, std::min(beg + block_size, count));
+			});
+		}
+
+		// Lock-free disjoint sets. The root of each set is its lowest index.
+		struct DisjointSets
 		{
-			struct Face
+			std::vector<uint32_t> m_parent;
+
+			explicit DisjointSets(size_t count)
+				:m_parent(count)
 			{
-				v4     m_norm;
-				v4     m_angles;
-				size_t m_idx[3];
-				int    m_grp;
-				v4 normal(size_t idx) const
+				std::iota(std::begin(m_parent), std::end(m_parent), 0U);
+			}
+
+			// The root of the set containing 'x'
+			uint32_t Find(uint32_t x)
+			{
+				for (;;)
 				{
-					// 'idx' is the vertex index in m_verts
-					if (idx == m_idx[0]) return m_norm * m_angles.x;
-					if (idx == m_idx[1]) return m_norm * m_angles.y;
-					if (idx == m_idx[2]) return m_norm * m_angles.z;
-					assert(false && "index is not part of this face");
-					return v4::Zero();
+					auto p = std::atomic_ref<uint32_t>(m_parent[x]).load(std::memory_order_relaxed);
+					if (p == x)
+						return x;
+
+					// Path halving
+					auto gp = std::atomic_ref<uint32_t>(m_parent[p]).load(std::memory_order_relaxed);
+					if (gp != p)
+						std::atomic_ref<uint32_t>(m_parent[x]).compare_exchange_weak(p, gp, std::memory_order_relaxed);
+
+					x = gp;
 				}
-			};
-			struct Edge
+			}
+
+			// Merge the sets containing 'a' and 'b'
+			void Union(uint32_t a, uint32_t b)
 			{
-				size_t m_sidx;      // Index of the start of the edge
-				size_t m_eidx;      // Index of the other end of the edge
-				Face*  m_lface;     // The face to the left of the edge
-				Face*  m_rface;     // The face to the right of the edge
-				Edge*  m_next;      // Forms a linked list of edges
-				bool   m_nonplanar; // True if this edge has more than two left or right faces
-
-				bool smooth(float cos_angle_threshold) const
+				for (;;)
 				{
-					return
-						m_lface && m_rface && // two faces needed to be smooth
-						!m_nonplanar &&       // no more than two faces per side
-						(
-							(m_lface->m_grp == m_rface->m_grp) ||                           // Already in the same group
-							(Dot3(m_lface->m_norm, m_rface->m_norm) > cos_angle_threshold)  // Normals within the tolerance
-						);
+					a = Find(a);
+					b = Find(b);
+					if (a == b)
+						return;
+
+					// Link the higher root to the lower one
+					if (a < b) std::swap(a, b);
+					auto expected = a;
+					if (std::atomic_ref<uint32_t>(m_parent[a]).compare_exchange_strong(expected, b, std::memory_order_relaxed))
+						return;
 				}
+			}
+		};
+
+		// Notes:
+		//  - Corners are the index positions in the face data (3 per face). Verts with a position within the weld distance
+		//    of each other share a 'weld id' (the lowest vertex index). Without welding, the weld id is the vertex index.
+		//  - Corners are bucketed by weld id using a counting sort, giving a flat vertex to face adjacency table in corner order.
+		//    Each undirected edge is found from the bucket of its lower weld id.
+		//  - An edge is smooth if it has exactly one face in each direction and the face normals are within the smoothing angle.
+		//    Smoothing groups are the faces connected by smooth edges, identified by the lowest face index in the group.
+		//  - A wedge is a vertex index in a smoothing group. The first wedge of each vertex (in face order) keeps the vertex
+		//    index, the rest become new verts, numbered in face order from 'new_vidx'.
+		//  - Normals are the angle weighted sum of the face normals in the same weld id and smoothing group, accumulated in
+		//    face order.
+		struct Impl
+		{
+			static constexpr size_t BlockSize = 1024;
+
+			struct EdgeEnd
+			{
+				uint32_t m_other; // The weld id at the other end of the edge
+				uint32_t m_face;  // The face that the edge belongs to
+				bool m_left;      // True if the edge is directed from this bucket's weld id to 'm_other'
 			};
-			struct Vert
+			struct Wedge
 			{
-				v4     m_norm;       // Smoothed vertex normal
-				Edge*  m_edges;      // The edges that connect to this vertex
-				Vert*  m_next;       // Other vert the same as this, but in a different smoothing group
-				size_t m_orig_idx;   // Index of the original vertex
-				size_t m_new_idx;    // Index of the vertex in 'm_verts'
-				int    m_edge_count; // The number of edges connecting to this vertex
-				int    m_grp;        // The smoothing group number that all contributing faces have
+				uint32_t m_vert;  // The original vertex index
+				uint32_t m_grp;   // The smoothing group
+				uint32_t m_first; // The first corner in the wedge
+				bool m_dup;       // True if the wedge needs a new vertex
 			};
-			static_assert(std::alignment_of<Face>::value == 16, "Face not aligned correctly");
-			static_assert(std::alignment_of<Vert>::value == 16, "Vert not aligned correctly");
-			static_assert((sizeof(Face) % sizeof(v4)) == 0, "Face size not a multiple of v4 alignment");
-			static_assert((sizeof(Vert) % sizeof(v4)) == 0, "Vert size not a multiple of v4 alignment");
-
-			pr::vector<Face> m_faces;
-			pr::deque<Vert> m_verts;
-			pr::deque<Edge> m_edge_alloc;
-
-			Impl(size_t num_indices, TIdxCIter indices, float smoothing_angle, size_t new_vidx, TGetV getv)
-				:m_faces()
-				,m_verts()
-				,m_edge_alloc()
+			struct GroupNorm
 			{
-				BuildAdjacencyData(num_indices, indices, getv);
-				GenerateDegenerateVerts(smoothing_angle);
-				AssignSmoothingGroups(smoothing_angle);
-				CreateNormals(new_vidx);
-			}
+				v4 m_norm;
+				uint32_t m_grp;
+			};
+			struct Scratch
+			{
+				std::vector<EdgeEnd> m_ends;
+				std::vector<Wedge> m_wedges;
+				std::vector<GroupNorm> m_norms;
+				std::vector<uint32_t> m_slot;
+			};
 
-			// Creates the adjacency data
-			void BuildAdjacencyData(size_t num_indices, TIdxCIter indices, TGetV getv)
+			std::vector<uint32_t> m_idx;     // Face indices
+			std::vector<v4> m_pos;           // Positions of the referenced verts
+			std::vector<v4> m_fnorm;         // Face normals
+			std::vector<float> m_angle;      // Corner angles
+			std::vector<uint32_t> m_weld;    // The weld id of each vertex
+			std::vector<uint32_t> m_ofs;     // Offsets into 'm_corners' for each weld id
+			std::vector<uint32_t> m_corners; // Corners grouped by weld id, in corner order
+			std::vector<uint32_t> m_grp;     // The smoothing group of each face
+			std::vector<uint32_t> m_dup;     // The first corner of each new vertex, in order of vertex index
+			std::vector<uint32_t> m_out;     // The output vertex index for each corner
+			std::vector<v4> m_vnorm;         // Normals for the original verts, followed by the new verts
+			std::vector<uint8_t> m_used;     // Original verts referenced by the faces
+			size_t m_vcount;                 // One past the largest vertex index
+			size_t m_new_vidx;               // The index of the first new vertex
+
+			template <typename TIdxCIter, GetVertFn TGetV>
+			Impl(size_t num_indices, TIdxCIter indices, float smoothing_angle, size_t new_vidx, float weld_distance, TGetV getv)
+				:m_idx(num_indices)
+				,m_pos()
+				,m_fnorm(num_indices / 3)
+				,m_angle(num_indices)
+				,m_weld()
+				,m_ofs()
+				,m_corners(num_indices)
+				,m_grp(num_indices / 3)
+				,m_dup()
+				,m_out(num_indices)
+				,m_vnorm()
+				,m_used()
+				,m_vcount()
+				,m_new_vidx()
 			{
 				using VIdx = typename std::iterator_traits<TIdxCIter>::value_type;
 
-				size_t max_index = 0;
-				int sg = 0;
-
-				// Generate a collection of faces including their normals and vertex angles
-				m_faces.reserve(num_indices / 3);
-				for (size_t i = 0; i != num_indices; i += 3)
+				// Copy the indices, the caller may overwrite them in the output
+				for (auto& idx : m_idx)
 				{
-					Face face = {};
-					face.m_idx[0] = *indices++;
-					face.m_idx[1] = *indices++;
-					face.m_idx[2] = *indices++;
-
-					v4 v0 = getv(s_cast<VIdx>(face.m_idx[0]));
-					v4 v1 = getv(s_cast<VIdx>(face.m_idx[1]));
-					v4 v2 = getv(s_cast<VIdx>(face.m_idx[2]));
+					idx = s_cast<uint32_t>(*indices++);
+					m_vcount = std::max<size_t>(m_vcount, idx + size_t(1));
+				}
+				m_new_vidx = std::max(new_vidx, m_vcount);
 
-					// Find the largest vertex index
-					max_index = pr::max(max_index, face.m_idx[0], face.m_idx[1], face.m_idx[2]);
+				// Read the positions of the referenced verts
+				m_used.resize(m_vcount);
+				m_pos.resize(m_vcount);
+				for (auto idx : m_idx) m_used[idx] = 1;
+				ParallelBlocks(m_vcount, BlockSize, [&](size_t beg, size_t end)
+				{
+					for (auto v = beg; v != end; ++v)
+						m_pos[v] = m_used[v] ? v4(getv(s_cast<VIdx>(v))) : v4::Zero();
+				});
 
-					// Get properties of the face (normal, angles, etc)
-					face.m_norm = Normalise(Cross(v1 - v0, v2 - v1), v4::Zero());
-					face.m_angles = TriangleAngles(v0, v1, v2);
-					face.m_grp = ++sg; // each face is in a unique smoothing group to start with
+				WeldVerts(weld_distance);
+				FaceProperties();
+				BuildAdjacency();
+				AssignSmoothingGroups(smoothing_angle);
+				CreateNormals();
+			}
 
-					m_faces.push_back(face);
-				}
+			// Assign weld ids to the referenced verts
+			void WeldVerts(float weld_distance)
+			{
+				m_weld.resize(m_vcount);
+				std::iota(std::begin(m_weld), std::end(m_weld), 0U);
+				if (weld_distance < 0)
+					return;
+
+				// Spatial hash of the vertex positions. Cells are 8 times the weld distance in size, so most verts are only near
+				// verts in the same cell. A weld distance of zero welds verts with identical positions.
+				using cell_t = std::array<int64_t, 3>;
+				auto exact = weld_distance == 0;
+				auto scale = exact ? 0.0f : 0.125f / weld_distance;
+				auto Cell = [=](v4 const& p) -> cell_t
+				{
+					if (exact) return { std::bit_cast<int32_t>(p.x + 0.0f), std::bit_cast<int32_t>(p.y + 0.0f), std::bit_cast<int32_t>(p.z + 0.0f) };
+					return { static_cast<int64_t>(std::floor(p.x * scale)), static_cast<int64_t>(std::floor(p.y * scale)), static_cast<int64_t>(std::floor(p.z * scale)) };
+				};
+				auto Side = [=](float x, int64_t c) -> int64_t
+				{
+					// The adjacent cell within 'weld_distance' of 'x', or 0 if 'x' is not near a cell boundary
+					if (exact) return 0;
+					auto frac = x * scale - static_cast<float>(c);
+					return frac < 0.125f ? -1 : frac > 0.875f ? +1 : 0;
+				};
+				auto Hash = [](cell_t const& c)
+				{
+					auto h =
+						(static_cast<uint64_t>(c[0]) * 0x9E3779B97F4A7C15ULL) ^
+						(static_cast<uint64_t>(c[1]) * 0xC2B2AE3D27D4EB4FULL) ^
+						(static_cast<uint64_t>(c[2]) * 0x165667B19E3779F9ULL);
+					return h ^ (h >> 29);
+				};
 
-				// Generate a collection of verts
-				for (size_t i = 0; i != max_index+1; ++i)
+				// Sort the verts by cell
+				std::vector<std::pair<uint64_t, uint32_t>> hash;
+				hash.reserve(m_vcount);
+				for (size_t v = 0; v != m_vcount; ++v)
+					if (m_used[v]) hash.push_back({ Hash(Cell(m_pos[v])), s_cast<uint32_t>(v) });
+				std::sort(std::execution::par, std::begin(hash), std::end(hash));
+
+				// The start of each cell in 'hash', and an open addressing table from cell hash to cell
+				std::vector<uint32_t> cells;
+				for (size_t i = 0; i != hash.size(); ++i)
+					if (i == 0 || hash[i].first != hash[i - 1].first) cells.push_back(s_cast<uint32_t>(i));
+				cells.push_back(s_cast<uint32_t>(hash.size()));
+				auto mask = std::bit_ceil(2 * cells.size()) - 1;
+				std::vector<uint32_t> table(mask + 1, ~0U);
+				for (uint32_t c = 0, cend = s_cast<uint32_t>(cells.size() - 1); c != cend; ++c)
 				{
-					auto vert = Vert{};
-					vert.m_orig_idx = i;
-					vert.m_new_idx = i;
-					m_verts.push_back(vert);
+					auto s = hash[cells[c]].first & mask;
+					for (; table[s] != ~0U; s = (s + 1) & mask) {}
+					table[s] = c;
 				}
 
-				// Add edges to the corresponding vertices
-				auto add_edge = [&](size_t i0, size_t i1, Face* face)
+				// Weld each vert to the lower indexed verts near it
+				DisjointSets sets(m_vcount);
+				auto dist_sq = weld_distance * weld_distance;
+				auto WeldRange = [&](uint32_t v, uint32_t beg, uint32_t end)
 				{
-					Edge* eptr;
-
-					// Left side
-					eptr = m_verts[i0].m_edges;
-					for (; eptr != nullptr && eptr->m_eidx != i1; eptr = eptr->m_next) {}
-					if (eptr)
+					for (auto i = beg; i != end; ++i)
 					{
-						eptr->m_nonplanar = eptr->m_lface != nullptr;
-						eptr->m_lface = face;
+						auto u = hash[i].second;
+						if (u >= v || LengthSq(m_pos[u] - m_pos[v]) > dist_sq) continue;
+						sets.Union(u, v);
 					}
-					else
+				};
+				ParallelBlocks(cells.size() - 1, BlockSize, [&](size_t beg, size_t end)
+				{
+					for (auto c = beg; c != end; ++c)
 					{
-						Edge& edge = (m_edge_alloc.emplace_back(), m_edge_alloc.back());
-						edge.m_sidx = i0;
-						edge.m_eidx = i1;
-						edge.m_lface = face;
-						edge.m_next = m_verts[i0].m_edges;
-						m_verts[i0].m_edges = &edge;
-						++m_verts[i0].m_edge_count;
+						for (auto i = cells[c]; i != cells[c + 1]; ++i)
+						{
+							auto v = hash[i].second;
+							auto& pos = m_pos[v];
+							WeldRange(v, cells[c], cells[c + 1]);
+
+							// Check the adjacent cells if 'pos' is near the boundary
+							auto cell = Cell(pos);
+							cell_t side = { Side(pos.x, cell[0]), Side(pos.y, cell[1]), Side(pos.z, cell[2]) };
+							for (int n = 1; n != 8; ++n)
+							{
+								if (((n & 1) && side[0] == 0) || ((n & 2) && side[1] == 0) || ((n & 4) && side[2] == 0))
+									continue;
+
+								auto h = Hash({ cell[0] + (n >> 0 & 1) * side[0], cell[1] + (n >> 1 & 1) * side[1], cell[2] + (n >> 2 & 1) * side[2] });
+								for (auto s = h & mask; table[s] != ~0U; s = (s + 1) & mask)
+								{
+									auto adj = table[s];
+									if (hash[cells[adj]].first != h) continue;
+									WeldRange(v, cells[adj], cells[adj + 1]);
+									break;
+								}
+							}
+						}
 					}
+				});
+				ParallelBlocks(m_vcount, BlockSize, [&](size_t beg, size_t end)
+				{
+					for (auto v = beg; v != end; ++v)
+						m_weld[v] = sets.Find(s_cast<uint32_t>(v));
+				});
+			}
 
-					// Right side
-					eptr = m_verts[i1].m_edges;
-					for (; eptr != nullptr && eptr->m_eidx != i0; eptr = eptr->m_next) {}
-					if (eptr)
-					{
-						eptr->m_nonplanar = eptr->m_rface != nullptr;
-						eptr->m_rface = face;
-					}
-					else
+			// Calculate face normals and corner angles
+			void FaceProperties()
+			{
+				ParallelBlocks(m_fnorm.size(), BlockSize, [&](size_t beg, size_t end)
+				{
+					for (auto f = beg; f != end; ++f)
 					{
-						Edge& edge = (m_edge_alloc.emplace_back(), m_edge_alloc.back());
-						edge.m_sidx = i1;
-						edge.m_eidx = i0;
-						edge.m_rface = face;
-						edge.m_next = m_verts[i1].m_edges;
-						m_verts[i1].m_edges = &edge;
-						++m_verts[i1].m_edge_count;
+						auto v0 = m_pos[m_idx[3*f + 0]];
+						auto v1 = m_pos[m_idx[3*f + 1]];
+						auto v2 = m_pos[m_idx[3*f + 2]];
+						auto angles = TriangleAngles(v0, v1, v2);
+						m_fnorm[f] = Normalise(Cross(v1 - v0, v2 - v1), v4::Zero());
+						m_angle[3*f + 0] = angles.x;
+						m_angle[3*f + 1] = angles.y;
+						m_angle[3*f + 2] = angles.z;
 					}
-				};
-
-				// Add the edges to each vertex
-				for (auto& face : m_faces)
-				{
-					add_edge(face.m_idx[0], face.m_idx[1], &face);
-					add_edge(face.m_idx[1], face.m_idx[2], &face);
-					add_edge(face.m_idx[2], face.m_idx[0], &face);
-				}
+				});
 			}
 
-			// Create vertices with distinct normals
-			void GenerateDegenerateVerts(float smoothing_angle)
+			// Bucket the corners by weld id (counting sort)
+			void BuildAdjacency()
 			{
-				(void)smoothing_angle;
-				#if 0
-				// For each original model vertex...
-				for (size_t i = 0, iend = m_verts.size(); i != iend; ++i)
-				{
-					auto& vert = m_verts[i];
-			
-					//TODO
-					// Build a set of all the norms this vertex could have
-					// i.e. one for each face, one for each smooth edge
-					// Partition the group of normals into sets where all
-					// normals in each set are within a solid angle of 'smoothing_angle'
-					// Create a degenerate vert for each normal set
-					// Later, for each face, find the vertex with the normal
-					// closest to the face normal
-				}
-				#endif
+				m_ofs.assign(m_vcount + 1, 0);
+				for (auto idx : m_idx)
+					++m_ofs[m_weld[idx] + 1];
+
+				std::inclusive_scan(std::begin(m_ofs), std::end(m_ofs), std::begin(m_ofs));
+
+				std::vector<uint32_t> fill(std::begin(m_ofs), std::end(m_ofs) - 1);
+				for (uint32_t c = 0, cend = s_cast<uint32_t>(m_idx.size()); c != cend; ++c)
+					m_corners[fill[m_weld[m_idx[c]]]++] = c;
 			}
 
-			// Partition the edges for each vert into separate groups
+			// Join faces across smooth edges
 			void AssignSmoothingGroups(float smoothing_angle)
 			{
 				auto cos_angle_threshold = Cos(smoothing_angle);
-				for (bool no_changes = false; !no_changes; )
+				DisjointSets sets(m_fnorm.size());
+				ParallelBlocks(m_vcount, BlockSize, [&](size_t beg, size_t end)
 				{
-					no_changes = true;
-					for (auto& vert : m_verts)
+					std::vector<EdgeEnd> ends;
+					for (auto w = beg; w != end; ++w)
 					{
-						for (auto eptr = vert.m_edges; eptr != nullptr; eptr = eptr->m_next)
+						// Find the edges from 'w' to higher weld ids
+						ends.resize(0);
+						for (auto i = m_ofs[w]; i != m_ofs[w + 1]; ++i)
 						{
-							bool smooth_edge = eptr->smooth(cos_angle_threshold);
-							if (smooth_edge && eptr->m_lface->m_grp != eptr->m_rface->m_grp)
+							auto c = m_corners[i];
+							auto f = c / 3, k = c % 3;
+							auto next = m_weld[m_idx[3*f + (k + 1) % 3]];
+							auto prev = m_weld[m_idx[3*f + (k + 2) % 3]];
+							if (next > w) ends.push_back({ next, f, true });
+							if (prev > w) ends.push_back({ prev, f, false });
+						}
+						std::sort(std::begin(ends), std::end(ends), [](EdgeEnd const& l, EdgeEnd const& r) { return l.m_other < r.m_other; });
+
+						for (size_t i = 0, j = 0; i != ends.size(); i = j)
+						{
+							// Count the faces on each side of the edge
+							int left = 0, right = 0;
+							uint32_t lface = 0, rface = 0;
+							for (j = i; j != ends.size() && ends[j].m_other == ends[i].m_other; ++j)
 							{
-								// Assign the left and right faces to the same smoothing group (the lowest)
-								eptr->m_lface->m_grp = eptr->m_rface->m_grp = std::min(eptr->m_lface->m_grp, eptr->m_rface->m_grp);
-								no_changes = false;
+								if (ends[j].m_left) { ++left; lface = ends[j].m_face; }
+								else { ++right; rface = ends[j].m_face; }
 							}
+
+							// Two faces needed to be smooth, no more than one face per side
+							if (left != 1 || right != 1)
+								continue;
+							if (Dot3(m_fnorm[lface], m_fnorm[rface]) > cos_angle_threshold)
+								sets.Union(lface, rface);
 						}
 					}
-				}
+				});
+				ParallelBlocks(m_grp.size(), BlockSize, [&](size_t beg, size_t end)
+				{
+					for (auto f = beg; f != end; ++f)
+						m_grp[f] = sets.Find(s_cast<uint32_t>(f));
+				});
 			}
 
-			// Generate the normal for each vertex, adding new vertices for separate smoothing groups
-			void CreateNormals(size_t new_vidx)
+			// Find the wedges and group normals for the corners with weld id 'w'. 'scratch.m_slot' receives the wedge index of each corner.
+			void Wedges(size_t w, Scratch& scratch, bool sum_normals) const
 			{
-				// Set the starting index for any new verts created
-				new_vidx = std::max(new_vidx, m_verts.size());
-
-				// Return the new index for vertex 'idx' in smoothing group 'face.m_grp'
-				auto vert_index = [&](Face& face, size_t idx)
+				scratch.m_wedges.resize(0);
+				scratch.m_norms.resize(0);
+				scratch.m_slot.resize(0);
+				for (auto i = m_ofs[w]; i != m_ofs[w + 1]; ++i)
 				{
-					// m_verts[idx] is the head of a linked list of verts added for
-					// each vertex with a unique normal.
-					auto* vptr = &m_verts[idx];
-
-					// Vertex has not yet been assigned a smoothing group
-					if (vptr->m_grp == 0)
+					auto c = m_corners[i];
+					auto vert = m_idx[c];
+					auto grp = m_grp[c / 3];
+
+					// Find or add the wedge
+					auto dup = false;
+					auto slot = scratch.m_wedges.size();
+					for (size_t j = 0; j != scratch.m_wedges.size(); ++j)
 					{
-						vptr->m_norm = face.normal(idx);
-						vptr->m_grp = face.m_grp;
-						return vptr->m_new_idx;
+						auto& wedge = scratch.m_wedges[j];
+						if (wedge.m_vert != vert) continue;
+						if (wedge.m_grp == grp) { slot = j; break; }
+						dup = true;
 					}
+					if (slot == scratch.m_wedges.size())
+						scratch.m_wedges.push_back({ vert, grp, c, dup });
+
+					scratch.m_slot.push_back(s_cast<uint32_t>(slot));
 
-					// Find a vertex with a matching smoothing group
-					for (; vptr != nullptr && vptr->m_grp != face.m_grp; vptr = vptr->m_next) {}
-					if (vptr)
+					// Accumulate the group normals
+					if (!sum_normals) continue;
+					auto norm = m_fnorm[c / 3] * m_angle[c];
+					auto n = std::find_if(std::begin(scratch.m_norms), std::end(scratch.m_norms), [=](GroupNorm const& gn) { return gn.m_grp == grp; });
+					if (n != std::end(scratch.m_norms))
+						n->m_norm += norm;
+					else
+						scratch.m_norms.push_back({ norm, grp });
+				}
+			}
+
+			// Assign output vertex indices and normals
+			void CreateNormals()
+			{
+				// Mark the first corner of each new vertex
+				std::fill(std::begin(m_out), std::end(m_out), 0U);
+				ParallelBlocks(m_vcount, BlockSize, [&](size_t beg, size_t end)
+				{
+					Scratch scratch;
+					for (auto w = beg; w != end; ++w)
 					{
-						vptr->m_norm += face.normal(idx);
-						return vptr->m_new_idx;
+						Wedges(w, scratch, false);
+						for (auto& wedge : scratch.m_wedges)
+							m_out[wedge.m_first] = wedge.m_dup;
 					}
+				});
 
-					// Add a new copy of this vertex
-					m_verts.push_back(Vert{});
-					vptr = &m_verts.back();
-					vptr->m_orig_idx = idx;
-					vptr->m_new_idx = new_vidx++;
-					vptr->m_norm = face.normal(idx);
-					vptr->m_grp = face.m_grp;
-					vptr->m_next = m_verts[idx].m_next;
-					m_verts[idx].m_next = vptr;
-					return vptr->m_new_idx;
-				};
-
-				// Loop over the faces updating the vertex indices if necessary
-				for (auto& face : m_faces)
+				// New verts are numbered in face order. Replace the marks with the number of new verts before each corner.
+				std::vector<uint32_t> rank((m_out.size() + BlockSize - 1) / BlockSize + 1, 0U);
+				ParallelBlocks(m_out.size(), BlockSize, [&](size_t beg, size_t end)
 				{
-					face.m_idx[0] = vert_index(face, face.m_idx[0]);
-					face.m_idx[1] = vert_index(face, face.m_idx[1]);
-					face.m_idx[2] = vert_index(face, face.m_idx[2]);
-				}
+					rank[beg / BlockSize + 1] = std::accumulate(std::begin(m_out) + beg, std::begin(m_out) + end, 0U);
+				});
+				std::inclusive_scan(std::begin(rank), std::end(rank), std::begin(rank));
+				ParallelBlocks(m_out.size(), BlockSize, [&](size_t beg, size_t end)
+				{
+					for (auto c = beg, r = size_t(rank[beg / BlockSize]); c != end; ++c)
+						r += std::exchange(m_out[c], s_cast<uint32_t>(r));
+				});
+				m_dup.resize(rank.back());
+				m_vnorm.resize(m_vcount + m_dup.size());
+				ParallelBlocks(m_vcount, BlockSize, [&](size_t beg, size_t end)
+				{
+					Scratch scratch;
+					for (auto w = beg; w != end; ++w)
+					{
+						Wedges(w, scratch, true);
+
+						// Output index and normal for each wedge
+						for (auto& wedge : scratch.m_wedges)
+						{
+							auto n = std::find_if(std::begin(scratch.m_norms), std::end(scratch.m_norms), [&](GroupNorm const& gn) { return gn.m_grp == wedge.m_grp; });
+							auto norm = Normalise(n->m_norm, v4::Zero());
+							if (wedge.m_dup)
+							{
+								auto i = m_out[wedge.m_first];
+								m_dup[i] = wedge.m_first;
+								m_vnorm[m_vcount + i] = norm;
+								wedge.m_vert = s_cast<uint32_t>(m_new_vidx + i);
+							}
+							else
+							{
+								m_vnorm[wedge.m_vert] = norm;
+							}
+						}
+
+						// Remap the corners
+						for (auto i = m_ofs[w]; i != m_ofs[w + 1]; ++i)
+							m_out[m_corners[i]] = scratch.m_wedges[scratch.m_slot[i - m_ofs[w]]].m_vert;
+					}
+				});
 			}
 		};
 	}
@@ -293,9 +491,11 @@ namespace pr::geometry
 	// 'smoothing_angle' is the threshold above which normals are not merged and a new vertex is created (in radians)
 	// 'new_vidx' is the start index to assign to new vertices. Effectively, it's the size of the container 'getv' is
 	//   pulling from. You can set this to zero in which case one passed the largest vertex index encountered will be used.
-	// 'getv' is an accessor to the vertex for a given face index: v4 getv(VIdx idx)
+	// 'getv' is an accessor to the vertex for a given face index: v4 getv(VIdx idx). It is called concurrently, once per referenced vertex.
 	// 'vout' outputs the new vertex normals: vout(VIdx new_idx, VIdx orig_idx, v4 normal)
 	// 'iout' outputs the new face indices: iout(VIdx i0, VIdx i1, VIdx i2)
+	// 'weld_distance' if >= 0, verts within this distance of each other are treated as the same vertex when finding adjacent
+	//   faces and summing normals, so that faces either side of a texture or colour seam can be smoothed. Verts are not merged.
 	// This function will only add verts, not remove any, so 'vout' can overwrite and add to the existing container.
 	// It also outputs the verts in order.
 	// e.g.
@@ -313,46 +513,39 @@ namespace pr::geometry
 	//         *iptr++ = i2;
 	//      }
 	template <typename TIdxCIter, GetVertFn TGetV, generate_normals::VertOutFn TVertOut, generate_normals::IdxOutFn TIdxOut>
-	void GenerateNormals(int num_indices, TIdxCIter indices, float smoothing_angle, int new_vidx, TGetV getv, TVertOut vout, TIdxOut iout)
+	void GenerateNormals(int num_indices, TIdxCIter indices, float smoothing_angle, int new_vidx, TGetV getv, TVertOut vout, TIdxOut iout, float weld_distance = -1.0f)
 	{
 		// Notes:
-		//  - Can't weld verts because that would destroy distinct texture verts or colours.
-		//    If verts are distinct it's likely they represent a discontinuous edge in the model
-		//    and are therefore not edges that should be smoothed anyway.
+		//  - Distinct verts are never merged because that would destroy distinct texture verts or colours.
+		//    Welding only affects which faces are considered adjacent.
 		using VIdx = typename std::iterator_traits<TIdxCIter>::value_type;
 
 		if (num_indices % 3 != 0)
 			throw std::runtime_error("GenerateNormals expects triangle list data");
 
 		// Generate the normals
-		generate_normals::Impl gen(num_indices, indices, smoothing_angle, new_vidx, getv);
+		generate_normals::Impl gen(s_cast<size_t>(num_indices), indices, smoothing_angle, s_cast<size_t>(new_vidx), weld_distance, getv);
 
-		// Output the new verts
-		for (auto& vert : gen.m_verts)
+		// Output the original verts that are used, then the new verts.
+		// Callback function should duplicate the original vertex and set the normal to that provided.
+		for (size_t v = 0; v != gen.m_vcount; ++v)
 		{
-			// Skip verts that weren't used
-			if (vert.m_grp == 0)
-				continue;
-
-			// On x86 release, vert.m_norm isn't aligned, don't know why.
-			// I think it's something to do with std::deque.
-			// Copying to stack makes it aligned
-			v4 norm = vert.m_norm;
-
-			// Output the original vertex index, and the normal.
-			// Callback function should duplicate the original vertex and set the normal to that provided.
-			auto new_idx = s_cast<VIdx>(vert.m_new_idx);
-			auto org_idx = s_cast<VIdx>(vert.m_orig_idx);
-			vout(new_idx, org_idx, Normalise(norm, v4::Zero()));
+			if (!gen.m_used[v]) continue;
+			vout(s_cast<VIdx>(v), s_cast<VIdx>(v), gen.m_vnorm[v]);
+		}
+		for (size_t i = 0; i != gen.m_dup.size(); ++i)
+		{
+			auto new_idx = s_cast<VIdx>(gen.m_new_vidx + i);
+			auto org_idx = s_cast<VIdx>(gen.m_idx[gen.m_dup[i]]);
+			vout(new_idx, org_idx, gen.m_vnorm[gen.m_vcount + i]);
 		}
 
-		// Output the new faces
-		for (auto& face : gen.m_faces)
+		// Output the new faces, the same number as provided via 'indices'
+		for (size_t i = 0; i != gen.m_out.size(); i += 3)
 		{
-			// Output faces, should be the same number as provided via 'indices'
-			auto i0 = s_cast<VIdx>(face.m_idx[0]);
-			auto i1 = s_cast<VIdx>(face.m_idx[1]);
-			auto i2 = s_cast<VIdx>(face.m_idx[2]);
+			auto i0 = s_cast<VIdx>(gen.m_out[i + 0]);
+			auto i1 = s_cast<VIdx>(gen.m_out[i + 1]);
+			auto i2 = s_cast<VIdx>(gen.m_out[i + 2]);
 			iout(i0, i1, i2);
 		}
 	}
@@ -479,6 +672,32 @@ namespace pr::geometry
 					break;
 			}
 		}
+
+		{// Welding smooths across seams
+			v4 pos[] =
+			{
+				v4{0.0f, 0.0f, 0.0f, 1.0f}, v4{1.0f, 0.0f, 0.0f, 1.0f}, v4{1.0f, 1.0f, 0.0f, 1.0f}, v4{0.0f, 1.0f, 0.0f, 1.0f},
+				v4{1.0f, 0.0f, 0.0f, 1.0f}, v4{2.0f, 0.0f, 0.2f, 1.0f}, v4{2.0f, 1.0f, 0.2f, 1.0f}, v4{1.0f, 1.0f, 0.0f, 1.0f},
+			};
+			int idx[] =
+			{
+				0, 1, 2,  0, 2, 3,
+				4, 5, 6,  4, 6, 7,
+			};
+			for (auto weld : { -1.0f, 0.0f })
+			{
+				std::vector<v4> norms;
+				GenerateNormals(_countof(idx), &idx[0], DegreesToRadians(30.0f), 0,
+					[&](int i) { return pos[i]; },
+					[&](int new_idx, int, v4 norm) { norms.push_back(norm); assert(new_idx + 1 == isize(norms)); },
+					[&](int, int, int) {},
+					weld);
+
+				PR_EXPECT(norms.size() == 8U);
+				PR_EXPECT(weld < 0 ? norms[1].x == 0.0f : norms[1].x < 0.0f);
+				PR_EXPECT((norms[1] == norms[4]) == (weld >= 0));
+			}
+		}
 	}
 }
 #endif
@@ -516,6 +516,249 @@ namespace pr::math
 			bb.LowerY() >= -wh.y && bb.UpperY() <= +wh.y;
 	}
 
+	// Bounding spheres as structure-of-arrays streams, for batch 'IsWithin' tests
+	template <ScalarTypeFP S> struct BoundingSphereSoA
+	{
+		std::span<S const> x, y, z; // Centres
+		std::span<S const> radius;  // Radii
+
+		constexpr size_t size() const noexcept
+		{
+			return x.size();
+		}
+	};
+
+	// Bounding boxes as structure-of-arrays streams, for batch 'IsWithin' tests
+	template <ScalarTypeFP S> struct BoundingBoxSoA
+	{
+		std::span<S const> x, y, z;    // Centres
+		std::span<S const> ex, ey, ez; // Half extents
+
+		constexpr size_t size() const noexcept
+		{
+			return x.size();
+		}
+	};
+
+	namespace frustum_cull
+	{
+		// The frustum side planes and near/far clip values in the form used by the batch tests
+		template <ScalarTypeFP S> struct Planes
+		{
+			S px[4], py[4], pz[4], pw[4]; // The side planes (same order as EPlane)
+			S ax[4], ay[4], az[4];        // Absolute values of the plane normal components (for box extents)
+			S zshift;                     // Offset that puts the frustum apex at (0,0,zshift) (see 'IsWithin')
+			S znear, zfar;                // The z coordinates of the near and far clip planes (after shifting)
+
+			Planes(Frustum3<S> const& frustum, Vec2<S> nf) noexcept
+			{
+				for (int k = 0; k != 4; ++k)
+				{
+					px[k] = frustum.m_Tplanes.x[k];
+					py[k] = frustum.m_Tplanes.y[k];
+					pz[k] = frustum.m_Tplanes.z[k];
+					pw[k] = frustum.m_Tplanes.w[k];
+					ax[k] = Abs(px[k]);
+					ay[k] = Abs(py[k]);
+					az[k] = Abs(pz[k]);
+				}
+
+				// Same clip values as the scalar 'IsWithin'
+				if (!frustum.orthographic())
+				{
+					zshift = frustum.zfar();
+					znear = zshift - nf.x;
+					zfar = nf.y > 0 ? zshift - nf.y : nf.y == 0 ? S(0) : -std::numeric_limits<S>::infinity();
+				}
+				else
+				{
+					zshift = S(0);
+					znear = -nf.x;
+					zfar = nf.y > 0 ? -nf.y : -std::numeric_limits<S>::infinity();
+				}
+			}
+
+			// Classify a bounding volume: 0 = outside, 1 = intersecting, 2 = entirely inside
+			int Classify(S x, S y, S z, S ex, S ey, S ez, bool box) const noexcept
+			{
+				z += zshift;
+				if (z - ez > znear || z + ez < zfar)
+					return 0;
+
+				auto inside = z + ez <= znear && z - ez >= zfar;
+				for (int k = 0; k != 4; ++k)
+				{
+					auto dist = x * px[k] + y * py[k] + z * pz[k] + pw[k];
+					auto ext = box ? ex * ax[k] + ey * ay[k] + ez * az[k] : ex;
+					if (dist + ext < 0) return 0;
+					inside &= dist - ext >= 0;
+				}
+				return inside ? 2 : 1;
+			}
+		};
+
+		// Return a bit mask of the volumes in [beg, end) (at most 64) that are within the frustum. Bit 0 is 'beg'.
+		// 'ex,ey,ez' are the box half extents, or all equal to the sphere radius when 'Box' is false.
+		template <bool Box, ScalarTypeFP S>
+		uint64_t TestRange(Planes<S> const& p, S const* x, S const* y, S const* z, S const* ex, S const* ey, S const* ez, int beg, int end) noexcept
+		{
+			pr_assert(end - beg <= 64);
+			uint64_t bits = 0;
+			int i = beg;
+
+			// Eight volumes per iteration
+			if constexpr (PR_MATHS_USE_INTRINSICS && std::is_same_v<S, float>)
+			{
+				auto const zero = _mm256_setzero_ps();
+				auto const zshift = _mm256_set1_ps(p.zshift);
+				auto const znear = _mm256_set1_ps(p.znear);
+				auto const zfar = _mm256_set1_ps(p.zfar);
+				for (; i + 8 <= end; i += 8)
+				{
+					auto X = _mm256_loadu_ps(x + i);
+					auto Y = _mm256_loadu_ps(y + i);
+					auto Z = _mm256_add_ps(_mm256_loadu_ps(z + i), zshift);
+					auto EX = _mm256_loadu_ps(ex + i);
+					auto EY = Box ? _mm256_loadu_ps(ey + i) : EX;
+					auto EZ = Box ? _mm256_loadu_ps(ez + i) : EX;
+
+					// Near and far planes
+					auto mask = _mm256_and_ps(
+						_mm256_cmp_ps(_mm256_sub_ps(Z, EZ), znear, _CMP_LE_OQ),
+						_mm256_cmp_ps(_mm256_add_ps(Z, EZ), zfar, _CMP_GE_OQ));
+
+					// Side planes
+					for (int k = 0; k != 4; ++k)
+					{
+						auto dist = _mm256_add_ps(
+							_mm256_add_ps(_mm256_mul_ps(X, _mm256_set1_ps(p.px[k])), _mm256_mul_ps(Y, _mm256_set1_ps(p.py[k]))),
+							_mm256_add_ps(_mm256_mul_ps(Z, _mm256_set1_ps(p.pz[k])), _mm256_set1_ps(p.pw[k])));
+						auto ext = !Box ? EX : _mm256_add_ps(
+							_mm256_add_ps(_mm256_mul_ps(EX, _mm256_set1_ps(p.ax[k])), _mm256_mul_ps(EY, _mm256_set1_ps(p.ay[k]))),
+							_mm256_mul_ps(EZ, _mm256_set1_ps(p.az[k])));
+
+						mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(dist, ext), zero, _CMP_GE_OQ));
+					}
+
+					bits |= static_cast<uint64_t>(_mm256_movemask_ps(mask)) << (i - beg);
+				}
+			}
+
+			// Remaining volumes
+			for (; i != end; ++i)
+			{
+				auto within = Box
+					? p.Classify(x[i], y[i], z[i], ex[i], ey[i], ez[i], true) != 0
+					: p.Classify(x[i], y[i], z[i], ex[i], ex[i], ex[i], false) != 0;
+				bits |= static_cast<uint64_t>(within) << (i - beg);
+			}
+			return bits;
+		}
+		template <ScalarTypeFP S>
+		uint64_t TestRange(Planes<S> const& p, BoundingSphereSoA<S> const& spheres, int beg, int end) noexcept
+		{
+			return TestRange<false>(p, spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.radius.data(), spheres.radius.data(), spheres.radius.data(), beg, end);
+		}
+		template <ScalarTypeFP S>
+		uint64_t TestRange(Planes<S> const& p, BoundingBoxSoA<S> const& boxes, int beg, int end) noexcept
+		{
+			return TestRange<true>(p, boxes.x.data(), boxes.y.data(), boxes.z.data(), boxes.ex.data(), boxes.ey.data(), boxes.ez.data(), beg, end);
+		}
+
+		// Set the bits in 'visible' for the volumes in [beg, end) that are within the frustum
+		template <ScalarTypeFP S, typename Volumes>
+		void Test(Planes<S> const& p, Volumes const& volumes, int beg, int end, std::span<uint64_t> visible) noexcept
+		{
+			for (int i = beg; i < end;)
+			{
+				auto e = std::min(end, (i / 64 + 1) * 64);
+				visible[i / 64] |= TestRange(p, volumes, i, e) << (i % 64);
+				i = e;
+			}
+		}
+
+		// Set the bits in 'visible' for [beg, end)
+		inline void SetBits(int beg, int end, std::span<uint64_t> visible) noexcept
+		{
+			for (int i = beg; i < end;)
+			{
+				auto e = std::min(end, (i / 64 + 1) * 64);
+				auto n = e - i;
+				visible[i / 64] |= (n == 64 ? ~0ULL : ((1ULL << n) - 1)) << (i % 64);
+				i = e;
+			}
+		}
+
+		// Write the indices of the set bits in 'visible' to 'indices'. Returns the number of indices written.
+		inline int Compact(std::span<uint64_t const> visible, std::span<int> indices) noexcept
+		{
+			int count = 0;
+			for (int w = 0, wend = static_cast<int>(visible.size()); w != wend; ++w)
+			{
+				for (auto bits = visible[w]; bits != 0; bits &= bits - 1)
+					indices[count++] = w * 64 + std::countr_zero(bits);
+			}
+			return count;
+		}
+	}
+
+	// Batch test of bounding spheres or boxes against 'frustum'.
+	// Bit 'i' of 'visible' is set if volume 'i' is within the frustum, 'visible' must have at least (size + 63) / 64 words.
+	// Spheres give the same result as the scalar 'IsWithin'. Boxes are tested against each plane using the box's
+	// projected extent, which is conservative near the frustum edges. Floats are tested eight at a time using AVX.
+	template <ScalarTypeFP S> inline void IsWithin(Frustum3<S> const& frustum, BoundingSphereSoA<S> const& spheres, std::span<uint64_t> visible, Vec2<S> nf = Zero<Vec2<S>>()) noexcept
+	{
+		pr_assert(visible.size() * 64 >= spheres.size() && "'visible' is too small");
+		frustum_cull::Planes<S> planes(frustum, nf);
+		std::fill(std::begin(visible), std::end(visible), 0ULL);
+		frustum_cull::Test(planes, spheres, 0, static_cast<int>(spheres.size()), visible);
+	}
+	template <ScalarTypeFP S> inline void IsWithin(Frustum3<S> const& frustum, BoundingBoxSoA<S> const& boxes, std::span<uint64_t> visible, Vec2<S> nf = Zero<Vec2<S>>()) noexcept
+	{
+		pr_assert(visible.size() * 64 >= boxes.size() && "'visible' is too small");
+		frustum_cull::Planes<S> planes(frustum, nf);
+		std::fill(std::begin(visible), std::end(visible), 0ULL);
+		frustum_cull::Test(planes, boxes, 0, static_cast<int>(boxes.size()), visible);
+	}
+
+	// Batch test with a hierarchy of parent bounds. Group 'g' bounds the volumes [group_start[g], group_start[g+1]),
+	// so 'group_start' has one more entry than 'groups'. Groups outside the frustum are skipped, and groups entirely
+	// within the frustum mark all of their volumes as visible without testing them.
+	template <ScalarTypeFP S, typename Volumes> requires (std::is_same_v<Volumes, BoundingSphereSoA<S>> || std::is_same_v<Volumes, BoundingBoxSoA<S>>)
+	inline void IsWithin(Frustum3<S> const& frustum, BoundingBoxSoA<S> const& groups, std::span<int const> group_start, Volumes const& volumes, std::span<uint64_t> visible, Vec2<S> nf = Zero<Vec2<S>>()) noexcept
+	{
+		pr_assert(group_start.size() == groups.size() + 1 && "'group_start' should have one more entry than 'groups'");
+		pr_assert(visible.size() * 64 >= volumes.size() && "'visible' is too small");
+		frustum_cull::Planes<S> planes(frustum, nf);
+		std::fill(std::begin(visible), std::end(visible), 0ULL);
+		for (int g = 0, gend = static_cast<int>(groups.size()); g != gend; ++g)
+		{
+			switch (planes.Classify(groups.x[g], groups.y[g], groups.z[g], groups.ex[g], groups.ey[g], groups.ez[g], true))
+			{
+				case 0: break;
+				case 1: frustum_cull::Test(planes, volumes, group_start[g], group_start[g + 1], visible); break;
+				case 2: frustum_cull::SetBits(group_start[g], group_start[g + 1], visible); break;
+			}
+		}
+	}
+
+	// Batch tests that write the indices of the visible volumes to 'indices' (which must be at least as long as the number of volumes).
+	// Returns the number of visible volumes.
+	template <ScalarTypeFP S> inline int IsWithin(Frustum3<S> const& frustum, BoundingSphereSoA<S> const& spheres, std::span<int> indices, Vec2<S> nf = Zero<Vec2<S>>())
+	{
+		pr_assert(indices.size() >= spheres.size() && "'indices' is too small");
+		std::vector<uint64_t> visible((spheres.size() + 63) / 64);
+		IsWithin(frustum, spheres, visible, nf);
+		return frustum_cull::Compact(visible, indices);
+	}
+	template <ScalarTypeFP S> inline int IsWithin(Frustum3<S> const& frustum, BoundingBoxSoA<S> const& boxes, std::span<int> indices, Vec2<S> nf = Zero<Vec2<S>>())
+	{
+		pr_assert(indices.size() >= boxes.size() && "'indices' is too small");
+		std::vector<uint64_t> visible((boxes.size() + 63) / 64);
+		IsWithin(frustum, boxes, visible, nf);
+		return frustum_cull::Compact(visible, indices);
+	}
+
 	// Grow a frustum (i.e. move it along +f2w.Z growing zfar while preserving fov/aspect) so that 'ws_pt','ws_bbox', or 'ws_sphere' are within the frustum.
 	template <ScalarTypeFP S> inline void pr_vectorcall Grow(Frustum3<S>& frustum, Mat4x4<S>& f2w, Vec2<S>& nf, Vec4<S> ws_pt, S radius) noexcept
 	{
@@ -913,6 +1156,104 @@ namespace pr::math::tests
 				PR_EXPECT(within);
 			}
 		}
+		PRUnitTestMethod(BatchIsWithin, float, double)
+		{
+			using Vec4 = Vec4<T>;
+			using Vec2 = Vec2<T>;
+
+			// Groups of spheres in clusters around the frustum
+			int const GroupCount = 40, GroupSize = 37;
+			std::uniform_real_distribution<T> rdist(T(0.01), T(0.3));
+			std::vector<T> x, y, z, r, gx, gy, gz, gex, gey, gez;
+			std::vector<int> group_start = { 0 };
+			for (int g = 0; g != GroupCount; ++g)
+			{
+				auto centre = Random<Vec4>(rng, Vec4(T(-4), T(-4), T(-6), T(1)), Vec4(T(4), T(4), T(1), T(1)));
+				auto bbox = BoundingBox<T>::Reset();
+				for (int i = 0; i != GroupSize; ++i)
+				{
+					auto pt = centre + Random<Vec4>(rng, Vec4(T(-1), T(-1), T(-1), T(0)), Vec4(T(1), T(1), T(1), T(0)));
+					auto rad = rdist(rng);
+					x.push_back(pt.x);
+					y.push_back(pt.y);
+					z.push_back(pt.z);
+					r.push_back(rad);
+					Grow(bbox, BoundingSphere<T>(pt, rad));
+				}
+				gx.push_back(bbox.Centre().x);
+				gy.push_back(bbox.Centre().y);
+				gz.push_back(bbox.Centre().z);
+				gex.push_back(bbox.Radius().x);
+				gey.push_back(bbox.Radius().y);
+				gez.push_back(bbox.Radius().z);
+				group_start.push_back(static_cast<int>(x.size()));
+			}
+
+			BoundingSphereSoA<T> spheres = { x, y, z, r };
+			BoundingBoxSoA<T> boxes = { x, y, z, r, r, r };
+			BoundingBoxSoA<T> groups = { gx, gy, gz, gex, gey, gez };
+			auto count_all = static_cast<int>(x.size());
+			auto words = (x.size() + 63) / 64;
+
+			Frustum3<T> frusta[] = {
+				Frustum3<T>::MakeFA(constants<T>::tau_by_8, T(1.5), T(5)),
+				Frustum3<T>::MakeOrtho(Vec2(T(4), T(3))),
+			};
+			Vec2 nfs[] = { Vec2(T(0), T(0)), Vec2(T(0.5), T(4)) };
+			for (auto& f : frusta)
+			{
+				for (auto nf : nfs)
+				{
+					if (f.orthographic() && nf.y == 0)
+						continue;
+
+					// Spheres that touch a plane (to within 'tol') can be classified differently by
+					// the vectorised and scalar tests because of rounding. These are not compared.
+					auto const tol = T(1e-3);
+					std::vector<uint64_t> near(words);
+					for (int i = 0; i != count_all; ++i)
+					{
+						auto pos = Vec4(x[i], y[i], z[i], T(1));
+						if (IsWithin(f, pos, r[i] + tol, nf) != IsWithin(f, pos, r[i] - tol, nf))
+							near[i / 64] |= uint64_t(1) << (i % 64);
+					}
+
+					// Spheres match the scalar test
+					std::vector<uint64_t> visible(words);
+					IsWithin(f, spheres, visible, nf);
+					for (int i = 0; i != count_all; ++i)
+					{
+						auto within = IsWithin(f, Vec4(x[i], y[i], z[i], T(1)), r[i], nf);
+						auto bit = ((visible[i / 64] >> (i % 64)) & 1) != 0;
+						auto skip = ((near[i / 64] >> (i % 64)) & 1) != 0;
+						PR_EXPECT(within == bit || skip);
+					}
+
+					// Index lists match the bit mask
+					std::vector<int> indices(x.size());
+					auto count = IsWithin(f, spheres, std::span<int>(indices), nf);
+					PR_EXPECT(count <= count_all);
+					for (int j = 0, i = 0; i != count_all; ++i)
+					{
+						if (((visible[i / 64] >> (i % 64)) & 1) == 0) continue;
+						PR_EXPECT(j < count && indices[j] == i);
+						++j;
+					}
+
+					// Boxes that enclose the spheres are a superset
+					std::vector<uint64_t> box_visible(words);
+					IsWithin(f, boxes, box_visible, nf);
+					for (size_t w = 0; w != words; ++w)
+						PR_EXPECT((visible[w] & ~box_visible[w] & ~near[w]) == 0);
+
+					// The hierarchy gives the same result as the flat test
+					std::vector<uint64_t> hier_visible(words);
+					IsWithin(f, groups, std::span<int const>(group_start), spheres, hier_visible, nf);
+					for (size_t w = 0; w != words; ++w)
+						PR_EXPECT(((hier_visible[w] ^ visible[w]) & ~near[w]) == 0);
+				}
+			}
+		}
 		template <ScalarTypeFP S> void DumpFrustum(Frustum3<S> const& f, Mat4x4<S> const& f2w) noexcept
 		{
 			(void)f,f2w;
@@ -401,7 +401,7 @@ namespace pr::math
 	{
 		S length = 0;
 		int i0 = std::clamp(static_cast<int>(std::floor(t0)), 0, static_cast<int>(spline.m_curves.size()) - 1);
-		int i1 = std::clamp(static_cast<int>(std::ceil(t1)), 0, static_cast<int>(spline.m_curves.size()) - 1);
+		int i1 = std::clamp(static_cast<int>(std::floor(t1)), 0, static_cast<int>(spline.m_curves.size()) - 1);
 		for (auto i = i0; i <= i1; ++i)
 		{
 			auto const& curve = spline.m_curves[i];
@@ -410,7 +410,7 @@ namespace pr::math
 				i == i1 ? t1 - i1 : S(1),
 				tol);
 		}
-		return length; // CHECK ME
+		return length;
 	}
 
 	// Fill a container of points with a rasterized version of 'spline'. Returns the span of used points.
@@ -558,8 +558,253 @@ namespace pr::math
 		return out.subspan(0, count);
 	}
 
+	// Evaluate the positions and tangents (P'(t)) of 'spline' at many times. Empty output spans are not computed.
+	// Runs of times that fall within the same curve are evaluated four at a time, as one matrix product per output.
+	template <ScalarTypeFP S>
+	void EvalMany(CubicSpline<S> const& spline, std::span<S const> times, std::span<Vec4<S>> positions, std::span<Vec4<S>> tangents) noexcept
+	{
+		using Vec4 = Vec4<S>;
+		using Mat4x4 = Mat4x4<S>;
+
+		auto count = times.size();
+		auto want_pos = !positions.empty();
+		auto want_tan = !tangents.empty();
+		pr_assert((!want_pos || positions.size() >= count) && (!want_tan || tangents.size() >= count) && "Output buffers are too small");
+		if (spline.m_curves.empty())
+			return;
+
+		for (size_t i = 0; i != count;)
+		{
+			// Find the run of times (up to 4) on the same curve
+			auto idx = spline.CurveIndex(times[i]);
+			size_t n = 1;
+			for (; n != 4 && i + n != count && spline.CurveIndex(times[i + n]) == idx; ++n) {}
+
+			// Basis vectors in the columns. Unused columns repeat the last time.
+			Mat4x4 basis, dbasis;
+			for (int j = 0; j != 4; ++j)
+			{
+				auto t = Clamp<S>(times[i + std::min<size_t>(j, n - 1)] - idx, 0, 1);
+				basis[j] = Vec4{ 1, t, t * t, t * t * t };
+				dbasis[j] = Vec4{ 0, 1, 2 * t, 3 * t * t };
+			}
+
+			auto const& curve = spline.m_curves[idx];
+			if (want_pos)
+			{
+				auto pos = curve.m_coeff * basis;
+				for (size_t j = 0; j != n; ++j)
+					positions[i + j] = pos[static_cast<int>(j)];
+			}
+			if (want_tan)
+			{
+				auto tan = curve.m_coeff * dbasis;
+				for (size_t j = 0; j != n; ++j)
+					tangents[i + j] = tan[static_cast<int>(j)];
+			}
+			i += n;
+		}
+	}
+
+	// Adaptively tessellate 'spline' over [t0,t1] into a polyline that is within 'tol' of the spline.
+	// Each section is split until the Bezier control points of that section are within 'tol' of its chord.
+	// By the convex hull property, this bounds the deviation of the curve itself. Unlike 'Raster', the
+	// number of points is not fixed in advance; points are passed to 'out' in order, one call per point.
+	template <ScalarTypeFP S, std::invocable<Vec4<S>> VOut>
+	void Tessellate(CubicSpline<S> const& spline, S t0, S t1, S tol, VOut out, bool store_time_in_w = false)
+	{
+		using Vec4 = Vec4<S>;
+		using CubicCurve3 = CubicCurve3<S>;
+
+		struct L
+		{
+			// Squared distance from 'p' to the line segment 'a-b'
+			static S DistSq(Vec4 p, Vec4 a, Vec4 b) noexcept
+			{
+				auto ab = (b - a).w0();
+				auto ap = (p - a).w0();
+				auto len_sq = LengthSq(ab);
+				auto t = len_sq > tiny<S> ? Clamp<S>(Dot(ap, ab) / len_sq, 0, 1) : S(0);
+				return LengthSq(ap - t * ab);
+			}
+
+			// Emit the end point of [a,b] on 'curve' (time offset by 'ofs'), subdividing until flat
+			static void Subdivide(CubicCurve3 const& curve, S ofs, S a, Vec4 pa, Vec4 da, S b, Vec4 pb, Vec4 db, S tol_sq, VOut& out, bool store_time_in_w, int depth)
+			{
+				// Bezier control points of the section [a,b]
+				auto h = (b - a) / 3;
+				auto c1 = pa + h * da;
+				auto c2 = pb - h * db;
+
+				static constexpr int max_depth = 20;
+				if (depth != max_depth && (DistSq(c1, pa, pb) > tol_sq || DistSq(c2, pa, pb) > tol_sq))
+				{
+					auto m = S(0.5) * (a + b);
+					auto pm = curve.Eval(m);
+					auto dm = curve.EvalDerivative(m);
+					Subdivide(curve, ofs, a, pa, da, m, pm, dm, tol_sq, out, store_time_in_w, depth + 1);
+					Subdivide(curve, ofs, m, pm, dm, b, pb, db, tol_sq, out, store_time_in_w, depth + 1);
+					return;
+				}
+
+				if (store_time_in_w) pb.w = ofs + b;
+				out(pb);
+			}
+		};
+
+		if (spline.m_curves.empty())
+			return;
+
+		t0 = std::clamp(t0, spline.Time0(), spline.Time1());
+		t1 = std::clamp(t1, spline.Time0(), spline.Time1());
+		if (t1 < t0)
+			return;
+
+		// The first point
+		{
+			auto p0 = spline.Position(t0);
+			if (store_time_in_w) p0.w = t0;
+			out(p0);
+		}
+
+		// Tessellate each curve overlapping [t0,t1] separately, so sections never span a curve join
+		for (int i = spline.CurveIndex(t0), iend = spline.CurveIndex(t1); i <= iend; ++i)
+		{
+			auto const& curve = spline.m_curves[i];
+			auto a = std::max(t0 - i, S(0));
+			auto b = std::min(t1 - i, S(1));
+			if (b <= a)
+				continue;
+
+			L::Subdivide(curve, static_cast<S>(i), a, curve.Eval(a), curve.EvalDerivative(a), b, curve.Eval(b), curve.EvalDerivative(b), tol * tol, out, store_time_in_w, 0);
+		}
+	}
+
 	#pragma endregion
 
+	// Arc length parameterisation of a spline
+	template <ScalarTypeFP S>
+	struct ArcLengthTable
+	{
+		// Notes:
+		//  - Stores the cumulative arc length at evenly spaced times, so that mapping a distance along the
+		//    spline to a spline time is a binary search plus a few Newton steps, rather than repeated integration.
+		//  - Within a table interval, lengths are found with 5 point Gauss-Legendre quadrature.
+		//  - 'spline' must outlive the table and not be modified while the table is in use.
+		using Vec4 = Vec4<S>;
+		using CubicSpline = CubicSpline<S>;
+
+		CubicSpline const* m_spline;
+		std::vector<S> m_length;  // Cumulative arc length at time 'i / m_samples'
+		int m_samples;            // Table intervals per curve
+
+		explicit ArcLengthTable(CubicSpline const& spline, int samples_per_curve = 16, S tol = tiny<S>)
+			: m_spline(&spline)
+			, m_length()
+			, m_samples(std::max(samples_per_curve, 1))
+		{
+			auto intervals = static_cast<int>(ssize(spline.m_curves)) * m_samples;
+			m_length.reserve(intervals + 1);
+			m_length.push_back(0);
+			for (int i = 0; i != intervals; ++i)
+			{
+				auto const& curve = spline.m_curves[i / m_samples];
+				auto t0 = S(i % m_samples + 0) / m_samples;
+				auto t1 = S(i % m_samples + 1) / m_samples;
+				m_length.push_back(m_length.back() + math::Length(curve, t0, t1, tol));
+			}
+		}
+
+		// The total length of the spline
+		S Length() const noexcept
+		{
+			return m_length.back();
+		}
+
+		// The arc length from the start of the spline to 'time'
+		S LengthAt(S time) const noexcept
+		{
+			auto intervals = ssize(m_length) - 1;
+			if (intervals == 0)
+				return 0;
+
+			time = std::clamp(time, m_spline->Time0(), m_spline->Time1());
+			auto i = std::clamp(static_cast<int>(time * m_samples), 0, static_cast<int>(intervals - 1));
+			return m_length[i] + IntervalLength(i, time);
+		}
+
+		// The spline time at arc length 'length' from the start of the spline
+		S TimeAt(S length) const noexcept
+		{
+			auto intervals = ssize(m_length) - 1;
+			if (intervals == 0)
+				return 0;
+
+			// Find the table interval containing 'length'
+			length = std::clamp(length, S(0), Length());
+			auto i = static_cast<int>(std::upper_bound(begin(m_length), end(m_length), length) - begin(m_length)) - 1;
+			i = std::clamp(i, 0, static_cast<int>(intervals - 1));
+
+			// Initial guess by linear interpolation, then Newton's method on f(t) = LengthAt(t) - length,
+			// with f'(t) = |P'(t)|. Fall back to bisection if a step leaves the bracket.
+			auto lo = S(i + 0) / m_samples;
+			auto hi = S(i + 1) / m_samples;
+			auto dlen = m_length[i + 1] - m_length[i];
+			auto t = dlen > tiny<S> ? lo + (hi - lo) * (length - m_length[i]) / dlen : lo;
+			auto tol = tiny<S> * std::max(Length(), S(1));
+			for (int iter = 0; iter != 8; ++iter)
+			{
+				auto f = m_length[i] + IntervalLength(i, t) - length;
+				if (std::abs(f) <= tol)
+					break;
+
+				if (f > 0) hi = t; else lo = t;
+				auto speed = Speed(i, t);
+				auto next = speed > tiny<S> ? t - f / speed : lo;
+				t = next > lo && next < hi ? next : S(0.5) * (lo + hi);
+			}
+			return t;
+		}
+
+		// The position on the spline at arc length 'length' from the start
+		Vec4 PositionAt(S length) const noexcept
+		{
+			return m_spline->Position(TimeAt(length));
+		}
+
+	private:
+
+		// The speed |P'(t)| at spline time 't' in table interval 'i'
+		S Speed(int i, S t) const noexcept
+		{
+			auto ci = i / m_samples;
+			return math::Length(m_spline->m_curves[ci].EvalDerivative(t - ci));
+		}
+
+		// The arc length from the start of table interval 'i' to spline time 't' (within the interval)
+		S IntervalLength(int i, S t) const noexcept
+		{
+			// 5 point Gauss-Legendre nodes and weights on [-1,1]
+			static constexpr S x[] = { S(0), S(0.5384693101056831), S(0.9061798459386640) };
+			static constexpr S w[] = { S(0.5688888888888889), S(0.4786286704993665), S(0.2369268850561891) };
+
+			auto ci = i / m_samples;
+			auto const& curve = m_spline->m_curves[ci];
+			auto a = S(i % m_samples) / m_samples;
+			auto b = t - ci;
+			auto half = S(0.5) * (b - a);
+			auto mid = S(0.5) * (a + b);
+
+			auto sum = w[0] * math::Length(curve.EvalDerivative(mid));
+			for (int k = 1; k != 3; ++k)
+			{
+				sum += w[k] * math::Length(curve.EvalDerivative(mid - half * x[k]));
+				sum += w[k] * math::Length(curve.EvalDerivative(mid + half * x[k]));
+			}
+			return half * sum;
+		}
+	};
+
 
 	// Previous implementation *************************
 	#if 0
@@ -1111,6 +1356,86 @@ namespace pr::math
 			auto rastered = Raster(schpline, T(0), T(1), std::span{ points });
 			(void)rastered;
 		}
+		// A spline made from two joined bezier curves
+		template <ScalarTypeFP S>
+		static CubicSpline<S> TwoCurveSpline()
+		{
+			using Vec4 = Vec4<S>;
+			using CurveType = CurveType<S>;
+			return CubicSpline<S>{
+				CubicCurve3(Vec4{ 0,0,0,1 }, Vec4{ 1,0,0,1 }, Vec4{ 1,0,1,1 }, Vec4{ 0,0,1,1 }, CurveType::Bezier),
+				CubicCurve3(Vec4{ 0,0,1,1 }, Vec4{ -1,0,1,1 }, Vec4{ -1,1,2,1 }, Vec4{ 0,2,3,1 }, CurveType::Bezier),
+			};
+		}
+		PRUnitTestMethod(ArcLengthTableTest, float, double)
+		{
+			auto spline = TwoCurveSpline<T>();
+
+			ArcLengthTable<T> table(spline);
+			PR_EXPECT(FEqlRelative(table.Length(), Length(spline.m_curves[0], T(0), T(1)) + Length(spline.m_curves[1], T(0), T(1)), T(1e-4)));
+
+			// Length -> time -> length round trips
+			for (int i = 0; i <= 20; ++i)
+			{
+				auto s = table.Length() * i / 20;
+				auto t = table.TimeAt(s);
+				PR_EXPECT(FEqlAbsolute(table.LengthAt(t), s, T(1e-4)));
+				PR_EXPECT(FEqlRelative(table.LengthAt(t), Length(spline, T(0), t), T(1e-3)));
+			}
+
+			// Evenly spaced distances give evenly spaced points
+			auto step = table.Length() / 200;
+			for (int i = 0; i != 200; ++i)
+			{
+				auto chord = math::Length(table.PositionAt(step * (i + 1)) - table.PositionAt(step * i));
+				PR_EXPECT(FEqlRelative(chord, step, T(1e-2)));
+			}
+		}
+		PRUnitTestMethod(EvalManyTest, float, double)
+		{
+			using Vec4 = Vec4<T>;
+
+			auto spline = TwoCurveSpline<T>();
+
+			std::vector<T> times;
+			for (int i = 0; i <= 37; ++i)
+				times.push_back(spline.Time1() * i / 37);
+
+			std::vector<Vec4> pos(times.size()), tan(times.size());
+			EvalMany<T>(spline, times, pos, tan);
+			for (size_t i = 0; i != times.size(); ++i)
+			{
+				PR_EXPECT(FEqlAbsolute(pos[i], spline.Position(times[i]), T(1e-5)));
+				PR_EXPECT(FEqlAbsolute(tan[i], spline.Velocity(times[i]), T(1e-5)));
+			}
+		}
+		PRUnitTestMethod(TessellateTest, float, double)
+		{
+			using Vec4 = Vec4<T>;
+
+			auto spline = TwoCurveSpline<T>();
+
+			auto tol = T(0.001);
+			std::vector<Vec4> points;
+			Tessellate(spline, spline.Time0(), spline.Time1(), tol, [&](Vec4 p) { points.push_back(p); }, true);
+			PR_EXPECT(points.size() > 2);
+			PR_EXPECT(points.front().w == spline.Time0() && points.back().w == spline.Time1());
+
+			// The spline between consecutive points is within 'tol' of the polyline
+			for (size_t i = 0; i + 1 != points.size(); ++i)
+			{
+				auto a = points[i].w1();
+				auto b = points[i + 1].w1();
+				for (int j = 1; j != 8; ++j)
+				{
+					auto p = spline.Position(points[i].w + (points[i + 1].w - points[i].w) * j / 8);
+					auto ab = (b - a).w0();
+					auto ap = (p - a).w0();
+					auto t = Clamp<T>(Dot(ap, ab) / LengthSq(ab), 0, 1);
+					PR_EXPECT(math::Length(ap - t * ab) <= tol * T(1.001));
+				}
+			}
+		}
 
 		template <ScalarTypeFP S>
 		void DumpToLDraw(CubicCurve3<S> const& curve)
@@ -55,6 +55,65 @@ namespace pr::math::tests
 			PR_EXPECT(FEql(m.lu, res));
 		}
 
+		PRUnitTestMethod(LUDecompositionLarge)
+		{
+			// Large enough to use the blocked factorisation and multi-RHS solve
+			const int N = 203, K = 9;
+			auto A = Matrix<double>::Random(rng, N, N, -1.0, 1.0);
+			auto V = Matrix<double>::Random(rng, K, N, -1.0, 1.0);
+			auto lu = MatrixLU<double>(A);
+
+			// 'A * x == v' for each vector
+			auto X = Solve(lu, V);
+			PR_EXPECT(X.vecs() == K && X.cmps() == N);
+			PR_EXPECT(FEqlAbsolute(A * X, V, 1e-8));
+
+			// Same as solving one vector at a time
+			for (int i = 0; i != K; ++i)
+			{
+				Matrix<double> v = V.vec(i);
+				Matrix<double> x = X.vec(i);
+				PR_EXPECT(FEqlAbsolute(Solve(lu, v), x, 1e-10));
+			}
+
+			// The inverse from the factorisation
+			auto inv = Invert(lu);
+			PR_EXPECT(FEqlAbsolute(A * inv, Matrix<double>::Identity(N, N), 1e-8));
+
+			// Transposed input
+			auto At = Transpose(A);
+			PR_EXPECT(FEqlAbsolute(At * Solve(MatrixLU<double>(At), V), V, 1e-8));
+		}
+
+		PRUnitTestMethod(Cholesky)
+		{
+			{
+				auto A = Matrix<double>(3, 3, { 4, 12, -16, 12, 37, -43, -16, -43, 98 });
+				auto llt = MatrixCholesky<double>(A);
+				auto L = Matrix<double>(3, 3, { 2, 6, -8, 0, 1, 5, 0, 0, 3 });
+				PR_EXPECT(FEql(llt.llt, L));
+				PR_EXPECT(FEql(Determinant(llt), Determinant(A)));
+			}
+			{
+				// Symmetric positive definite: R * R^T + N * I
+				const int N = 150, K = 5;
+				auto R = Matrix<double>::Random(rng, N, N, -1.0, 1.0);
+				auto A = R * Transpose(R) + N * Matrix<double>::Identity(N, N);
+				auto V = Matrix<double>::Random(rng, K, N, -1.0, 1.0);
+				auto llt = MatrixCholesky<double>(A);
+
+				auto X = Solve(llt, V);
+				PR_EXPECT(FEqlAbsolute(A * X, V, 1e-10));
+				PR_EXPECT(FEqlAbsolute(X, Solve(MatrixLU<double>(A), V), 1e-10));
+				PR_EXPECT(FEqlAbsolute(A * Invert(llt), Matrix<double>::Identity(N, N), 1e-10));
+			}
+			{
+				// Not positive definite
+				auto A = Matrix<double>(2, 2, { 1, 2, 2, 1 });
+				PR_THROWS(MatrixCholesky<double>{ A }, std::runtime_error);
+			}
+		}
+
 		PRUnitTestMethod(Invert)
 		{
 			auto m = Matrix<double>(4, 4, { 1, 2, 3, 1, 4, -5, 6, 5, 7, 8, 9, -9, -10, 11, 12, 0 });
@@ -153,6 +212,48 @@ namespace pr::math::tests
 			}
 		}
 
+		PRUnitTestMethod(MultiplyLarge)
+		{
+			// Non-square, transposed, and odd sized operands exercise the blocked multiply edge cases
+			auto Check = [&]<typename S>(Matrix<S> const& b2c, Matrix<S> const& a2b, S tol)
+			{
+				auto res = b2c * a2b;
+				PR_EXPECT(res.vecs() == a2b.vecs());
+				PR_EXPECT(res.cmps() == b2c.cmps());
+				for (int r = 0; r != res.vecs(); ++r)
+				{
+					for (int c = 0; c != res.cmps(); ++c)
+					{
+						auto expected = 0.0;
+						for (int k = 0; k != a2b.cmps(); ++k)
+							expected += double(a2b(r, k)) * double(b2c(k, c));
+						PR_EXPECT(FEqlAbsolute(double(res(r, c)), expected, double(tol)));
+					}
+				}
+			};
+			{
+				auto A = Matrix<float>::Random(rng, 131, 259, -1.0f, 1.0f);
+				auto B = Matrix<float>::Random(rng, 259, 77, -1.0f, 1.0f);
+				Check(B, A, 1e-3f);
+				Check(math::Transpose(math::Transpose(B)), A, 1e-3f);
+				Check(B, Matrix<float>(math::Transpose(Matrix<float>::Random(rng, 259, 131, -1.0f, 1.0f))), 1e-3f);
+			}
+			{
+				auto A = Matrix<double>::Random(rng, 70, 300, -1.0, 1.0);
+				auto B = Matrix<double>::Random(rng, 77, 300, -1.0, 1.0);
+				Check(math::Transpose(B), A, 1e-10);
+			}
+			{
+				// Matrix-vector products
+				auto A = Matrix<double>::Random(rng, 300, 200, -1.0, 1.0);
+				auto x = Matrix<double>::Random(rng, 1, 300, -1.0, 1.0);
+				auto y = Matrix<double>::Random(rng, 200, 1, -1.0, 1.0);
+				Check(A, x, 1e-10);
+				Check(y, A, 1e-10);
+				Check(math::Transpose(A), math::Transpose(y), 1e-10);
+			}
+		}
+
 		PRUnitTestMethod(Transpose)
 		{
 			const int vecs = 4, cmps = 3;
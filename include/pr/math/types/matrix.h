@@ -7,9 +7,403 @@
 #include "pr/math/core/traits.h"
 #include "pr/math/core/constants.h"
 #include "pr/math/types/vector4.h"
+#include <execution>
 
 namespace pr::math
 {
+	// Matrix multiply kernels
+	namespace gemm
+	{
+		// Notes:
+		//  - These kernels compute 'C += A * B' in standard (row, column) notation, where A is MxK, B is KxN, and C is
+		//    a contiguous row major MxN buffer. Element (r,c) of A is at 'A[r*rs + c*cs]' (similarly for B) so that
+		//    transposed operands are read in place, only the packing functions know about the strides.
+		//  - Blocking follows the Goto/BLIS scheme: B is packed into KCxNC panels made of NR wide slivers, A is packed
+		//    into MCxKC blocks made of MR tall slivers, and the micro-kernel accumulates an MRxNR tile of C in registers
+		//    from one sliver of each. Panels are sized so that the B sliver stays in L1 and the A block stays in L2.
+		//  - Blocks of rows of C are computed on separate threads.
+
+		// Generic micro-kernel. Written so that the compiler can vectorise it, used for integer types or without intrinsics.
+		template <typename S> struct Kernel
+		{
+			static constexpr int MR = 4;
+			static constexpr int NR = 4;
+
+			// 'C[MR][NR] += A[MR][kc] * B[kc][NR]' where 'a' and 'b' are packed slivers
+			static void Run(int kc, S const* a, S const* b, S* c, int ldc) noexcept
+			{
+				S acc[MR][NR] = {};
+				for (int k = 0; k != kc; ++k, a += MR, b += NR)
+					for (int i = 0; i != MR; ++i)
+						for (int j = 0; j != NR; ++j)
+							acc[i][j] += a[i] * b[j];
+
+				for (int i = 0; i != MR; ++i)
+					for (int j = 0; j != NR; ++j)
+						c[i * ldc + j] += acc[i][j];
+			}
+		};
+		#if PR_MATHS_USE_INTRINSICS
+		template <> struct Kernel<float>
+		{
+			// 6x16 tile = 12 ymm accumulators + 2 for B + 1 for the broadcast A value.
+			// Unrolled by hand so that the accumulators stay in registers regardless of the optimiser.
+			static constexpr int MR = 6;
+			static constexpr int NR = 16;
+
+			static void Run(int kc, float const* a, float const* b, float* c, int ldc) noexcept
+			{
+				auto c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+				auto c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+				auto c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+				auto c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+				auto c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+				auto c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+				for (int k = 0; k != kc; ++k, a += MR, b += NR)
+				{
+					auto b0 = _mm256_loadu_ps(b + 0);
+					auto b1 = _mm256_loadu_ps(b + 8);
+					__m256 ai;
+					ai = _mm256_broadcast_ss(a + 0); c00 = Madd(ai, b0, c00); c01 = Madd(ai, b1, c01);
+					ai = _mm256_broadcast_ss(a + 1); c10 = Madd(ai, b0, c10); c11 = Madd(ai, b1, c11);
+					ai = _mm256_broadcast_ss(a + 2); c20 = Madd(ai, b0, c20); c21 = Madd(ai, b1, c21);
+					ai = _mm256_broadcast_ss(a + 3); c30 = Madd(ai, b0, c30); c31 = Madd(ai, b1, c31);
+					ai = _mm256_broadcast_ss(a + 4); c40 = Madd(ai, b0, c40); c41 = Madd(ai, b1, c41);
+					ai = _mm256_broadcast_ss(a + 5); c50 = Madd(ai, b0, c50); c51 = Madd(ai, b1, c51);
+				}
+
+				Store(c + 0 * ldc, c00, c01);
+				Store(c + 1 * ldc, c10, c11);
+				Store(c + 2 * ldc, c20, c21);
+				Store(c + 3 * ldc, c30, c31);
+				Store(c + 4 * ldc, c40, c41);
+				Store(c + 5 * ldc, c50, c51);
+			}
+			static __m256 Madd(__m256 a, __m256 b, __m256 c) noexcept
+			{
+				#if defined(__AVX2__) || defined(__FMA__)
+				return _mm256_fmadd_ps(a, b, c);
+				#else
+				return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+				#endif
+			}
+			static void Store(float* c, __m256 r0, __m256 r1) noexcept
+			{
+				_mm256_storeu_ps(c + 0, _mm256_add_ps(_mm256_loadu_ps(c + 0), r0));
+				_mm256_storeu_ps(c + 8, _mm256_add_ps(_mm256_loadu_ps(c + 8), r1));
+			}
+		};
+		template <> struct Kernel<double>
+		{
+			// 6x8 tile = 12 ymm accumulators + 2 for B + 1 for the broadcast A value.
+			// Unrolled by hand so that the accumulators stay in registers regardless of the optimiser.
+			static constexpr int MR = 6;
+			static constexpr int NR = 8;
+
+			static void Run(int kc, double const* a, double const* b, double* c, int ldc) noexcept
+			{
+				auto c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+				auto c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+				auto c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+				auto c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+				auto c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+				auto c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+				for (int k = 0; k != kc; ++k, a += MR, b += NR)
+				{
+					auto b0 = _mm256_loadu_pd(b + 0);
+					auto b1 = _mm256_loadu_pd(b + 4);
+					__m256d ai;
+					ai = _mm256_broadcast_sd(a + 0); c00 = Madd(ai, b0, c00); c01 = Madd(ai, b1, c01);
+					ai = _mm256_broadcast_sd(a + 1); c10 = Madd(ai, b0, c10); c11 = Madd(ai, b1, c11);
+					ai = _mm256_broadcast_sd(a + 2); c20 = Madd(ai, b0, c20); c21 = Madd(ai, b1, c21);
+					ai = _mm256_broadcast_sd(a + 3); c30 = Madd(ai, b0, c30); c31 = Madd(ai, b1, c31);
+					ai = _mm256_broadcast_sd(a + 4); c40 = Madd(ai, b0, c40); c41 = Madd(ai, b1, c41);
+					ai = _mm256_broadcast_sd(a + 5); c50 = Madd(ai, b0, c50); c51 = Madd(ai, b1, c51);
+				}
+
+				Store(c + 0 * ldc, c00, c01);
+				Store(c + 1 * ldc, c10, c11);
+				Store(c + 2 * ldc, c20, c21);
+				Store(c + 3 * ldc, c30, c31);
+				Store(c + 4 * ldc, c40, c41);
+				Store(c + 5 * ldc, c50, c51);
+			}
+			static __m256d Madd(__m256d a, __m256d b, __m256d c) noexcept
+			{
+				#if defined(__AVX2__) || defined(__FMA__)
+				return _mm256_fmadd_pd(a, b, c);
+				#else
+				return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+				#endif
+			}
+			static void Store(double* c, __m256d r0, __m256d r1) noexcept
+			{
+				_mm256_storeu_pd(c + 0, _mm256_add_pd(_mm256_loadu_pd(c + 0), r0));
+				_mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), r1));
+			}
+		};
+		#endif
+
+		// Pack the 'mc x kc' block of 'alpha * A' into MR tall slivers (k major within a sliver), zero padding the last sliver
+		template <typename S, int MR> void PackA(int mc, int kc, S alpha, S const* a, int rs, int cs, S* out) noexcept
+		{
+			for (int i0 = 0; i0 < mc; i0 += MR)
+			{
+				auto rows = std::min(MR, mc - i0);
+				for (int k = 0; k != kc; ++k)
+				{
+					auto src = a + i0 * rs + k * cs;
+					int i = 0;
+					for (; i != rows; ++i) *out++ = alpha * src[i * rs];
+					for (; i != MR; ++i) *out++ = S(0);
+				}
+			}
+		}
+
+		// Pack the 'kc x nc' panel of B into NR wide slivers (k major within a sliver), zero padding the last sliver
+		template <typename S, int NR> void PackB(int kc, int nc, S const* b, int rs, int cs, S* out) noexcept
+		{
+			for (int j0 = 0; j0 < nc; j0 += NR)
+			{
+				auto cols = std::min(NR, nc - j0);
+				for (int k = 0; k != kc; ++k)
+				{
+					auto src = b + k * rs + j0 * cs;
+					int j = 0;
+					if (cs == 1) { memcpy(out, src, sizeof(S) * cols); out += cols; j = cols; }
+					else for (; j != cols; ++j) *out++ = src[j * cs];
+					for (; j != NR; ++j) *out++ = S(0);
+				}
+			}
+		}
+
+		// Dot product of 'n' elements of 'a' with 'n' elements of 'b' (at stride 'incb')
+		template <typename S> S Dot(int n, S const* a, S const* b, int incb = 1) noexcept
+		{
+			if (incb != 1)
+			{
+				S dp = 0;
+				for (int i = 0; i != n; ++i)
+					dp += a[i] * b[i * incb];
+				return dp;
+			}
+
+			// Independent partial sums so that the loop vectorises and isn't limited by the add latency
+			constexpr int L = 16;
+			S acc[L] = {};
+			int i = 0;
+			for (; i + L <= n; i += L)
+				for (int j = 0; j != L; ++j)
+					acc[j] += a[i + j] * b[i + j];
+			for (; i != n; ++i)
+				acc[0] += a[i] * b[i];
+
+			S dp = 0;
+			for (int j = 0; j != L; ++j)
+				dp += acc[j];
+			return dp;
+		}
+
+		// Call 'func(beg, end)' for blocks of '[0,count)', in parallel when there is more than one block
+		template <typename Func> void ParallelBlocks(int count, int block_size, Func func)
+		{
+			if (count <= block_size)
+				return func(0, count);
+
+			std::vector<int> blocks;
+			for (int i = 0; i < count; i += block_size)
+				blocks.push_back(i);
+
+			std::for_each(std::execution::par, std::begin(blocks), std::end(blocks), [&](int beg)
+			{
+				func(beg, std::min(beg + block_size, count));
+			});
+		}
+
+		// 'y = A * x' where A is MxK. 'y' must not alias 'A' or 'x'.
+		template <typename S> void Gemv(int M, int K, S const* A, int rs, int cs, S const* x, int incx, S* y, int incy)
+		{
+			// Parallelise only when there is enough work to cover the thread overhead
+			auto block_rows = std::max(64, (1 << 18) / std::max(K, 1));
+
+			if (cs == 1)
+			{
+				// Rows of A are contiguous, each element of 'y' is a dot product
+				ParallelBlocks(M, block_rows, [&](int beg, int end)
+				{
+					for (int r = beg; r != end; ++r)
+						y[r * incy] = Dot(K, A + r * rs, x, incx);
+				});
+			}
+			else if (rs == 1 && incy == 1)
+			{
+				// Columns of A are contiguous, accumulate scaled columns into 'y'
+				ParallelBlocks(M, std::max(block_rows, 256), [&](int beg, int end)
+				{
+					std::fill(y + beg, y + end, S(0));
+					for (int k = 0; k != K; ++k)
+					{
+						auto s = x[k * incx];
+						auto col = A + k * cs;
+						for (int r = beg; r != end; ++r)
+							y[r] += col[r] * s;
+					}
+				});
+			}
+			else
+			{
+				for (int r = 0; r != M; ++r)
+				{
+					S dp = 0;
+					for (int k = 0; k != K; ++k)
+						dp += A[r * rs + k * cs] * x[k * incx];
+					y[r * incy] = dp;
+				}
+			}
+		}
+
+		// 'C += alpha * A * B' where A is MxK, B is KxN, and C is MxN row major with row stride 'ldc'
+		template <typename S> void Gemm(int M, int N, int K, S alpha, S const* A, int ars, int acs, S const* B, int brs, int bcs, S* C, int ldc)
+		{
+			using kernel_t = Kernel<S>;
+			constexpr int MR = kernel_t::MR;
+			constexpr int NR = kernel_t::NR;
+			constexpr int KC = 256;
+			constexpr int MC = MR * 16;
+			constexpr int NC = NR * 128;
+
+			std::vector<S> bpack(size_t(KC) * std::min(NC, (N + NR - 1) / NR * NR));
+			for (int jc = 0; jc < N; jc += NC)
+			{
+				auto nc = std::min(NC, N - jc);
+				for (int pc = 0; pc < K; pc += KC)
+				{
+					auto kc = std::min(KC, K - pc);
+					PackB<S, NR>(kc, nc, B + pc * brs + jc * bcs, brs, bcs, bpack.data());
+
+					ParallelBlocks(M, MC, [&](int ic, int iend)
+					{
+						auto mc = iend - ic;
+						std::vector<S> apack(size_t(kc) * ((mc + MR - 1) / MR * MR));
+						PackA<S, MR>(mc, kc, alpha, A + ic * ars + pc * acs, ars, acs, apack.data());
+
+						for (int jr = 0; jr < nc; jr += NR)
+						{
+							auto nr = std::min(NR, nc - jr);
+							for (int ir = 0; ir < mc; ir += MR)
+							{
+								auto mr = std::min(MR, mc - ir);
+								auto a = apack.data() + ir * kc;
+								auto b = bpack.data() + jr * kc;
+								auto c = C + (ic + ir) * ldc + jc + jr;
+								if (mr == MR && nr == NR)
+								{
+									kernel_t::Run(kc, a, b, c, ldc);
+								}
+								else
+								{
+									// Partial tiles are computed into a temporary then added to C
+									S tmp[MR * NR] = {};
+									kernel_t::Run(kc, a, b, &tmp[0], NR);
+									for (int i = 0; i != mr; ++i)
+										for (int j = 0; j != nr; ++j)
+											c[i * ldc + j] += tmp[i * NR + j];
+								}
+							}
+						}
+					});
+				}
+			}
+		}
+
+		// Solve 'T * X = B' for X in place, where T is an NxN lower triangular matrix with element (r,c) at 't[r*trs + c*tcs]',
+		// and B is NxK with its K columns contiguous at stride 'ldb'. 'unit_diag' means the diagonal of T is implicitly 1.
+		template <typename S> void TrsmLower(int N, int K, S const* t, int trs, int tcs, bool unit_diag, S* b, int ldb)
+		{
+			// Solve the diagonal blocks by substitution, then update the rows below with a multiply.
+			// With few right hand sides there is nothing to gain from blocking.
+			auto NB = K < 4 ? N : 64;
+			for (int k0 = 0; k0 < N; k0 += NB)
+			{
+				auto k1 = std::min(k0 + NB, N);
+				ParallelBlocks(K, std::max(1, (1 << 16) / (NB * NB)), [&](int beg, int end)
+				{
+					for (int i = beg; i != end; ++i)
+					{
+						auto x = b + i * ldb;
+						if (tcs == 1)
+						{
+							// Rows of T are contiguous, use dot products
+							for (int k = k0; k != k1; ++k)
+							{
+								x[k] -= Dot(k - k0, t + k * trs + k0, x + k0);
+								if (!unit_diag) x[k] /= t[k * trs + k];
+							}
+						}
+						else
+						{
+							// Columns of T are contiguous, subtract scaled columns
+							for (int k = k0; k != k1; ++k)
+							{
+								if (!unit_diag) x[k] /= t[k * trs + k * tcs];
+								auto xk = x[k];
+								auto col = t + k * tcs;
+								for (int r = k + 1; r < k1; ++r)
+									x[r] -= col[r * trs] * xk;
+							}
+						}
+					}
+				});
+				if (k1 != N)
+				{
+					// In transposed form: B2^T -= B1^T * T21^T
+					gemm::Gemm<S>(K, N - k1, k1 - k0, S(-1), b + k0, ldb, 1, t + k1 * trs + k0 * tcs, tcs, trs, b + k1, ldb);
+				}
+			}
+		}
+
+		// Solve 'T * X = B' for X in place, where T is an NxN upper triangular matrix. See 'TrsmLower'.
+		template <typename S> void TrsmUpper(int N, int K, S const* t, int trs, int tcs, bool unit_diag, S* b, int ldb)
+		{
+			auto NB = K < 4 ? N : 64;
+			for (int k1 = N; k1 > 0; k1 -= NB)
+			{
+				auto k0 = std::max(k1 - NB, 0);
+				ParallelBlocks(K, std::max(1, (1 << 16) / (NB * NB)), [&](int beg, int end)
+				{
+					for (int i = beg; i != end; ++i)
+					{
+						auto x = b + i * ldb;
+						if (tcs == 1)
+						{
+							for (int k = k1; k-- != k0;)
+							{
+								x[k] -= Dot(k1 - k - 1, t + k * trs + k + 1, x + k + 1);
+								if (!unit_diag) x[k] /= t[k * trs + k];
+							}
+						}
+						else
+						{
+							for (int k = k1; k-- != k0;)
+							{
+								if (!unit_diag) x[k] /= t[k * trs + k * tcs];
+								auto xk = x[k];
+								auto col = t + k * tcs;
+								for (int r = k0; r < k; ++r)
+									x[r] -= col[r * trs] * xk;
+							}
+						}
+					}
+				});
+				if (k0 != 0)
+				{
+					// In transposed form: B0^T -= B1^T * T01^T
+					gemm::Gemm<S>(K, k0, k1 - k0, S(-1), b + k0, ldb, 1, t + k0 * tcs, tcs, trs, b, ldb);
+				}
+			}
+		}
+	}
+
 	// Dynamically allocated NxM matrix
 	template <ScalarType S>
 	struct Matrix
@@ -216,6 +610,16 @@ namespace pr::math
 			return { m_data, static_cast<size_t>(size()) };
 		}
 
+		// The distance between consecutive vectors/components in 'data()'
+		int vec_stride() const noexcept
+		{
+			return !m_transposed ? m_cmps : 1;
+		}
+		int cmp_stride() const noexcept
+		{
+			return !m_transposed ? 1 : m_cmps;
+		}
+
 		// Access this matrix by vector
 		struct VecProxy
 		{
@@ -546,8 +950,14 @@ namespace pr::math
 			// Result
 			Matrix res(a2b.vecs(), b2c.cmps());
 
-			auto msize = std::max(std::max(a2b.vecs(), a2b.cmps()), std::max(b2c.vecs(), b2c.cmps()));
-			if (msize < 32)
+			// In (row, column) notation, 'res = A * B' where A = a2b (MxK) and B = b2c (KxN)
+			auto M = a2b.vecs();
+			auto N = b2c.cmps();
+			auto K = a2b.cmps();
+			if (M == 0 || N == 0 || K == 0)
+				return res;
+
+			if (int64_t(M) * N * K < 32 * 32 * 32)
 			{
 				// Small matrix multiply
 				for (int r = 0; r != res.vecs(); ++r)
@@ -558,208 +968,20 @@ namespace pr::math
 				return res;
 			}
 
-			// 'Strassen Multiply'
-			int n = 0;
-			int size = 1;
-			while (msize > size) { size *= 2; n++; };
-			int h = size / 2;
-
-			// Temporary smaller square matrices
-			const int M = 9;
-			std::vector<Matrix> buf(n * M);
-			
-			//  8x8, 8x8, 8x8, ...
-			//  4x4, 4x4, 4x4, ...
-			//  2x2, 2x2, 2x2, ...
-			//  . . .
-			auto field = &buf[0];
-			for (int i = 0; i < n - 4; i++)
+			// Matrix-vector products are memory bound, use dot products or axpy's instead of blocking
+			if (N == 1)
 			{
-				auto z = (int)pow(2, n - i - 1);
-				for (int j = 0; j < M; j++)
-					field[i*M+j] = Matrix(z, z);
+				gemm::Gemv<S>(M, K, a2b.m_data, a2b.vec_stride(), a2b.cmp_stride(), b2c.m_data, b2c.vec_stride(), res.m_data, 1);
+				return res;
 			}
-
-			#pragma region Sub Functions
-			struct L
+			if (M == 1)
 			{
-				static void SafeAplusBintoC(Matrix const& A, int xa, int ya, Matrix const& B, int xb, int yb, Matrix& C, int sz) noexcept
-				{
-					for (int r = 0; r < sz; ++r) // rows
-					{
-						for (int c = 0; c < sz; ++c) // cols
-						{
-							C(r, c) = 0;
-							if (xa + c < A.cmps() && ya + r < A.vecs()) C(r, c) += A(ya + r, xa + c);
-							if (xb + c < B.cmps() && yb + r < B.vecs()) C(r, c) += B(yb + r, xb + c);
-						}
-					}
-				}
-				static void SafeAminusBintoC(Matrix const& A, int xa, int ya, Matrix const& B, int xb, int yb, Matrix& C, int sz) noexcept
-				{
-					for (int r = 0; r < sz; ++r) // rows
-					{
-						for (int c = 0; c < sz; ++c) // cols
-						{
-							C(r, c) = 0;
-							if (xa + c < A.cmps() && ya + r < A.vecs()) C(r, c) += A(ya + r, xa + c);
-							if (xb + c < B.cmps() && yb + r < B.vecs()) C(r, c) -= B(yb + r, xb + c);
-						}
-					}
-				}
-				static void SafeACopytoC(Matrix const& A, int xa, int ya, Matrix& C, int sz) noexcept
-				{
-					for (int r = 0; r < sz; ++r) // rows
-					{
-						for (int c = 0; c < sz; ++c) // cols
-						{
-							C(r, c) = 0;
-							if (xa + c < A.cmps() && ya + r < A.vecs()) C(r, c) += A(ya + r, xa + c);
-						}
-					}
-				}
-				static void AplusBintoC(Matrix const& A, int xa, int ya, Matrix const& B, int xb, int yb, Matrix& C, int sz) noexcept
-				{
-					for (int r = 0; r < sz; ++r) // rows
-						for (int c = 0; c < sz; ++c)
-							C(r, c) = A(ya + r, xa + c) + B(yb + r, xb + c);
-				}
-				static void AminusBintoC(Matrix const& A, int xa, int ya, Matrix const& B, int xb, int yb, Matrix& C, int sz) noexcept
-				{
-					for (int r = 0; r < sz; ++r) // rows
-						for (int c = 0; c < sz; ++c)
-							C(r, c) = A(ya + r, xa + c) - B(yb + r, xb + c);
-				}
-				static void ACopytoC(Matrix const& A, int xa, int ya, Matrix& C, int sz) noexcept
-				{
-					for (int r = 0; r < sz; ++r) // rows
-						for (int c = 0; c < sz; ++c)
-							C(r, c) = A(ya + r, xa + c);
-				}
-				static void StrassenMultiplyRun(Matrix const& A, Matrix const& B, Matrix& C, int l, Matrix* f) noexcept
-				{
-					// A * B into C, level of recursion, matrix field
-					// function for square matrix 2^N x 2^N
-					auto sz = A.vecs();
-					if (sz < 32)
-					{
-						for (int r = 0; r < C.vecs(); ++r)
-						{
-							for (int c = 0; c < C.cmps(); ++c)
-							{
-								C(r, c) = 0;
-								for (int k = 0; k < A.cmps(); ++k)
-									C(r, c) += A(r, k) * B(k, c);
-							}
-						}
-					}
-					else
-					{
-						auto hh = sz / 2;
-						AplusBintoC(A, 0, 0, A, hh, hh, f[l*M + 0], hh);
-						AplusBintoC(B, 0, 0, B, hh, hh, f[l*M + 1], hh);
-						StrassenMultiplyRun(f[l*M + 0], f[l*M + 1], f[l*M + 1 + 1], l + 1, f); // (A11 + A22) * (B11 + B22);
-
-						AplusBintoC(A, 0, hh, A, hh, hh, f[l*M + 0], hh);
-						ACopytoC(B, 0, 0, f[l*M + 1], hh);
-						StrassenMultiplyRun(f[l*M + 0], f[l*M + 1], f[l*M + 1 + 2], l + 1, f); // (A21 + A22) * B11;
-
-						ACopytoC(A, 0, 0, f[l*M + 0], hh);
-						AminusBintoC(B, hh, 0, B, hh, hh, f[l*M + 1], hh);
-						StrassenMultiplyRun(f[l*M + 0], f[l*M + 1], f[l*M + 1 + 3], l + 1, f); //A11 * (B12 - B22);
-
-						ACopytoC(A, hh, hh, f[l*M + 0], hh);
-						AminusBintoC(B, 0, hh, B, 0, 0, f[l*M + 1], hh);
-						StrassenMultiplyRun(f[l*M + 0], f[l*M + 1], f[l*M + 1 + 4], l + 1, f); //A22 * (B21 - B11);
-
-						AplusBintoC(A, 0, 0, A, hh, 0, f[l*M + 0], hh);
-						ACopytoC(B, hh, hh, f[l*M + 1], hh);
-						StrassenMultiplyRun(f[l*M + 0], f[l*M + 1], f[l*M + 1 + 5], l + 1, f); //(A11 + A12) * B22;
-
-						AminusBintoC(A, 0, hh, A, 0, 0, f[l*M + 0], hh);
-						AplusBintoC(B, 0, 0, B, hh, 0, f[l*M + 1], hh);
-						StrassenMultiplyRun(f[l*M + 0], f[l*M + 1], f[l*M + 1 + 6], l + 1, f); //(A21 - A11) * (B11 + B12);
-
-						AminusBintoC(A, hh, 0, A, hh, hh, f[l*M + 0], hh);
-						AplusBintoC(B, 0, hh, B, hh, hh, f[l*M + 1], hh);
-						StrassenMultiplyRun(f[l*M + 0], f[l*M + 1], f[l*M + 1 + 7], l + 1, f); // (A12 - A22) * (B21 + B22);
-
-						// C11
-						for (int r = 0; r < hh; r++) // rows
-							for (int c = 0; c < hh; c++) // cols
-								C(r, c) = f[l*M + 1 + 1](r, c) + f[l*M + 1 + 4](r, c) - f[l*M + 1 + 5](r, c) + f[l*M + 1 + 7](r, c);
-
-						// C12
-						for (int r = 0; r < hh; r++) // rows
-							for (int c = hh; c < sz; c++) // cols
-								C(r, c) = f[l*M + 1 + 3](r, c - hh) + f[l*M + 1 + 5](r, c - hh);
-
-						// C21
-						for (int r = hh; r < sz; r++) // rows
-							for (int c = 0; c < hh; c++) // cols
-								C(r, c) = f[l*M + 1 + 2](r - hh, c) + f[l*M + 1 + 4](r - hh, c);
-
-						// C22
-						for (int r = hh; r < sz; r++) // rows
-							for (int c = hh; c < sz; c++) // cols
-								C(r, c) = f[l*M + 1 + 1](r - hh, c - hh) - f[l*M + 1 + 2](r - hh, c - hh) + f[l*M + 1 + 3](r - hh, c - hh) + f[l*M + 1 + 6](r - hh, c - hh);
-					}
-				}
-			};
-			#pragma endregion
-
-			#pragma region Strassen Multiply
-
-			L::SafeAplusBintoC(a2b, 0, 0, a2b, h, h, field[0*M + 0], h);
-			L::SafeAplusBintoC(b2c, 0, 0, b2c, h, h, field[0*M + 1], h);
-			L::StrassenMultiplyRun(field[0*M + 0], field[0*M + 1], field[0*M + 1 + 1], 1, field); // (A11 + A22) * (B11 + B22);
-
-			L::SafeAplusBintoC(a2b, 0, h, a2b, h, h, field[0*M + 0], h);
-			L::SafeACopytoC(b2c, 0, 0, field[0*M + 1], h);
-			L::StrassenMultiplyRun(field[0*M + 0], field[0*M + 1], field[0*M + 1 + 2], 1, field); // (A21 + A22) * B11;
-
-			L::SafeACopytoC(a2b, 0, 0, field[0*M + 0], h);
-			L::SafeAminusBintoC(b2c, h, 0, b2c, h, h, field[0*M + 1], h);
-			L::StrassenMultiplyRun(field[0*M + 0], field[0*M + 1], field[0*M + 1 + 3], 1, field); //A11 * (B12 - B22);
-
-			L::SafeACopytoC(a2b, h, h, field[0*M + 0], h);
-			L::SafeAminusBintoC(b2c, 0, h, b2c, 0, 0, field[0*M + 1], h);
-			L::StrassenMultiplyRun(field[0*M + 0], field[0*M + 1], field[0*M + 1 + 4], 1, field); //A22 * (B21 - B11);
-
-			L::SafeAplusBintoC(a2b, 0, 0, a2b, h, 0, field[0*M + 0], h);
-			L::SafeACopytoC(b2c, h, h, field[0*M + 1], h);
-			L::StrassenMultiplyRun(field[0*M + 0], field[0*M + 1], field[0*M + 1 + 5], 1, field); //(A11 + A12) * B22;
-
-			L::SafeAminusBintoC(a2b, 0, h, a2b, 0, 0, field[0*M + 0], h);
-			L::SafeAplusBintoC(b2c, 0, 0, b2c, h, 0, field[0*M + 1], h);
-			L::StrassenMultiplyRun(field[0*M + 0], field[0*M + 1], field[0*M + 1 + 6], 1, field); //(A21 - A11) * (B11 + B12);
-
-			L::SafeAminusBintoC(a2b, h, 0, a2b, h, h, field[0*M + 0], h);
-			L::SafeAplusBintoC(b2c, 0, h, b2c, h, h, field[0*M + 1], h);
-			L::StrassenMultiplyRun(field[0*M + 0], field[0*M + 1], field[0*M + 1 + 7], 1, field); // (A12 - A22) * (B21 + B22);
-
-			// C11
-			for (int r = 0; r < std::min(h, res.vecs()); r++) // rows
-				for (int c = 0; c < std::min(h, res.cmps()); c++) // cols
-					res(r, c) = field[0*M + 1 + 1](r, c) + field[0*M + 1 + 4](r, c) - field[0*M + 1 + 5](r, c) + field[0*M + 1 + 7](r, c);
-
-			// C12
-			for (int r = 0; r < std::min(h, res.vecs()); r++) // rows
-				for (int c = h; c < std::min(2 * h, res.cmps()); c++) // cols
-					res(r, c) = field[0*M + 1 + 3](r, c - h) + field[0*M + 1 + 5](r, c - h);
-
-			// C21
-			for (int r = h; r < std::min(2 * h, res.vecs()); r++) // rows
-				for (int c = 0; c < std::min(h, res.cmps()); c++) // cols
-					res(r, c) = field[0*M + 1 + 2](r - h, c) + field[0*M + 1 + 4](r - h, c);
-
-			// C22
-			for (int r = h; r < std::min(2 * h, res.vecs()); r++) // rows
-				for (int c = h; c < std::min(2 * h, res.cmps()); c++) // cols
-					res(r, c) = field[0*M + 1 + 1](r - h, c - h) - field[0*M + 1 + 2](r - h, c - h) + field[0*M + 1 + 3](r - h, c - h) + field[0*M + 1 + 6](r - h, c - h);
-
-			#pragma endregion 
+				gemm::Gemv<S>(N, K, b2c.m_data, b2c.cmp_stride(), b2c.vec_stride(), a2b.m_data, a2b.cmp_stride(), res.m_data, 1);
+				return res;
+			}
 
+			// Packed, cache blocked, multi-threaded multiply
+			gemm::Gemm<S>(M, N, K, S(1), a2b.m_data, a2b.vec_stride(), a2b.cmp_stride(), b2c.m_data, b2c.vec_stride(), b2c.cmp_stride(), res.m_data, N);
 			return res;
 		}
 		
@@ -935,7 +1157,7 @@ namespace pr::math
 			:MatrixLU(Matrix<S>(vecs, cmps, data, transposed))
 		{}
 		MatrixLU(Matrix<S> const& m)
-			:lu(m)
+			:lu(m.vecs(), m.cmps())
 			,L(lu)
 			,U(lu)
 			,pi(new int[m.vecs()])
@@ -943,64 +1165,94 @@ namespace pr::math
 		{
 			auto const N = m.IsSquare() ? m.vecs() : throw std::logic_error("LU decomposition is only possible on square matrices");
 
-			// We will store both the L and U matrices in 'base' since we know
-			// L has the form: [1 0] and U has the form: [U U]
-			//                 [L 1]                     [0 U]
-			auto  LL = Matrix<S>::Identity(m.vecs(), m.cmps());
-			auto& UU = lu;
+			// Notes:
+			//  - In (row, column) notation, 'lu' holds the matrix with its columns contiguous (i.e. 'A(r,c) = lu(c,r)').
+			//    This is the layout used by LAPACK, so the same right-looking blocked algorithm applies:
+			//    factor a panel of NB columns, apply its row swaps to the other columns, solve for the U12 block
+			//    of rows, then update the trailing matrix with a multiply. The multiply does nearly all of the work.
+			//  - L and U are both stored in 'lu' since L has the form [1 0] and U has the form [U U]
+			//                                                         [L 1]                     [0 U]
+			for (int v = 0; v != N; ++v)
+				for (int c = 0; c != N; ++c)
+					lu(v, c) = m(v, c);
+
+			auto a = lu.data().data();
+			auto const lda = N;
+			constexpr int NB = 64;
 
-			// Initialise the permutation vector
-			for (int i = 0; i != N; ++i)
-				pi[i] = i;
+			// The row swaps applied to each column
+			std::vector<int> ipiv(N);
 
-			// Decompose 'm' into 'LL' and 'UU'
-			for (int v = 0; v != N; ++v)
+			for (int j = 0; j < N; j += NB)
 			{
-				// Pivoting is used to avoid instability when the pivot is ~0
-				// It will probably always be enabled, but this documents it.
-				const bool UsePivot = true;
-				if constexpr (UsePivot)
+				auto jb = std::min(NB, N - j);
+
+				// Factor the panel of columns [j, j+jb) with partial pivoting
+				for (int k = j; k != j + jb; ++k)
 				{
-					// Find the largest component in the vector 'v' to use as the pivot
-					auto p = 0;
+					// Find the largest component in column 'k' to use as the pivot (avoids instability when the pivot is ~0)
+					auto col = a + k * lda;
+					auto p = k;
 					S max = 0;
-					for (int i = v; i != N; ++i)
+					for (int r = k; r != N; ++r)
 					{
-						auto val = abs(UU(v, i));
+						auto val = abs(col[r]);
 						if (val <= max) continue;
 						max = val;
-						p = i;
+						p = r;
 					}
 					if (max == 0)
 						throw std::runtime_error("The matrix is singular");
 
-					// Switch the components of all vectors
-					if (p != v)
+					// Swap rows within the panel
+					ipiv[k] = p;
+					if (p != k)
 					{
-						std::swap(pi[v], pi[p]);
 						DetOfP = -DetOfP;
-				
-						// Switch the components in LL and UU
-						for (int i = 0; i != v; ++i)
-							std::swap(LL(i, v), LL(i, p));
-						for (int i = 0; i != N; ++i)
-							std::swap(UU(i, v), UU(i, p));
+						for (int c = j; c != j + jb; ++c)
+							std::swap(a[c * lda + k], a[c * lda + p]);
+					}
+
+					// Gaussian eliminate the rows below the pivot, within the panel
+					for (int r = k + 1; r != N; ++r)
+						col[r] /= col[k];
+					for (int c = k + 1; c != j + jb; ++c)
+					{
+						auto cc = a + c * lda;
+						auto s = cc[k];
+						for (int r = k + 1; r != N; ++r)
+							cc[r] -= col[r] * s;
 					}
 				}
 
-				// Gaussian eliminate the remaining components of vector 'v'
-				for (int c = v + 1; c != N; ++c)
+				// Apply the panel's row swaps to the columns either side of the panel
+				gemm::ParallelBlocks(N - jb, 64, [&](int beg, int end)
 				{
-					LL(v, c) = UU(v, c) / UU(v, v);
-					for (int i = v; i != N; ++i)
-						UU(i, c) -= LL(v, c) * UU(i, v);
+					for (int i = beg; i != end; ++i)
+					{
+						auto cc = a + (i < j ? i : i + jb) * lda;
+						for (int k = j; k != j + jb; ++k)
+							std::swap(cc[k], cc[ipiv[k]]);
+					}
+				});
+
+				if (j + jb != N)
+				{
+					auto n = N - j - jb;
+
+					// U12 = L11^-1 * A12
+					gemm::TrsmLower<S>(jb, n, a + j * lda + j, 1, lda, true, a + (j + jb) * lda + j, lda);
+
+					// A22 -= L21 * U12, in transposed form: A22^T -= U12^T * L21^T
+					gemm::Gemm<S>(n, n, jb, S(-1), a + (j + jb) * lda + j, lda, 1, a + j * lda + j + jb, lda, 1, a + (j + jb) * lda + j + jb, lda);
 				}
 			}
 
-			// Combine 'LL' and 'UU' into 'LU' (note UU *is* lu)
-			for (int v = 0; v != N; ++v)
-				for (int c = v+1; c != N; ++c)
-					lu(v, c) = LL(v, c);
+			// Convert the row swaps into a permutation
+			for (int i = 0; i != N; ++i)
+				pi[i] = i;
+			for (int k = 0; k != N; ++k)
+				std::swap(pi[k], pi[ipiv[k]]);
 		}
 
 		// The matrix dimension (square)
@@ -1022,6 +1274,85 @@ namespace pr::math
 		}
 	};
 
+	// The Cholesky decomposition of a symmetric positive definite matrix, 'A = L * L^T'
+	template <ScalarType S>
+	struct MatrixCholesky
+	{
+		// Notes:
+		//  - Needs half of the work of an LU decomposition and no pivoting, but 'A' must be symmetric positive definite.
+		//    Only the lower triangle of 'A' is read.
+		//  - 'L' is stored in the same orientation as 'MatrixLU::lu', i.e. 'L(r,c) = llt(c,r)' in (row, column) notation.
+		//    The strict upper triangle of 'L' is zero.
+
+		// The lower triangular factor
+		Matrix<S> llt;
+
+		MatrixCholesky(Matrix<S> const& m)
+			:llt(m.vecs(), m.cmps())
+		{
+			auto const N = m.IsSquare() ? m.vecs() : throw std::logic_error("Cholesky decomposition is only possible on square matrices");
+			for (int v = 0; v != N; ++v)
+				for (int c = v; c != N; ++c)
+					llt(v, c) = m(v, c);
+
+			auto a = llt.data().data();
+			auto const lda = N;
+			constexpr int NB = 64;
+
+			for (int j = 0; j < N; j += NB)
+			{
+				auto jb = std::min(NB, N - j);
+
+				// Factor the panel of columns [j, j+jb), giving L11 and L21
+				for (int k = j; k != j + jb; ++k)
+				{
+					auto col = a + k * lda;
+					if (!(col[k] > S(0)))
+						throw std::runtime_error("The matrix is not positive definite");
+
+					col[k] = std::sqrt(col[k]);
+					for (int r = k + 1; r != N; ++r)
+						col[r] /= col[k];
+					for (int c = k + 1; c != j + jb; ++c)
+					{
+						auto cc = a + c * lda;
+						auto s = col[c];
+						for (int r = c; r != N; ++r)
+							cc[r] -= col[r] * s;
+					}
+				}
+				if (j + jb == N)
+					break;
+
+				// A22 -= L21 * L21^T, lower triangle only. Each block of columns is updated from its diagonal down
+				// which is where the saving over LU comes from.
+				auto c0 = j + jb;
+				gemm::ParallelBlocks(N - c0, NB, [&](int beg, int end)
+				{
+					auto cb = c0 + beg;
+					gemm::Gemm<S>(end - beg, N - cb, jb, S(-1), a + j * lda + cb, 1, lda, a + j * lda + cb, lda, 1, a + cb * lda + cb, lda);
+				});
+			}
+
+			// Clear the upper triangle (and the parts of the diagonal blocks written by the update)
+			for (int c = 1; c < N; ++c)
+				for (int r = 0; r != c; ++r)
+					a[c * lda + r] = S(0);
+		}
+
+		// The matrix dimension (square)
+		int dim() const noexcept
+		{
+			return llt.vecs();
+		}
+
+		// Access to the lower triangular factor in (row, column) notation
+		S L(int r, int c) const noexcept
+		{
+			return llt(c, r);
+		}
+	};
+
 	// Result of eigenvalue decomposition
 	template <typename S>
 	struct EigenResult
@@ -1049,6 +1380,14 @@ namespace pr::math
 	{
 		return Determinant(MatrixLU<S>(m));
 	}
+	template <typename S> inline S Determinant(MatrixCholesky<S> const& m) noexcept
+	{
+		S det = 1;
+		for (int i = 0; i != m.dim(); ++i)
+			det *= m.L(i, i) * m.L(i, i);
+
+		return det;
+	}
 
 	// Return the dot product of two vectors
 	template <typename S> inline S Dot(Matrix<S> const& lhs, Matrix<S> const& rhs) noexcept
@@ -1056,10 +1395,8 @@ namespace pr::math
 		pr_assert("Dot product is between column vectors" && lhs.vecs() == 1 && rhs.vecs() == 1);
 		pr_assert("Dot product must be between vectors of the same length" && lhs.cmps() == rhs.cmps());
 
-		S dp = 0;
-		for (int i = 0, iend = lhs.cmps(); i != iend; ++i)
-			dp += lhs(0, i) * rhs(0, i);
-		return dp;
+		// Vectors are contiguous whether transposed or not
+		return gemm::Dot<S>(lhs.cmps(), lhs.data().data(), rhs.data().data());
 	}
 
 	// True if 'm' has an inverse
@@ -1072,38 +1409,44 @@ namespace pr::math
 		return IsInvertible(MatrixLU<S>(m));
 	}
 
-	// Solves for 'x' in 'Ax = v'
+	// Solves for 'x' in 'Ax = v'.
+	// 'v' can contain multiple vectors, in which case each vector of the result is the solution for the corresponding vector in 'v'.
 	template <typename S> inline Matrix<S> Solve(MatrixLU<S> const& A, Matrix<S> const& v) noexcept
 	{
 		// e.g. [4x4][1x4] = [1x4]
-		pr_assert("Solution vector 'v' has the wrong dimensions" && A.dim() == v.cmps() && v.vecs() == 1);
+		pr_assert("Solution vector 'v' has the wrong dimensions" && A.dim() == v.cmps());
+		auto const N = A.dim();
+		auto const K = v.vecs();
 
 		// Switch items in 'v' due to permutation matrix
-		Matrix<S> a(1, A.dim());
-		for (int i = 0; i != A.dim(); ++i)
-			a(0, i) = v(0, A.pi[i]);
+		Matrix<S> x(K, N);
+		for (int i = 0; i != K; ++i)
+			for (int r = 0; r != N; ++r)
+				x(i, r) = v(i, A.pi[r]);
 
-		// Solve for x in 'L.x = b' assuming 'L' is a lower triangular matrix
-		Matrix<S> b(1, A.dim());
-		for (int i = 0; i != A.dim(); ++i)
-		{
-			b(0, i) = a(0, i);
-			for (int j = 0; j != i; ++j)
-				b(0, i) -= A.L(j, i) * b(0, j);
-		}
+		// Solve for 'y' in 'L.y = b' then for 'x' in 'U.x = y'. The vectors of 'x' are contiguous.
+		auto a = A.lu.data().data();
+		gemm::TrsmLower<S>(N, K, a, 1, N, true, x.data().data(), N);
+		gemm::TrsmUpper<S>(N, K, a, 1, N, false, x.data().data(), N);
+		return x;
+	}
 
-		// Solve for x in 'Ux = b' assuming 'U' is an upper triangular matrix
-		Matrix<S> c(b);
-		for (int i = A.dim(); i-- != 0;)
-		{
-			b(0, i) = c(0, i);
-			for (int j = A.dim() - 1; j > i; --j)
-				b(0, i) -= A.U(j, i) * b(0, j);
+	template <typename S> inline Matrix<S> Solve(MatrixCholesky<S> const& A, Matrix<S> const& v) noexcept
+	{
+		pr_assert("Solution vector 'v' has the wrong dimensions" && A.dim() == v.cmps());
+		auto const N = A.dim();
+		auto const K = v.vecs();
 
-			b(0, i) = b(0, i) / A.U(i, i);
-		}
+		Matrix<S> x(K, N);
+		for (int i = 0; i != K; ++i)
+			for (int r = 0; r != N; ++r)
+				x(i, r) = v(i, r);
 
-		return b;
+		// Solve for 'y' in 'L.y = b' then for 'x' in 'L^T.x = y'
+		auto a = A.llt.data().data();
+		gemm::TrsmLower<S>(N, K, a, 1, N, false, x.data().data(), N);
+		gemm::TrsmUpper<S>(N, K, a, N, 1, false, x.data().data(), N);
+		return x;
 	}
 
 	// Solves for 'x' in 'Ax = v'
@@ -1118,16 +1461,12 @@ namespace pr::math
 	{
 		pr_assert("Matrix has no inverse" && IsInvertible(lu));
 
-		// Inverse of an NxM matrix is a MxN matrix (even though this only works for square matrices)
-		Matrix<S> inv(lu.dim(), lu.dim());
-		Matrix<S> elem(1, lu.dim());
-		for (int i = 0; i != lu.dim(); ++i)
-		{
-			elem(0, i) = 1;
-			inv.vec(i) = Solve(lu, elem);
-			elem(0, i) = 0;
-		}
-		return inv;
+		// Solve for all of the columns of the identity matrix at once
+		return Solve(lu, Matrix<S>::Identity(lu.dim(), lu.dim()));
+	}
+	template <typename S> inline Matrix<S> Invert(MatrixCholesky<S> const& llt) noexcept
+	{
+		return Solve(llt, Matrix<S>::Identity(llt.dim(), llt.dim()));
 	}
 	template <typename S> inline Matrix<S> Invert(Matrix<S> const& m) noexcept
 	{
@@ -1441,10 +1780,7 @@ namespace pr::math
 					V(j, i) = q(i);
 
 				// w = A * q (A is symmetric, so A(i,j) = A(j,i))
-				w.zero();
-				for (int i = 0; i != N; ++i)
-					for (int jj = 0; jj != N; ++jj)
-						w(i) += m(i, jj) * q(jj);
+				w = m * q;
 
 				// alpha[j] = q^T * w
 				alpha(j) = S(0);
@@ -1510,21 +1846,17 @@ namespace pr::math
 			// ritz_i[r] = sum_j eigvec_i[j] * basis_j[r]
 			auto result = EigenResult<S>{};
 			result.values = Matrix<S>(1, k);
-			result.vectors = Matrix<S>(N, k);
-
+			auto t_vectors = Matrix<S>(lanczos_dim, k);
 			for (int i = 0; i != k; ++i)
 			{
 				result.values(0, i) = t_eigen.values(0, i);
-				for (int r = 0; r != N; ++r)
-				{
-					auto val = S(0);
-					for (int j = 0; j != lanczos_dim; ++j)
-						val += t_eigen.vectors(j, i) * V(j, r);
-					result.vectors(r, i) = val;
-				}
+				for (int j = 0; j != lanczos_dim; ++j)
+					t_vectors(j, i) = t_eigen.vectors(j, i);
 			}
+			result.vectors = t_vectors * Transpose(V);
 
 			// Check convergence via residual norm of the k-th Ritz pair
+			auto AV = result.vectors * m;
 			auto residual = S(0);
 			for (int i = 0; i != k; ++i)
 			{
@@ -1532,10 +1864,7 @@ namespace pr::math
 				auto max_res = S(0);
 				for (int r = 0; r != N; ++r)
 				{
-					auto av = S(0);
-					for (int c = 0; c != N; ++c)
-						av += m(r, c) * result.vectors(c, i);
-					auto diff = std::abs(av - result.values(0, i) * result.vectors(r, i));
+					auto diff = std::abs(AV(r, i) - result.values(0, i) * result.vectors(r, i));
 					max_res = std::max(max_res, diff);
 				}
 				residual = std::max(residual, max_res);
@@ -0,0 +1,592 @@
+//*********************************************
+// Physics Engine
+//  Copyright (C) Rylogic Ltd 2016
+//*********************************************
+// CPU smoothed particle hydrodynamics (SPH) fluid.
+// Mirrors the stages of the GPU fluid pipeline ('view3d-12/compute/fluid_simulation'),
+// so that simulations can run on machines without a GPU:
+//   1. Cell hashing     - Same grid cell and cell hash as 'spatial_partition.hlsli'
+//   2. Radix sort       - Sort particle indices by cell hash
+//   3. Cell start table - Start index and count for each cell hash
+//   4. Density/pressure - Per-particle density using the 'KernelSpike2D/3D' kernels
+//   5. Forces           - Pressure gradient, viscosity, and gravity
+//   6. Integration      - Constant acceleration over the step, with boundary planes
+#pragma once
+#include <execution>
+#include <numeric>
+#include "pr/common/hash.h"
+#include "pr/physics-2/forward.h"
+#include "pr/physics-2/utility/field.h"
+
+namespace pr::physics::fluid
+{
+	template <int Dim>
+	struct SphFluid
+	{
+		// Notes:
+		//  - Particle state is stored as structure-of-arrays, in the caller's particle order. The spatially sorted
+		//    copies of positions and velocities are also structure-of-arrays so that the neighbour loops are over
+		//    contiguous floats. The neighbour loops process four neighbours at a time with SSE when
+		//    'PR_MATHS_USE_INTRINSICS' is enabled.
+		//  - 'ReadParticles/WriteParticles' copy to/from any particle/dynamics types with 'pos', 'vel', and 'accel'
+		//    members (e.g. 'rdr12::compute::fluid::Particle/Dynamics'), so the CPU and GPU can share particle buffers.
+		//    The force model is not the GPU's (see 'ApplyForces'), so only the data layout matches, not the results.
+		//  - Cells are found by hash, so different cells can share a hash value. Neighbour loops use a distance test,
+		//    and each hash is visited at most once per particle, so collisions only cost time.
+		//  - Particles with NaN positions are hashed to the last cell (as on the GPU) and are ignored. They are skipped
+		//    by the density and force passes (their density and acceleration are zero), and by integration. No other
+		//    cell hashes to the last cell, so they are never the neighbour of a valid particle.
+
+		static_assert(Dim == 2 || Dim == 3, "Invalid dimension");
+		using Kernel = std::conditional_t<Dim == 2, field::KernelSpike2D, field::KernelSpike3D>;
+
+		struct ConfigData
+		{
+			v4 Gravity = { 0, -10.0f, 0, 0 }; // The acceleration due to gravity
+			float ParticleRadius = 0.1f;      // The radius of influence for each particle (the kernel radius)
+			float Mass = 1.0f;                // The mass of each particle
+			float RestDensity = 0.0f;         // The density at zero pressure. If zero, the density of the initial particles is used.
+			float Stiffness = 10.0f;          // Pressure per unit density above the rest density
+			float Viscosity = 0.05f;          // The viscosity scaler
+			float GridScale = 10.0f;          // The quantising factor for the spatial partition grid (typically 1/ParticleRadius)
+			int CellCount = 65521 + 1;        // The number of cell hash values. The last cell is reserved for NaN positions
+			v2 Restitution = { 1.0f, 1.0f };  // The coefficient of restitution (normal, tangential) for boundary planes
+			std::vector<v4> Boundaries;       // Planes (normal, distance) that particles are kept on the positive side of
+		};
+
+		ConfigData Config;
+
+		// Particle state in particle order
+		std::vector<float> m_pos[3];
+		std::vector<float> m_vel[3];
+		std::vector<float> m_acc[3];
+		std::vector<float> m_density;
+
+		// Spatial partition
+		std::vector<uint32_t> m_hash;      // The cell hash of each particle, in sorted order after 'Partition'
+		std::vector<uint32_t> m_spatial;   // Particle indices sorted by cell hash
+		std::vector<uint32_t> m_idx_start; // The lowest index (in 'm_spatial') for each cell hash (length CellCount)
+		std::vector<uint32_t> m_idx_count; // The number of particles for each cell hash (length CellCount)
+
+		// Spatially sorted copies of the particle state
+		std::vector<float> m_spos[3];
+		std::vector<float> m_svel[3];
+		std::vector<float> m_sdensity;
+		std::vector<float> m_spressure;
+
+		// Radix sort scratch
+		std::vector<uint32_t> m_tmp_hash;
+		std::vector<uint32_t> m_tmp_spatial;
+
+		explicit SphFluid(ConfigData config = {})
+			: Config(std::move(config))
+			, m_pos()
+			, m_vel()
+			, m_acc()
+			, m_density()
+			, m_hash()
+			, m_spatial()
+			, m_idx_start()
+			, m_idx_count()
+			, m_spos()
+			, m_svel()
+			, m_sdensity()
+			, m_spressure()
+			, m_tmp_hash()
+			, m_tmp_spatial()
+		{}
+
+		// The number of particles in the simulation
+		int ParticleCount() const
+		{
+			return isize(m_density);
+		}
+
+		// The density at particle 'i' from the last step
+		float Density(int i) const
+		{
+			return m_density[i];
+		}
+
+		// Set the particles in the simulation. 'dynamics' can be empty, meaning zero initial velocity.
+		template <typename TParticle, typename TDynamics>
+		void WriteParticles(std::span<TParticle const> particles, std::span<TDynamics const> dynamics)
+		{
+			if (!dynamics.empty() && dynamics.size() != particles.size())
+				throw std::runtime_error("WriteParticles: 'dynamics' must be empty or the same length as 'particles'");
+
+			Resize(isize(particles));
+			for (int i = 0, iend = isize(particles); i != iend; ++i)
+			{
+				for (int d = 0; d != 3; ++d)
+				{
+					m_pos[d][i] = d < Dim ? particles[i].pos[d] : 0.0f;
+					m_vel[d][i] = d < Dim && !dynamics.empty() ? dynamics[i].vel[d] : 0.0f;
+					m_acc[d][i] = 0.0f;
+				}
+			}
+
+			// Measure the rest density from the initial arrangement. Only valid particles (i.e. not NaN)
+			// with a finite density contribute. If there are none, 'RestDensity' is left unset.
+			if (Config.RestDensity == 0 && !particles.empty())
+			{
+				Partition(std::execution::par);
+				CalculateDensity(std::execution::par);
+
+				auto sum = 0.0;
+				auto count = 0;
+				for (int i = 0, iend = ParticleCount(); i != iend; ++i)
+				{
+					if (std::isnan(m_pos[0][i]) || std::isnan(m_pos[1][i]) || std::isnan(m_pos[2][i]) || !std::isfinite(m_density[i]))
+						continue;
+
+					sum += m_density[i];
+					++count;
+				}
+				if (count != 0)
+					Config.RestDensity = static_cast<float>(sum / count);
+			}
+		}
+		template <typename TParticle>
+		void WriteParticles(std::span<TParticle const> particles)
+		{
+			struct NoDynamics { v4 vel; };
+			WriteParticles(particles, std::span<NoDynamics const>{});
+		}
+
+		// Copy the particle state into 'particles' and 'dynamics'. Other members (colour, surface, etc) are not changed.
+		// 'accel' is the acceleration applied during the last step.
+		template <typename TParticle, typename TDynamics>
+		void ReadParticles(std::span<TParticle> particles, std::span<TDynamics> dynamics) const
+		{
+			if (particles.size() > m_density.size() || (!dynamics.empty() && dynamics.size() != particles.size()))
+				throw std::runtime_error("ReadParticles: invalid particle buffer range");
+
+			for (int i = 0, iend = isize(particles); i != iend; ++i)
+			{
+				particles[i].pos = v4(m_pos[0][i], m_pos[1][i], m_pos[2][i], 1);
+				if (dynamics.empty()) continue;
+				dynamics[i].vel = v4(m_vel[0][i], m_vel[1][i], m_vel[2][i], 0);
+				dynamics[i].accel = v4(m_acc[0][i], m_acc[1][i], m_acc[2][i], 0);
+			}
+		}
+
+		// Advance the simulation forward in time by 'elapsed_s' seconds
+		template <field::ExecutionPolicy Policy>
+		void Step(Policy&& policy, float elapsed_s)
+		{
+			if (m_density.empty())
+				return;
+
+			Partition(policy);
+			CalculateDensity(policy);
+			ApplyForces(policy);
+			Integrate(policy, elapsed_s);
+		}
+		void Step(float elapsed_s)
+		{
+			Step(std::execution::par, elapsed_s);
+		}
+
+		// Hash each particle into a grid cell, sort the particles by cell hash, and build the cell lookup table.
+		template <field::ExecutionPolicy Policy>
+		void Partition(Policy&& policy)
+		{
+			auto const count = ParticleCount();
+			auto const nan_cell = static_cast<uint32_t>(Config.CellCount - 1);
+			if (Config.CellCount < 2)
+				throw std::runtime_error("Partition: CellCount must be >= 2");
+
+			// Cell hash for each particle
+			ForEachBlock(policy, count, [&](int beg, int end)
+			{
+				for (int i = beg; i != end; ++i)
+				{
+					auto const x = m_pos[0][i], y = m_pos[1][i], z = m_pos[2][i];
+					m_hash[i] = std::isnan(x) || std::isnan(y) || std::isnan(z) ? nan_cell : CellHash(GridCell(x, y, z));
+					m_spatial[i] = static_cast<uint32_t>(i);
+				}
+			});
+
+			// Sort the particle indices by cell hash
+			RadixSort(policy, nan_cell);
+
+			// Build the cell lookup table
+			m_idx_start.assign(Config.CellCount, ~0U);
+			m_idx_count.assign(Config.CellCount, 0U);
+			ForEachBlock(policy, count, [&](int beg, int end)
+			{
+				for (int i = beg; i != end; ++i)
+				{
+					if (i != 0 && m_hash[i] == m_hash[i - 1])
+						continue;
+
+					auto j = i + 1;
+					for (; j != count && m_hash[j] == m_hash[i]; ++j) {}
+					m_idx_start[m_hash[i]] = static_cast<uint32_t>(i);
+					m_idx_count[m_hash[i]] = static_cast<uint32_t>(j - i);
+				}
+			});
+
+			// Spatially sorted copies of the particle state
+			ForEachBlock(policy, count, [&](int beg, int end)
+			{
+				for (int d = 0; d != 3; ++d)
+				{
+					for (int i = beg; i != end; ++i)
+					{
+						m_spos[d][i] = m_pos[d][m_spatial[i]];
+						m_svel[d][i] = m_vel[d][m_spatial[i]];
+					}
+				}
+			});
+		}
+
+		// Calculate the density and pressure at each particle. Requires 'Partition'.
+		template <field::ExecutionPolicy Policy>
+		void CalculateDensity(Policy&& policy)
+		{
+			Kernel const kernel(Config.ParticleRadius);
+			auto const mass = Config.Mass;
+			auto const nan_cell = static_cast<uint32_t>(Config.CellCount - 1);
+
+			ForEachBlock(policy, ParticleCount(), [&](int beg, int end)
+			{
+				for (int i = beg; i != end; ++i)
+				{
+					// Ignore particles with NaN positions
+					if (m_hash[i] == nan_cell)
+					{
+						m_sdensity[i] = 0.0f;
+						m_spressure[i] = 0.0f;
+						m_density[m_spatial[i]] = 0.0f;
+						continue;
+					}
+
+					auto const xi = m_spos[0][i], yi = m_spos[1][i], zi = m_spos[2][i];
+					auto density = 0.0f;
+					ForEachNeighbourRange(xi, yi, zi, [&](int nbeg, int nend)
+					{
+						auto j = nbeg;
+
+						// Four neighbours at a time
+						if constexpr (PR_MATHS_USE_INTRINSICS)
+						{
+							auto const zero = _mm_setzero_ps();
+							auto const radius = _mm_set1_ps(kernel.m_radius);
+							auto const inv_volume = _mm_set1_ps(1.0f / kernel.m_volume);
+							auto const Xi = _mm_set1_ps(xi), Yi = _mm_set1_ps(yi), Zi = _mm_set1_ps(zi);
+							auto sum = zero;
+							for (; j + 4 <= nend; j += 4)
+							{
+								auto const dx = _mm_sub_ps(Xi, _mm_loadu_ps(&m_spos[0][j]));
+								auto const dy = _mm_sub_ps(Yi, _mm_loadu_ps(&m_spos[1][j]));
+								auto const dz = Dim == 3 ? _mm_sub_ps(Zi, _mm_loadu_ps(&m_spos[2][j])) : zero;
+								auto const dist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+
+								// Influence = (radius - dist)^2 / volume, for dist < radius
+								auto const t = _mm_max_ps(_mm_sub_ps(radius, dist), zero);
+								sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(t, t), inv_volume));
+							}
+							density += _mm_cvtss_f32(_mm_dp_ps(sum, _mm_set1_ps(1.0f), 0xF1));
+						}
+
+						// Remaining neighbours
+						for (; j != nend; ++j)
+						{
+							auto const dx = xi - m_spos[0][j];
+							auto const dy = yi - m_spos[1][j];
+							auto const dz = Dim == 3 ? zi - m_spos[2][j] : 0.0f;
+							density += kernel.InfluenceAt(std::sqrt(dx * dx + dy * dy + dz * dz));
+						}
+					});
+
+					density *= mass;
+					m_sdensity[i] = density;
+					m_spressure[i] = std::max(0.0f, Config.Stiffness * (density - Config.RestDensity));
+					m_density[m_spatial[i]] = density;
+				}
+			});
+		}
+
+		// Calculate the acceleration of each particle from pressure, viscosity, and gravity. Requires 'CalculateDensity'.
+		template <field::ExecutionPolicy Policy>
+		void ApplyForces(Policy&& policy)
+		{
+			// Notes:
+			//  - Pressure uses the symmetric form: a_i = -sum_j m (p_i + p_j) / (2 rho_j) grad W(r_ij) / rho_i
+			//  - Viscosity pulls particle velocities toward the kernel weighted velocity of their neighbours:
+			//    a_i = mu * sum_j m (v_j - v_i) / rho_j W(r_ij) / rho_i
+			Kernel const kernel(Config.ParticleRadius);
+			auto const mass = Config.Mass;
+			auto const viscosity = Config.Viscosity;
+			auto const nan_cell = static_cast<uint32_t>(Config.CellCount - 1);
+
+			ForEachBlock(policy, ParticleCount(), [&](int beg, int end)
+			{
+				for (int i = beg; i != end; ++i)
+				{
+					// Ignore particles with NaN positions
+					if (m_hash[i] == nan_cell)
+					{
+						for (int d = 0; d != 3; ++d)
+							m_acc[d][m_spatial[i]] = 0.0f;
+
+						continue;
+					}
+
+					auto const xi = m_spos[0][i], yi = m_spos[1][i], zi = m_spos[2][i];
+					auto const vxi = m_svel[0][i], vyi = m_svel[1][i], vzi = m_svel[2][i];
+					auto const pi = m_spressure[i];
+					auto ax = 0.0f, ay = 0.0f, az = 0.0f;
+					ForEachNeighbourRange(xi, yi, zi, [&](int nbeg, int nend)
+					{
+						auto j = nbeg;
+
+						// Four neighbours at a time
+						if constexpr (PR_MATHS_USE_INTRINSICS)
+						{
+							auto const zero = _mm_setzero_ps();
+							auto const one = _mm_set1_ps(1.0f);
+							auto const radius = _mm_set1_ps(kernel.m_radius);
+							auto const inv_volume = _mm_set1_ps(1.0f / kernel.m_volume);
+							auto const Xi = _mm_set1_ps(xi), Yi = _mm_set1_ps(yi), Zi = _mm_set1_ps(zi);
+							auto const VXi = _mm_set1_ps(vxi), VYi = _mm_set1_ps(vyi), VZi = _mm_set1_ps(vzi);
+							auto const Pi = _mm_set1_ps(pi);
+							auto const Visc = _mm_set1_ps(viscosity);
+							auto Ax = zero, Ay = zero, Az = zero;
+							for (; j + 4 <= nend; j += 4)
+							{
+								auto const dx = _mm_sub_ps(Xi, _mm_loadu_ps(&m_spos[0][j]));
+								auto const dy = _mm_sub_ps(Yi, _mm_loadu_ps(&m_spos[1][j]));
+								auto const dz = Dim == 3 ? _mm_sub_ps(Zi, _mm_loadu_ps(&m_spos[2][j])) : zero;
+								auto const dist = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+								auto const not_self = _mm_cmpgt_ps(dist, zero); // Excludes self interaction
+								auto const inv_dist = _mm_and_ps(not_self, _mm_div_ps(one, dist));
+								auto const inv_rho = _mm_div_ps(one, _mm_loadu_ps(&m_sdensity[j]));
+
+								// Pressure, pushes 'i' away from 'j'. With t = max(radius - dist, 0), -0.5 * dInfluence = t / volume
+								auto const t = _mm_max_ps(_mm_sub_ps(radius, dist), zero);
+								auto const push = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(Pi, _mm_loadu_ps(&m_spressure[j])), inv_rho), _mm_mul_ps(_mm_mul_ps(t, inv_volume), inv_dist));
+
+								// Viscosity
+								auto const drag = _mm_and_ps(not_self, _mm_mul_ps(_mm_mul_ps(Visc, inv_rho), _mm_mul_ps(_mm_mul_ps(t, t), inv_volume)));
+
+								Ax = _mm_add_ps(Ax, _mm_add_ps(_mm_mul_ps(push, dx), _mm_mul_ps(drag, _mm_sub_ps(_mm_loadu_ps(&m_svel[0][j]), VXi))));
+								Ay = _mm_add_ps(Ay, _mm_add_ps(_mm_mul_ps(push, dy), _mm_mul_ps(drag, _mm_sub_ps(_mm_loadu_ps(&m_svel[1][j]), VYi))));
+								Az = _mm_add_ps(Az, _mm_add_ps(_mm_mul_ps(push, dz), _mm_mul_ps(drag, _mm_sub_ps(_mm_loadu_ps(&m_svel[2][j]), VZi))));
+							}
+							ax += _mm_cvtss_f32(_mm_dp_ps(Ax, one, 0xF1));
+							ay += _mm_cvtss_f32(_mm_dp_ps(Ay, one, 0xF1));
+							az += _mm_cvtss_f32(_mm_dp_ps(Az, one, 0xF1));
+						}
+
+						// Remaining neighbours
+						for (; j != nend; ++j)
+						{
+							auto const dx = xi - m_spos[0][j];
+							auto const dy = yi - m_spos[1][j];
+							auto const dz = Dim == 3 ? zi - m_spos[2][j] : 0.0f;
+							auto const dist = std::sqrt(dx * dx + dy * dy + dz * dz);
+							auto const inv_dist = dist > 0 ? 1.0f / dist : 0.0f; // Excludes self interaction
+							auto const inv_rho = 1.0f / m_sdensity[j];
+
+							// Pressure, pushes 'i' away from 'j' ('dInfluenceAt' is negative)
+							auto const push = -0.5f * (pi + m_spressure[j]) * inv_rho * kernel.dInfluenceAt(dist) * inv_dist;
+
+							// Viscosity
+							auto const drag = viscosity * inv_rho * kernel.InfluenceAt(dist) * (dist > 0 ? 1.0f : 0.0f);
+
+							ax += push * dx + drag * (m_svel[0][j] - vxi);
+							ay += push * dy + drag * (m_svel[1][j] - vyi);
+							az += push * dz + drag * (m_svel[2][j] - vzi);
+						}
+					});
+
+					auto const scale = mass / m_sdensity[i];
+					auto const idx = m_spatial[i];
+					m_acc[0][idx] = ax * scale + Config.Gravity.x;
+					m_acc[1][idx] = ay * scale + Config.Gravity.y;
+					m_acc[2][idx] = Dim == 3 ? az * scale + Config.Gravity.z : 0.0f;
+				}
+			});
+		}
+
+		// Advance positions and velocities, assuming the acceleration is constant over the step, and resolve boundary collisions.
+		template <field::ExecutionPolicy Policy>
+		void Integrate(Policy&& policy, float elapsed_s)
+		{
+			auto const dt = elapsed_s;
+			ForEachBlock(policy, ParticleCount(), [&](int beg, int end)
+			{
+				for (int i = beg; i != end; ++i)
+				{
+					v4 pos(m_pos[0][i], m_pos[1][i], m_pos[2][i], 1);
+					v4 vel(m_vel[0][i], m_vel[1][i], m_vel[2][i], 0);
+					v4 acc(m_acc[0][i], m_acc[1][i], m_acc[2][i], 0);
+					if (IsNaN(pos))
+						continue;
+
+					pos += vel * dt + 0.5f * acc * Sqr(dt);
+					vel += acc * dt;
+
+					// Keep the particle on the positive side of the boundary planes
+					for (auto const& plane : Config.Boundaries)
+					{
+						auto const dist = Dot(pos, plane);
+						if (dist >= 0)
+							continue;
+
+						// Move the particle onto the plane and reflect its velocity, with restitution
+						auto const normal = v4(plane.x, plane.y, plane.z, 0);
+						pos -= dist * normal;
+
+						auto const vel_n = Dot(vel, normal) * normal;
+						auto const vel_t = vel - vel_n;
+						vel = vel_t * Config.Restitution.y - vel_n * Config.Restitution.x;
+					}
+
+					for (int d = 0; d != Dim; ++d)
+					{
+						m_pos[d][i] = pos[d];
+						m_vel[d][i] = vel[d];
+					}
+				}
+			});
+		}
+
+	private:
+
+		// Resize the particle buffers
+		void Resize(int count)
+		{
+			for (int d = 0; d != 3; ++d)
+			{
+				m_pos[d].resize(count);
+				m_vel[d].resize(count);
+				m_acc[d].resize(count);
+				m_spos[d].resize(count);
+				m_svel[d].resize(count);
+			}
+			m_density.resize(count);
+			m_hash.resize(count);
+			m_spatial.resize(count);
+			m_sdensity.resize(count);
+			m_spressure.resize(count);
+			m_tmp_hash.resize(count);
+			m_tmp_spatial.resize(count);
+		}
+
+		// Convert a position into a grid cell coordinate (see 'GridCell' in 'spatial_partition.hlsli')
+		std::array<int, 3> GridCell(float x, float y, float z) const
+		{
+			auto const scale = Config.GridScale;
+			return { static_cast<int>(std::ceil(x * scale)), static_cast<int>(std::ceil(y * scale)), static_cast<int>(std::ceil(z * scale)) };
+		}
+
+		// Generate a hash from a grid cell coordinate (see 'CellHash' in 'spatial_partition.hlsli')
+		uint32_t CellHash(std::array<int, 3> const& grid) const
+		{
+			constexpr uint32_t prime1 = 73856093;
+			constexpr uint32_t prime2 = 19349663;
+			constexpr uint32_t prime3 = 83492791;
+			auto Hash = [](int value) { return (static_cast<uint32_t>(value) + hash::FNV_offset_basis32) * hash::FNV_prime32; };
+
+			// The last cell is reserved for 'nan' positions
+			return (Hash(grid[0]) * prime1 + Hash(grid[1]) * prime2 + Hash(grid[2]) * prime3) % static_cast<uint32_t>(Config.CellCount - 1);
+		}
+
+		// Call 'func(beg, end)' for each index range in the sorted particles whose cell is within the kernel radius of 'x,y,z'.
+		template <typename Func> void ForEachNeighbourRange(float x, float y, float z, Func func) const
+		{
+			auto const radius = Config.ParticleRadius;
+			auto const rz = Dim == 3 ? radius : 0.0f;
+			auto const lwr = GridCell(x - radius, y - radius, z - rz);
+			auto const upr = GridCell(x + radius, y + radius, z + rz);
+
+			// Different cells can have the same hash, only visit each hash once
+			pr::vector<uint32_t, 64> hashes;
+			std::array<int, 3> cell;
+			for (cell[2] = lwr[2]; cell[2] <= upr[2]; ++cell[2])
+			{
+				for (cell[1] = lwr[1]; cell[1] <= upr[1]; ++cell[1])
+				{
+					for (cell[0] = lwr[0]; cell[0] <= upr[0]; ++cell[0])
+					{
+						auto h = CellHash(cell);
+						if (m_idx_count[h] == 0 || std::find(std::begin(hashes), std::end(hashes), h) != std::end(hashes))
+							continue;
+
+						hashes.push_back(h);
+						func(static_cast<int>(m_idx_start[h]), static_cast<int>(m_idx_start[h] + m_idx_count[h]));
+					}
+				}
+			}
+		}
+
+		// LSD radix sort of 'm_spatial' by 'm_hash'. Stable, 8 bits per pass.
+		template <typename Policy> void RadixSort(Policy&& policy, uint32_t max_key)
+		{
+			constexpr int Bits = 8;
+			constexpr int Buckets = 1 << Bits;
+			auto const count = ParticleCount();
+			auto const blocks = BlockCount(count);
+
+			std::vector<std::array<uint32_t, Buckets>> offsets(blocks);
+			for (int shift = 0; shift < 32 && (max_key >> shift) != 0; shift += Bits)
+			{
+				// Histogram per block
+				ForEachBlock(policy, count, [&](int beg, int end)
+				{
+					auto& hist = offsets[beg / BlockSize];
+					hist.fill(0);
+					for (int i = beg; i != end; ++i)
+						++hist[(m_hash[i] >> shift) & (Buckets - 1)];
+				});
+
+				// Exclusive prefix sum, in bucket then block order, so that each block scatters to its own range
+				uint32_t sum = 0;
+				for (int b = 0; b != Buckets; ++b)
+				{
+					for (auto& hist : offsets)
+					{
+						auto n = hist[b];
+						hist[b] = sum;
+						sum += n;
+					}
+				}
+
+				// Scatter
+				ForEachBlock(policy, count, [&](int beg, int end)
+				{
+					auto& ofs = offsets[beg / BlockSize];
+					for (int i = beg; i != end; ++i)
+					{
+						auto dst = ofs[(m_hash[i] >> shift) & (Buckets - 1)]++;
+						m_tmp_hash[dst] = m_hash[i];
+						m_tmp_spatial[dst] = m_spatial[i];
+					}
+				});
+
+				std::swap(m_hash, m_tmp_hash);
+				std::swap(m_spatial, m_tmp_spatial);
+			}
+		}
+
+		// Split [0, count) into blocks and call 'func(beg, end)' for each block
+		static constexpr int BlockSize = 4096;
+		static int BlockCount(int count)
+		{
+			return (count + BlockSize - 1) / BlockSize;
+		}
+		template <typename Policy, typename Func> static void ForEachBlock(Policy&& policy, int count, Func func)
+		{
+			std::vector<int> blocks(BlockCount(count));
+			std::iota(std::begin(blocks), std::end(blocks), 0);
+			std::for_each(std::forward<Policy>(policy), std::begin(blocks), std::end(blocks), [&](int b)
+			{
+				func(b * BlockSize, std::min(count, (b + 1) * BlockSize));
+			});
+		}
+	};
+}
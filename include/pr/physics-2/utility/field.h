@@ -3,7 +3,8 @@
 //  Copyright (C) Rylogic Ltd 2016
 //*********************************************
 #pragma once
-#include "pr/algorithm/space_filling.h"
+#include <cmath>
+#include <execution>
 #include "pr/physics-2/forward.h"
 
 namespace pr::physics
@@ -11,6 +12,8 @@ namespace pr::physics
 	// Predefined kernels
 	namespace field
 	{
+		template <typename T> concept ExecutionPolicy = std::is_execution_policy_v<std::remove_cvref_t<T>>;
+
 		// A smoothing kernel defines the influence of a point at a given distance, the rate of
 		// change of that influence at a given distance, and the maximum range of the influence.
 		template <typename T> concept KernalType = requires(T k, float distance)
@@ -93,28 +96,51 @@ namespace pr::physics
 		// Notes:
 		//  - A field has a property (Scalar or Vector) defined at every point in space.
 		//  - Storing every point in space is inefficient, quantize to a 2D/3D grid.
-		//  - Map 2D/3D grid points to 1D using the Z-Order curve.
-		//  - Only need to store grid points with values.
-		//  - Inserting a value means updating values within the kernel radius.
-		//  - Returning a value means calculating the value at a point from points within the kernel radius.
-		//  - For efficiency, the kernel radius should span ~12 grid points (2D) or ~20 grid points (3D).
-		//  - There are no range limits on the field, but the more points stored, the more memory consumed.
-	
+		//  - Grid points are grouped into dense bricks (16x16 in 2D, 8x8x8 in 3D). Only bricks that contain
+		//    written grid points are stored. Bricks are found by hashing the packed brick coordinate.
+		//  - Splatting a value adds the kernel weighted value to the grid points within the kernel radius.
+		//  - Reading a value returns the kernel weighted average of the grid points within the kernel radius.
+		//    Grid points in bricks that aren't stored contribute 'm_default_value'.
+		//  - The kernel footprint is processed a brick row at a time. The weights for a row are calculated
+		//    into a small buffer first, so both the weight and the accumulate loops are over contiguous memory.
+		//  - For efficiency, the kernel radius should span a few grid points so that a footprint touches
+		//    only a handful of bricks.
+		//  - There are no range limits on the field (other than +/-2^20 bricks per axis in 3D), but the more
+		//    bricks stored, the more memory consumed.
+
 		static_assert(Dim == 2 || Dim == 3, "Invalid dimension");
 
 		using IVec = std::conditional_t<Dim == 2, iv2, iv4>;
 		using FVec = std::conditional_t<Dim == 2, v2, v4>;
-		using Map = std::unordered_map<int, int>;
-		using Prop = pr::vector<TProperty>;
+		using Coord = std::array<int, Dim>;
 
-		Map m_map;                 // This maps a Z-Order index to an index in 'm_field'
-		Prop m_field;              // Stores the field values
-		Kernel m_kernel;           // The smoothing kernel
-		TProperty m_default_value; // The value for non-stored field points.
+		static constexpr int BrickBits = Dim == 2 ? 4 : 3;
+		static constexpr int BrickSize = 1 << BrickBits;
+		static constexpr int BrickCells = 1 << (BrickBits * Dim);
+		static constexpr int BrickMask = BrickSize - 1;
+		using Brick = std::array<TProperty, BrickCells>;
+
+		// Mix the packed brick coordinate so that neighbouring bricks spread over the buckets
+		struct BrickHash
+		{
+			size_t operator()(uint64_t key) const noexcept
+			{
+				key ^= key >> 33;
+				key *= 0xff51afd7ed558ccdULL;
+				key ^= key >> 33;
+				return static_cast<size_t>(key);
+			}
+		};
+		using Map = std::unordered_map<uint64_t, int, BrickHash>;
+
+		Map m_map;                   // This maps a brick key to an index in 'm_bricks'
+		std::vector<Brick> m_bricks; // Stores the field values, a brick at a time
+		Kernel m_kernel;             // The smoothing kernel
+		TProperty m_default_value;   // The value for non-stored field points.
 
 		Field(Kernel kernal = {}, TProperty default_value = {})
 			: m_map()
-			, m_field()
+			, m_bricks()
 			, m_kernel(kernal)
 			, m_default_value(default_value)
 		{}
@@ -123,131 +149,335 @@ namespace pr::physics
 		void Reset()
 		{
 			m_map.clear();
-			m_field.resize(0);
+			m_bricks.resize(0);
 		}
 
-		// Loops over the grid points that fall within the kernel radius of 'position'.
-		void EnumSamplePoints(FVec position, std::function<TProperty(FVec)> value)
+		// The number of bricks stored
+		size_t BrickCount() const
 		{
-			auto const radius = m_kernel.Radius();
-			auto const radius_sq = Sqr(radius);
-			auto const range = (radius * 2 + 1);
-
-			// Lower and upper bounds in grid space
-			auto min = GridPoint(position - FVec(radius));
-			auto max = GridPoint(position + FVec(radius));
+			return m_bricks.size();
+		}
 
-			// Loop over X,Y,(Z) grid points
-			#pragma omp parallel for
-			for (int i = 0; i != Dim * range; ++i)
+		// Loops over the grid points that fall within the kernel radius of 'position'.
+		// 'func' is called with the position of each grid point and its kernel weight: 'func(FVec pt, float weight)'
+		template <typename Func> void EnumSamplePoints(FVec position, Func func) const
+		{
+			Footprint(position, [this](Coord const& brick) { return BrickIndex(brick); }, [&](Coord const& grid, int, int, float const* weights, int count)
 			{
-				auto pt = min + ZOrder<Dim>(i);
-
-				// Skip points outside the kernel radius
-				if (LengthSq(pt - position) > radius_sq)
-					continue;
-				
-				value(pt);
-			}
+				auto pt = GridPosition(grid);
+				for (int i = 0; i != count; ++i, pt[0] += Resolution)
+				{
+					if (weights[i] == 0) continue;
+					func(pt, weights[i]);
+				}
+			});
 		}
 
 		// Get the field value at a point in space.
-		// TODO: This function is incomplete — the weighted accumulation logic is not implemented.
+		// This is the kernel weighted average of the grid points within the kernel radius of 'position'.
 		TProperty ValueAt(FVec position) const
 		{
-			auto value = m_default_value;
-			// TODO: Loop over sample points within the kernel radius and accumulate
-			// weighted contributions: value += kernel.InfluenceAt(dist) * field[pt]
-			return value;
+			auto value = TProperty{};
+			auto weight = 0.0f;
+			Footprint(position, [this](Coord const& brick) { return BrickIndex(brick); }, [&](Coord const&, int brick, int cell, float const* weights, int count)
+			{
+				auto sum = 0.0f;
+				if (brick != -1)
+				{
+					auto const* values = &m_bricks[brick][cell];
+					for (int i = 0; i != count; ++i)
+					{
+						value += values[i] * weights[i];
+						sum += weights[i];
+					}
+				}
+				else
+				{
+					for (int i = 0; i != count; ++i)
+						sum += weights[i];
+
+					value += m_default_value * sum;
+				}
+				weight += sum;
+			});
+			return weight != 0 ? value * (1.0f / weight) : m_default_value;
+		}
+
+		// Get the field values at 'positions', evaluating the positions concurrently.
+		template <field::ExecutionPolicy Policy>
+		void ValueAt(Policy&& policy, std::span<FVec const> positions, std::span<TProperty> values) const
+		{
+			if (positions.size() != values.size())
+				throw std::runtime_error("ValueAt: 'positions' and 'values' must be the same length");
+
+			std::transform(std::forward<Policy>(policy), std::begin(positions), std::end(positions), std::begin(values), [this](FVec position)
+			{
+				return ValueAt(position);
+			});
+		}
+		void ValueAt(std::span<FVec const> positions, std::span<TProperty> values) const
+		{
+			ValueAt(std::execution::seq, positions, values);
 		}
 
 		// Set a field value at a point in space.
+		// This sets the value of the nearest grid point only.
 		void ValueAt(FVec position, TProperty value)
 		{
-			// Convert the floating point position to an infinite grid position
-			auto grid_point = To<IVec>(position / (1 << Bits));
+			Coord grid;
+			for (int i = 0; i != Dim; ++i)
+				grid[i] = static_cast<int>(std::floor(position[i] / Resolution + 0.5f));
 
-			// Convert the grid point to a Z-Order index
-			auto index = ZOrder(grid_point);
-
-			// Lookup the index in the map
-			auto it = m_map.find(index);
-			if (it != m_map.end())
-			{
-				m_field[it->second] = value;
-			}
-			else
-			{
-				m_map[index] = m_field.size();
-				m_field.push_back(value);
-			}
+			Cell(grid) = value;
 		}
 
 		// Set a field value at a volume in space.
 		// 'value' is a function that calculates the value at a given point in space
 		// 'position + radius' define the volume of space affected by 'value'.
-		void ValueAt(FVec position, float radius, std::function<TProperty(FVec)> value)
+		template <typename Func> void ValueAt(FVec position, float radius, Func value)
 		{
-			// Convert the floating point position to an infinite grid position
-			auto grid_point = To<IVec>(position / (1 << Bits));
+			Coord lo, hi;
+			if (!GridRange(position, radius / Resolution, lo, hi))
+				return;
 
-			// Convert the grid point to a Z-Order index
-			auto index = ZOrder(grid_point);
-
-			// Lookup the index in the map
-			auto it = m_map.find(index);
-			if (it != m_map.end())
+			auto const radius_sq = Sqr(radius);
+			auto const z0 = Dim == 3 ? lo[Dim - 1] : 0;
+			auto const z1 = Dim == 3 ? hi[Dim - 1] : 0;
+			for (int z = z0; z <= z1; ++z)
 			{
-				m_field[it->second] = value(position);
+				for (int y = lo[1]; y <= hi[1]; ++y)
+				{
+					for (int x = lo[0]; x <= hi[0]; ++x)
+					{
+						Coord grid;
+						grid[0] = x;
+						grid[1] = y;
+						if constexpr (Dim == 3)
+							grid[2] = z;
+
+						auto pt = GridPosition(grid);
+
+						// Skip points outside the radius
+						auto dist_sq = 0.0f;
+						for (int i = 0; i != Dim; ++i)
+							dist_sq += Sqr(pt[i] - position[i]);
+						if (dist_sq > radius_sq)
+							continue;
+
+						Cell(grid) = value(pt);
+					}
+				}
 			}
-			else
+		}
+
+		// Add 'value', weighted by the kernel, to the grid points within the kernel radius of 'position'.
+		void Splat(FVec position, TProperty value)
+		{
+			Footprint(position, [this](Coord const& brick) { return AddBrick(brick); }, [&](Coord const&, int brick, int cell, float const* weights, int count)
 			{
-				m_map[index] = m_field.size();
-				m_field.push_back(value(position));
+				auto* values = &m_bricks[brick][cell];
+				for (int i = 0; i != count; ++i)
+					values[i] += value * weights[i];
+			});
+		}
+
+		// Splat 'values[i]' at 'positions[i]'.
+		void Splat(std::span<FVec const> positions, std::span<TProperty const> values)
+		{
+			if (positions.size() != values.size())
+				throw std::runtime_error("Splat: 'positions' and 'values' must be the same length");
+
+			// Splat in brick order so that consecutive samples update the same bricks.
+			// The result is the same as splatting in the given order (up to float rounding).
+			std::vector<std::pair<uint64_t, int>> order(positions.size());
+			for (int i = 0, iend = isize(positions); i != iend; ++i)
+			{
+				Coord brick;
+				for (int d = 0; d != Dim; ++d)
+					brick[d] = static_cast<int>(std::floor(positions[i][d] / Resolution)) >> BrickBits;
+
+				order[i] = { BrickKey(brick), i };
 			}
+			std::sort(std::begin(order), std::end(order));
+
+			for (auto [key, i] : order)
+				Splat(positions[i], values[i]);
 		}
 
 	private:
 
-		// Convert a grid point to a Z-Order index
-		int64_t ZOrder(IVec grid_point) const
+		// Pack a brick coordinate into a key
+		static uint64_t BrickKey(Coord const& brick)
 		{
 			if constexpr (Dim == 2)
 			{
-				return space_filling::ZOrder2D(grid_point);
-			}
-			else if constexpr (Dim == 3)
-			{
-				return space_filling::ZOrder3D(grid_point);
+				return
+					(static_cast<uint64_t>(static_cast<uint32_t>(brick[0])) <<  0) |
+					(static_cast<uint64_t>(static_cast<uint32_t>(brick[1])) << 32);
 			}
 			else
 			{
-				static_assert(pr::dependent_false<TProperty>, "Invalid dimension");
+				constexpr uint64_t mask = (1ULL << 21) - 1;
+				return
+					((static_cast<uint64_t>(brick[0]) & mask) <<  0) |
+					((static_cast<uint64_t>(brick[1]) & mask) << 21) |
+					((static_cast<uint64_t>(brick[2]) & mask) << 42);
 			}
 		}
 
-		// Convert a Z-Order index to a grid point
-		IVec ZOrder(int64_t index) const
+		// Return the index of the brick at 'brick' (in brick units), or -1 if not stored
+		int BrickIndex(Coord const& brick) const
 		{
-			if constexpr (Dim == 2)
-			{
-				return space_filling::ZOrder2D(index);
-			}
-			else if constexpr (Dim == 3)
+			auto iter = m_map.find(BrickKey(brick));
+			return iter != m_map.end() ? iter->second : -1;
+		}
+
+		// Return the index of the brick at 'brick' (in brick units), creating it if needed
+		int AddBrick(Coord const& brick)
+		{
+			auto key = BrickKey(brick);
+			auto [iter, added] = m_map.try_emplace(key, isize(m_bricks));
+			if (added)
 			{
-				return space_filling::ZOrder3D(index);
+				m_bricks.emplace_back();
+				m_bricks.back().fill(m_default_value);
 			}
-			else
+			return iter->second;
+		}
+
+		// Return the index of the grid point 'grid' within its brick
+		static int CellIndex(Coord const& grid)
+		{
+			auto index = 0;
+			for (int i = 0; i != Dim; ++i)
+				index |= (grid[i] & BrickMask) << (i * BrickBits);
+
+			return index;
+		}
+
+		// Return the stored value for the grid point 'grid', creating the brick if needed
+		TProperty& Cell(Coord const& grid)
+		{
+			Coord brick;
+			for (int i = 0; i != Dim; ++i)
+				brick[i] = grid[i] >> BrickBits;
+
+			return m_bricks[AddBrick(brick)][CellIndex(grid)];
+		}
+
+		// Convert a grid point to a position in space
+		static FVec GridPosition(Coord const& grid)
+		{
+			FVec pt = {};
+			for (int i = 0; i != Dim; ++i)
+				pt[i] = grid[i] * Resolution;
+			if constexpr (Dim == 3)
+				pt.w = 1.0f;
+
+			return pt;
+		}
+
+		// Get the inclusive range of grid points within 'radius' (in grid units) of 'position'. Returns false if empty.
+		static bool GridRange(FVec position, float radius, Coord& lo, Coord& hi)
+		{
+			for (int i = 0; i != Dim; ++i)
 			{
-				static_assert(pr::dependent_false<TProperty>, "Invalid dimension");
+				auto q = position[i] / Resolution;
+				lo[i] = static_cast<int>(std::ceil(q - radius));
+				hi[i] = static_cast<int>(std::floor(q + radius));
+				if (hi[i] < lo[i])
+					return false;
 			}
+			return true;
 		}
 
-		// Convert a floating point position to a grid position
-		IVec GridPoint(FVec position) const
+		// Visit the grid points within the kernel radius of 'position' a brick row at a time.
+		// 'lookup(Coord brick)' returns the index of a brick or -1.
+		// 'row(Coord grid, int brick, int cell, float const* weights, int count)' is called for each row of grid points
+		// that intersects the kernel radius, where 'grid' is the first grid point of the row and 'cell' is its index within
+		// the brick. Grid points on the boundary of the kernel radius can have zero weight.
+		template <typename Lookup, typename Row> void Footprint(FVec position, Lookup lookup, Row row) const
 		{
-			return To<IVec>(position / Resolution);
+			auto const radius = m_kernel.Radius() / Resolution;
+			auto const radius_sq = Sqr(radius);
+
+			Coord lo, hi;
+			if (!GridRange(position, radius, lo, hi))
+				return;
+
+			float q[Dim];
+			Coord blo, bhi;
+			for (int i = 0; i != Dim; ++i)
+			{
+				q[i] = position[i] / Resolution;
+				blo[i] = lo[i] >> BrickBits;
+				bhi[i] = hi[i] >> BrickBits;
+			}
+
+			float weights[BrickSize];
+			auto const bz0 = Dim == 3 ? blo[Dim - 1] : 0;
+			auto const bz1 = Dim == 3 ? bhi[Dim - 1] : 0;
+			for (int bz = bz0; bz <= bz1; ++bz)
+			{
+				for (int by = blo[1]; by <= bhi[1]; ++by)
+				{
+					for (int bx = blo[0]; bx <= bhi[0]; ++bx)
+					{
+						Coord brick;
+						brick[0] = bx;
+						brick[1] = by;
+						if constexpr (Dim == 3)
+							brick[2] = bz;
+
+						auto const index = lookup(brick);
+
+						// The range of grid points within this brick
+						Coord g0, g1;
+						for (int i = 0; i != Dim; ++i)
+						{
+							g0[i] = std::max(lo[i], brick[i] * BrickSize);
+							g1[i] = std::min(hi[i], brick[i] * BrickSize + BrickMask);
+						}
+
+						auto const z0 = Dim == 3 ? g0[Dim - 1] : 0;
+						auto const z1 = Dim == 3 ? g1[Dim - 1] : 0;
+						for (int z = z0; z <= z1; ++z)
+						{
+							auto const dz = Dim == 3 ? z - q[Dim - 1] : 0.0f;
+							for (int y = g0[1]; y <= g1[1]; ++y)
+							{
+								auto const dy = y - q[1];
+								auto const d_sq = Sqr(dy) + Sqr(dz);
+								if (d_sq >= radius_sq)
+									continue;
+
+								// Clip the row to the kernel radius
+								auto const half = std::sqrt(radius_sq - d_sq);
+								auto const x0 = std::max(g0[0], static_cast<int>(std::ceil(q[0] - half)));
+								auto const x1 = std::min(g1[0], static_cast<int>(std::floor(q[0] + half)));
+								auto const count = x1 - x0 + 1;
+								if (count <= 0)
+									continue;
+
+								// Kernel weights for the row
+								for (int i = 0; i != count; ++i)
+								{
+									auto const dx = (x0 + i) - q[0];
+									weights[i] = m_kernel.InfluenceAt(std::sqrt(Sqr(dx) + d_sq) * Resolution);
+								}
+
+								Coord grid = g0;
+								grid[0] = x0;
+								grid[1] = y;
+								if constexpr (Dim == 3)
+									grid[2] = z;
+
+								row(grid, index, CellIndex(grid), &weights[0], count);
+							}
+						}
+					}
+				}
+			}
 		}
 	};
 }
-
@@ -123,6 +123,31 @@ namespace pr::script
 		using modules_t = std::vector<HMODULE>;
 		using strtable_t = std::unordered_map<string_t, std::string>;
 
+		// The contents of an include file, read once and shared by all sources opened on it
+		struct CachedFile
+		{
+			std::string m_data;
+			EEncoding m_enc;
+			int m_bom_size;
+			std::filesystem::file_time_type m_time;
+		};
+		using filecache_t = std::unordered_map<std::wstring, std::shared_ptr<CachedFile const>>;
+
+		// A source that reads from the cached contents of an include file
+		struct CachedFileSrc :StringSrc
+		{
+			// Hold a reference to the data, since the cache entry can be replaced while this source is in use
+			std::shared_ptr<CachedFile const> m_file;
+
+			CachedFileSrc(std::shared_ptr<CachedFile const> file, std::filesystem::path const& filepath)
+				:StringSrc(std::string_view(file->m_data).substr(s_cast<size_t>(file->m_bom_size)), file->m_enc)
+				,m_file(file)
+			{
+				// Report locations as if reading from the file
+				m_loc = Loc{ filepath, s_cast<std::streamsize>(file->m_data.size()), file->m_bom_size, file->m_bom_size, 1, 1, true };
+			}
+		};
+
 	private:
 
 		// Types of includes supported
@@ -137,6 +162,12 @@ namespace pr::script
 		// A map of include names to utf-8 strings.
 		strtable_t m_strtab;
 
+		// Include files that have been read during this session
+		filecache_t m_file_cache;
+
+		// True if include files should be read once and then served from 'm_file_cache'
+		bool m_cache_files;
+
 	public:
 
 		explicit Includes(EIncludeTypes types = EIncludeTypes::All)
@@ -144,6 +175,8 @@ namespace pr::script
 			,m_paths()
 			,m_modules()
 			,m_strtab()
+			,m_file_cache()
+			,m_cache_files(true)
 			,FileOpened()
 		{}
 		explicit Includes(std::initializer_list<HMODULE> modules, EIncludeTypes types = EIncludeTypes::All)
@@ -210,6 +243,24 @@ namespace pr::script
 			m_strtab = strtab;
 		}
 
+		// Get/Set whether included files are cached. Files are re-read if their timestamp changes.
+		bool CacheFiles() const
+		{
+			return m_cache_files;
+		}
+		void CacheFiles(bool cache)
+		{
+			m_cache_files = cache;
+			if (!cache)
+				ClearCache();
+		}
+
+		// Release the cached include file contents
+		void ClearCache()
+		{
+			m_file_cache.clear();
+		}
+
 		// Get/Set the search paths as a delimited list
 		std::string SearchPathList() const
 		{
@@ -295,6 +346,9 @@ namespace pr::script
 			if (AllSet(m_types, EIncludeTypes::Files) && ResolveFileInclude(include, AllSet(flags, EIncludeFlags::IncludeLocalDir), loc, fullpath, searched_paths))
 			{
 				FileOpened(*this, fullpath);
+				if (m_cache_files)
+					return std::unique_ptr<CachedFileSrc>(new CachedFileSrc(CacheFile(fullpath), fullpath));
+
 				return std::unique_ptr<FileSrc>(new FileSrc(fullpath));
 			}
 
@@ -373,6 +427,35 @@ namespace pr::script
 
 	private:
 
+		// Return the cached contents of 'filepath', reading the file if not cached or if it has changed
+		std::shared_ptr<CachedFile const> CacheFile(std::filesystem::path const& filepath)
+		{
+			auto key = filepath.lexically_normal().wstring();
+			auto time = std::filesystem::last_write_time(filepath);
+
+			auto iter = m_file_cache.find(key);
+			if (iter != std::end(m_file_cache) && iter->second->m_time == time)
+				return iter->second;
+
+			auto file = std::make_shared<CachedFile>();
+			file->m_time = time;
+			file->m_bom_size = 0;
+			file->m_enc = filesys::DetectFileEncoding(filepath, file->m_bom_size);
+
+			// Read the whole file in one go
+			std::ifstream in(filepath, std::ios::binary);
+			if (!in.good())
+				throw ScriptException(EResult::FileNotFound, Loc(filepath), std::wstring(L"Failed to open file ").append(filepath));
+
+			file->m_data.resize(s_cast<size_t>(std::filesystem::file_size(filepath)));
+			in.read(file->m_data.data(), s_cast<std::streamsize>(file->m_data.size()));
+			file->m_data.resize(s_cast<size_t>(in.gcount()));
+			file->m_bom_size = std::min(file->m_bom_size, s_cast<int>(file->m_data.size()));
+
+			m_file_cache[key] = file;
+			return file;
+		}
+
 		// Resolve an include into a full path
 		bool ResolveFileInclude(std::filesystem::path const& include, bool include_local_dir, Loc const& loc, std::filesystem::path& result, std::vector<std::filesystem::path>& searched_paths)
 		{
@@ -93,6 +93,119 @@ namespace pr::script
 		// is assumed to return already decoded utf-16 characters and so should never see an 'EOS'.
 		virtual int Read() = 0;
 
+		// Return the unread bytes of the underlying stream that are held contiguously in memory.
+		// Byte sources that can hand out blocks of data allow 'ReadAhead()' to decode whole runs of
+		// characters without a virtual call to 'Read()' per byte. Bytes used from the span are passed
+		// to 'ReadSpanConsume()'. An empty span means 'Read()' should be used instead.
+		virtual std::string_view ReadSpan()
+		{
+			return {};
+		}
+		virtual void ReadSpanConsume(size_t n)
+		{
+			(void)n;
+		}
+
+		// Decode up to 'count' characters from the span of bytes returned by 'ReadSpan()' into the local buffer.
+		// Returns the number of characters buffered. Characters that are split across the end of the span, encoding
+		// errors, and terminating nulls are left for the per-byte path in 'ReadAhead()' to handle.
+		int64_t DecodeSpan(int64_t count)
+		{
+			auto bytes = ReadSpan();
+			if (bytes.empty())
+				return 0;
+
+			auto const* beg = reinterpret_cast<uint8_t const*>(bytes.data());
+			auto const* end = beg + bytes.size();
+			auto const* ptr = beg;
+
+			// Every character is at least one byte
+			auto const ofs = m_buffer.size();
+			m_buffer.resize(ofs + s_cast<size_t>(std::min(count, s_cast<int64_t>(bytes.size()))));
+			auto* out = m_buffer.data() + ofs;
+			auto* out_end = m_buffer.data() + m_buffer.size();
+
+			switch (m_enc)
+			{
+				case EEncoding::ascii:
+				{
+					for (; ptr != end && out != out_end && *ptr != 0 && *ptr < 0x80; ++ptr)
+						*out++ = s_cast<char_t>(*ptr);
+					break;
+				}
+				case EEncoding::ascii_extended:
+				{
+					for (; ptr != end && out != out_end && *ptr != 0; ++ptr)
+						*out++ = s_cast<char_t>(*ptr);
+					break;
+				}
+				case EEncoding::utf8:
+				{
+					for (; ptr != end && out != out_end;)
+					{
+						auto const b0 = ptr[0];
+						if (b0 < 0x80)
+						{
+							if (b0 == 0) break;
+							*out++ = s_cast<char_t>(b0);
+							ptr += 1;
+							continue;
+						}
+
+						// Two byte sequences (excluding overlong forms)
+						if (b0 >= 0xC2 && b0 <= 0xDF && end - ptr >= 2 && (ptr[1] & 0xC0) == 0x80)
+						{
+							*out++ = s_cast<char_t>(((b0 & 0x1F) << 6) | (ptr[1] & 0x3F));
+							ptr += 2;
+							continue;
+						}
+
+						// Three byte sequences (excluding overlong forms and surrogates)
+						if (b0 >= 0xE0 && b0 <= 0xEF && end - ptr >= 3 && (ptr[1] & 0xC0) == 0x80 && (ptr[2] & 0xC0) == 0x80 &&
+							!(b0 == 0xE0 && ptr[1] < 0xA0) && !(b0 == 0xED && ptr[1] >= 0xA0))
+						{
+							*out++ = s_cast<char_t>(((b0 & 0x0F) << 12) | ((ptr[1] & 0x3F) << 6) | (ptr[2] & 0x3F));
+							ptr += 3;
+							continue;
+						}
+
+						// Anything else goes through 'mbrtoc16'
+						break;
+					}
+					break;
+				}
+				case EEncoding::utf16_le:
+				{
+					for (; end - ptr >= 2 && out != out_end; ptr += 2)
+					{
+						auto const ch = s_cast<char_t>(ptr[0] | (ptr[1] << 8));
+						if (ch == 0) break;
+						*out++ = ch;
+					}
+					break;
+				}
+				case EEncoding::utf16_be:
+				{
+					for (; end - ptr >= 2 && out != out_end; ptr += 2)
+					{
+						auto const ch = s_cast<char_t>((ptr[0] << 8) | ptr[1]);
+						if (ch == 0) break;
+						*out++ = ch;
+					}
+					break;
+				}
+				default:
+				{
+					break;
+				}
+			}
+
+			auto const decoded = out - (m_buffer.data() + ofs);
+			m_buffer.resize(ofs + s_cast<size_t>(decoded));
+			ReadSpanConsume(s_cast<size_t>(ptr - beg));
+			return decoded;
+		}
+
 	public:
 
 		virtual ~Src() {}
@@ -229,6 +342,10 @@ namespace pr::script
 
 			for (; n > s_cast<int64_t>(m_buffer.size());)
 			{
+				// Decode runs of characters directly from the source's bytes, if available
+				if (m_enc != EEncoding::already_decoded && DecodeSpan(n - s_cast<int64_t>(m_buffer.size())) != 0)
+					continue;
+
 				// Ensure 'Buffer's length grows with each loop
 				auto const count = m_buffer.size();
 
@@ -501,6 +618,16 @@ namespace pr::script
 			return m_ptr != m_end ? static_cast<uint8_t>(*m_ptr++) : EOS;
 		}
 
+		// The string is contiguous, so hand out the remaining bytes
+		std::string_view ReadSpan() noexcept override
+		{
+			return std::string_view(m_ptr, s_cast<size_t>(m_end - m_ptr));
+		}
+		void ReadSpanConsume(size_t n) noexcept override
+		{
+			m_ptr += n;
+		}
+
 		// Read all data into the local buffer
 		template <typename Char>
 		void BufferLocally(std::basic_string_view<Char> str)
@@ -624,11 +751,38 @@ namespace pr::script
 		// The size of the potion of the file to read.
 		uintmax_t m_filesize;
 
+		// A block of bytes read from the file, and the unread range within it
+		std::unique_ptr<char[]> m_block;
+		size_t m_block_beg;
+		size_t m_block_end;
+		static constexpr size_t BlockSize = 64 * 1024;
+
 		// Return the next byte or decoded character from the underlying stream, or EOS for the end of the stream.
 		int Read() override
 		{
-			auto ch = m_file.get();
-			return m_file.good() ? ch : EOS;
+			auto span = ReadSpan();
+			if (span.empty()) return EOS;
+			++m_block_beg;
+			return static_cast<uint8_t>(span[0]);
+		}
+
+		// Return the unread part of the current block, reading the next block from the file when it is empty
+		std::string_view ReadSpan() override
+		{
+			if (m_block_beg == m_block_end && m_file.is_open() && m_file.good())
+			{
+				if (!m_block)
+					m_block.reset(new char[BlockSize]);
+
+				m_file.read(m_block.get(), BlockSize);
+				m_block_beg = 0;
+				m_block_end = s_cast<size_t>(m_file.gcount());
+			}
+			return std::string_view(m_block.get() + m_block_beg, m_block_end - m_block_beg);
+		}
+		void ReadSpanConsume(size_t n) override
+		{
+			m_block_beg += n;
 		}
 
 	public:
@@ -643,6 +797,9 @@ namespace pr::script
 			:Src(enc, Loc{})
 			,m_file()
 			,m_filesize()
+			,m_block()
+			,m_block_beg()
+			,m_block_end()
 		{
 			if (!filepath.empty())
 				Open(filepath, ofs, limit, enc);
@@ -689,6 +846,8 @@ namespace pr::script
 		void Close()
 		{
 			m_file.close();
+			m_block_beg = 0;
+			m_block_end = 0;
 			m_enc = EEncoding::auto_detect;
 			m_loc = Loc();
 		}
@@ -696,12 +855,17 @@ namespace pr::script
 		// Get/Set the read position in the file
 		int64_t Position() const
 		{
+			// 'tellg' fails once the end of file is reached, so use the file size in that case
 			std::streamoff ofs = const_cast<std::ifstream&>(m_file).tellg();
-			return s_cast<int64_t>(ofs);
+			auto pos = ofs != std::streamoff(-1) ? s_cast<int64_t>(ofs) : s_cast<int64_t>(m_filesize);
+			return pos - s_cast<int64_t>(m_block_end - m_block_beg);
 		}
 		int64_t Position(int64_t pos)
 		{
+			m_file.clear();
 			m_file.seekg(s_cast<std::streamoff>(pos), std::ios::beg);
+			m_block_beg = 0;
+			m_block_end = 0;
 			return Position();
 		}
 
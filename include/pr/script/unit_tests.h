@@ -149,6 +149,31 @@ namespace pr::script
 			PR_EXPECT(*file == str[0]); ++file;
 			PR_EXPECT(*file == str[1]); ++file;
 		}
+		PRUnitTestMethod(FileSourceBlocks)
+		{
+			// Multi-byte characters that straddle the file read blocks
+			std::string data; std::wstring str;
+			for (int i = 0; i != 20000; ++i)
+			{
+				data.append("abc\xc3\xa9\xe4\xbd\xa0\n");
+				str.append(L"abc\u00e9\u4f60\n");
+			}
+
+			{// Create the file
+				std::ofstream fout(script_utf, std::ios::binary);
+				fout.write(data.data(), s_cast<std::streamsize>(data.size()));
+			}
+
+			// Read a character at a time
+			FileSrc file(script_utf, EEncoding::utf8);
+			std::wstring r; for (; *file; ++file) r.push_back(*file);
+			PR_EXPECT(r == str);
+
+			// Read in bulk
+			FileSrc file2(script_utf, EEncoding::utf8);
+			PR_EXPECT(file2.ReadAhead(Src::AllData) == s_cast<int64_t>(str.size()));
+			PR_EXPECT(file2.Buffer() == str);
+		}
 		PRUnitTestMethod(EatFunctions)
 		{
 			{
@@ -604,6 +629,14 @@ namespace pr::script
 
 			std::wstring r; for (;*src; ++src) r.push_back(*src);
 			PR_EXPECT(str::Equal(r, data));
+
+			// The second open is served from the cache
+			auto src2_ptr = inc.Open(script_include, EIncludeFlags::None);
+			auto& src2 = *src2_ptr;
+			PR_EXPECT(src2.Location().Filepath() == script_include);
+
+			std::wstring r2; for (;*src2; ++src2) r2.push_back(*src2);
+			PR_EXPECT(r2 == r);
 		}
 	}
 	PRUnitTest(TokeniserTests)
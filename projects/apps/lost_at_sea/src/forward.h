@@ -9,8 +9,10 @@
 #include <concepts>
 #include <string_view>
 #include <string>
+#include <span>
 #include <filesystem>
 #include <variant>
+#include <atomic>
 
 // Windows
 #include <windows.h>
@@ -25,6 +25,7 @@ namespace las
 		, m_sim_state()
 		, m_sim_time(0.0)
 		, m_render_frame(0)
+		, m_spectral_physics(false)
 		, m_step_graph(2)   // Step graph: small thread pool (input-heavy, will grow with physics/AI)
 		, m_render_graph(4) // Render graph: larger pool for parallel CB prep
 		, m_imgui({
@@ -80,6 +81,12 @@ namespace las
 			ui.Text("-- Underwater --");
 			ui.SliderFloat("Smooth Depth", &tuning.m_underwater_smooth_depth, 10.0f, 200.0f);
 		});
+		m_diag.AddPanel("Ocean Physics", [this](ImGuiUI& ui)
+		{
+			auto spectral = m_spectral_physics.load();
+			if (ui.Checkbox("Spectral Height Field", &spectral))
+				m_spectral_physics = spectral;
+		});
 	}
 	Main::~Main()
 	{
@@ -117,6 +124,14 @@ namespace las
 
 		// Physics task: step rigid bodies
 		m_step_graph.Add(StepTaskId::Physics, [&, dt](auto&) -> pr::task_graph::Task {
+			// Switch the ocean physics model between steps, not while the ship is reading it
+			if (m_spectral_physics != m_ocean.IsSpectral())
+			{
+				auto params = SpectralOcean::Params{};
+				m_ocean.UseSpectral(m_spectral_physics ? &params : nullptr);
+			}
+
+			m_ocean.Update(static_cast<float>(m_sim_time));
 			m_ship.Step(dt, m_ocean, m_height_field, static_cast<float>(m_sim_time));
 			co_return;
 		});
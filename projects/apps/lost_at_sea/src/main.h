@@ -46,6 +46,9 @@ namespace las
 		double m_sim_time;
 		int64_t m_render_frame;
 
+		// Use the spectral height field for ocean physics queries (set from the UI, applied in the step)
+		std::atomic<bool> m_spectral_physics;
+
 		// Task graphs for parallel execution
 		pr::task_graph::Graph<StepTaskId> m_step_graph;
 		pr::task_graph::Graph<RenderTaskId> m_render_graph;
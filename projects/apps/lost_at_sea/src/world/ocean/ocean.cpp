@@ -6,6 +6,7 @@
 #include "src/world/ocean/ocean.h"
 #include "src/world/ocean/gerstner_wave.h"
 #include "src/world/ocean/shaders/ocean_shader.h"
+#include <immintrin.h>
 
 namespace las
 {
@@ -23,6 +24,7 @@ namespace las
 		: m_inst()
 		, m_waves()
 		, m_shader()
+		, m_spectral()
 	{
 		// Initialise the ocean with a set of default wave components.
 		// Scale: ~1m amplitude swell, realistic for sailing ship conditions (Beaufort 4-5).
@@ -134,11 +136,31 @@ namespace las
 		factory.FlushToGpu(EGpuFlush::Block);
 	}
 
+	// Use a spectral height field for physics queries
+	void Ocean::UseSpectral(SpectralOcean::Params const* params)
+	{
+		m_spectral = params != nullptr ? std::make_unique<SpectralOcean>(*params) : nullptr;
+	}
+	bool Ocean::IsSpectral() const
+	{
+		return m_spectral != nullptr;
+	}
+
+	// Evolve the spectral height field
+	void Ocean::Update(float time)
+	{
+		if (m_spectral)
+			m_spectral->Update(time);
+	}
+
 	// Physics queries — kept for buoyancy calculations in Phase 2
 
 	// 
 	float Ocean::HeightAt(float world_x, float world_y, float time) const
 	{
+		if (m_spectral)
+			return m_spectral->HeightAt(world_x, world_y);
+
 		auto h = 0.0f;
 		for (auto& w : m_waves)
 		{
@@ -151,6 +173,9 @@ namespace las
 
 	v4 Ocean::DisplacedPosition(float world_x, float world_y, float time) const
 	{
+		if (m_spectral)
+			return m_spectral->DisplacedPosition(world_x, world_y);
+
 		auto dx = 0.0f, dy = 0.0f, dz = 0.0f;
 		for (auto& w : m_waves)
 		{
@@ -167,6 +192,9 @@ namespace las
 
 	v4 Ocean::NormalAt(float world_x, float world_y, float time) const
 	{
+		if (m_spectral)
+			return m_spectral->NormalAt(world_x, world_y);
+
 		auto nx = 0.0f, ny = 0.0f, nz = 1.0f;
 		for (auto& w : m_waves)
 		{
@@ -181,6 +209,158 @@ namespace las
 		return Normalise(v4(nx, ny, nz, 0.0f));
 	}
 
+	// Sine and cosine of four angles at once.
+	// Reduces to [-π/4, π/4] using multiples of π/2 (Cody-Waite, 3 part), then uses the cephes polynomials.
+	// Accurate to a few ulp for the phase range of the ocean waves.
+	static void SinCos(__m128 x, __m128& sin_x, __m128& cos_x)
+	{
+		auto j = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.636619772f))); // round(x * 2/π)
+		auto fj = _mm_cvtepi32_ps(j);
+		auto r = _mm_sub_ps(x, _mm_mul_ps(fj, _mm_set1_ps(1.5703125f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(fj, _mm_set1_ps(4.837512969970703125e-4f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(fj, _mm_set1_ps(7.54978995489188216e-8f)));
+		auto r2 = _mm_mul_ps(r, r);
+
+		// sin(r) and cos(r) on [-π/4, π/4]
+		auto ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+		ps = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(-1.6666654611e-1f));
+		ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, r2), r), r);
+		auto pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(-1.388731625493765e-3f));
+		pc = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(4.166664568298827e-2f));
+		pc = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(pc, r2), r2), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)));
+
+		// Quadrant selection: odd quadrants swap sin/cos, quadrants 2,3 negate sin, quadrants 1,2 negate cos
+		auto swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		auto sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), 30));
+		auto cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+		auto s = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+		auto c = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+		sin_x = _mm_xor_ps(s, sin_sign);
+		cos_x = _mm_xor_ps(c, cos_sign);
+	}
+
+	// Evaluate the ocean surface at many points at once.
+	void Ocean::Sample(std::span<float const> xs, std::span<float const> ys, float time, Samples const& out) const
+	{
+		auto count = std::min(xs.size(), ys.size());
+		auto want_height = !out.height.empty();
+		auto want_disp = !out.disp_x.empty() && !out.disp_y.empty();
+		auto want_norm = !out.norm_x.empty() && !out.norm_y.empty() && !out.norm_z.empty();
+		if ((want_height && out.height.size() < count) ||
+			(want_disp && std::min(out.disp_x.size(), out.disp_y.size()) < count) ||
+			(want_norm && std::min({ out.norm_x.size(), out.norm_y.size(), out.norm_z.size() }) < count))
+			throw std::runtime_error("Ocean sample output buffers are too small");
+
+		// The spectral height field is a table lookup per point, so there's nothing to gain from batching
+		if (m_spectral)
+		{
+			for (size_t i = 0; i != count; ++i)
+			{
+				if (want_height)
+				{
+					out.height[i] = m_spectral->HeightAt(xs[i], ys[i]);
+				}
+				if (want_disp)
+				{
+					auto p = m_spectral->DisplacedPosition(xs[i], ys[i]);
+					out.disp_x[i] = p.x;
+					out.disp_y[i] = p.y;
+				}
+				if (want_norm)
+				{
+					auto n = m_spectral->NormalAt(xs[i], ys[i]);
+					out.norm_x[i] = n.x;
+					out.norm_y[i] = n.y;
+					out.norm_z[i] = n.z;
+				}
+			}
+			return;
+		}
+
+		// Per-wave constants, so the inner loop is only multiply-adds and the sincos
+		struct WaveConsts { __m128 kx, ky, phase0, amp, qax, qay, kax, kay, qka; };
+		std::vector<WaveConsts> waves;
+		waves.reserve(m_waves.size());
+		for (auto& w : m_waves)
+		{
+			auto k = w.WaveNumber();
+			auto a = w.m_amplitude;
+			waves.push_back(WaveConsts{
+				.kx = _mm_set1_ps(k * w.m_direction.x),
+				.ky = _mm_set1_ps(k * w.m_direction.y),
+				.phase0 = _mm_set1_ps(-w.Frequency() * time),
+				.amp = _mm_set1_ps(a),
+				.qax = _mm_set1_ps(w.m_steepness * a * w.m_direction.x),
+				.qay = _mm_set1_ps(w.m_steepness * a * w.m_direction.y),
+				.kax = _mm_set1_ps(k * a * w.m_direction.x),
+				.kay = _mm_set1_ps(k * a * w.m_direction.y),
+				.qka = _mm_set1_ps(w.m_steepness * k * a),
+			});
+		}
+
+		// Evaluate four points at a time. The tail is padded by repeating the last point.
+		for (size_t i = 0; i < count; i += 4)
+		{
+			auto n = std::min<size_t>(4, count - i);
+			alignas(16) float px[4], py[4];
+			for (size_t j = 0; j != 4; ++j)
+			{
+				px[j] = xs[i + std::min(j, n - 1)];
+				py[j] = ys[i + std::min(j, n - 1)];
+			}
+			auto x = _mm_load_ps(px);
+			auto y = _mm_load_ps(py);
+
+			auto h = _mm_setzero_ps();
+			auto dx = _mm_setzero_ps(), dy = _mm_setzero_ps();
+			auto nx = _mm_setzero_ps(), ny = _mm_setzero_ps(), nz = _mm_set1_ps(1.0f);
+			for (auto const& w : waves)
+			{
+				auto phase = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w.kx, x), _mm_mul_ps(w.ky, y)), w.phase0);
+
+				__m128 s, c;
+				SinCos(phase, s, c);
+
+				h = _mm_add_ps(h, _mm_mul_ps(w.amp, s));
+				dx = _mm_sub_ps(dx, _mm_mul_ps(w.qax, c));
+				dy = _mm_sub_ps(dy, _mm_mul_ps(w.qay, c));
+				nx = _mm_sub_ps(nx, _mm_mul_ps(w.kax, c));
+				ny = _mm_sub_ps(ny, _mm_mul_ps(w.kay, c));
+				nz = _mm_sub_ps(nz, _mm_mul_ps(w.qka, s));
+			}
+
+			alignas(16) float r[6][4];
+			_mm_store_ps(r[0], h);
+			_mm_store_ps(r[1], _mm_add_ps(x, dx));
+			_mm_store_ps(r[2], _mm_add_ps(y, dy));
+			if (want_norm)
+			{
+				auto len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+				_mm_store_ps(r[3], _mm_div_ps(nx, len));
+				_mm_store_ps(r[4], _mm_div_ps(ny, len));
+				_mm_store_ps(r[5], _mm_div_ps(nz, len));
+			}
+			for (size_t j = 0; j != n; ++j)
+			{
+				if (want_height)
+				{
+					out.height[i + j] = r[0][j];
+				}
+				if (want_disp)
+				{
+					out.disp_x[i + j] = r[1][j];
+					out.disp_y[i + j] = r[2][j];
+				}
+				if (want_norm)
+				{
+					out.norm_x[i + j] = r[3][j];
+					out.norm_y[i + j] = r[4][j];
+					out.norm_z[i + j] = r[5][j];
+				}
+			}
+		}
+	}
+
 	// Prepare shader constant buffers for rendering (thread-safe, no scene interaction).
 	void Ocean::PrepareRender(v4 camera_world_pos, float time, bool has_env_map, v4 sun_direction, v4 sun_colour)
 	{
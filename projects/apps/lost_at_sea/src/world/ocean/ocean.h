@@ -4,9 +4,11 @@
 //************************************
 // Gerstner wave ocean simulation.
 // GPU vertex shader handles wave displacement. CPU-side queries for physics.
+// Optionally, physics queries can use a spectral (FFT) height field tile instead of the Gerstner waves.
 #pragma once
 #include "src/forward.h"
 #include "src/world/ocean/gerstner_wave.h"
+#include "src/world/ocean/spectral_ocean.h"
 
 namespace las
 {
@@ -27,14 +29,38 @@ namespace las
 		Instance m_inst;
 		vector<GerstnerWave> m_waves;
 		OceanShader* m_shader; // Owned by 'm_model'
+		std::unique_ptr<SpectralOcean> m_spectral; // Optional spectral height field for physics queries
 
 		explicit Ocean(Renderer& rdr);
 
+		// Use a spectral height field for physics queries. Pass null to return to the Gerstner waves.
+		// While enabled, the 'time' parameter of the physics queries is ignored; the field is evolved by 'Update'.
+		void UseSpectral(SpectralOcean::Params const* params);
+		bool IsSpectral() const;
+
+		// Evolve the spectral height field (if enabled) to 'time'. Call once per physics step.
+		void Update(float time);
+
+		// Outputs for a batch of physics queries. Empty spans are not computed.
+		struct Samples
+		{
+			std::span<float> height;  // Surface height at (x,y)
+			std::span<float> disp_x;  // Horizontally displaced surface position of the point (x,y)
+			std::span<float> disp_y;  // (the z component is 'height')
+			std::span<float> norm_x;  // Surface normal at (x,y)
+			std::span<float> norm_y;
+			std::span<float> norm_z;
+		};
+
 		// Physics queries (read-only, no rendering side effects)
 		float HeightAt(float world_x, float world_y, float time) const;
 		v4 DisplacedPosition(float world_x, float world_y, float time) const;
 		v4 NormalAt(float world_x, float world_y, float time) const;
 
+		// Evaluate the ocean surface at many points at once. 'xs' and 'ys' are the world space query points.
+		// Waves are evaluated for four points at a time using SSE.
+		void Sample(std::span<float const> xs, std::span<float const> ys, float time, Samples const& out) const;
+
 		// Prepare shader constant buffers for rendering (thread-safe, no scene interaction).
 		void PrepareRender(v4 camera_world_pos, float time, bool has_env_map, v4 sun_direction, v4 sun_colour);
 
@@ -0,0 +1,225 @@
+//************************************
+// Lost at Sea
+//  Copyright (c) Rylogic Ltd 2025
+//************************************
+#include "src/forward.h"
+#include "src/world/ocean/spectral_ocean.h"
+#include <random>
+
+namespace las
+{
+	static constexpr float G = 9.81f;        // Gravitational acceleration (m/s²)
+	static constexpr float Phillips = 0.0081f; // Phillips constant
+
+	SpectralOcean::SpectralOcean(Params const& params)
+		: m_params(params)
+		, m_fft(params.m_size, params.m_size)
+		, m_kx()
+		, m_ky()
+		, m_omega()
+		, m_h0()
+		, m_h0_conj()
+		, m_re0(), m_im0(), m_re1(), m_im1(), m_re2(), m_im2()
+		, m_height()
+		, m_disp_x(), m_disp_y()
+		, m_slope_x(), m_slope_y()
+		, m_time(-1.0f)
+	{
+		auto N = m_params.m_size;
+		auto count = static_cast<size_t>(N) * N;
+		auto dk = constants<float>::tau / m_params.m_tile_length;
+
+		m_kx.resize(count);
+		m_ky.resize(count);
+		m_omega.resize(count);
+		m_h0.resize(count);
+		m_h0_conj.resize(count);
+		for (auto buf : { &m_re0, &m_im0, &m_re1, &m_im1, &m_re2, &m_im2, &m_height, &m_disp_x, &m_disp_y, &m_slope_x, &m_slope_y })
+			buf->resize(count);
+
+		// Random Gaussian amplitudes for each wave vector. E|h0|² = S(k)·Δk²/2, so that
+		// h0(k) and h0(-k) together carry the variance of their spectrum cells.
+		std::mt19937 rng(m_params.m_seed);
+		std::normal_distribution<float> gauss(0.0f, 1.0f);
+		vector<std::complex<float>> h0(count);
+		for (int j = 0; j != N; ++j)
+		{
+			for (int i = 0; i != N; ++i)
+			{
+				auto idx = j * N + i;
+				auto kx = dk * (i < N / 2 ? i : i - N);
+				auto ky = dk * (j < N / 2 ? j : j - N);
+				m_kx[idx] = kx;
+				m_ky[idx] = ky;
+				m_omega[idx] = std::sqrt(G * std::sqrt(kx * kx + ky * ky)); // Deep water dispersion
+
+				// The Nyquist row/column has no '-k' partner in the grid, so the derived spectra there wouldn't be Hermitian
+				auto nyquist = i == N / 2 || j == N / 2;
+				auto amp = !nyquist ? std::sqrt(Spectrum(kx, ky) * dk * dk * 0.5f) * constants<float>::inv_root2 : 0.0f;
+				auto xr = gauss(rng);
+				auto xi = gauss(rng);
+				h0[idx] = std::complex<float>(xr * amp, xi * amp);
+			}
+		}
+
+		// conj(h0(-k)), where -k is the mirrored index
+		for (int j = 0; j != N; ++j)
+		{
+			for (int i = 0; i != N; ++i)
+			{
+				auto idx = j * N + i;
+				auto mirror = ((N - j) % N) * N + ((N - i) % N);
+				m_h0[idx] = h0[idx];
+				m_h0_conj[idx] = std::conj(h0[mirror]);
+			}
+		}
+
+		Update(0.0f);
+	}
+
+	// Evolve the spectrum to 'time' and regenerate the spatial grids
+	void SpectralOcean::Update(float time)
+	{
+		if (time == m_time)
+			return;
+
+		// h(k,t) = h0(k)·e^(iωt) + conj(h0(-k))·e^(-iωt), then derive the displacement and slope spectra.
+		// Pairs of real fields are packed into one complex transform as 'a + i·b', since each field's spectrum is Hermitian.
+		auto count = m_h0.size();
+		constexpr std::complex<float> I(0.0f, 1.0f);
+		for (size_t idx = 0; idx != count; ++idx)
+		{
+			auto kx = m_kx[idx];
+			auto ky = m_ky[idx];
+			auto k = std::sqrt(kx * kx + ky * ky);
+			if (k == 0.0f)
+			{
+				m_re0[idx] = m_im0[idx] = m_re1[idx] = m_im1[idx] = m_re2[idx] = m_im2[idx] = 0.0f;
+				continue;
+			}
+
+			auto wt = m_omega[idx] * time;
+			auto e = std::complex<float>(std::cos(wt), std::sin(wt));
+			auto h = m_h0[idx] * e + m_h0_conj[idx] * std::conj(e);
+
+			auto dx = -I * (kx / k) * h;
+			auto dy = -I * (ky / k) * h;
+			auto sx = I * kx * h;
+			auto sy = I * ky * h;
+
+			auto c0 = h + I * dx;
+			auto c1 = dy + I * sx;
+			auto c2 = sy;
+			m_re0[idx] = c0.real(); m_im0[idx] = c0.imag();
+			m_re1[idx] = c1.real(); m_im1[idx] = c1.imag();
+			m_re2[idx] = c2.real(); m_im2[idx] = c2.imag();
+		}
+
+		m_fft.Transform(m_re0.data(), m_im0.data(), true);
+		m_fft.Transform(m_re1.data(), m_im1.data(), true);
+		m_fft.Transform(m_re2.data(), m_im2.data(), true);
+
+		// Unpack the real fields
+		auto lambda = m_params.m_choppiness;
+		for (size_t idx = 0; idx != count; ++idx)
+		{
+			m_height[idx] = m_re0[idx];
+			m_disp_x[idx] = lambda * m_im0[idx];
+			m_disp_y[idx] = lambda * m_re1[idx];
+			m_slope_x[idx] = m_im1[idx];
+			m_slope_y[idx] = m_re2[idx];
+		}
+
+		m_time = time;
+	}
+
+	// Physics queries
+	float SpectralOcean::HeightAt(float world_x, float world_y) const
+	{
+		return Sample(m_height, Lookup(world_x, world_y));
+	}
+	v4 SpectralOcean::DisplacedPosition(float world_x, float world_y) const
+	{
+		auto c = Lookup(world_x, world_y);
+		return v4(world_x + Sample(m_disp_x, c), world_y + Sample(m_disp_y, c), Sample(m_height, c), 1.0f);
+	}
+	v4 SpectralOcean::NormalAt(float world_x, float world_y) const
+	{
+		auto c = Lookup(world_x, world_y);
+		return Normalise(v4(-Sample(m_slope_x, c), -Sample(m_slope_y, c), 1.0f, 0.0f));
+	}
+
+	// Bilinear interpolation weights for a world space position. The grid tiles infinitely.
+	SpectralOcean::Cell SpectralOcean::Lookup(float world_x, float world_y) const
+	{
+		auto N = m_params.m_size;
+		auto scale = N / m_params.m_tile_length;
+		auto u = world_x * scale;
+		auto v = world_y * scale;
+		auto fu = std::floor(u);
+		auto fv = std::floor(v);
+
+		// Wrap into [0, N). 'N' is a power of two, so masking handles negative values.
+		auto i0 = static_cast<int>(static_cast<int64_t>(fu) & (N - 1));
+		auto j0 = static_cast<int>(static_cast<int64_t>(fv) & (N - 1));
+		auto i1 = (i0 + 1) & (N - 1);
+		auto j1 = (j0 + 1) & (N - 1);
+		return Cell{ j0 * N + i0, j0 * N + i1, j1 * N + i0, j1 * N + i1, u - fu, v - fv };
+	}
+	float SpectralOcean::Sample(vector<float> const& grid, Cell const& c) const
+	{
+		auto a = grid[c.i00] + (grid[c.i10] - grid[c.i00]) * c.tx;
+		auto b = grid[c.i01] + (grid[c.i11] - grid[c.i01]) * c.tx;
+		return a + (b - a) * c.ty;
+	}
+
+	// The directional wave spectrum S(k)
+	float SpectralOcean::Spectrum(float kx, float ky) const
+	{
+		auto k = std::sqrt(kx * kx + ky * ky);
+		if (k < constants<float>::tiny)
+			return 0.0f;
+
+		auto wind = Normalise(v4(m_params.m_wind_direction.x, m_params.m_wind_direction.y, 0, 0));
+		auto cos_theta = (kx * wind.x + ky * wind.y) / k;
+		auto U = std::max(m_params.m_wind_speed, 0.1f);
+
+		// Suppress waves shorter than the minimum wavelength
+		auto k_max = constants<float>::tau / m_params.m_min_wavelength;
+		auto small = std::exp(-Sqr(k / k_max));
+
+		auto S = 0.0f;
+		switch (m_params.m_spectrum)
+		{
+			case ESpectrum::Phillips:
+			{
+				// P(k) = α/2 · e^(-1/(kL)²) / k⁴ · (k̂·ŵ)², with L = U²/g the largest wave from the wind
+				auto L = U * U / G;
+				S = 0.5f * Phillips * std::exp(-1.0f / Sqr(k * L)) / Sqr(Sqr(k)) * Sqr(cos_theta);
+				break;
+			}
+			case ESpectrum::JONSWAP:
+			{
+				// Frequency spectrum S(ω) converted to wave number space with the
+				// deep water dispersion ω = √(gk): S(k) = S(ω)·(dω/dk)/k·D(θ)
+				auto F = std::max(m_params.m_fetch, 1.0f);
+				auto omega = std::sqrt(G * k);
+				auto omega_p = 22.0f * std::pow(G * G / (U * F), 1.0f / 3.0f);
+				auto alpha = 0.076f * std::pow(U * U / (F * G), 0.22f);
+				auto sigma = omega <= omega_p ? 0.07f : 0.09f;
+				auto r = std::exp(-Sqr(omega - omega_p) / (2.0f * Sqr(sigma * omega_p)));
+				auto S_omega = alpha * G * G / std::pow(omega, 5.0f) * std::exp(-1.25f * Sqr(Sqr(omega_p / omega))) * std::pow(3.3f, r);
+
+				// Directional spreading D(θ) = 2/π·cos²θ, for waves travelling downwind only
+				auto spread = cos_theta > 0 ? (2.0f / constants<float>::tau_by_2) * Sqr(cos_theta) : 0.0f;
+				S = S_omega * (G / (2.0f * omega)) / k * spread;
+				break;
+			}
+			default:
+			{
+				throw std::runtime_error("Unknown ocean spectrum");
+			}
+		}
+		return m_params.m_amplitude * S * small;
+	}
+}
@@ -0,0 +1,92 @@
+//************************************
+// Lost at Sea
+//  Copyright (c) Rylogic Ltd 2025
+//************************************
+// Spectral ocean height field (Tessendorf).
+// A wave spectrum is sampled once into random complex amplitudes, then evolved in time and
+// transformed with an inverse 2D FFT into a tileable grid of heights, displacements and slopes.
+// Physics queries are then bilinear lookups into the grid, independent of the number of waves.
+#pragma once
+#include "src/forward.h"
+#include "pr/algorithm/fft.h"
+
+namespace las
+{
+	struct SpectralOcean
+	{
+		enum class ESpectrum
+		{
+			Phillips, // Fully developed sea, single parameter (wind speed)
+			JONSWAP,  // Fetch limited sea, with a sharper spectral peak
+		};
+
+		struct Params
+		{
+			int m_size = 128;                 // Grid resolution (power of two)
+			float m_tile_length = 256.0f;     // World space size of the (tileable) patch (m)
+			float m_wind_speed = 10.0f;       // Wind speed at 10m above the surface (m/s)
+			v4 m_wind_direction = v4::XAxis(); // Direction the wind blows toward (XY plane)
+			float m_fetch = 100'000.0f;       // Distance over which the wind has blown (m, JONSWAP only)
+			float m_amplitude = 1.0f;         // Scale applied to the spectrum amplitudes
+			float m_choppiness = 1.0f;        // Scale applied to the horizontal displacement
+			float m_min_wavelength = 0.5f;    // Waves shorter than this are suppressed (m)
+			ESpectrum m_spectrum = ESpectrum::JONSWAP;
+			uint32_t m_seed = 1;
+		};
+
+	private:
+
+		Params m_params;
+		algorithm::fft::FFT2D<float> m_fft;
+
+		// Per-cell constants. Stored in FFT order (index n maps to wave number 2π(n < N/2 ? n : n - N)/L)
+		vector<float> m_kx, m_ky, m_omega;       // Wave vector and angular frequency
+		vector<std::complex<float>> m_h0;        // h0(k)
+		vector<std::complex<float>> m_h0_conj;   // conj(h0(-k))
+
+		// FFT work buffers: (height + i·disp_x), (disp_y + i·slope_x), (slope_y)
+		vector<float> m_re0, m_im0, m_re1, m_im1, m_re2, m_im2;
+
+		// The spatial grids, row-major 'size x size'
+		vector<float> m_height;
+		vector<float> m_disp_x, m_disp_y;
+		vector<float> m_slope_x, m_slope_y;
+
+		// The time of the current grids
+		float m_time;
+
+	public:
+
+		explicit SpectralOcean(Params const& params);
+
+		// The generator parameters
+		Params const& params() const
+		{
+			return m_params;
+		}
+
+		// The time that the grids were last evolved to
+		float Time() const
+		{
+			return m_time;
+		}
+
+		// Evolve the spectrum to 'time' and regenerate the spatial grids. Call once per frame.
+		void Update(float time);
+
+		// Physics queries. Bilinear lookups into the grids at the last 'Update' time.
+		float HeightAt(float world_x, float world_y) const;
+		v4 DisplacedPosition(float world_x, float world_y) const;
+		v4 NormalAt(float world_x, float world_y) const;
+
+	private:
+
+		// Bilinear interpolation weights for a world space position
+		struct Cell { int i00, i10, i01, i11; float tx, ty; };
+		Cell Lookup(float world_x, float world_y) const;
+		float Sample(vector<float> const& grid, Cell const& c) const;
+
+		// The directional wave spectrum S(k) (m^4, i.e. variance per unit wave number area)
+		float Spectrum(float kx, float ky) const;
+	};
+}
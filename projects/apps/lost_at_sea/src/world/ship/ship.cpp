@@ -6,20 +6,48 @@
 #include "src/world/ship/ship.h"
 #include "src/world/ocean/ocean.h"
 #include "src/world/terrain/height_field.h"
-#include "pr/physics-2/collision/contact.h"
 #include "pr/physics-2/integrator/integrator.h"
-#include "pr/physics-2/integrator/impulse.h"
 
 namespace las
 {
 	// Gravity acceleration (m/s²)
 	constexpr float Gravity = -9.81f;
 
+	// Half extent of the ship's box (m)
+	constexpr float HalfSize = 0.5f;
+
+	// Sea water density (kg/m³)
+	constexpr float WaterDensity = 1025.0f;
+
+	// Resistance to the hull moving through the water along the hull normals, per unit of submerged area (N·s/m³)
+	constexpr float HullDamping = 600.0f;
+
 	Ship::Ship(Renderer& rdr, HeightField const&, v4 location)
 		:m_col_shape(v4{1, 1, 1, 0})
 		,m_body(&m_col_shape, m4x4::Identity(), Inertia::Box(v4{0.5f, 0.5f, 0.5f, 0}, 100.0f)) // Rigid body: mass = 100kg, box inertia with half-extents of 0.5
+		,m_hull_verts()
+		,m_hull_faces()
+		,m_ws_x()
+		,m_ws_y()
+		,m_ws_z()
+		,m_water_z()
 		,m_inst()
 	{
+		// Hull surface matching the collision box, outward facing (CCW)
+		constexpr float H = HalfSize;
+		m_hull_verts = {
+			{-H, -H, -H, 1}, {+H, -H, -H, 1}, {-H, +H, -H, 1}, {+H, +H, -H, 1},
+			{-H, -H, +H, 1}, {+H, -H, +H, 1}, {-H, +H, +H, 1}, {+H, +H, +H, 1},
+		};
+		m_hull_faces = {
+			0, 2, 3,  0, 3, 1, // -z
+			4, 5, 7,  4, 7, 6, // +z
+			0, 1, 5,  0, 5, 4, // -y
+			2, 6, 7,  2, 7, 3, // +y
+			0, 4, 6,  0, 6, 2, // -x
+			1, 3, 7,  1, 7, 5, // +x
+		};
+
 		// Create a simple box model for visualisation
 		ResourceFactory factory(rdr);
 		auto opts = ModelGenerator::CreateOptions{}.bake(m4x4::Identity());
@@ -36,90 +64,110 @@ namespace las
 	{
 		auto mass = m_body.Mass();
 		auto o2w = m_body.O2W();
-		auto w2o = InvertOrthonormal(o2w);
 
 		// Apply gravity
 		m_body.ApplyForceWS(v4{0, 0, Gravity * mass, 0}, v4::Zero());
 
-		// Box corners in object space (1x1x1 box, half-extent 0.5)
-		constexpr float H = 0.5f;
-		constexpr v4 os_corners[] = {
-			{-H, -H, -H, 1}, {+H, -H, -H, 1}, {-H, +H, -H, 1}, {+H, +H, -H, 1},
-			{-H, -H, +H, 1}, {+H, -H, +H, 1}, {-H, +H, +H, 1}, {+H, +H, +H, 1},
-		};
-
-		// Static ocean body (infinite mass, zero velocity)
-		auto ocean_body = RigidBody{nullptr, m4x4::Identity(), Inertia::Infinite()};
+		// Hull vertices in world space
+		auto vcount = m_hull_verts.size();
+		m_ws_x.resize(vcount);
+		m_ws_y.resize(vcount);
+		m_ws_z.resize(vcount);
+		m_water_z.resize(vcount);
+		for (size_t i = 0; i != vcount; ++i)
+		{
+			auto ws = o2w * m_hull_verts[i];
+			m_ws_x[i] = ws.x;
+			m_ws_y[i] = ws.y;
+			m_ws_z[i] = ws.z;
+		}
 
-		// Ocean collision: test each corner against the ocean surface
-		auto max_pen = 0.0f;
-		auto max_correction = v4::Zero();
-		auto submerged_count = 0;
-		for (auto const& os_corner : os_corners)
+		// Sample the ocean under all hull vertices in one batch
+		ocean.Sample({ m_ws_x.data(), vcount }, { m_ws_y.data(), vcount }, sim_time, { .height = { m_water_z.data(), vcount } });
+
+		// Integrate the water pressure over the submerged part of each hull triangle.
+		// The depth below the surface is treated as linear across each triangle, so the pressure
+		// force on a (clipped) triangle is ρ·g·A·(mean vertex depth) along the inward normal, acting
+		// at the centre of pressure: (Σr·Σd + Σ(r·d)) / (4·Σd).
+		auto velocity = m_body.VelocityWS();
+		auto force = v4::Zero();
+		auto torque = v4::Zero();
+		auto wetted_area = 0.0f;
+		auto total_area = 0.0f;
+		auto ApplyPressure = [&](v4 a, v4 b, v4 c, float da, float db, float dc)
+		{
+			auto cross = Cross3(b - a, c - a);
+			auto area = 0.5f * Length(cross);
+			auto sum_d = da + db + dc;
+			if (area < constants<float>::tiny_sq || sum_d <= 0)
+				return;
+
+			auto ws_norm = cross / (2.0f * area);
+			auto centre = ((a + b + c) * sum_d + a * da + b * db + c * dc) / (4.0f * sum_d);
+			auto f = (WaterDensity * -Gravity * area * sum_d / 3.0f) * -ws_norm;
+
+			// Damp motion of the hull along its normal
+			auto ws_at = centre - o2w.pos;
+			auto vel = Dot(velocity.LinAt(ws_at), ws_norm);
+			f -= (HullDamping * area * vel) * ws_norm;
+
+			force += f;
+			torque += Cross3(ws_at, f);
+			wetted_area += area;
+		};
+		for (size_t f = 0; f + 3 <= m_hull_faces.size(); f += 3)
 		{
-			auto ws_corner = o2w * os_corner;
-			auto surface_z = ocean.HeightAt(ws_corner.x, ws_corner.y, sim_time);
-			auto penetration = surface_z - ws_corner.z;
-			if (penetration <= 0) continue;
-
-			++submerged_count;
-
-			// Ocean surface normal at this corner
-			auto normal_ws = ocean.NormalAt(ws_corner.x, ws_corner.y, sim_time);
-
-			// Build contact: ship (objA) vs ocean (objB)
-			auto contact = physics::RbContact{m_body, ocean_body};
-
-			// Normal from ship to ocean, in ship object space
-			auto os_normal = w2o * (-normal_ws);
-			os_normal.w = 0;
-
-			// Contact point is the corner as offset from ship origin (w=0)
-			auto os_contact = v4{os_corner.x, os_corner.y, os_corner.z, 0};
-
-			contact.m_axis = os_normal;
-			contact.m_point = os_contact;
-			contact.m_point_at_t = os_contact;
-			contact.m_depth = penetration;
-			contact.m_mat = physics::Material{
-				physics::Material::DefaultID,
-				/*friction_static=*/ 0.3f,
-				/*elasticity_norm=*/ 0.3f,
-				/*elasticity_tang=*/ 0.0f,
-				/*elasticity_tors=*/ 0.0f,
-				/*density=*/ 1025.0f,
-			};
-
-			// Apply impulse if approaching the surface
-			auto rel_vel = contact.m_velocity.LinAt(contact.m_point_at_t);
-			auto approach = Dot(rel_vel, contact.m_axis);
-			if (approach < 0)
+			int idx[3] = { m_hull_faces[f + 0], m_hull_faces[f + 1], m_hull_faces[f + 2] };
+			v4 p[3];
+			float d[3];
+			auto submerged = 0;
+			for (int i = 0; i != 3; ++i)
 			{
-				auto impulse = physics::RestitutionImpulse(contact);
-				m_body.MomentumOS(m_body.MomentumOS() + impulse.m_os_impulse_objA);
+				p[i] = v4{ m_ws_x[idx[i]], m_ws_y[idx[i]], m_ws_z[idx[i]], 1 };
+				d[i] = m_water_z[idx[i]] - m_ws_z[idx[i]];
+				submerged += d[i] > 0;
 			}
+			total_area += 0.5f * Length(Cross3(p[1] - p[0], p[2] - p[0]));
+
+			// Rotate the vertex order (preserving the winding) so that the odd one out is first
+			auto odd = 0;
+			if (submerged == 1) odd = d[0] > 0 ? 0 : d[1] > 0 ? 1 : 2;
+			if (submerged == 2) odd = d[0] <= 0 ? 0 : d[1] <= 0 ? 1 : 2;
+			auto const& a = p[odd], &b = p[(odd + 1) % 3], &c = p[(odd + 2) % 3];
+			auto da = d[odd], db = d[(odd + 1) % 3], dc = d[(odd + 2) % 3];
 
-			// Track the deepest penetration for position correction
-			if (penetration > max_pen)
+			switch (submerged)
 			{
-				max_pen = penetration;
-				max_correction = normal_ws * penetration;
+				case 3:
+				{
+					ApplyPressure(a, b, c, da, db, dc);
+					break;
+				}
+				case 1:
+				{
+					// Only 'a' is under water
+					auto ab = a + (b - a) * (da / (da - db));
+					auto ac = a + (c - a) * (da / (da - dc));
+					ApplyPressure(a, ab, ac, da, 0, 0);
+					break;
+				}
+				case 2:
+				{
+					// Only 'a' is above water
+					auto ab = a + (b - a) * (da / (da - db));
+					auto ac = a + (c - a) * (da / (da - dc));
+					ApplyPressure(ab, b, c, 0, db, dc);
+					ApplyPressure(ab, c, ac, 0, dc, 0);
+					break;
+				}
 			}
 		}
-
-		// Position correction: push ship out of the ocean along the deepest normal
-		if (max_pen > 0)
-		{
-			o2w = m_body.O2W();
-			o2w.pos += max_correction;
-			m_body.O2W(o2w);
-		}
+		m_body.ApplyForceWS(force, torque, v4::Zero());
 
 		// Water drag when submerged to damp oscillation
-		if (submerged_count > 0)
+		if (wetted_area > 0)
 		{
-			auto submersion = static_cast<float>(submerged_count) / 8.0f;
-			auto velocity = m_body.VelocityWS();
+			auto submersion = wetted_area / total_area;
 			m_body.ApplyForceWS(-150.0f * submersion * velocity.lin, -40.0f * submersion * velocity.ang);
 		}
 
@@ -127,7 +175,7 @@ namespace las
 		{
 			auto ws_pos = m_body.O2W().pos;
 			auto terrain_z = height_field.HeightAt(ws_pos.x, ws_pos.y);
-			auto bottom_z = ws_pos.z - H;
+			auto bottom_z = ws_pos.z - HalfSize;
 			auto penetration = terrain_z - bottom_z;
 			if (penetration > 0)
 			{
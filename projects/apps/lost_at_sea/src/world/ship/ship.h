@@ -19,7 +19,9 @@ namespace las
 		// Notes:
 		//  - A rigid body that floats on the ocean surface.
 		//    The "ship" is a 1x1x1 cube with gravity and buoyancy forces applied.
-		//    Buoyancy is approximated by the submersion depth of the centre of mass.
+		//  - Buoyancy is the hydrostatic pressure integrated over the hull triangles. Each triangle
+		//    is clipped against the water surface and the submerged part pushes along its inward normal
+		//    with a force proportional to its depth. The ocean is sampled once per hull vertex per step.
 
 		struct Instance
 		{
@@ -36,6 +38,13 @@ namespace las
 		// Physics rigid body
 		RigidBody m_body;
 
+		// Hull surface in object space (outward facing triangles)
+		vector<v4> m_hull_verts;
+		vector<int> m_hull_faces;
+
+		// Per-step scratch space for the hull vertices in world space and the ocean heights there
+		vector<float> m_ws_x, m_ws_y, m_ws_z, m_water_z;
+
 		// Graphics
 		Instance m_inst;
 
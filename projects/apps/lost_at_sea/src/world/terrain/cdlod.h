@@ -34,16 +34,33 @@ namespace las
 		float size;      // Patch size in metres (= MinPatchSize * 2^lod_level)
 	};
 
-	// Quadtree LOD selection for CDLOD terrain
+	// Quadtree LOD selection for CDLOD terrain.
+	// Selection is planar: nodes are tested by XY distance only (matching the XY geomorph distance
+	// in the vertex shader) and never sample terrain heights, so a full walk is a few microseconds.
 	struct CDLODSelection
 	{
 		std::vector<PatchInfo> m_patches;
 
+		// The inputs of the last selection
+		struct Key { float cam_x, cam_y, draw_distance, min_distance; };
+		std::optional<Key> m_last;
+
 		// Select visible patches centred on camera position.
 		// min_distance: skip patches entirely within this radius (0 = no inner cutout).
 		void Select(v4 camera_pos, float draw_distance, float min_distance = 0.0f)
 		{
 			using namespace cdlod;
+
+			// The selection depends only on these inputs, so reuse the previous result while the camera is still
+			auto key = Key{ camera_pos.x, camera_pos.y, draw_distance, min_distance };
+			if (m_last &&
+				m_last->cam_x == key.cam_x &&
+				m_last->cam_y == key.cam_y &&
+				m_last->draw_distance == key.draw_distance &&
+				m_last->min_distance == key.min_distance)
+				return;
+
+			m_last = key;
 			m_patches.clear();
 
 			// Root node: smallest power-of-2 >= draw_distance
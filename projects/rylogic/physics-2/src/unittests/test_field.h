@@ -5,6 +5,7 @@
 #pragma once
 
 #if PR_UNITTESTS
+#include <random>
 #include "pr/common/unittests.h"
 #include "pr/physics-2/utility/field.h"
 namespace pr::physics::tests
@@ -13,9 +14,31 @@ namespace pr::physics::tests
 	{
 		PRUnitTestMethod(FieldTests)
 		{
-			// 2D Vector field, 10cm grid
+			// 2D Vector field, 1cm grid
 			Field<2, v2, 0.01f, field::KernelSpike2D> field(0.05f);
 
+			// Unwritten parts of the field have the default value
+			PR_EXPECT(field.ValueAt(v2(5, 5)) == v2::Zero());
+			PR_EXPECT(field.BrickCount() == 0U);
+
+			// Set a constant value over a region. Reading within the region returns that value
+			field.ValueAt(v2(0.2f, 0.2f), 0.1f, [](v2) { return v2(1, 2); });
+			PR_EXPECT(FEql(field.ValueAt(v2(0.2f, 0.2f)), v2(1, 2)));
+			PR_EXPECT(FEql(field.ValueAt(v2(0.23f, 0.18f)), v2(1, 2)));
+			PR_EXPECT(field.ValueAt(v2(-5, 5)) == v2::Zero());
+
+			// Reading at the edge of the region blends with the default value
+			auto edge = field.ValueAt(v2(0.3f, 0.2f));
+			PR_EXPECT(edge.x > 0.0f && edge.x < 1.0f);
+
+			// Negative grid coordinates work the same as positive ones
+			field.ValueAt(v2(-0.2f, -0.2f), 0.1f, [](v2) { return v2(3, 4); });
+			PR_EXPECT(FEql(field.ValueAt(v2(-0.2f, -0.2f)), v2(3, 4)));
+
+			field.Reset();
+			PR_EXPECT(field.BrickCount() == 0U);
+			PR_EXPECT(field.ValueAt(v2(0.2f, 0.2f)) == v2::Zero());
+
 			/*
 			// Draw the vector field
 			pr::ldraw::Builder builder;
@@ -31,25 +54,62 @@ namespace pr::physics::tests
 			}
 			builder.Write("E:/Dump/Field.ldr");
 			//*/
+		}
+		PRUnitTestMethod(DensityField)
+		{
+			// 3D scalar field, 1cm grid, kernel spanning 5 grid points
+			using DensityField = Field<3, float, 0.01f, field::KernelSpike3D>;
+			DensityField density(0.05f);
 
-			/*
-			// Insert some vectors into the field
-			std::default_random_engine rng;
-			for (int i = 0; i != 1000; ++i)
+			// A single splat deposits (approximately) its whole value into the grid
+			density.Splat(v4(0.013f, -0.027f, 0.041f, 1), 2.0f);
 			{
-				auto v = v2::Random(rng, v2(-1000), v2(+1000));
+				auto total = 0.0f;
+				for (auto const& brick : density.m_bricks)
+					for (auto v : brick)
+						total += v;
 
-				// Insert an "explosion" at 'v'
-				field.ValueAt(v, [&](v2 p)
-				{
-					auto d = Length(p - v);
-					return v2::Normalize(p - v) * (1.0f - d);
-				});
+				PR_EXPECT(FEqlRelative(total * Cube(0.01f), 2.0f, 0.05f));
 			}
+			density.Reset();
 
-			auto v0 = field.get(v2(5, 5));
-			PR_EXPECT(v0 == v2::Zero());
-			//*/
+			// Particles of unit mass scattered in a box
+			std::default_random_engine rng(1);
+			std::uniform_real_distribution<float> dist(-0.2f, 0.2f);
+			std::vector<v4> positions(2000);
+			std::vector<float> masses(positions.size(), 1.0f);
+			for (auto& pos : positions)
+				pos = v4(dist(rng), dist(rng), dist(rng), 1);
+
+			// Batch splat matches individual splats
+			DensityField individual(0.05f);
+			density.Splat(positions, masses);
+			for (auto const& pos : positions)
+				individual.Splat(pos, 1.0f);
+
+			// Batch reads match individual reads
+			std::vector<float> values(positions.size());
+			density.ValueAt(std::execution::par, positions, values);
+			for (int i = 0; i != isize(positions); ++i)
+			{
+				PR_EXPECT(FEql(values[i], density.ValueAt(positions[i])));
+				PR_EXPECT(FEqlRelative(values[i], individual.ValueAt(positions[i]), 1e-4f));
+				PR_EXPECT(values[i] > 0.0f);
+			}
+
+			// Enumerated sample points are within the kernel radius and have non-zero weight
+			auto count = 0;
+			density.EnumSamplePoints(v4(0.005f, 0.005f, 0.005f, 1), [&](v4 pt, float weight)
+			{
+				PR_EXPECT(Length(pt.xyz - v3(0.005f)) < 0.05f);
+				PR_EXPECT(weight > 0.0f);
+				++count;
+			});
+			PR_EXPECT(count > 400 && count < 600);
+
+			// Outside the particle region the density falls to the default value
+			PR_EXPECT(density.ValueAt(v4(1, 1, 1, 1)) == 0.0f);
+			PR_THROWS(density.Splat(positions, std::span<float const>(masses).subspan(1)), std::runtime_error);
 		}
 	};
 }
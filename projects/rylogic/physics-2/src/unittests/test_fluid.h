@@ -0,0 +1,141 @@
+//************************************
+// Physics-2 Engine
+//  Copyright (c) Rylogic Ltd 2016
+//************************************
+#pragma once
+
+#if PR_UNITTESTS
+#include "pr/common/unittests.h"
+#include "pr/physics-2/fluid/sph_fluid.h"
+namespace pr::physics::tests
+{
+	PRUnitTestClass(SphFluidTests)
+	{
+		// Same layout as the GPU fluid simulation 'Particle' and 'Dynamics' structs
+		struct Particle { v4 pos; v4 col; v4 pad0; v4 pad1; };
+		struct Dynamics { v4 vel; v4 accel; v4 surface; };
+
+		// A block of particles resting on a floor
+		static std::vector<Particle> Block(int nx, int ny, float spacing)
+		{
+			std::vector<Particle> particles;
+			for (int y = 0; y != ny; ++y)
+				for (int x = 0; x != nx; ++x)
+					particles.push_back(Particle{ .pos = v4(x * spacing, (y + 0.5f) * spacing, 0, 1), .col = v4::One() });
+			return particles;
+		}
+
+		PRUnitTestMethod(Partition)
+		{
+			auto particles = Block(20, 20, 0.05f);
+			particles[7].pos = v4(std::numeric_limits<float>::quiet_NaN());
+
+			fluid::SphFluid<2> sph({ .ParticleRadius = 0.1f, .GridScale = 10.0f, .CellCount = 1021 + 1 });
+			sph.WriteParticles<Particle>(particles);
+			sph.Partition(std::execution::seq);
+
+			// Hashes are sorted, and the cell table covers every particle once
+			auto total = 0U;
+			for (int i = 1; i != sph.ParticleCount(); ++i)
+				PR_EXPECT(sph.m_hash[i - 1] <= sph.m_hash[i]);
+			for (int h = 0; h != sph.Config.CellCount; ++h)
+			{
+				total += sph.m_idx_count[h];
+				for (auto i = 0U; i != sph.m_idx_count[h]; ++i)
+					PR_EXPECT(sph.m_hash[sph.m_idx_start[h] + i] == static_cast<uint32_t>(h));
+			}
+			PR_EXPECT(total == particles.size());
+
+			// The NaN particle is in the last cell
+			PR_EXPECT(sph.m_idx_count[sph.Config.CellCount - 1] == 1U);
+			PR_EXPECT(sph.m_spatial.back() == 7U);
+		}
+		PRUnitTestMethod(RestDensity)
+		{
+			auto particles = Block(20, 20, 0.05f);
+			fluid::SphFluid<2> sph_ref({ .ParticleRadius = 0.1f, .GridScale = 10.0f });
+			sph_ref.WriteParticles<Particle>(particles);
+			PR_EXPECT(sph_ref.Config.RestDensity > 0.0f);
+
+			// A NaN particle does not contribute to the rest density
+			particles.push_back(Particle{ .pos = v4(std::numeric_limits<float>::quiet_NaN()), .col = v4::One() });
+			fluid::SphFluid<2> sph({ .ParticleRadius = 0.1f, .GridScale = 10.0f });
+			sph.WriteParticles<Particle>(particles);
+			PR_EXPECT(std::isfinite(sph.Config.RestDensity));
+			PR_EXPECT(FEql(sph.Config.RestDensity, sph_ref.Config.RestDensity));
+
+			// The NaN particle does not affect the other particles during a step
+			sph.Config.RestDensity = sph_ref.Config.RestDensity;
+			sph.Step(std::execution::seq, 0.005f);
+			sph_ref.Step(std::execution::seq, 0.005f);
+			for (int i = 0; i != sph_ref.ParticleCount(); ++i)
+			{
+				PR_EXPECT(sph.Density(i) == sph_ref.Density(i));
+				for (int d = 0; d != 3; ++d)
+				{
+					PR_EXPECT(sph.m_acc[d][i] == sph_ref.m_acc[d][i]);
+					PR_EXPECT(sph.m_pos[d][i] == sph_ref.m_pos[d][i]);
+				}
+			}
+
+			// The NaN particle has no density or acceleration, and stays NaN
+			auto nan_idx = sph_ref.ParticleCount();
+			PR_EXPECT(sph.Density(nan_idx) == 0.0f);
+			PR_EXPECT(sph.m_acc[0][nan_idx] == 0.0f && sph.m_acc[1][nan_idx] == 0.0f && sph.m_acc[2][nan_idx] == 0.0f);
+			PR_EXPECT(std::isnan(sph.m_pos[0][nan_idx]));
+
+			// With no valid particles, the rest density is left unset
+			std::vector<Particle> invalid(4, Particle{ .pos = v4(std::numeric_limits<float>::quiet_NaN()), .col = v4::One() });
+			fluid::SphFluid<2> sph_nan({ .ParticleRadius = 0.1f, .GridScale = 10.0f });
+			sph_nan.WriteParticles<Particle>(invalid);
+			PR_EXPECT(sph_nan.Config.RestDensity == 0.0f);
+		}
+		PRUnitTestMethod(Simulate)
+		{
+			auto particles = Block(30, 10, 0.05f);
+			std::vector<Dynamics> dynamics(particles.size(), Dynamics{ .surface = v4(0, 1, 0, 1) });
+
+			fluid::SphFluid<2>::ConfigData config = {
+				.ParticleRadius = 0.1f,
+				.Stiffness = 50.0f,
+				.Viscosity = 0.1f,
+				.GridScale = 10.0f,
+				.Restitution = { 0.5f, 1.0f },
+				.Boundaries = { v4(0, 1, 0, 0), v4(1, 0, 0, 0.2f), v4(-1, 0, 0, 1.7f) },
+			};
+			fluid::SphFluid<2> sph(config);
+			fluid::SphFluid<2> sph_seq(config);
+			sph.WriteParticles<Particle, Dynamics>(particles, dynamics);
+			sph_seq.WriteParticles<Particle, Dynamics>(particles, dynamics);
+
+			// The rest density is measured from the initial particles
+			PR_EXPECT(sph.Config.RestDensity > 0.0f);
+			PR_EXPECT(sph.Config.RestDensity == sph_seq.Config.RestDensity);
+
+			for (int i = 0; i != 100; ++i)
+			{
+				sph.Step(std::execution::par, 0.005f);
+				sph_seq.Step(std::execution::seq, 0.005f);
+			}
+
+			// Results don't depend on the execution policy
+			PR_EXPECT(sph.m_pos[0] == sph_seq.m_pos[0]);
+			PR_EXPECT(sph.m_pos[1] == sph_seq.m_pos[1]);
+
+			// Read back into the GPU structures
+			sph.ReadParticles<Particle, Dynamics>(particles, dynamics);
+			for (int i = 0; i != isize(particles); ++i)
+			{
+				auto const& p = particles[i];
+				PR_EXPECT(!IsNaN(p.pos));
+				PR_EXPECT(p.pos.y >= 0.0f);
+				PR_EXPECT(p.pos.x >= -0.2f && p.pos.x <= 1.7f);
+				PR_EXPECT(p.pos.z == 0.0f && p.pos.w == 1.0f);
+				PR_EXPECT(p.col == v4::One());
+				PR_EXPECT(dynamics[i].surface == v4(0, 1, 0, 1));
+				PR_EXPECT(sph.Density(i) > 0.0f);
+			}
+		}
+	};
+}
+#endif
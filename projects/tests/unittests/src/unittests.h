@@ -5,6 +5,7 @@
 
 // Headers to unit test
 #include "pr/algorithm/algorithm.h"
+#include "pr/algorithm/astar_grid.h"
 #include "pr/algorithm/astar_search.h"
 #include "pr/algorithm/dimension_index.h"
 #include "pr/algorithm/fft.h"
@@ -28,6 +29,7 @@
 #include "pr/collision/col_triangle_vs_sphere.h"
 #include "pr/collision/col_triangle_vs_triangle.h"
 #include "pr/collision/ldraw.h"
+#include "pr/collision/ray_packet.h"
 #include "pr/collision/shape_polytope.h"
 #include "pr/common/alloca.h"
 #include "pr/common/arena_allocator.h"
@@ -78,18 +80,23 @@
 #include "pr/container/vector_map.h"
 #include "pr/container/vector.h"
 #include "pr/crypt/blake2b.h"
+#include "pr/crypt/blake2s.h"
 #include "pr/crypt/md5.h"
 #include "pr/crypt/rijndael.h"
 #include "pr/crypt/sha1.h"
+#include "pr/crypt/sha256.h"
 #include "pr/crypt/sha512.h"
 #include "pr/filesys/file_snapshot.h"
 #include "pr/filesys/filesys.h"
 #include "pr/geometry/3ds.h"
 #include "pr/geometry/convex_hull.h"
 #include "pr/geometry/index_buffer.h"
+#include "pr/geometry/mesh_optimise.h"
 #include "pr/geometry/p3d.h"
+#include "pr/geometry/p3d_view.h"
 #include "pr/geometry/reflect.h"
 #include "pr/geometry/scatter.h"
+#include "pr/geometry/simplify.h"
 #include "pr/geometry/triangle.h"
 #include "pr/geometry/unit_tests.h"
 #include "pr/geometry/utility.h"
@@ -11,7 +11,7 @@ using namespace pr::geometry;
 
 // Index stride independent
 template <std::integral VIdx>
-void DoGenNorms(p3d::Mesh& mesh, float smoothing_angle, p3d::Nugget& nug, VIdx* iptr)
+void DoGenNorms(p3d::Mesh& mesh, float smoothing_angle, float weld_distance, p3d::Nugget& nug, VIdx* iptr)
 {
 	// Generate the normals
 	GenerateNormals(
@@ -39,12 +39,13 @@ void DoGenNorms(p3d::Mesh& mesh, float smoothing_angle, p3d::Nugget& nug, VIdx*
 			*iptr++ = s_cast<VIdx>(i0);
 			*iptr++ = s_cast<VIdx>(i1);
 			*iptr++ = s_cast<VIdx>(i2);
-		});
+		},
+		weld_distance);
 }
 
 
 // Generate normals for the p3d mesh
-void GenerateVertNormals(p3d::Mesh& mesh, float smoothing_angle, int verbosity)
+void GenerateVertNormals(p3d::Mesh& mesh, float smoothing_angle, float weld_distance, int verbosity)
 {
 	// No verts, no normals
 	if (mesh.m_vert.size() == 0)
@@ -63,17 +64,17 @@ void GenerateVertNormals(p3d::Mesh& mesh, float smoothing_angle, int verbosity)
 		// Generate the normals
 		switch (nug.m_vidx.stride())
 		{
-			case 2: DoGenNorms(mesh, smoothing_angle, nug, nug.m_vidx.data<uint16_t>()); break;
-			case 4: DoGenNorms(mesh, smoothing_angle, nug, nug.m_vidx.data<uint32_t>()); break;
+			case 2: DoGenNorms(mesh, smoothing_angle, weld_distance, nug, nug.m_vidx.data<uint16_t>()); break;
+			case 4: DoGenNorms(mesh, smoothing_angle, weld_distance, nug, nug.m_vidx.data<uint32_t>()); break;
 			default: throw std::runtime_error("Unsupported index format");
 		}
 	}
 }
 
 // Generate normals for the p3d file
-void GenerateVertNormals(p3d::File& p3d, float smoothing_angle, int verbosity)
+void GenerateVertNormals(p3d::File& p3d, float smoothing_angle, float weld_distance, int verbosity)
 {
 	// Generate normals for each mesh
 	for (auto& mesh : p3d.m_scene.m_meshes)
-		GenerateVertNormals(mesh, smoothing_angle, verbosity);
+		GenerateVertNormals(mesh, smoothing_angle, weld_distance, verbosity);
 }
@@ -6,8 +6,9 @@
 #pragma once
 #include "src/forward.h"
 
-// Generate normals for the p3d file
-void GenerateVertNormals(pr::geometry::p3d::Mesh& mesh, float smoothing_angle, int verbosity);
+// Generate normals for the p3d file.
+// Verts within 'weld_distance' of each other are smoothed as one vertex (e.g. across UV seams). Negative values disable welding.
+void GenerateVertNormals(pr::geometry::p3d::Mesh& mesh, float smoothing_angle, float weld_distance, int verbosity);
 
 // Generate normals for the p3d file
-void GenerateVertNormals(pr::geometry::p3d::File& p3d, float smoothing_angle, int verbosity);
+void GenerateVertNormals(pr::geometry::p3d::File& p3d, float smoothing_angle, float weld_distance, int verbosity);
@@ -5,9 +5,11 @@
 
 #include "src/forward.h"
 #include "pr/geometry/p3d.h"
+#include "pr/geometry/p3d_view.h"
 #include "pr/geometry/3ds.h"
 #include "pr/geometry/stl.h"
 #include "pr/geometry/obj.h"
+#include "pr/filesys/mapped_file.h"
 
 using namespace pr;
 using namespace pr::script;
@@ -18,8 +20,9 @@ static_assert(std::is_move_constructible_v<p3d::File>);
 // Populate the p3d data structures from a p3d file
 std::unique_ptr<p3d::File> CreateFromP3D(std::filesystem::path const& filepath)
 {
-	std::ifstream src(filepath, std::ifstream::binary);
-	auto p3d = p3d::Read(src);
+	// Map the file and decode the meshes in parallel
+	filesys::MappedFile file(filepath);
+	auto p3d = p3d::FileView(file.data()).Load();
 	return std::unique_ptr<p3d::File>(new p3d::File(std::move(p3d)));
 }
 
@@ -0,0 +1,165 @@
+//**********************************************
+// P3D Graphics Tool
+//  Copyright (c) Rylogic Ltd 2019
+//**********************************************
+
+#include "src/forward.h"
+#include "src/commands/optimise_mesh.h"
+#include "pr/geometry/mesh_optimise.h"
+#include <chrono>
+
+using namespace pr;
+using namespace pr::geometry;
+
+// Call 'func' with the nugget indices as a typed span
+template <typename Func>
+auto WithIndices(p3d::Nugget& nug, Func func)
+{
+	switch (nug.m_vidx.stride())
+	{
+		case 1: return func(nug.m_vidx.span<uint8_t>());
+		case 2: return func(nug.m_vidx.span<uint16_t>());
+		case 4: return func(nug.m_vidx.span<uint32_t>());
+		case 8: return func(nug.m_vidx.span<uint64_t>());
+		default: throw std::runtime_error("Unsupported index format");
+	}
+}
+
+// Reorder faces and verts for GPU cache efficiency, optionally splitting nuggets into meshlets
+void OptimiseForGpu(p3d::Mesh& mesh, int cache_size, bool meshlets, int verbosity)
+{
+	// No verts, nothing to optimise
+	if (mesh.m_vert.size() == 0)
+		return;
+
+	if (verbosity >= 2)
+		std::cout << "  Optimising mesh: " << mesh.m_name << std::endl;
+
+	auto start = std::chrono::steady_clock::now();
+	auto vcount = s_cast<int>(mesh.vcount());
+	auto fcount = 0.0;
+	auto before = VertexCacheStats{};
+	auto after = VertexCacheStats{};
+
+	// Reorder the faces of each triangle list nugget for vertex cache locality, then overdraw
+	for (auto& nug : mesh.m_nugget)
+	{
+		if (nug.m_topo != ETopo::TriList)
+			continue;
+
+		WithIndices(nug, [&]<typename VIdx>(std::span<VIdx> indices)
+		{
+			auto faces = s_cast<double>(indices.size() / 3);
+			auto b = MeasureVertexCache<VIdx>(indices, vcount, cache_size);
+			OptimiseVertexCache<VIdx>(indices, vcount, cache_size);
+			OptimiseOverdraw<VIdx>(indices, vcount, [&](int i) { return std::as_const(mesh.m_vert)[i]; }, cache_size);
+			auto a = MeasureVertexCache<VIdx>(indices, vcount, cache_size);
+
+			// Face weighted averages over the nuggets
+			before.m_acmr += b.m_acmr * faces;
+			before.m_atvr += b.m_atvr * faces;
+			after.m_acmr += a.m_acmr * faces;
+			after.m_atvr += a.m_atvr * faces;
+			fcount += faces;
+		});
+	}
+
+	// Renumber the verts in the order they're first used by the nuggets. Nuggets without
+	// indices may be using the vertex buffer directly, so leave the vertex order alone in that case.
+	auto can_reorder = std::ranges::none_of(mesh.m_nugget, [](p3d::Nugget const& nug) { return nug.m_vidx.empty(); });
+	if (can_reorder)
+	{
+		std::vector<int> remap;
+		auto new_vcount = 0;
+		for (auto& nug : mesh.m_nugget)
+		{
+			new_vcount = WithIndices(nug, [&]<typename VIdx>(std::span<VIdx> indices)
+			{
+				return OptimiseVertexFetch<VIdx>(indices, vcount, remap, new_vcount);
+			});
+		}
+
+		// Remap the vertex streams. Streams with 0 or 1 elements are shared by all verts.
+		// Other lengths are expanded using the modulo access of the containers first.
+		auto RemapStream = [&](auto& cont)
+		{
+			if (cont.size() <= 1)
+				return;
+
+			using T = std::decay_t<decltype(*cont.data())>;
+			std::vector<T> full(vcount);
+			for (int i = 0; i != vcount; ++i)
+				full[i] = std::as_const(cont)[i];
+
+			cont.m_cont = RemapVertexStream<T>(full, remap, new_vcount);
+		};
+		RemapStream(mesh.m_vert);
+		RemapStream(mesh.m_diff);
+		RemapStream(mesh.m_norm);
+		RemapStream(mesh.m_tex0);
+
+		// Unreferenced verts have been dropped
+		mesh.m_bbox = BBox::Reset();
+		for (auto& vert : mesh.m_vert)
+			Grow(mesh.m_bbox, vert);
+
+		if (verbosity >= 3 && new_vcount != vcount)
+			std::cout << "    " << (vcount - new_vcount) << " unreferenced verts removed" << std::endl;
+
+		vcount = new_vcount;
+	}
+
+	// Split triangle list nuggets into meshlets. The meshlets are contiguous in the (cache optimised)
+	// index order, so each meshlet is just a slice of the nugget's index buffer.
+	if (meshlets)
+	{
+		auto meshlet_count = 0;
+		auto cullable_count = 0;
+		p3d::Nuggets nuggets;
+		for (auto& nug : mesh.m_nugget)
+		{
+			if (nug.m_topo != ETopo::TriList)
+			{
+				nuggets.push_back(std::move(nug));
+				continue;
+			}
+
+			WithIndices(nug, [&]<typename VIdx>(std::span<VIdx> indices)
+			{
+				auto ml = BuildMeshlets<VIdx>(indices, vcount, [&](int i) { return std::as_const(mesh.m_vert)[i]; });
+				for (auto& m : ml.m_meshlets)
+				{
+					p3d::Nugget n(nug.m_topo, nug.m_geom, nug.m_mat, nug.stride());
+					n.m_vidx.append<VIdx>(indices.subspan(3 * m.m_face_offset, 3 * m.m_face_count));
+					nuggets.push_back(std::move(n));
+
+					cullable_count += m.m_cone_cutoff < 1.0f;
+				}
+				meshlet_count += isize(ml.m_meshlets);
+			});
+		}
+		mesh.m_nugget = std::move(nuggets);
+
+		if (verbosity >= 3)
+			std::cout
+				<< "    " << meshlet_count << " meshlets created\n"
+				<< "    " << cullable_count << " meshlets have a usable normal cone" << std::endl;
+	}
+
+	auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (verbosity >= 3 && fcount != 0)
+	{
+		std::cout
+			<< "    ACMR: " << (before.m_acmr / fcount) << " -> " << (after.m_acmr / fcount) << "\n"
+			<< "    ATVR: " << (before.m_atvr / fcount) << " -> " << (after.m_atvr / fcount) << "\n";
+	}
+	if (verbosity >= 3)
+		std::cout << "    " << mesh.icount() / 3 << " faces optimised in " << elapsed << "s" << std::endl;
+}
+
+// Reorder faces and verts for GPU cache efficiency, optionally splitting nuggets into meshlets
+void OptimiseForGpu(p3d::File& p3d, int cache_size, bool meshlets, int verbosity)
+{
+	for (auto& mesh : p3d.m_scene.m_meshes)
+		OptimiseForGpu(mesh, cache_size, meshlets, verbosity);
+}
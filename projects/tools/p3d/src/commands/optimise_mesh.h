@@ -0,0 +1,13 @@
+//**********************************************
+// P3D Graphics Tool
+//  Copyright (c) Rylogic Ltd 2019
+//**********************************************
+
+#pragma once
+#include "src/forward.h"
+
+// Reorder faces and verts for GPU cache efficiency, optionally splitting nuggets into meshlets
+void OptimiseForGpu(pr::geometry::p3d::Mesh& mesh, int cache_size = 16, bool meshlets = false, int verbosity = 2);
+
+// Reorder faces and verts for GPU cache efficiency, optionally splitting nuggets into meshlets
+void OptimiseForGpu(pr::geometry::p3d::File& p3d, int cache_size = 16, bool meshlets = false, int verbosity = 2);
@@ -0,0 +1,166 @@
+//**********************************************
+// P3D Graphics Tool
+//  Copyright (c) Rylogic Ltd 2019
+//**********************************************
+
+#include "src/forward.h"
+#include "src/commands/simplify_mesh.h"
+#include "pr/geometry/simplify.h"
+#include "pr/geometry/mesh_optimise.h"
+#include <chrono>
+
+using namespace pr;
+using namespace pr::geometry;
+
+// The approximate size of a mesh in a p3d file (default formats)
+static int64_t MeshSizeInBytes(p3d::Mesh const& mesh)
+{
+	auto size = int64_t{};
+	size += s_cast<int64_t>(mesh.m_vert.size()) * 12;
+	size += s_cast<int64_t>(mesh.m_diff.size()) * 4;
+	size += s_cast<int64_t>(mesh.m_norm.size()) * 12;
+	size += s_cast<int64_t>(mesh.m_tex0.size()) * 8;
+	for (auto& nug : mesh.m_nugget)
+		size += s_cast<int64_t>(nug.icount()) * nug.stride();
+	return size;
+}
+
+// Create a reduced detail copy of 'src'. Returns false if 'src' could not be reduced.
+static bool SimplifyMesh(p3d::Mesh const& src, p3d::Mesh& lod, int target_faces, float max_error, bool lock_border, float& error)
+{
+	auto vcount = s_cast<int>(src.vcount());
+
+	// Concatenate the nugget faces, using the nugget index as the face group so that material boundaries are preserved
+	std::vector<uint32_t> indices;
+	std::vector<int> face_group;
+	indices.reserve(src.icount());
+	face_group.reserve(src.icount() / 3);
+	for (int n = 0, nend = isize(src.m_nugget); n != nend; ++n)
+	{
+		auto& nug = src.m_nugget[n];
+		for (auto idx : nug.indices<uint32_t>())
+			indices.push_back(idx);
+
+		face_group.resize(indices.size() / 3, n);
+	}
+	auto fcount = isize(indices) / 3;
+
+	// Collapse edges
+	SimplifyParams params = {
+		.m_target_faces = target_faces,
+		.m_max_error = max_error,
+		.m_lock_border = lock_border,
+	};
+	auto result = Simplify<uint32_t>(indices, face_group, vcount, [&](int i) { return src.m_vert[i]; }, params);
+	if (result.m_face_count == fcount)
+		return false;
+
+	// Drop the verts that are no longer referenced. Streams with 0 or 1 elements are shared by all verts.
+	std::vector<int> remap;
+	auto new_vcount = OptimiseVertexFetch<uint32_t>(indices, vcount, remap);
+	auto RemapStream = [&](auto const& cont, auto& out)
+	{
+		if (cont.size() <= 1)
+		{
+			out.m_cont = cont.m_cont;
+			return;
+		}
+
+		using T = std::decay_t<decltype(*cont.data())>;
+		std::vector<T> full(vcount);
+		for (int i = 0; i != vcount; ++i)
+			full[i] = cont[i];
+
+		out.m_cont = RemapVertexStream<T>(full, remap, new_vcount);
+	};
+	RemapStream(src.m_vert, lod.m_vert);
+	RemapStream(src.m_diff, lod.m_diff);
+	RemapStream(src.m_norm, lod.m_norm);
+	RemapStream(src.m_tex0, lod.m_tex0);
+
+	// Split the faces back into nuggets. Face order is preserved, so each group is contiguous.
+	for (int f = 0, n = 0, nend = isize(src.m_nugget); n != nend; ++n)
+	{
+		auto& nug = src.m_nugget[n];
+		auto f0 = f;
+		for (; f != result.m_face_count && face_group[f] == n; ++f) {}
+		if (f == f0)
+			continue;
+
+		p3d::Nugget nugget(nug.m_topo, nug.m_geom, nug.m_mat, nug.stride());
+		nugget.m_vidx.append<uint32_t>(std::span<uint32_t const>{ indices.data() + 3 * f0, s_cast<size_t>(3 * (f - f0)) });
+		lod.m_nugget.push_back(std::move(nugget));
+	}
+
+	lod.m_bbox = BBox::Reset();
+	for (auto& vert : lod.m_vert)
+		Grow(lod.m_bbox, vert);
+
+	lod.m_o2p = src.m_o2p;
+	error = result.m_error;
+	return true;
+}
+
+// Generate a chain of reduced detail meshes in 'mesh.m_lods'
+void GenerateLods(p3d::Mesh& mesh, int lod_count, float ratio, float max_error, int64_t memory_budget, bool lock_border, int verbosity)
+{
+	// No verts, nothing to simplify
+	if (mesh.m_vert.size() == 0)
+		return;
+
+	if (verbosity >= 2)
+		std::cout << "  Generating LODs for mesh: " << mesh.m_name << std::endl;
+
+	// The simplifier only handles indexed triangle lists
+	if (!std::ranges::all_of(mesh.m_nugget, [](p3d::Nugget const& nug) { return nug.m_topo == ETopo::TriList && !nug.m_vidx.empty(); }))
+	{
+		if (verbosity >= 2)
+			std::cout << "    Skipped. LODs can only be generated for meshes containing indexed triangle lists" << std::endl;
+		return;
+	}
+
+	ratio = std::clamp(ratio, 0.0f, 1.0f);
+	mesh.m_lods.clear();
+
+	for (int i = 0; i != lod_count; ++i)
+	{
+		// Each LOD is generated from the previous one
+		auto const& src = mesh.m_lods.empty() ? mesh : mesh.m_lods.back();
+		if (memory_budget > 0 && MeshSizeInBytes(src) <= memory_budget)
+			break;
+
+		auto start = std::chrono::steady_clock::now();
+		auto fcount = s_cast<int>(src.icount() / 3);
+		auto target = s_cast<int>(fcount * ratio);
+
+		// The error limit is relative to the full detail mesh
+		auto error = 0.0f;
+		p3d::Mesh lod(FmtS("%s_lod%d", mesh.m_name.c_str(), i + 1));
+		if (!SimplifyMesh(src, lod, target, max_error - src.m_lod_error, lock_border, error))
+			break;
+
+		// Errors accumulate down the chain
+		lod.m_lod_error = src.m_lod_error + error;
+
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (verbosity >= 3)
+		{
+			std::cout
+				<< "    " << lod.m_name << ": " << fcount << " -> " << (lod.icount() / 3) << " faces, "
+				<< lod.vcount() << " verts, " << MeshSizeInBytes(lod) << " bytes, "
+				<< "error " << lod.m_lod_error << " (" << elapsed << "s)" << std::endl;
+		}
+
+		mesh.m_lods.push_back(std::move(lod));
+	}
+
+	if (verbosity >= 2)
+		std::cout << "    " << mesh.m_lods.size() << " LODs generated" << std::endl;
+}
+
+// Generate a chain of reduced detail meshes for each mesh in the p3d file
+void GenerateLods(p3d::File& p3d, int lod_count, float ratio, float max_error, int64_t memory_budget, bool lock_border, int verbosity)
+{
+	for (auto& mesh : p3d.m_scene.m_meshes)
+		GenerateLods(mesh, lod_count, ratio, max_error, memory_budget, lock_border, verbosity);
+}
@@ -0,0 +1,14 @@
+//**********************************************
+// P3D Graphics Tool
+//  Copyright (c) Rylogic Ltd 2019
+//**********************************************
+
+#pragma once
+#include "src/forward.h"
+
+// Generate a chain of reduced detail meshes in 'mesh.m_lods'. Each LOD has 'ratio' times the faces of the previous one.
+// Generation stops after 'lod_count' LODs, when the error would exceed 'max_error', or once a LOD fits within 'memory_budget' bytes.
+void GenerateLods(pr::geometry::p3d::Mesh& mesh, int lod_count, float ratio, float max_error, int64_t memory_budget, bool lock_border, int verbosity);
+
+// Generate a chain of reduced detail meshes for each mesh in the p3d file
+void GenerateLods(pr::geometry::p3d::File& p3d, int lod_count, float ratio, float max_error, int64_t memory_budget, bool lock_border, int verbosity);
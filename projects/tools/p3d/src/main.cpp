@@ -7,6 +7,8 @@
 #include "src/commands/model_io.h"
 #include "src/commands/remove_degenerates.h"
 #include "src/commands/generate_normals.h"
+#include "src/commands/optimise_mesh.h"
+#include "src/commands/simplify_mesh.h"
 //#include "rc/commands/NEW_COMMAND.h"
 
 struct Main
@@ -91,9 +93,26 @@ struct Main
 			"        <UVDistance> - Vertices with  UVs different by more than this distance are not degenerate.\n"
 			"            (default UVs ignored)\n"
 			"\n"
-			"    -GenerateNormals [<SmoothingAngle>]\n"
+			"    -GenerateNormals [<SmoothingAngle>] [Weld[:<Distance>]]\n"
 			"        Generate normals from face data within the model.\n"
 			"        SmoothingAngle -  All faces within the smoothing angle of each other are smoothed.\n"
+			"        Weld - Optional. Smooth across verts within <Distance> of each other (default 0 = identical positions),\n"
+			"             e.g. texture or colour seams. Verts are not merged.\n"
+			"\n"
+			"    -OptimiseMesh [<CacheSize>] [Meshlets]\n"
+			"        Reorder faces and verts for GPU vertex cache, overdraw, and vertex fetch efficiency.\n"
+			"        <CacheSize> - The vertex cache size to optimise for (default 16).\n"
+			"        Meshlets - Optional. Split triangle list nuggets into meshlets of at most 64 verts and 124 faces.\n"
+			"\n"
+			"    -Simplify [<LodCount>:<Ratio>:<MaxError>:<MemoryBudget>] [LockBorder]\n"
+			"        Generate a chain of reduced detail meshes (LODs) using quadric error edge collapses.\n"
+			"        UV/normal seams and material boundaries are preserved.\n"
+			"        Parameters can be omitted, in which case defaults are used. e.g.  -Simplify 6::0.01\n"
+			"        <LodCount> - The maximum number of LODs to generate (default 4).\n"
+			"        <Ratio> - The face count of each LOD as a fraction of the previous LOD (default 0.5).\n"
+			"        <MaxError> - The maximum object space error of any LOD (default unlimited).\n"
+			"        <MemoryBudget> - Stop once a LOD is smaller than this many bytes (default unlimited).\n"
+			"        LockBorder - Optional. Don't simplify open borders of the mesh.\n"
 			"\n"
 			"    -Transform <o2w>\n"
 			"        Apply a transform to the model.\n"
@@ -203,11 +222,48 @@ struct Main
 							for (; arg != arg_end && !IsOption(*arg); ++arg)
 							{
 								if (int i; str::ExtractIntC(i, 10, arg->c_str())) { ss << "*SmoothingAngle {" << i << "}"; continue; }
+								if (str::EqualI(*arg, "weld")) { ss << "*WeldDistance {0}"; continue; }
+								if (str::EqualNI(*arg, "weld:", 5)) { ss << "*WeldDistance {" << Narrow(arg->substr(5)) << "}"; continue; }
 								throw std::runtime_error(FmtS("GenerateNormals - unknown argument:  %s", arg->c_str()));
 							}
 							ss << "}\n";
 							break;
 						}
+						if (str::EqualI(option, "-OptimiseMesh"))
+						{
+							ss << "*OptimiseMesh {";
+							for (; arg != arg_end && !IsOption(*arg); ++arg)
+							{
+								if (int i; str::ExtractIntC(i, 10, arg->c_str())) { ss << "*CacheSize {" << i << "}"; continue; }
+								if (str::EqualI(*arg, "meshlets")) { ss << "*Meshlets"; continue; }
+								throw std::runtime_error(FmtS("OptimiseMesh - unknown argument:  %S", arg->c_str()));
+							}
+							ss << "}\n";
+							break;
+						}
+						if (str::EqualI(option, "-Simplify"))
+						{
+							ss << "*Simplify {";
+							for (; arg != arg_end && !IsOption(*arg); ++arg)
+							{
+								if (str::EqualI(*arg, "lockborder")) { ss << "*LockBorder"; continue; }
+
+								int field = 0;
+								str::Split(*arg, ":", [&](auto sub, int)
+								{
+									switch (field++)
+									{
+										case 0: if (!sub.empty()) ss << "*LodCount {" << Narrow(sub) << "}"; break;
+										case 1: if (!sub.empty()) ss << "*Ratio {" << Narrow(sub) << "}"; break;
+										case 2: if (!sub.empty()) ss << "*MaxError {" << Narrow(sub) << "}"; break;
+										case 3: if (!sub.empty()) ss << "*MemoryBudget {" << Narrow(sub) << "}"; break;
+										default: throw std::runtime_error(FmtS("Simplify - too many parameter fields. Expected %d", field - 1));
+									}
+								});
+							}
+							ss << "}\n";
+							break;
+						}
 						if (str::EqualI(option, "-Transform"))
 						{
 							ss << "*Transform {" << Narrow(*arg) << "}\n";
@@ -303,6 +359,16 @@ struct Main
 					GenerateNormals(reader);
 					continue;
 				}
+				if (str::EqualI(kw, "OptimiseMesh"))
+				{
+					OptimiseMesh(reader);
+					continue;
+				}
+				if (str::EqualI(kw, "Simplify"))
+				{
+					Simplify(reader);
+					continue;
+				}
 				if (str::EqualI(kw, "Transform"))
 				{
 					Transform(reader);
@@ -514,6 +580,7 @@ struct Main
 			return;
 
 		auto smoothing_angle = 10.0f;
+		auto weld_distance = -1.0f;
 
 		// Read parameters
 		reader.SectionStart();
@@ -524,11 +591,94 @@ struct Main
 				reader.RealS(smoothing_angle);
 				continue;
 			}
+			if (str::EqualI(kw, "WeldDistance"))
+			{
+				reader.RealS(weld_distance);
+				continue;
+			}
 		}
 		reader.SectionEnd();
 
 		// Remove the degenerates
-		GenerateVertNormals(*m_model, smoothing_angle, m_verbosity);
+		GenerateVertNormals(*m_model, smoothing_angle, weld_distance, m_verbosity);
+	}
+
+	// Reorder faces and verts for cache efficiency
+	void OptimiseMesh(script::Reader& reader) const
+	{
+		if (m_model == nullptr)
+			return;
+
+		auto cache_size = 16;
+		auto meshlets = false;
+
+		// Read parameters
+		reader.SectionStart();
+		for (char kw[32]; reader.NextKeywordS(kw);)
+		{
+			if (str::EqualI(kw, "CacheSize"))
+			{
+				reader.IntS(cache_size, 10);
+				continue;
+			}
+			if (str::EqualI(kw, "Meshlets"))
+			{
+				meshlets = true;
+				continue;
+			}
+		}
+		reader.SectionEnd();
+
+		// Optimise the meshes
+		OptimiseForGpu(*m_model, cache_size, meshlets, m_verbosity);
+	}
+
+	// Generate reduced detail LODs for the model
+	void Simplify(script::Reader& reader) const
+	{
+		if (m_model == nullptr)
+			return;
+
+		auto lod_count = 4;
+		auto ratio = 0.5f;
+		auto max_error = std::numeric_limits<float>::max();
+		auto memory_budget = int64_t{};
+		auto lock_border = false;
+
+		// Read parameters
+		reader.SectionStart();
+		for (char kw[32]; reader.NextKeywordS(kw);)
+		{
+			if (str::EqualI(kw, "LodCount"))
+			{
+				reader.IntS(lod_count, 10);
+				continue;
+			}
+			if (str::EqualI(kw, "Ratio"))
+			{
+				reader.RealS(ratio);
+				continue;
+			}
+			if (str::EqualI(kw, "MaxError"))
+			{
+				reader.RealS(max_error);
+				continue;
+			}
+			if (str::EqualI(kw, "MemoryBudget"))
+			{
+				reader.IntS(memory_budget, 10);
+				continue;
+			}
+			if (str::EqualI(kw, "LockBorder"))
+			{
+				lock_border = true;
+				continue;
+			}
+		}
+		reader.SectionEnd();
+
+		// Generate the LOD chains
+		GenerateLods(*m_model, lod_count, ratio, max_error, memory_budget, lock_border, m_verbosity);
 	}
 
 	// Apply a transform to the model